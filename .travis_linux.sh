@@ -42,6 +42,7 @@ cd build
 qmake -v
 qmake CONFIG+=release -spec linux-g++-64 ../VNote.pro
 make -j$(nproc)
+make check
 
 #
 # Pack AppImage using linuxdeployqt
@@ -10,6 +10,7 @@ CONFIG += c++11
 
 SUBDIRS = hoedown \
     peg-highlight \
-    src
+    src \
+    tests
 
 src.depends = hoedown peg-highlight
@@ -4,6 +4,7 @@
 #include <QObject>
 #include <QVector>
 #include <QList>
+#include <QStringList>
 
 #include "vsearchconfig.h"
 
@@ -22,8 +23,21 @@ public:
         m_result.clear();
     }
 
-    virtual void search(const QSharedPointer<VSearchConfig> &p_config,
-                        const QSharedPointer<VSearchResult> &p_result) = 0;
+    // Start to search for @p_result.
+    // Items to search are added via addItems() until finishItems() is called,
+    // so the search could begin before all the items are collected.
+    virtual void start(const QSharedPointer<VSearchConfig> &p_config,
+                       const QSharedPointer<VSearchResult> &p_result) = 0;
+
+    // Items of the same @p_stream are searched in order, while different
+    // streams are served in turn so that a large one could not block others.
+    virtual void addItems(const QStringList &p_items, int p_stream = 0) = 0;
+
+    // Drop the pending items of @p_stream and skip the rest of it.
+    virtual void stopStream(int p_stream) = 0;
+
+    // No more items will be added.
+    virtual void finishItems() = 0;
 
     virtual void stop() = 0;
 
@@ -34,6 +48,9 @@ signals:
 
     void resultItemsAdded(const QList<QSharedPointer<VSearchResultItem> > &p_items);
 
+    // Emitted when another @p_numOfItems items of @p_stream have been searched.
+    void itemsSearched(int p_stream, int p_numOfItems);
+
 protected:
     QSharedPointer<VSearchResult> m_result;
 };
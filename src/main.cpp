@@ -15,6 +15,8 @@
 #include "vsingleinstanceguard.h"
 #include "vconfigmanager.h"
 #include "vpalette.h"
+#include "vsearchbenchmark.h"
+#include "vdirconfigwriter.h"
 
 VConfigManager *g_config;
 
@@ -133,6 +135,20 @@ int main(int argc, char *argv[])
 
     QApplication app(argc, argv);
 
+    // Run the search benchmark without the main window.
+    // Pass "-platform offscreen" to run it without a display.
+    if (VSearchBenchmark::isRequested(app.arguments())) {
+        VConfigManager vconfig;
+        vconfig.initialize();
+        g_config = &vconfig;
+
+        // Create it before any worker thread could read the configs.
+        VDirConfigWriter::getInstance();
+
+        VSearchBenchmark benchmark;
+        return benchmark.run(app.arguments());
+    }
+
     // The file path passed via command line arguments.
     QStringList filePaths = VUtils::filterFilePathsToOpen(app.arguments().mid(1));
 
@@ -151,6 +167,9 @@ int main(int argc, char *argv[])
     vconfig.initialize();
     g_config = &vconfig;
 
+    // Create it before any worker thread could read the configs.
+    VDirConfigWriter::getInstance();
+
     bool checkSSL = true;
 
 #if defined(QT_NO_DEBUG)
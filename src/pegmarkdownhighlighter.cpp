@@ -15,7 +15,8 @@ PegMarkdownHighlighter::PegMarkdownHighlighter(QTextDocument *p_doc)
       m_doc(p_doc),
       m_timeStamp(0),
       m_parser(NULL),
-      m_parserExts(pmh_EXT_NOTES | pmh_EXT_STRIKE | pmh_EXT_FRONTMATTER)
+      m_parserExts(pmh_EXT_NOTES | pmh_EXT_STRIKE | pmh_EXT_FRONTMATTER),
+      m_parseSuspended(false)
 {
 }
 
@@ -187,6 +188,11 @@ void PegMarkdownHighlighter::handleContentsChange(int p_position, int p_charsRem
 
     ++m_timeStamp;
 
+    if (m_parseSuspended) {
+        m_timer->stop();
+        return;
+    }
+
     startFastParse(p_position, p_charsRemoved, p_charsAdded);
 
     // We still need a timer to start a complete parse.
@@ -36,6 +36,10 @@ public:
     // Parse and only update the highlight results for rehighlight().
     void updateHighlightFast();
 
+    // Do not parse on contents change, such as while a large document is
+    // being loaded. Call updateHighlight() after resuming.
+    void setParseSuspended(bool p_suspended);
+
     QHash<QString, QTextCharFormat> &getCodeBlockStyles();
 
     QVector<HighlightingStyle> &getStyles();
@@ -148,6 +152,8 @@ private:
 
     // Blocks have only one format set which occupies the whole block.
     QSet<int> m_singleFormatBlocks;
+
+    bool m_parseSuspended;
 };
 
 inline const QVector<VElementRegion> &PegMarkdownHighlighter::getHeaderRegions() const
@@ -187,6 +193,11 @@ inline const QVector<HighlightingStyle> &PegMarkdownHighlighter::getStyles() con
     return m_styles;
 }
 
+inline void PegMarkdownHighlighter::setParseSuspended(bool p_suspended)
+{
+    m_parseSuspended = p_suspended;
+}
+
 inline const QTextDocument *PegMarkdownHighlighter::getDocument() const
 {
     return m_doc;
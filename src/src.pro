@@ -116,6 +116,7 @@ SOURCES += main.cpp\
     vsearcher.cpp \
     vsearch.cpp \
     vsearchresulttree.cpp \
+    vsearchresultmodel.cpp \
     vsearchengine.cpp \
     vuniversalentry.cpp \
     vlistwidgetdoublerows.cpp \
@@ -142,7 +143,25 @@ SOURCES += main.cpp\
     vtagexplorer.cpp \
     pegmarkdownhighlighter.cpp \
     pegparser.cpp \
-    peghighlighterresult.cpp
+    peghighlighterresult.cpp \
+    vnotebookmanifest.cpp \
+    utils/vfuzzymatcher.cpp \
+    vsearchbenchmark.cpp \
+    vfilemetacache.cpp \
+    utils/vchunkedlinereader.cpp \
+    vdirconfigwriter.cpp \
+    vdirconfigcache.cpp \
+    vnotebookloader.cpp \
+    vdirconfigprefetcher.cpp \
+    vfilewatcher.cpp \
+    utils/vstringpool.cpp \
+    utils/vcopyengine.cpp \
+    vfilesaver.cpp \
+    utils/veditjournal.cpp \
+    vresourceindex.cpp \
+    utils/vblocksizetree.cpp \
+    vimagedecoder.cpp \
+    vsearchtraverser.cpp
 
 HEADERS  += vmainwindow.h \
     vdirectorytree.h \
@@ -246,6 +265,7 @@ HEADERS  += vmainwindow.h \
     vsearcher.h \
     vsearch.h \
     vsearchresulttree.h \
+    vsearchresultmodel.h \
     isearchengine.h \
     vsearchconfig.h \
     vsearchengine.h \
@@ -279,7 +299,25 @@ HEADERS  += vmainwindow.h \
     markdownhighlighterdata.h \
     pegmarkdownhighlighter.h \
     pegparser.h \
-    peghighlighterresult.h
+    peghighlighterresult.h \
+    vnotebookmanifest.h \
+    utils/vfuzzymatcher.h \
+    vsearchbenchmark.h \
+    vfilemetacache.h \
+    utils/vchunkedlinereader.h \
+    vdirconfigwriter.h \
+    vdirconfigcache.h \
+    vnotebookloader.h \
+    vdirconfigprefetcher.h \
+    vfilewatcher.h \
+    utils/vstringpool.h \
+    utils/vcopyengine.h \
+    vfilesaver.h \
+    utils/veditjournal.h \
+    vresourceindex.h \
+    utils/vblocksizetree.h \
+    vimagedecoder.h \
+    vsearchtraverser.h
 
 RESOURCES += \
     vnote.qrc \
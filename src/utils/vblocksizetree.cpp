@@ -0,0 +1,132 @@
+#include "vblocksizetree.h"
+
+VBlockSizeTree::VBlockSizeTree()
+    : m_leaves(1)
+{
+    rebuild();
+}
+
+void VBlockSizeTree::reset(int p_count)
+{
+    m_widths.fill(0, p_count);
+    m_heights.fill(0, p_count);
+    rebuild();
+}
+
+void VBlockSizeTree::insert(int p_index, int p_count)
+{
+    Q_ASSERT(p_index >= 0 && p_index <= count() && p_count >= 0);
+    m_widths.insert(p_index, p_count, 0);
+    m_heights.insert(p_index, p_count, 0);
+    rebuild();
+}
+
+void VBlockSizeTree::remove(int p_index, int p_count)
+{
+    Q_ASSERT(p_index >= 0 && p_count >= 0 && p_index + p_count <= count());
+    m_widths.remove(p_index, p_count);
+    m_heights.remove(p_index, p_count);
+    rebuild();
+}
+
+void VBlockSizeTree::rebuild()
+{
+    int cnt = m_heights.size();
+    m_leaves = 1;
+    while (m_leaves < cnt) {
+        m_leaves <<= 1;
+    }
+
+    m_sumHeights.fill(0, 2 * m_leaves);
+    m_maxWidths.fill(0, 2 * m_leaves);
+    m_maxWidthIndexes.fill(-1, 2 * m_leaves);
+
+    for (int i = 0; i < cnt; ++i) {
+        int node = m_leaves + i;
+        m_sumHeights[node] = m_heights[i];
+        m_maxWidths[node] = m_widths[i];
+        m_maxWidthIndexes[node] = i;
+    }
+
+    for (int node = m_leaves - 1; node > 0; --node) {
+        pull(node);
+    }
+}
+
+void VBlockSizeTree::pull(int p_node)
+{
+    int left = 2 * p_node;
+    int right = left + 1;
+    m_sumHeights[p_node] = m_sumHeights[left] + m_sumHeights[right];
+
+    // Prefer the left one on tie.
+    int pick = left;
+    if (m_maxWidthIndexes[right] != -1
+        && (m_maxWidthIndexes[left] == -1 || m_maxWidths[right] > m_maxWidths[left])) {
+        pick = right;
+    }
+
+    m_maxWidths[p_node] = m_maxWidths[pick];
+    m_maxWidthIndexes[p_node] = m_maxWidthIndexes[pick];
+}
+
+void VBlockSizeTree::setSize(int p_index, qreal p_width, qreal p_height)
+{
+    Q_ASSERT(p_index >= 0 && p_index < count());
+    if (m_widths[p_index] == p_width && m_heights[p_index] == p_height) {
+        return;
+    }
+
+    m_widths[p_index] = p_width;
+    m_heights[p_index] = p_height;
+
+    int node = m_leaves + p_index;
+    m_sumHeights[node] = p_height;
+    m_maxWidths[node] = p_width;
+    for (node >>= 1; node > 0; node >>= 1) {
+        pull(node);
+    }
+}
+
+qreal VBlockSizeTree::offset(int p_index) const
+{
+    Q_ASSERT(p_index >= 0 && p_index <= count());
+    if (p_index >= m_leaves) {
+        return totalHeight();
+    }
+
+    // Add up the left siblings on the path to the root.
+    qreal off = 0;
+    for (int node = m_leaves + p_index; node > 1; node >>= 1) {
+        if (node & 1) {
+            off += m_sumHeights[node - 1];
+        }
+    }
+
+    return off;
+}
+
+int VBlockSizeTree::findByOffset(qreal p_y) const
+{
+    if (p_y < 0) {
+        p_y = 0;
+    }
+
+    if (p_y >= totalHeight()) {
+        return -1;
+    }
+
+    int node = 1;
+    while (node < m_leaves) {
+        int left = 2 * node;
+        if (m_sumHeights[left] > p_y) {
+            node = left;
+        } else {
+            p_y -= m_sumHeights[left];
+            node = left + 1;
+        }
+    }
+
+    int idx = node - m_leaves;
+    return idx < count() ? idx : count() - 1;
+}
@@ -0,0 +1,98 @@
+#ifndef VBLOCKSIZETREE_H
+#define VBLOCKSIZETREE_H
+
+#include <QVector>
+
+
+// Segment tree over the sizes of a sequence of blocks.
+// Each node holds the total height and the maximum width of its range, so the
+// offset of a block, the block at a given offset, and the size of the whole
+// sequence are all got in O(log N) after a size update in O(log N).
+// Inserting or removing blocks rebuilds the tree in O(N), which is done only
+// when the block count changes.
+class VBlockSizeTree
+{
+public:
+    VBlockSizeTree();
+
+    // Reset to @p_count blocks of zero size.
+    void reset(int p_count);
+
+    // Insert @p_count blocks of zero size before block @p_index.
+    void insert(int p_index, int p_count);
+
+    // Remove @p_count blocks from block @p_index.
+    void remove(int p_index, int p_count);
+
+    void setSize(int p_index, qreal p_width, qreal p_height);
+
+    qreal height(int p_index) const;
+
+    // Total height of the blocks before block @p_index.
+    qreal offset(int p_index) const;
+
+    // Return the first block whose bottom is below @p_y, which is the block
+    // containing @p_y if there is one. Blocks of zero height are skipped.
+    // Returns -1 if @p_y is not above the bottom of the last block.
+    int findByOffset(qreal p_y) const;
+
+    // Total height of all the blocks.
+    qreal totalHeight() const;
+
+    qreal maximumWidth() const;
+
+    // The first block with the maximum width, or -1 if there is no block.
+    int maximumWidthIndex() const;
+
+    int count() const;
+
+private:
+    // Rebuild the tree from m_widths and m_heights.
+    void rebuild();
+
+    // Recompute internal node @p_node from its children.
+    void pull(int p_node);
+
+    // Number of leaves, a power of two.
+    int m_leaves;
+
+    // Sizes of the blocks.
+    QVector<qreal> m_widths;
+
+    QVector<qreal> m_heights;
+
+    // Node i has children 2i and 2i+1. Leaves start at m_leaves.
+    QVector<qreal> m_sumHeights;
+
+    QVector<qreal> m_maxWidths;
+
+    // The block of the maximum width of each node, -1 for an empty range.
+    QVector<int> m_maxWidthIndexes;
+};
+
+inline qreal VBlockSizeTree::height(int p_index) const
+{
+    return m_heights[p_index];
+}
+
+inline qreal VBlockSizeTree::totalHeight() const
+{
+    return m_sumHeights[1];
+}
+
+inline qreal VBlockSizeTree::maximumWidth() const
+{
+    return m_maxWidths[1];
+}
+
+inline int VBlockSizeTree::maximumWidthIndex() const
+{
+    return m_maxWidthIndexes[1];
+}
+
+inline int VBlockSizeTree::count() const
+{
+    return m_heights.size();
+}
+
+#endif // VBLOCKSIZETREE_H
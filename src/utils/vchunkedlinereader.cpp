@@ -0,0 +1,157 @@
+#include "vchunkedlinereader.h"
+
+#include <QIODevice>
+#include <QTextCodec>
+#include <QTextDecoder>
+
+// Size in bytes of each chunk read from the device.
+#define READ_CHUNK_SIZE (256 * 1024)
+
+// Default max length in chars of a line.
+#define DEFAULT_MAX_LINE_LENGTH (64 * 1024)
+
+VChunkedLineReader::VChunkedLineReader(QIODevice *p_device, QTextCodec *p_codec)
+    : m_device(p_device),
+      m_decoder(p_codec->makeDecoder()),
+      m_pos(0),
+      m_deviceEnd(false),
+      m_maxLineLength(DEFAULT_MAX_LINE_LENGTH),
+      m_overlap(0),
+      m_lineNumber(0),
+      m_inLongLine(false),
+      m_column(0),
+      m_nextColumn(0)
+{
+}
+
+VChunkedLineReader::VChunkedLineReader(const QString &p_content)
+    : m_device(NULL),
+      m_decoder(NULL),
+      m_buffer(p_content),
+      m_pos(0),
+      m_deviceEnd(true),
+      m_maxLineLength(DEFAULT_MAX_LINE_LENGTH),
+      m_overlap(0),
+      m_lineNumber(0),
+      m_inLongLine(false),
+      m_column(0),
+      m_nextColumn(0)
+{
+}
+
+VChunkedLineReader::~VChunkedLineReader()
+{
+    delete m_decoder;
+}
+
+void VChunkedLineReader::setMaxLineLength(int p_maxLength, int p_overlap)
+{
+    Q_ASSERT(p_maxLength > 0 && p_overlap >= 0 && p_overlap < p_maxLength);
+    m_maxLineLength = p_maxLength;
+    m_overlap = p_overlap;
+}
+
+// Return the index of the first '\n' or '\r' in [@p_from, @p_to) of @p_str, or -1.
+static int indexOfEol(const QString &p_str, int p_from, int p_to)
+{
+    const QChar *data = p_str.constData();
+    for (int i = p_from; i < p_to; ++i) {
+        ushort uc = data[i].unicode();
+        if (uc == '\n' || uc == '\r') {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool VChunkedLineReader::readLine(QString &p_line, int &p_lineNumber)
+{
+    while (true) {
+        int avail = m_buffer.size() - m_pos;
+        int idx = indexOfEol(m_buffer, m_pos, qMin(m_buffer.size(), m_pos + m_maxLineLength + 1));
+        if (idx != -1) {
+            // A line ends with "\n", "\r\n", or "\r".
+            int eolLength = 1;
+            if (m_buffer.at(idx) == QChar('\r')) {
+                if (idx + 1 == m_buffer.size() && fillBuffer()) {
+                    // Read more to tell whether it is followed by '\n'.
+                    continue;
+                }
+
+                if (idx + 1 < m_buffer.size() && m_buffer.at(idx + 1) == QChar('\n')) {
+                    eolLength = 2;
+                }
+            }
+
+            p_line = m_buffer.mid(m_pos, idx - m_pos);
+            m_pos = idx + eolLength;
+            break;
+        }
+
+        if (avail > m_maxLineLength) {
+            // A long line. Return a segment and keep the overlap for next one.
+            p_line = m_buffer.mid(m_pos, m_maxLineLength);
+            m_pos += m_maxLineLength - m_overlap;
+            p_lineNumber = m_inLongLine ? m_lineNumber : ++m_lineNumber;
+            m_column = m_inLongLine ? m_nextColumn : 0;
+            m_nextColumn = m_column + m_maxLineLength - m_overlap;
+            m_inLongLine = true;
+            return true;
+        }
+
+        if (!fillBuffer()) {
+            if (avail == 0) {
+                // The last line ends with a new line.
+                return false;
+            }
+
+            // The last line without a new line.
+            p_line = m_buffer.mid(m_pos);
+            m_pos = m_buffer.size();
+            break;
+        }
+    }
+
+    p_lineNumber = m_inLongLine ? m_lineNumber : ++m_lineNumber;
+    m_column = m_inLongLine ? m_nextColumn : 0;
+    m_nextColumn = 0;
+    m_inLongLine = false;
+    return true;
+}
+
+bool VChunkedLineReader::atEnd() const
+{
+    if (m_pos < m_buffer.size()) {
+        return false;
+    }
+
+    return m_deviceEnd || m_device->atEnd();
+}
+
+bool VChunkedLineReader::fillBuffer()
+{
+    while (!m_deviceEnd) {
+        QByteArray data = m_device->read(READ_CHUNK_SIZE);
+        if (data.isEmpty()) {
+            m_deviceEnd = true;
+            break;
+        }
+
+        // Drop consumed data. Only the unfinished line is kept.
+        if (m_pos > 0) {
+            m_buffer.remove(0, m_pos);
+            m_pos = 0;
+        }
+
+        int size = m_buffer.size();
+        m_buffer.append(m_decoder->toUnicode(data));
+        if (m_buffer.size() > size) {
+            return true;
+        }
+
+        // Only part of a char is read.
+    }
+
+    return false;
+}
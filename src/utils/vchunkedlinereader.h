@@ -0,0 +1,92 @@
+#ifndef VCHUNKEDLINEREADER_H
+#define VCHUNKEDLINEREADER_H
+
+#include <QString>
+
+class QIODevice;
+class QTextCodec;
+class QTextDecoder;
+
+
+// Read lines from a device in fixed-size chunks, or from a string in memory
+// without copying it, so that only the current window stays in memory.
+// A multi-byte char split by a chunk boundary is handled by the incremental
+// decoder.
+// A line longer than the max line length is returned in several segments with
+// the same line number. Each segment overlaps the previous one by the given
+// overlap, so that a match shorter than the overlap is not split by the
+// boundary.
+class VChunkedLineReader
+{
+public:
+    // Read from @p_device decoded by @p_codec.
+    VChunkedLineReader(QIODevice *p_device, QTextCodec *p_codec);
+
+    // Read from @p_content.
+    explicit VChunkedLineReader(const QString &p_content);
+
+    ~VChunkedLineReader();
+
+    // Should be called before reading.
+    // @p_overlap should be less than @p_maxLength.
+    void setMaxLineLength(int p_maxLength, int p_overlap);
+
+    // Read next line or segment of a long line into @p_line without the
+    // trailing end-of-line characters, which are "\n", "\r\n", or "\r".
+    // @p_lineNumber: 1-based number of the line.
+    // Returns false if there is no more line.
+    bool readLine(QString &p_line, int &p_lineNumber);
+
+    // Offset in chars of the last line or segment read within its line.
+    int column() const;
+
+    // Whether all the content has been read.
+    bool atEnd() const;
+
+    // Number of lines read so far.
+    int lineCount() const;
+
+private:
+    // Read and decode next chunk into m_buffer.
+    // Returns false if there is no more data.
+    bool fillBuffer();
+
+    QIODevice *m_device;
+
+    QTextDecoder *m_decoder;
+
+    // Decoded data. Data before m_pos has been consumed.
+    QString m_buffer;
+
+    int m_pos;
+
+    bool m_deviceEnd;
+
+    int m_maxLineLength;
+
+    int m_overlap;
+
+    // Number of current line.
+    int m_lineNumber;
+
+    // Whether the next segment belongs to current line.
+    bool m_inLongLine;
+
+    // Offset of the last segment read within its line.
+    int m_column;
+
+    // Offset of the next segment of a long line.
+    int m_nextColumn;
+};
+
+inline int VChunkedLineReader::lineCount() const
+{
+    return m_lineNumber;
+}
+
+inline int VChunkedLineReader::column() const
+{
+    return m_column;
+}
+
+#endif // VCHUNKEDLINEREADER_H
@@ -0,0 +1,494 @@
+#include "vcopyengine.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#endif
+
+// Max number of threads to copy files.
+#define MAX_COPY_THREADS 4
+
+// Size in bytes of each chunk in the fallback copy, and of each
+// copy_file_range() call so the copy could be cancelled in time.
+#define COPY_CHUNK_SIZE (4 * 1024 * 1024)
+
+// Interval in ms to report the progress.
+#define PROGRESS_INTERVAL 100
+
+VCopyEngineWorker::VCopyEngineWorker(VCopyEngine *p_engine, QObject *p_parent)
+    : QThread(p_parent),
+      m_engine(p_engine),
+      m_failed(false)
+{
+}
+
+void VCopyEngineWorker::run()
+{
+    VCopyEngine::Job job;
+    while (m_engine->takeJob(job)) {
+        if (!m_engine->copyFile(job.m_srcPath, job.m_destPath)) {
+            if (!m_engine->isCancelled()) {
+                qWarning() << "fail to copy file" << job.m_srcPath << job.m_destPath;
+            }
+
+            m_failed = true;
+
+            // Stop the others since the copy could not be completed anyway.
+            m_engine->cancel();
+            break;
+        }
+    }
+}
+
+
+VCopyEngine::VCopyEngine(QObject *p_parent)
+    : QObject(p_parent),
+      m_totalBytes(0),
+      m_copiedBytes(0),
+      m_cancelled(0),
+      m_processUserInput(false),
+      m_loop(NULL)
+{
+}
+
+VCopyEngine::~VCopyEngine()
+{
+}
+
+void VCopyEngine::setProcessUserInput(bool p_enabled)
+{
+    if (m_processUserInput == p_enabled) {
+        return;
+    }
+
+    m_processUserInput = p_enabled;
+
+    // Run the nested loop again with the new flags.
+    if (m_loop) {
+        m_loop->quit();
+    }
+}
+
+void VCopyEngine::cancel()
+{
+    m_cancelled.store(1);
+}
+
+bool VCopyEngine::copyDirectory(const QString &p_srcDirPath,
+                                const QString &p_destDirPath,
+                                bool p_isCut)
+{
+    QString srcPath = QDir::cleanPath(p_srcDirPath);
+    QString destPath = QDir::cleanPath(p_destDirPath);
+    if (srcPath == destPath) {
+        return true;
+    }
+
+    if (QFileInfo::exists(destPath)) {
+        qWarning() << "target directory already exists" << destPath;
+        return false;
+    }
+
+    m_cancelled.store(0);
+    m_copiedBytes.store(0);
+    m_totalBytes = 0;
+
+    QDir dir;
+    if (!dir.mkpath(QFileInfo(destPath).absolutePath())) {
+        qWarning() << "fail to create parent of target directory" << destPath;
+        return false;
+    }
+
+    // Within the same file system, a move is just a rename.
+    if (p_isCut && dir.rename(srcPath, destPath)) {
+        return true;
+    }
+
+    if (!prepare(srcPath, destPath)) {
+        QDir(destPath).removeRecursively();
+        return false;
+    }
+
+    emit progressChanged(0, m_totalBytes);
+
+    int numThread = qBound(1, QThread::idealThreadCount(), MAX_COPY_THREADS);
+    numThread = qMin(numThread, qMax(m_jobs.size(), 1));
+
+    QEventLoop loop;
+    int finishedWorkers = 0;
+    QList<VCopyEngineWorker *> workers;
+    for (int i = 0; i < numThread; ++i) {
+        VCopyEngineWorker *th = new VCopyEngineWorker(this, this);
+        connect(th, &VCopyEngineWorker::finished,
+                &loop, [&loop, &finishedWorkers, numThread]() {
+                    if (++finishedWorkers == numThread) {
+                        loop.quit();
+                    }
+                });
+
+        workers.append(th);
+        th->start();
+    }
+
+    QTimer timer;
+    timer.setInterval(PROGRESS_INTERVAL);
+    connect(&timer, &QTimer::timeout,
+            this, [this]() {
+                emit progressChanged(m_copiedBytes.load(), m_totalBytes);
+            });
+    timer.start();
+
+    m_loop = &loop;
+    while (finishedWorkers < numThread) {
+        loop.exec(m_processUserInput ? QEventLoop::AllEvents
+                                     : QEventLoop::ExcludeUserInputEvents);
+    }
+
+    m_loop = NULL;
+    timer.stop();
+
+    bool ret = !isCancelled();
+    for (auto th : workers) {
+        th->wait();
+        if (th->hasFailed()) {
+            ret = false;
+        }
+
+        delete th;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_jobs.clear();
+    }
+
+    if (!ret) {
+        qDebug() << "copy of directory cancelled or failed, remove target" << destPath;
+        QDir(destPath).removeRecursively();
+        return false;
+    }
+
+    emit progressChanged(m_totalBytes, m_totalBytes);
+
+    if (p_isCut) {
+        // Never delete the source unless the target is complete.
+        if (!verifyTarget(srcPath, destPath)) {
+            QDir(destPath).removeRecursively();
+            return false;
+        }
+
+        // Delete only what has been copied, so nothing skipped is lost.
+        if (!removeSource(srcPath, destPath)) {
+            qWarning() << "fail to delete source directory after cut" << srcPath;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VCopyEngine::prepare(const QString &p_srcDirPath,
+                          const QString &p_destDirPath)
+{
+    QDir destDir(p_destDirPath);
+    if (!destDir.mkpath(p_destDirPath)) {
+        qWarning() << "fail to create target directory" << p_destDirPath;
+        return false;
+    }
+
+    QDir srcDir(p_srcDirPath);
+    QList<Job> jobs;
+    // Links are not followed into. System is needed for dangling links.
+    QDirIterator it(p_srcDirPath,
+                    QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo fi = it.fileInfo();
+        QString destPath = destDir.filePath(srcDir.relativeFilePath(fi.filePath()));
+        if (fi.isSymLink()) {
+            // Keep relative links relative to the new place.
+            if (!QFile::link(readLinkTarget(fi.filePath()), destPath)) {
+                qWarning() << "fail to create symbolic link" << destPath;
+                return false;
+            }
+        } else if (fi.isDir()) {
+            if (!destDir.mkpath(destPath)) {
+                qWarning() << "fail to create target directory" << destPath;
+                return false;
+            }
+        } else if (fi.isFile()) {
+            Job job;
+            job.m_srcPath = fi.filePath();
+            job.m_destPath = destPath;
+            jobs.append(job);
+
+            m_totalBytes += fi.size();
+        } else {
+            qWarning() << "skip special file" << fi.filePath();
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_jobs = jobs;
+    return true;
+}
+
+bool VCopyEngine::takeJob(Job &p_job)
+{
+    if (isCancelled()) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_jobs.isEmpty()) {
+        return false;
+    }
+
+    p_job = m_jobs.takeFirst();
+    return true;
+}
+
+void VCopyEngine::addCopiedBytes(qint64 p_bytes)
+{
+    m_copiedBytes.fetchAndAddRelaxed(p_bytes);
+}
+
+bool VCopyEngine::copyFile(const QString &p_srcPath, const QString &p_destPath)
+{
+    int ret = copyFileInKernel(p_srcPath, p_destPath);
+    if (ret != 0) {
+        return ret == 1;
+    }
+
+    return copyFileInChunks(p_srcPath, p_destPath);
+}
+
+int VCopyEngine::copyFileInKernel(const QString &p_srcPath, const QString &p_destPath)
+{
+#if defined(Q_OS_LINUX)
+    int srcFd = ::open(QFile::encodeName(p_srcPath).constData(), O_RDONLY | O_CLOEXEC);
+    if (srcFd == -1) {
+        return -1;
+    }
+
+    struct stat st;
+    if (::fstat(srcFd, &st) == -1) {
+        ::close(srcFd);
+        return -1;
+    }
+
+    int destFd = ::open(QFile::encodeName(p_destPath).constData(),
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        st.st_mode & 0777);
+    if (destFd == -1) {
+        ::close(srcFd);
+        return -1;
+    }
+
+    int ret = 0;
+
+#if defined(FICLONE)
+    // Share the data blocks with the source, such as on Btrfs and XFS.
+    if (::ioctl(destFd, FICLONE, srcFd) == 0) {
+        addCopiedBytes(st.st_size);
+        ret = 1;
+    }
+#endif
+
+#if defined(SYS_copy_file_range)
+    if (ret == 0) {
+        // Copy within the kernel, which may also be a server-side copy or a
+        // reflink depending on the file system.
+        qint64 remain = st.st_size;
+        while (remain > 0) {
+            if (isCancelled()) {
+                ret = -1;
+                break;
+            }
+
+            size_t len = (size_t)qMin(remain, (qint64)COPY_CHUNK_SIZE);
+            ssize_t copied = ::syscall(SYS_copy_file_range, srcFd, NULL, destFd, NULL, len, 0);
+            if (copied <= 0) {
+                // Not supported across the file systems, or fails midway.
+                // Fall back only if nothing is copied yet.
+                ret = remain == st.st_size ? 0 : -1;
+                break;
+            }
+
+            remain -= copied;
+            addCopiedBytes(copied);
+        }
+
+        if (remain == 0) {
+            ret = 1;
+        }
+    }
+#endif
+
+    ::close(srcFd);
+    if (::close(destFd) == -1 && ret == 1) {
+        ret = -1;
+    }
+
+    return ret;
+#else
+    Q_UNUSED(p_srcPath);
+    Q_UNUSED(p_destPath);
+    return 0;
+#endif
+}
+
+bool VCopyEngine::copyFileInChunks(const QString &p_srcPath, const QString &p_destPath)
+{
+    QFile srcFile(p_srcPath);
+    if (!srcFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QFile destFile(p_destPath);
+    if (!destFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    while (!srcFile.atEnd()) {
+        if (isCancelled()) {
+            return false;
+        }
+
+        QByteArray data = srcFile.read(COPY_CHUNK_SIZE);
+        if (data.isEmpty()) {
+            break;
+        }
+
+        if (destFile.write(data) != data.size()) {
+            qWarning() << "fail to write file" << p_destPath << destFile.errorString();
+            return false;
+        }
+
+        addCopiedBytes(data.size());
+    }
+
+    if (srcFile.error() != QFileDevice::NoError) {
+        qWarning() << "fail to read file" << p_srcPath << srcFile.errorString();
+        return false;
+    }
+
+    // The buffered tail is written only now, which may fail such as when the
+    // disk is full.
+    if (!destFile.flush()) {
+        qWarning() << "fail to write file" << p_destPath << destFile.errorString();
+        return false;
+    }
+
+    destFile.close();
+    if (destFile.error() != QFileDevice::NoError) {
+        qWarning() << "fail to close file" << p_destPath << destFile.errorString();
+        return false;
+    }
+
+    destFile.setPermissions(srcFile.permissions());
+    return true;
+}
+
+bool VCopyEngine::verifyTarget(const QString &p_srcDirPath,
+                               const QString &p_destDirPath) const
+{
+    QDir srcDir(p_srcDirPath);
+    QDir destDir(p_destDirPath);
+    QDirIterator it(p_srcDirPath,
+                    QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo fi = it.fileInfo();
+        QFileInfo destFi(destDir.filePath(srcDir.relativeFilePath(fi.filePath())));
+        bool matched = true;
+        if (fi.isSymLink()) {
+            matched = destFi.isSymLink()
+                      && readLinkTarget(destFi.filePath()) == readLinkTarget(fi.filePath());
+        } else if (fi.isDir()) {
+            matched = destFi.isDir() && !destFi.isSymLink();
+        } else if (fi.isFile()) {
+            matched = destFi.isFile() && !destFi.isSymLink() && destFi.size() == fi.size();
+        }
+
+        if (!matched) {
+            qWarning() << "target file does not match source" << fi.filePath() << destFi.filePath();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VCopyEngine::removeSource(const QString &p_srcDirPath,
+                               const QString &p_destDirPath) const
+{
+    QDir srcDir(p_srcDirPath);
+    QDir destDir(p_destDirPath);
+    QStringList dirs;
+    bool ret = true;
+    QDirIterator it(p_srcDirPath,
+                    QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo fi = it.fileInfo();
+        if (fi.isDir() && !fi.isSymLink()) {
+            dirs.append(fi.filePath());
+            continue;
+        }
+
+        // Skipped special files, or files added after the verification.
+        QFileInfo destFi(destDir.filePath(srcDir.relativeFilePath(fi.filePath())));
+        if ((!fi.isSymLink() && !fi.isFile())
+            || (!destFi.exists() && !destFi.isSymLink())) {
+            qWarning() << "keep source file not copied" << fi.filePath();
+            ret = false;
+            continue;
+        }
+
+        // Remove the link itself rather than its target.
+        if (!QFile::remove(fi.filePath())) {
+            qWarning() << "fail to delete source file" << fi.filePath();
+            ret = false;
+        }
+    }
+
+    // Children are visited after their parents.
+    dirs.prepend(p_srcDirPath);
+    for (int i = dirs.size() - 1; i >= 0; --i) {
+        if (!srcDir.rmdir(dirs[i])) {
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+QString VCopyEngine::readLinkTarget(const QString &p_linkPath)
+{
+#if defined(Q_OS_LINUX)
+    char buf[PATH_MAX];
+    ssize_t len = ::readlink(QFile::encodeName(p_linkPath).constData(), buf, sizeof(buf));
+    if (len > 0) {
+        return QFile::decodeName(QByteArray(buf, (int)len));
+    }
+#endif
+
+    return QFileInfo(p_linkPath).symLinkTarget();
+}
@@ -0,0 +1,148 @@
+#ifndef VCOPYENGINE_H
+#define VCOPYENGINE_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+class VCopyEngine;
+class QEventLoop;
+
+// Worker copying files from the queue of the engine until there is no more.
+class VCopyEngineWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit VCopyEngineWorker(VCopyEngine *p_engine, QObject *p_parent = nullptr);
+
+    // Whether any file failed to be copied.
+    bool hasFailed() const;
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    VCopyEngine *m_engine;
+
+    bool m_failed;
+};
+
+
+// Copy or move a directory tree in background threads with progress and
+// cancellation.
+// A move within the same file system is a rename. Otherwise, files are copied
+// in parallel. On Linux, each file is cloned as a reflink if the file system
+// supports it, or copied in kernel by copy_file_range(), falling back to a
+// chunked copy. Symbolic links are copied as links. Other special files are
+// skipped and kept in the source after a move. On failure or cancellation,
+// the partial target is removed and the source is left untouched.
+class VCopyEngine : public QObject
+{
+    Q_OBJECT
+
+    friend class VCopyEngineWorker;
+
+public:
+    explicit VCopyEngine(QObject *p_parent = nullptr);
+
+    ~VCopyEngine();
+
+    // Copy or move directory @p_srcDirPath to @p_destDirPath, which should not
+    // exist yet.
+    // Returns after it is done. Non-user-input events are processed meanwhile
+    // so the progress could be shown. User input is processed only if
+    // setProcessUserInput() is enabled.
+    bool copyDirectory(const QString &p_srcDirPath,
+                       const QString &p_destDirPath,
+                       bool p_isCut);
+
+    bool isCancelled() const;
+
+    // Whether to process user input events during the copy.
+    // Should be enabled only when a modal dialog is shown, so the user could do
+    // nothing but cancel the copy, while the callers still hold the folders.
+    // Could be called during the copy, such as once the dialog shows up.
+    void setProcessUserInput(bool p_enabled);
+
+public slots:
+    // Cancel current copy.
+    void cancel();
+
+signals:
+    // Emitted periodically during the copy.
+    void progressChanged(qint64 p_copiedBytes, qint64 p_totalBytes);
+
+private:
+    struct Job
+    {
+        QString m_srcPath;
+
+        QString m_destPath;
+    };
+
+    // Take next file to copy.
+    // Returns false if there is no more or the copy is cancelled.
+    bool takeJob(Job &p_job);
+
+    // Copy file @p_srcPath to @p_destPath, which is created.
+    // Returns false if it fails or is cancelled.
+    bool copyFile(const QString &p_srcPath, const QString &p_destPath);
+
+    // Copy with the file system and kernel help.
+    // Returns 1 if done, 0 if not supported, and -1 if it fails.
+    int copyFileInKernel(const QString &p_srcPath, const QString &p_destPath);
+
+    bool copyFileInChunks(const QString &p_srcPath, const QString &p_destPath);
+
+    // Whether each file in @p_srcDirPath has a copy of the same size in
+    // @p_destDirPath, and each symbolic link a link to the same target.
+    bool verifyTarget(const QString &p_srcDirPath,
+                      const QString &p_destDirPath) const;
+
+    // Delete the files and links of @p_srcDirPath which have been copied to
+    // @p_destDirPath, and then the emptied directories.
+    // Returns false if any entry is left.
+    bool removeSource(const QString &p_srcDirPath,
+                      const QString &p_destDirPath) const;
+
+    // Target of symbolic link @p_linkPath as stored, which may be relative.
+    static QString readLinkTarget(const QString &p_linkPath);
+
+    // Build the target tree and queue the files.
+    bool prepare(const QString &p_srcDirPath,
+                 const QString &p_destDirPath);
+
+    void addCopiedBytes(qint64 p_bytes);
+
+    // Protect m_jobs.
+    QMutex m_mutex;
+
+    QList<Job> m_jobs;
+
+    qint64 m_totalBytes;
+
+    QAtomicInteger<qint64> m_copiedBytes;
+
+    QAtomicInt m_cancelled;
+
+    bool m_processUserInput;
+
+    // Event loop waiting for the workers.
+    QEventLoop *m_loop;
+};
+
+inline bool VCopyEngineWorker::hasFailed() const
+{
+    return m_failed;
+}
+
+inline bool VCopyEngine::isCancelled() const
+{
+    return m_cancelled.load() == 1;
+}
+
+#endif // VCOPYENGINE_H
@@ -0,0 +1,216 @@
+#include "veditjournal.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QtEndian>
+#include <QDebug>
+
+// Changes are compacted into a new snapshot once they are larger than both
+// this size in bytes and the snapshot.
+#define COMPACTION_MIN_SIZE (1024 * 1024)
+
+// Size in bytes of the length and the checksum of a record.
+#define RECORD_LENGTH_SIZE 4
+#define RECORD_CHECKSUM_SIZE 4
+
+static quint32 crc32(const QByteArray &p_data)
+{
+    static quint32 table[256];
+    static bool tableInited = false;
+    if (!tableInited) {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+            }
+
+            table[i] = c;
+        }
+
+        tableInited = true;
+    }
+
+    quint32 crc = 0xFFFFFFFFU;
+    const uchar *data = reinterpret_cast<const uchar *>(p_data.constData());
+    for (int i = 0; i < p_data.size(); ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return crc ^ 0xFFFFFFFFU;
+}
+
+VEditJournal::VEditJournal()
+    : m_snapshotSize(0),
+      m_changesSize(0),
+      m_length(0),
+      m_broken(false)
+{
+}
+
+void VEditJournal::appendRecord(QByteArray &p_data, const QByteArray &p_payload)
+{
+    uchar buf[RECORD_LENGTH_SIZE];
+    qToBigEndian<quint32>(p_payload.size(), buf);
+    p_data.append(reinterpret_cast<const char *>(buf), RECORD_LENGTH_SIZE);
+
+    p_data.append(p_payload);
+
+    qToBigEndian<quint32>(crc32(p_payload), buf);
+    p_data.append(reinterpret_cast<const char *>(buf), RECORD_CHECKSUM_SIZE);
+}
+
+bool VEditJournal::start(const QString &p_filePath,
+                         const QString &p_head,
+                         const QString &p_content)
+{
+    m_filePath = p_filePath;
+    m_buffer.clear();
+    m_changesSize = 0;
+    m_length = p_content.size();
+    m_broken = false;
+
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << (quint8)RecordType::Snapshot << p_content.toUtf8();
+    }
+
+    QByteArray data = p_head.toUtf8() + "\n";
+    appendRecord(data, payload);
+    m_snapshotSize = data.size();
+
+    // Keep the old journal until the new one is complete.
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(data) != data.size()
+        || !file.commit()) {
+        qWarning() << "fail to write journal" << m_filePath;
+        m_broken = true;
+        return false;
+    }
+
+    return true;
+}
+
+void VEditJournal::addChange(int p_position, const QString &p_inserted, int p_newLength)
+{
+    if (m_broken) {
+        return;
+    }
+
+    // The number of chars removed reported by the document may include the
+    // hidden last block separator, so it is derived from the length instead.
+    int removed = m_length + p_inserted.size() - p_newLength;
+    if (p_position < 0 || removed < 0 || p_position + removed > m_length) {
+        qWarning() << "fail to record change in journal" << m_filePath
+                   << p_position << removed << m_length;
+        m_broken = true;
+        return;
+    }
+
+    m_length = p_newLength;
+
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream << (quint8)RecordType::Change
+               << (qint32)p_position
+               << (qint32)removed
+               << p_inserted.toUtf8();
+    }
+
+    int size = m_buffer.size();
+    appendRecord(m_buffer, payload);
+    m_changesSize += m_buffer.size() - size;
+}
+
+bool VEditJournal::flush()
+{
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "fail to open journal" << m_filePath << "to append";
+        return false;
+    }
+
+    if (file.write(m_buffer) != m_buffer.size()) {
+        qWarning() << "fail to append to journal" << m_filePath;
+        // The tail may be torn. Start over with a new snapshot.
+        m_broken = true;
+        return false;
+    }
+
+    m_buffer.clear();
+    return true;
+}
+
+bool VEditJournal::needsCompaction() const
+{
+    return m_broken
+           || m_filePath.isEmpty()
+           || m_changesSize > qMax((qint64)COMPACTION_MIN_SIZE, m_snapshotSize);
+}
+
+bool VEditJournal::replay(const QString &p_filePath, QString &p_content)
+{
+    QFile file(p_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "fail to open journal" << p_filePath;
+        return false;
+    }
+
+    // Skip the head line.
+    file.readLine();
+    const QByteArray data = file.readAll();
+
+    bool hasSnapshot = false;
+    int offset = 0;
+    while (data.size() - offset >= RECORD_LENGTH_SIZE + RECORD_CHECKSUM_SIZE) {
+        const uchar *pos = reinterpret_cast<const uchar *>(data.constData()) + offset;
+        quint32 len = qFromBigEndian<quint32>(pos);
+        if (len > (quint32)(data.size() - offset - RECORD_LENGTH_SIZE - RECORD_CHECKSUM_SIZE)) {
+            qWarning() << "torn record at the end of journal" << p_filePath << offset;
+            break;
+        }
+
+        QByteArray payload = data.mid(offset + RECORD_LENGTH_SIZE, len);
+        quint32 checksum = qFromBigEndian<quint32>(pos + RECORD_LENGTH_SIZE + len);
+        if (checksum != crc32(payload)) {
+            qWarning() << "corrupted record in journal" << p_filePath << offset;
+            break;
+        }
+
+        offset += RECORD_LENGTH_SIZE + len + RECORD_CHECKSUM_SIZE;
+
+        QDataStream stream(payload);
+        quint8 type;
+        stream >> type;
+        if (type == RecordType::Snapshot) {
+            QByteArray text;
+            stream >> text;
+            p_content = QString::fromUtf8(text);
+            hasSnapshot = true;
+        } else if (type == RecordType::Change && hasSnapshot) {
+            qint32 position, removed;
+            QByteArray text;
+            stream >> position >> removed >> text;
+            if (position < 0
+                || removed < 0
+                || position > p_content.size() - removed) {
+                qWarning() << "invalid change in journal" << p_filePath << offset;
+                break;
+            }
+
+            p_content.replace(position, removed, QString::fromUtf8(text));
+        } else {
+            qWarning() << "unknown record in journal" << p_filePath << offset;
+            break;
+        }
+    }
+
+    return hasSnapshot;
+}
@@ -0,0 +1,77 @@
+#ifndef VEDITJOURNAL_H
+#define VEDITJOURNAL_H
+
+#include <QString>
+#include <QByteArray>
+
+// Append-only journal of the edits to a note for crash recovery.
+// The journal file starts with a text head line, followed by records. The
+// first record is a snapshot of the content, and each of the rest is a change
+// of position, number of chars removed, and text inserted. Each record carries
+// a CRC-32 checksum, so a torn record at the end is detected and dropped on
+// replay.
+// Changes are kept in memory until flush(). Once the changes outgrow the
+// snapshot, the journal should be compacted by start() with a new snapshot.
+class VEditJournal
+{
+public:
+    VEditJournal();
+
+    // Start a new journal in @p_filePath with head line @p_head and snapshot
+    // @p_content, replacing the existing one.
+    bool start(const QString &p_filePath,
+               const QString &p_head,
+               const QString &p_content);
+
+    // Record a change at @p_position, which inserts @p_inserted and makes
+    // the content @p_newLength chars long.
+    void addChange(int p_position, const QString &p_inserted, int p_newLength);
+
+    // Append the recorded changes to the journal file.
+    bool flush();
+
+    // Whether a new snapshot should be started, since the changes have
+    // outgrown the snapshot or could not be recorded.
+    bool needsCompaction() const;
+
+    const QString &getFilePath() const;
+
+    // Read the journal @p_filePath and replay the records into @p_content.
+    // Replay stops at the first broken record.
+    // Returns false if there is no snapshot to replay.
+    static bool replay(const QString &p_filePath, QString &p_content);
+
+private:
+    enum RecordType
+    {
+        Snapshot = 0,
+        Change
+    };
+
+    // Append a record of @p_payload to @p_data.
+    static void appendRecord(QByteArray &p_data, const QByteArray &p_payload);
+
+    QString m_filePath;
+
+    // Records not written to the file yet.
+    QByteArray m_buffer;
+
+    // Size in bytes of the snapshot.
+    qint64 m_snapshotSize;
+
+    // Size in bytes of the changes after the snapshot.
+    qint64 m_changesSize;
+
+    // Length in chars of the content after the recorded changes.
+    int m_length;
+
+    // Whether a change could not be recorded.
+    bool m_broken;
+};
+
+inline const QString &VEditJournal::getFilePath() const
+{
+    return m_filePath;
+}
+
+#endif // VEDITJOURNAL_H
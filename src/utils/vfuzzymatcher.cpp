@@ -0,0 +1,277 @@
+#include "vfuzzymatcher.h"
+
+// Scores of the matcher.
+#define SCORE_MATCH 16
+#define SCORE_GAP_START -3
+#define SCORE_GAP_EXTENSION -1
+
+// Bonus of matching a char right after a delimiter or at the beginning.
+#define BONUS_BOUNDARY 8
+
+// Bonus of matching a non-word char.
+#define BONUS_NON_WORD 8
+
+// Bonus of matching at a camel case or a digit boundary.
+#define BONUS_CAMEL 7
+
+// Minimum bonus of consecutive matches.
+#define BONUS_CONSECUTIVE 4
+
+// Bonus of the first char of the pattern is multiplied.
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+
+// Classes of ASCII chars to avoid querying Unicode properties.
+static const char s_asciiClasses[128] = {
+    // 0x00 - 0x1f: control chars.
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    // ' ' ! " # $ % & ' ( ) * + , - . /
+    1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+    // 0 - 9 : ; < = > ?
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 1, 1, 0, 0, 0, 0,
+    // @ A - O
+    0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    // P - Z [ \ ] ^ _
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 1, 0, 0, 1,
+    // ` a - o
+    0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    // p - z { | } ~ DEL
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 0, 0
+};
+
+// Bit of each ASCII char in the char mask.
+// Letters of both cases share one bit. Non-ASCII chars share bit 63.
+static int asciiBit(int p_char)
+{
+    if (p_char >= 'a' && p_char <= 'z') {
+        return p_char - 'a';
+    } else if (p_char >= 'A' && p_char <= 'Z') {
+        return p_char - 'A';
+    } else if (p_char >= '0' && p_char <= '9') {
+        return 26 + p_char - '0';
+    }
+
+    return 36 + p_char % 27;
+}
+
+// Char mask of each ASCII char.
+static const quint64 *asciiMasks()
+{
+    struct Table
+    {
+        Table()
+        {
+            for (int i = 0; i < 128; ++i) {
+                m_masks[i] = quint64(1) << asciiBit(i);
+            }
+        }
+
+        quint64 m_masks[128];
+    };
+
+    static const Table table;
+    return table.m_masks;
+}
+
+VFuzzyMatcher::VFuzzyMatcher(const QString &p_pattern, Qt::CaseSensitivity p_cs)
+    : m_pattern(p_cs == Qt::CaseInsensitive ? p_pattern.toLower() : p_pattern),
+      m_caseSensitivity(p_cs)
+{
+    m_patternMask = charMask(m_pattern);
+}
+
+quint64 VFuzzyMatcher::charMask(const QString &p_text, quint64 p_stopMask)
+{
+    const quint64 *masks = asciiMasks();
+    const QChar *text = p_text.constData();
+    int size = p_text.size();
+    quint64 mask = 0;
+    for (int i = 0; i < size; ++i) {
+        ushort uc = text[i].unicode();
+        if (uc < 128) {
+            mask |= masks[uc];
+        } else {
+            // A non-ASCII char may be lowered to an ASCII one.
+            ushort lc = text[i].toLower().unicode();
+            mask |= (quint64(1) << 63) | (lc < 128 ? masks[lc] : 0);
+        }
+
+        if (p_stopMask && (mask & p_stopMask) == p_stopMask) {
+            break;
+        }
+    }
+
+    return mask;
+}
+
+int VFuzzyMatcher::score(const QString &p_text) const
+{
+    if (m_pattern.isEmpty()) {
+        return 0;
+    }
+
+    if (p_text.size() < m_pattern.size()) {
+        return -1;
+    }
+
+    if ((charMask(p_text, m_patternMask) & m_patternMask) != m_patternMask) {
+        return -1;
+    }
+
+    int start = 0, end = 0;
+    if (!findRange(p_text, start, end)) {
+        return -1;
+    }
+
+    return qMax(0, scoreRange(p_text, start, end));
+}
+
+bool VFuzzyMatcher::findRange(const QString &p_text, int &p_start, int &p_end) const
+{
+    const QChar *text = p_text.constData();
+    const QChar *pat = m_pattern.constData();
+    int textSize = p_text.size();
+    int patSize = m_pattern.size();
+
+    // Forward scan to find the end of the first occurrence.
+    int pidx = 0;
+    int start = -1;
+    int i = 0;
+    for (; i < textSize; ++i) {
+        if (equalChar(text[i], pat[pidx])) {
+            if (start == -1) {
+                start = i;
+            }
+
+            if (++pidx == patSize) {
+                break;
+            }
+        }
+    }
+
+    if (pidx < patSize) {
+        return false;
+    }
+
+    p_end = i + 1;
+
+    // Backward scan to shrink the start.
+    pidx = patSize - 1;
+    for (i = p_end - 1; i >= start; --i) {
+        if (equalChar(text[i], pat[pidx])) {
+            if (--pidx < 0) {
+                break;
+            }
+        }
+    }
+
+    p_start = i;
+    return true;
+}
+
+int VFuzzyMatcher::scoreRange(const QString &p_text, int p_start, int p_end) const
+{
+    const QChar *text = p_text.constData();
+    const QChar *pat = m_pattern.constData();
+
+    int score = 0;
+    int pidx = 0;
+    bool inGap = false;
+    int consecutive = 0;
+    int firstBonus = 0;
+    CharClass prevClass = p_start > 0 ? charClass(text[p_start - 1]) : Delimiter;
+    for (int i = p_start; i < p_end; ++i) {
+        CharClass cls = charClass(text[i]);
+        if (pidx < m_pattern.size() && equalChar(text[i], pat[pidx])) {
+            score += SCORE_MATCH;
+            int bonus = bonusOf(prevClass, cls);
+            if (consecutive == 0) {
+                firstBonus = bonus;
+            } else {
+                // Keep the bonus of the first char of a chunk.
+                if (bonus == BONUS_BOUNDARY) {
+                    firstBonus = bonus;
+                }
+
+                bonus = qMax(qMax(bonus, firstBonus), BONUS_CONSECUTIVE);
+            }
+
+            if (pidx == 0) {
+                score += bonus * BONUS_FIRST_CHAR_MULTIPLIER;
+            } else {
+                score += bonus;
+            }
+
+            inGap = false;
+            ++consecutive;
+            ++pidx;
+        } else {
+            score += inGap ? SCORE_GAP_EXTENSION : SCORE_GAP_START;
+            inGap = true;
+            consecutive = 0;
+            firstBonus = 0;
+        }
+
+        prevClass = cls;
+    }
+
+    return score;
+}
+
+bool VFuzzyMatcher::equalChar(QChar p_char, QChar p_patternChar) const
+{
+    if (p_char == p_patternChar) {
+        return true;
+    }
+
+    if (m_caseSensitivity == Qt::CaseSensitive) {
+        return false;
+    }
+
+    ushort uc = p_char.unicode();
+    if (uc < 128) {
+        return uc >= 'A' && uc <= 'Z' && ushort(uc + ('a' - 'A')) == p_patternChar.unicode();
+    }
+
+    return p_char.toLower() == p_patternChar;
+}
+
+VFuzzyMatcher::CharClass VFuzzyMatcher::charClass(QChar p_char)
+{
+    ushort uc = p_char.unicode();
+    if (uc < 128) {
+        return static_cast<CharClass>(s_asciiClasses[uc]);
+    }
+
+    if (p_char.isLower()) {
+        return Lower;
+    } else if (p_char.isUpper()) {
+        return Upper;
+    } else if (p_char.isLetter()) {
+        return Letter;
+    } else if (p_char.isDigit()) {
+        return Digit;
+    } else if (p_char.isSpace()) {
+        return Delimiter;
+    }
+
+    return NonWord;
+}
+
+int VFuzzyMatcher::bonusOf(CharClass p_prevClass, CharClass p_class)
+{
+    if (p_class == NonWord || p_class == Delimiter) {
+        return BONUS_NON_WORD;
+    }
+
+    if (p_prevClass == Delimiter || p_prevClass == NonWord) {
+        return BONUS_BOUNDARY;
+    }
+
+    if ((p_prevClass == Lower && p_class == Upper)
+        || (p_prevClass != Digit && p_class == Digit)) {
+        return BONUS_CAMEL;
+    }
+
+    return 0;
+}
@@ -0,0 +1,189 @@
+#ifndef VFUZZYMATCHER_H
+#define VFUZZYMATCHER_H
+
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <algorithm>
+
+
+// Scored fuzzy matcher.
+// A text matches if it contains all the characters of the pattern in order.
+// The match is scored by how the characters are placed: matches at the
+// beginning of words and consecutive matches are preferred, while gaps are
+// penalized. The higher the score, the better the match.
+class VFuzzyMatcher
+{
+public:
+    VFuzzyMatcher(const QString &p_pattern = QString(),
+                  Qt::CaseSensitivity p_cs = Qt::CaseInsensitive);
+
+    // Return the score of @p_text, or -1 if it does not match.
+    int score(const QString &p_text) const;
+
+    bool matched(const QString &p_text) const;
+
+    const QString &getPattern() const;
+
+private:
+    enum CharClass
+    {
+        NonWord = 0,
+        Delimiter,
+        Lower,
+        Upper,
+        Letter,
+        Digit
+    };
+
+    // Bit set of the chars of @p_text with ASCII letters case folded.
+    // A text could not match if it misses any bit of the pattern, which is
+    // checked with a table lookup per char before the scan comparing chars.
+    // @p_stopMask: stop once all the bits of it are set.
+    static quint64 charMask(const QString &p_text, quint64 p_stopMask = 0);
+
+    // Find the shortest range [p_start, p_end) of @p_text containing the pattern.
+    bool findRange(const QString &p_text, int &p_start, int &p_end) const;
+
+    int scoreRange(const QString &p_text, int p_start, int p_end) const;
+
+    bool equalChar(QChar p_char, QChar p_patternChar) const;
+
+    static CharClass charClass(QChar p_char);
+
+    // Bonus of matching a char of class @p_class after a char of class @p_prevClass.
+    static int bonusOf(CharClass p_prevClass, CharClass p_class);
+
+    // Lowered if case insensitive.
+    QString m_pattern;
+
+    Qt::CaseSensitivity m_caseSensitivity;
+
+    // Char mask of the pattern.
+    quint64 m_patternMask;
+};
+
+inline bool VFuzzyMatcher::matched(const QString &p_text) const
+{
+    return score(p_text) >= 0;
+}
+
+inline const QString &VFuzzyMatcher::getPattern() const
+{
+    return m_pattern;
+}
+
+
+// Keep the top K values with the highest scores.
+// Values with the same score are kept in the order they are added.
+template <typename T>
+class VTopK
+{
+public:
+    // @p_k: 0 to keep all the values.
+    explicit VTopK(int p_k = 0)
+        : m_k(p_k),
+          m_seq(0)
+    {
+    }
+
+    // Cheap check before constructing the value to add.
+    bool accept(int p_score) const
+    {
+        return m_k <= 0 || m_heap.size() < m_k || p_score > m_heap.front().m_score;
+    }
+
+    void add(int p_score, const T &p_value)
+    {
+        if (!accept(p_score)) {
+            return;
+        }
+
+        if (m_k > 0 && m_heap.size() == m_k) {
+            std::pop_heap(m_heap.begin(), m_heap.end(), &VTopK::better);
+            m_heap.removeLast();
+        }
+
+        m_heap.append(Entry(p_score, m_seq++, p_value));
+        std::push_heap(m_heap.begin(), m_heap.end(), &VTopK::better);
+    }
+
+    int size() const
+    {
+        return m_heap.size();
+    }
+
+    // Return values sorted from the best and clear the selector.
+    QVector<T> takeSorted()
+    {
+        std::sort(m_heap.begin(), m_heap.end(), &VTopK::better);
+
+        QVector<T> values;
+        values.reserve(m_heap.size());
+        for (auto const & it : m_heap) {
+            values.append(it.m_value);
+        }
+
+        m_heap.clear();
+        m_seq = 0;
+        return values;
+    }
+
+    // Return values with their scores sorted from the best and clear the
+    // selector, so they could be merged into another selector.
+    QVector<QPair<int, T> > takeSortedWithScores()
+    {
+        std::sort(m_heap.begin(), m_heap.end(), &VTopK::better);
+
+        QVector<QPair<int, T> > values;
+        values.reserve(m_heap.size());
+        for (auto const & it : m_heap) {
+            values.append(qMakePair(it.m_score, it.m_value));
+        }
+
+        m_heap.clear();
+        m_seq = 0;
+        return values;
+    }
+
+private:
+    struct Entry
+    {
+        Entry()
+            : m_score(0),
+              m_seq(0)
+        {
+        }
+
+        Entry(int p_score, int p_seq, const T &p_value)
+            : m_score(p_score),
+              m_seq(p_seq),
+              m_value(p_value)
+        {
+        }
+
+        int m_score;
+
+        int m_seq;
+
+        T m_value;
+    };
+
+    // Used as the less-than of a heap so the worst one is at the front.
+    static bool better(const Entry &p_a, const Entry &p_b)
+    {
+        if (p_a.m_score != p_b.m_score) {
+            return p_a.m_score > p_b.m_score;
+        }
+
+        return p_a.m_seq < p_b.m_seq;
+    }
+
+    int m_k;
+
+    int m_seq;
+
+    QVector<Entry> m_heap;
+};
+
+#endif // VFUZZYMATCHER_H
@@ -0,0 +1,21 @@
+#include "vstringpool.h"
+
+QMutex VStringPool::s_mutex;
+
+QSet<QString> VStringPool::s_strings;
+
+QString VStringPool::intern(const QString &p_str)
+{
+    if (p_str.isEmpty()) {
+        return QString();
+    }
+
+    QMutexLocker locker(&s_mutex);
+    auto it = s_strings.constFind(p_str);
+    if (it != s_strings.constEnd()) {
+        return *it;
+    }
+
+    s_strings.insert(p_str);
+    return p_str;
+}
@@ -0,0 +1,26 @@
+#ifndef VSTRINGPOOL_H
+#define VSTRINGPOOL_H
+
+#include <QString>
+#include <QSet>
+#include <QMutex>
+
+
+// Pool of strings repeated across many notes, such as tags.
+// Interned strings share the same data, so each distinct string is stored
+// only once however many notes refer to it.
+class VStringPool
+{
+public:
+    // Return the pooled string equal to @p_str.
+    static QString intern(const QString &p_str);
+
+private:
+    VStringPool() {}
+
+    static QMutex s_mutex;
+
+    static QSet<QString> s_strings;
+};
+
+#endif // VSTRINGPOOL_H
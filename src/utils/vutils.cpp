@@ -269,6 +269,72 @@ QVector<ImageLink> VUtils::fetchImagesFromMarkdownFile(VFile *p_file,
     return images;
 }
 
+// Add the path of @p_url to @p_paths if it is an existing local file.
+static void addLocalImagePath(QStringList &p_paths,
+                              QSet<QString> &p_fetchedUrls,
+                              const QString &p_basePath,
+                              const QString &p_url)
+{
+    if (p_url.isEmpty() || p_fetchedUrls.contains(p_url)) {
+        return;
+    }
+
+    p_fetchedUrls.insert(p_url);
+
+    QFileInfo info(p_basePath, p_url);
+    if (!info.exists()) {
+        // The URL may be percent-encoded.
+        info = QFileInfo(p_basePath, QUrl::fromPercentEncoding(p_url.toUtf8()));
+        if (!info.exists()) {
+            return;
+        }
+    }
+
+    if (info.isNativePath() && info.isFile()) {
+        p_paths.append(QDir::cleanPath(info.absoluteFilePath()));
+    }
+}
+
+QStringList VUtils::fetchLocalImagePathsFromText(const QString &p_text,
+                                                 const QString &p_basePath,
+                                                 bool p_isMarkdown)
+{
+    QStringList paths;
+    if (p_text.isEmpty()) {
+        return paths;
+    }
+
+    QSet<QString> fetchedUrls;
+
+    if (p_isMarkdown) {
+        QVector<VElementRegion> regions = fetchImageRegionsUsingParser(p_text);
+        QRegExp regExp(c_imageLinkRegExp);
+        for (auto const & reg : regions) {
+            QString linkText = p_text.mid(reg.m_startPos, reg.m_endPos - reg.m_startPos);
+            if (regExp.exactMatch(linkText)) {
+                addLocalImagePath(paths, fetchedUrls, p_basePath, regExp.capturedTexts()[2].trimmed());
+            }
+        }
+
+        // Image links with reference format refer to the definitions.
+        QRegExp refRegExp("(?:^|\\n)\\s{0,3}\\[[^\\]\\n]+\\]:\\s*<?([^\\s>]+)>?");
+        int pos = 0;
+        while ((pos = refRegExp.indexIn(p_text, pos)) != -1) {
+            addLocalImagePath(paths, fetchedUrls, p_basePath, refRegExp.cap(1));
+            pos += refRegExp.matchedLength();
+        }
+    }
+
+    QRegExp imgRegExp("<img\\s[^>]*src\\s*=\\s*[\"']([^\"']+)[\"']", Qt::CaseInsensitive);
+    int pos = 0;
+    while ((pos = imgRegExp.indexIn(p_text, pos)) != -1) {
+        addLocalImagePath(paths, fetchedUrls, p_basePath, imgRegExp.cap(1));
+        pos += imgRegExp.matchedLength();
+    }
+
+    return paths;
+}
+
 QString VUtils::imageLinkUrlToPath(const QString &p_basePath, const QString &p_url)
 {
     QString path;
@@ -128,6 +128,15 @@ public:
     static QVector<ImageLink> fetchImagesFromMarkdownFile(VFile *p_file,
                                                           ImageLink::ImageLinkType p_type = ImageLink::All);
 
+    // Fetch the cleaned absolute paths of existing local images linked in note
+    // content @p_text, whose relative links are based on @p_basePath.
+    // Markdown image links and reference definitions are parsed if
+    // @p_isMarkdown is true. HTML <img> tags are always parsed.
+    // Could be called in non-GUI threads.
+    static QStringList fetchLocalImagePathsFromText(const QString &p_text,
+                                                    const QString &p_basePath,
+                                                    bool p_isMarkdown);
+
     // Return the absolute path of @p_url according to @p_basePath.
     static QString imageLinkUrlToPath(const QString &p_basePath, const QString &p_url);
 
@@ -10,6 +10,8 @@
 #include <QStandardPaths>
 #include <QCoreApplication>
 #include "utils/vutils.h"
+#include "vdirconfigwriter.h"
+#include "vdirconfigcache.h"
 #include "vstyleparser.h"
 #include "vpalette.h"
 
@@ -39,6 +41,8 @@ const QString VConfigManager::c_templateConfigFolder = QString("templates");
 
 const QString VConfigManager::c_snippetConfigFolder = QString("snippets");
 
+const QString VConfigManager::c_cacheFolder = QString("cache");
+
 const QString VConfigManager::c_warningTextStyle = QString("color: #C9302C; font: bold");
 
 const QString VConfigManager::c_dataTextStyle = QString("font: bold");
@@ -381,8 +385,8 @@ void VConfigManager::readNotebookFromSettings(QSettings *p_settings,
         p_settings->setArrayIndex(i);
         QString name = p_settings->value("name").toString();
         QString path = p_settings->value("path").toString();
+        // The config of notebook will be read by VNotebookLoader in background.
         VNotebook *notebook = new VNotebook(name, path, parent);
-        notebook->readConfigNotebook();
         p_notebooks.append(notebook);
     }
 
@@ -494,6 +498,18 @@ QJsonObject VConfigManager::readDirectoryConfig(const QString &path)
 {
     QString configFile = fetchDirConfigFilePath(path);
 
+    // The config may not be written yet.
+    QJsonObject pendingJson;
+    if (VDirConfigWriter::getInstance()->pendingConfig(configFile, pendingJson)) {
+        return pendingJson;
+    }
+
+    // The config may be read in background already.
+    QJsonObject cachedJson;
+    if (VDirConfigCache::getInstance()->take(path, cachedJson)) {
+        return cachedJson;
+    }
+
     QFile config(configFile);
     if (!config.open(QIODevice::ReadOnly)) {
         qWarning() << "fail to read directory configuration file:"
@@ -507,30 +523,34 @@ QJsonObject VConfigManager::readDirectoryConfig(const QString &path)
 
 bool VConfigManager::directoryConfigExist(const QString &path)
 {
-     return QFileInfo::exists(fetchDirConfigFilePath(path));
+    QString configFile = fetchDirConfigFilePath(path);
+    QJsonObject pendingJson;
+    return VDirConfigWriter::getInstance()->pendingConfig(configFile, pendingJson)
+           || QFileInfo::exists(configFile);
 }
 
-bool VConfigManager::writeDirectoryConfig(const QString &path, const QJsonObject &configJson)
+bool VConfigManager::writeDirectoryConfig(const QString &path,
+                                          const QJsonObject &configJson,
+                                          bool p_later)
 {
-    QString configFile = fetchDirConfigFilePath(path);
+    VDirConfigCache::getInstance()->remove(path);
 
-    QFile config(configFile);
-    // We use Unix LF for config file.
-    if (!config.open(QIODevice::WriteOnly)) {
-        qWarning() << "fail to open directory configuration file for write:"
-                   << configFile;
-        return false;
+    QString configFile = fetchDirConfigFilePath(path);
+    if (p_later) {
+        VDirConfigWriter::getInstance()->write(configFile, configJson);
+        return true;
     }
 
-    QJsonDocument configDoc(configJson);
-    config.write(configDoc.toJson());
-    return true;
+    return VDirConfigWriter::getInstance()->writeNow(configFile, configJson);
 }
 
 bool VConfigManager::deleteDirectoryConfig(const QString &path)
 {
     QString configFile = fetchDirConfigFilePath(path);
 
+    VDirConfigWriter::getInstance()->discard(configFile);
+    VDirConfigCache::getInstance()->remove(path);
+
     QFile config(configFile);
     if (!config.remove()) {
         qWarning() << "fail to delete directory configuration file:"
@@ -801,6 +821,21 @@ const QString &VConfigManager::getSnippetConfigFolder() const
     return path;
 }
 
+const QString &VConfigManager::getCacheFolder() const
+{
+    if (!m_cacheFolder.isEmpty()) {
+        return m_cacheFolder;
+    }
+
+    static QString path = QDir(getConfigFolder()).filePath(c_cacheFolder);
+    return path;
+}
+
+void VConfigManager::setCacheFolder(const QString &p_folder)
+{
+    m_cacheFolder = p_folder;
+}
+
 const QString &VConfigManager::getSnippetConfigFilePath() const
 {
     static QString path = QDir(getSnippetConfigFolder()).filePath(c_snippetConfigFile);
@@ -64,12 +64,21 @@ public:
     // @path is the directory containing the config json file.
     static QJsonObject readDirectoryConfig(const QString &path);
 
-    static bool writeDirectoryConfig(const QString &path, const QJsonObject &configJson);
+    // Write the config synchronously via VDirConfigWriter.
+    // @p_later: write it in background instead, which is visible to
+    // readDirectoryConfig() immediately. Failures are reported by
+    // VDirConfigWriter::writeFailed() then, and true is returned.
+    static bool writeDirectoryConfig(const QString &path,
+                                     const QJsonObject &configJson,
+                                     bool p_later = false);
 
     static bool directoryConfigExist(const QString &path);
 
     static bool deleteDirectoryConfig(const QString &path);
 
+    // Get the path of the directory config file in directory @p_path.
+    static QString fetchDirConfigFilePath(const QString &p_path);
+
     // Get the path of the folder used to store default notebook.
     static QString getVnoteNotebookFolderPath();
 
@@ -417,6 +426,14 @@ public:
 
     const QString &getSnippetConfigFilePath() const;
 
+    // Get the folder c_cacheFolder in the config folder.
+    // Used to store data derived from notebooks which could be rebuilt.
+    const QString &getCacheFolder() const;
+
+    // Use @p_folder as the cache folder instead, such as a scratch folder of
+    // the search benchmark.
+    void setCacheFolder(const QString &p_folder);
+
     // Read all available templates files in c_templateConfigFolder.
     QVector<QString> getNoteTemplates(DocType p_type = DocType::Unknown) const;
 
@@ -484,6 +501,8 @@ public:
 
     bool getEnableWildCardInSimpleSearch() const;
 
+    int getSearchMaxMatchesPerFile() const;
+
     bool getEnableAutoSave() const;
     void setEnableAutoSave(bool p_enabled);
 
@@ -568,8 +587,6 @@ private:
 
     void updateMarkdownEditStyle();
 
-    static QString fetchDirConfigFilePath(const QString &p_path);
-
     // Read the [shortcuts] section in settings to init m_shortcuts.
     // Will remove invalid config items.
     // First read the config in default settings;
@@ -941,6 +958,9 @@ private:
     // Prefix of the name of inserted images.
     QString m_imageNamePrefix;
 
+    // Cache folder set by setCacheFolder().
+    QString m_cacheFolder;
+
     // The name of the config file in each directory.
     static const QString c_dirConfigFile;
 
@@ -981,6 +1001,9 @@ private:
     // The folder name of snippet files.
     static const QString c_snippetConfigFolder;
 
+    // The folder name of cache files.
+    static const QString c_cacheFolder;
+
     // The folder name to store all notebooks if user does not specify one.
     static const QString c_vnoteNotebookFolderName;
 
@@ -2262,6 +2285,12 @@ inline bool VConfigManager::getEnableWildCardInSimpleSearch() const
                                  "enable_wildcard_in_simple_search").toBool();
 }
 
+inline int VConfigManager::getSearchMaxMatchesPerFile() const
+{
+    return getConfigFromSettings("global",
+                                 "search_max_matches_per_file").toInt();
+}
+
 inline bool VConfigManager::getEnableAutoSave() const
 {
     return getConfigFromSettings("global",
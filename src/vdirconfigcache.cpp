@@ -0,0 +1,117 @@
+#include "vdirconfigcache.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QDebug>
+
+#include "vconfigmanager.h"
+
+// Max total size in bytes of the cached config files.
+// Parsed JSON takes several times the size of the file.
+#define MAX_CACHED_SIZE (8 * 1024 * 1024)
+
+VDirConfigCache::VDirConfigCache()
+    : m_nextSeq(0),
+      m_totalSize(0)
+{
+}
+
+VDirConfigCache *VDirConfigCache::getInstance()
+{
+    static VDirConfigCache s_cache;
+    return &s_cache;
+}
+
+QJsonObject VDirConfigCache::prefetch(const QString &p_path)
+{
+    QString configFile = VConfigManager::fetchDirConfigFilePath(p_path);
+
+    QFileInfo fi(configFile);
+    Entry entry;
+    entry.m_modifiedTime = fi.lastModified().toMSecsSinceEpoch();
+    entry.m_size = fi.size();
+
+    QFile file(configFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "fail to prefetch directory configuration file:" << configFile;
+        return QJsonObject();
+    }
+
+    entry.m_json = QJsonDocument::fromJson(file.readAll()).object();
+    if (entry.m_json.isEmpty()) {
+        return entry.m_json;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(p_path);
+    if (it != m_entries.end()) {
+        removeEntry(it);
+    }
+
+    entry.m_seq = m_nextSeq++;
+    m_entries.insert(p_path, entry);
+    m_order.insert(entry.m_seq, p_path);
+    m_totalSize += entry.m_size;
+
+    // Drop the oldest ones.
+    while (m_totalSize > MAX_CACHED_SIZE && m_entries.size() > 1) {
+        removeEntry(m_entries.find(m_order.first()));
+    }
+
+    return entry.m_json;
+}
+
+bool VDirConfigCache::take(const QString &p_path, QJsonObject &p_json)
+{
+    Entry entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_entries.find(p_path);
+        if (it == m_entries.end()) {
+            return false;
+        }
+
+        entry = it.value();
+        removeEntry(it);
+    }
+
+    QFileInfo fi(VConfigManager::fetchDirConfigFilePath(p_path));
+    if (fi.lastModified().toMSecsSinceEpoch() != entry.m_modifiedTime
+        || fi.size() != entry.m_size) {
+        qDebug() << "prefetched directory configuration is obsolete" << p_path;
+        return false;
+    }
+
+    p_json = entry.m_json;
+    return true;
+}
+
+bool VDirConfigCache::peek(const QString &p_path, QJsonObject &p_json) const
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.constFind(p_path);
+    if (it == m_entries.constEnd()) {
+        return false;
+    }
+
+    p_json = it->m_json;
+    return true;
+}
+
+void VDirConfigCache::remove(const QString &p_path)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_entries.find(p_path);
+    if (it != m_entries.end()) {
+        removeEntry(it);
+    }
+}
+
+void VDirConfigCache::removeEntry(QHash<QString, Entry>::iterator p_it)
+{
+    m_order.remove(p_it->m_seq);
+    m_totalSize -= p_it->m_size;
+    m_entries.erase(p_it);
+}
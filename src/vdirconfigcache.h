@@ -0,0 +1,70 @@
+#ifndef VDIRCONFIGCACHE_H
+#define VDIRCONFIGCACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QMap>
+#include <QJsonObject>
+#include <QMutex>
+
+
+// Parsed directory configs read ahead of use in background, keyed by the path
+// of the directory.
+// An entry is used only once and only if the config file does not change since
+// it was read. The oldest entries are dropped once the cache exceeds its memory
+// budget.
+// Thread-safe.
+class VDirConfigCache
+{
+public:
+    static VDirConfigCache *getInstance();
+
+    // Read and parse the config of directory @p_path into the cache.
+    // Returns the config, or an empty object if it fails.
+    QJsonObject prefetch(const QString &p_path);
+
+    // Take the cached config of directory @p_path out.
+    // Returns false if there is no valid one.
+    bool take(const QString &p_path, QJsonObject &p_json);
+
+    // Get the cached config of directory @p_path without taking it out.
+    // Returns false if there is none.
+    bool peek(const QString &p_path, QJsonObject &p_json) const;
+
+    // Drop the cached config of directory @p_path, such as after it is written.
+    void remove(const QString &p_path);
+
+private:
+    struct Entry
+    {
+        QJsonObject m_json;
+
+        // Of the config file when it was read.
+        qint64 m_modifiedTime;
+
+        qint64 m_size;
+
+        // Sequence number in m_order.
+        qint64 m_seq;
+    };
+
+    VDirConfigCache();
+
+    // Remove entry @p_it and update the budget.
+    // Should be called with m_mutex locked.
+    void removeEntry(QHash<QString, Entry>::iterator p_it);
+
+    mutable QMutex m_mutex;
+
+    QHash<QString, Entry> m_entries;
+
+    // Path of entries from the oldest to the newest, keyed by sequence number.
+    QMap<qint64, QString> m_order;
+
+    qint64 m_nextSeq;
+
+    // Total size in bytes of the cached config files.
+    qint64 m_totalSize;
+};
+
+#endif // VDIRCONFIGCACHE_H
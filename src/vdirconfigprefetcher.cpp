@@ -0,0 +1,115 @@
+#include "vdirconfigprefetcher.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDebug>
+
+#include "vconstants.h"
+#include "vdirconfigcache.h"
+
+// Max number of directories waiting to be read.
+// The oldest requests are dropped beyond it.
+#define MAX_QUEUED_DIRECTORIES 2000
+
+VDirConfigPrefetcher *VDirConfigPrefetcher::s_instance = NULL;
+
+VDirConfigPrefetcher::VDirConfigPrefetcher(QObject *p_parent)
+    : QThread(p_parent),
+      m_quit(false)
+{
+}
+
+VDirConfigPrefetcher::~VDirConfigPrefetcher()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_queue.clear();
+        m_queueCond.wakeAll();
+    }
+
+    wait();
+
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+}
+
+VDirConfigPrefetcher *VDirConfigPrefetcher::getInstance()
+{
+    if (!s_instance) {
+        s_instance = new VDirConfigPrefetcher(QCoreApplication::instance());
+        s_instance->start(QThread::LowPriority);
+    }
+
+    return s_instance;
+}
+
+void VDirConfigPrefetcher::prefetch(const QStringList &p_paths, int p_depth)
+{
+    if (p_paths.isEmpty() || p_depth < 1) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // Keep the order of @p_paths at the front.
+    for (int i = p_paths.size() - 1; i >= 0; --i) {
+        m_queue.prepend(qMakePair(p_paths[i], p_depth));
+    }
+
+    while (m_queue.size() > MAX_QUEUED_DIRECTORIES) {
+        m_queue.removeLast();
+    }
+
+    m_queueCond.wakeAll();
+}
+
+void VDirConfigPrefetcher::run()
+{
+    VDirConfigCache *cache = VDirConfigCache::getInstance();
+
+    QMutexLocker locker(&m_mutex);
+    while (!m_quit) {
+        if (m_queue.isEmpty()) {
+            m_queueCond.wait(&m_mutex);
+            continue;
+        }
+
+        QPair<QString, int> item = m_queue.takeFirst();
+        locker.unlock();
+
+        // The cache drops the oldest unused configs once it is full, which
+        // are the least likely to be opened since the latest requests are
+        // served first.
+        // A cached config is still walked for its children.
+        QJsonObject json;
+        if (!cache->peek(item.first, json)) {
+            json = cache->prefetch(item.first);
+        }
+
+        QStringList children;
+        if (item.second > 1) {
+            QDir dir(item.first);
+            QJsonArray dirJson = json[DirConfig::c_subDirectories].toArray();
+            for (int i = 0; i < dirJson.size(); ++i) {
+                QString name = dirJson[i].toObject()[DirConfig::c_name].toString();
+                if (!name.isEmpty()) {
+                    children.append(dir.filePath(name));
+                }
+            }
+        }
+
+        locker.relock();
+
+        // Children go after the queued siblings.
+        for (auto const & child : children) {
+            if (m_queue.size() >= MAX_QUEUED_DIRECTORIES) {
+                break;
+            }
+
+            m_queue.append(qMakePair(child, item.second - 1));
+        }
+    }
+}
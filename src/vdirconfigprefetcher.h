@@ -0,0 +1,49 @@
+#ifndef VDIRCONFIGPREFETCHER_H
+#define VDIRCONFIGPREFETCHER_H
+
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QMutex>
+#include <QWaitCondition>
+
+
+// Read the configs of directories ahead of use into VDirConfigCache in a
+// background thread.
+// Directories requested later are served first since they are more likely to
+// be opened soon.
+class VDirConfigPrefetcher : public QThread
+{
+    Q_OBJECT
+public:
+    // Should be called in the main thread first.
+    static VDirConfigPrefetcher *getInstance();
+
+    ~VDirConfigPrefetcher();
+
+    // Read the configs of directories @p_paths and their descendants up to
+    // @p_depth levels (1 for @p_paths only).
+    void prefetch(const QStringList &p_paths, int p_depth);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    explicit VDirConfigPrefetcher(QObject *p_parent = nullptr);
+
+    // Protect all the fields below.
+    QMutex m_mutex;
+
+    QWaitCondition m_queueCond;
+
+    // Pairs of directory path and depth.
+    QList<QPair<QString, int> > m_queue;
+
+    bool m_quit;
+
+    static VDirConfigPrefetcher *s_instance;
+};
+
+#endif // VDIRCONFIGPREFETCHER_H
@@ -0,0 +1,303 @@
+#include "vdirconfigwriter.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QDebug>
+
+// Max delay in ms to write a pending config.
+#define FLUSH_DELAY 1000
+
+VDirConfigWriter *VDirConfigWriter::s_instance = NULL;
+
+VDirConfigWriter::VDirConfigWriter(QObject *p_parent)
+    : QThread(p_parent),
+      m_quit(false)
+{
+}
+
+VDirConfigWriter::~VDirConfigWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_pendingCond.wakeAll();
+    }
+
+    wait();
+
+    if (!flush()) {
+        qWarning() << "fail to write some directory configs on exit";
+    }
+
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+}
+
+VDirConfigWriter *VDirConfigWriter::getInstance()
+{
+    if (!s_instance) {
+        // Flushed on exit with the application.
+        s_instance = new VDirConfigWriter(QCoreApplication::instance());
+        s_instance->start();
+    }
+
+    return s_instance;
+}
+
+void VDirConfigWriter::write(const QString &p_filePath, const QJsonObject &p_json)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pending.isEmpty()) {
+        m_pendingTimer.start();
+    }
+
+    dropOrphans(m_failed);
+    for (auto it = m_failed.constBegin(); it != m_failed.constEnd(); ++it) {
+        if (!m_pending.contains(it.key())) {
+            m_pending.insert(it.key(), it.value());
+        }
+    }
+
+    m_failed.clear();
+
+    m_pending.insert(p_filePath, p_json);
+    m_pendingCond.wakeAll();
+}
+
+bool VDirConfigWriter::writeNow(const QString &p_filePath, const QJsonObject &p_json)
+{
+    QJsonObject pendingJson;
+    bool hasPending = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        // Wait for the writes in progress since the file may be written again.
+        while (m_writing.contains(p_filePath)) {
+            m_writingCond.wait(&m_mutex);
+        }
+
+        auto it = m_pending.find(p_filePath);
+        if (it != m_pending.end()) {
+            pendingJson = it.value();
+            hasPending = true;
+            m_pending.erase(it);
+        } else {
+            it = m_failed.find(p_filePath);
+            if (it != m_failed.end()) {
+                pendingJson = it.value();
+                hasPending = true;
+                m_failed.erase(it);
+            }
+        }
+
+        m_writing.insert(p_filePath, p_json);
+    }
+
+    bool ret = writeConfig(p_filePath, p_json);
+    if (ret) {
+        QFileInfo fi(p_filePath);
+        emit configWritten(p_filePath, fi.lastModified().toMSecsSinceEpoch(), fi.size());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_writing.remove(p_filePath);
+    m_writingCond.wakeAll();
+    m_pendingCond.wakeAll();
+
+    // Keep the older config to write so the caller could roll back to it.
+    if (!ret && hasPending && !m_pending.contains(p_filePath)) {
+        m_pending.insert(p_filePath, pendingJson);
+        if (m_pending.size() == 1) {
+            m_pendingTimer.start();
+        }
+    }
+
+    return ret;
+}
+
+bool VDirConfigWriter::pendingConfig(const QString &p_filePath, QJsonObject &p_json) const
+{
+    QMutexLocker locker(&m_mutex);
+    // From the newest to the oldest.
+    auto it = m_pending.constFind(p_filePath);
+    if (it != m_pending.constEnd()) {
+        p_json = it.value();
+        return true;
+    }
+
+    it = m_writing.constFind(p_filePath);
+    if (it != m_writing.constEnd()) {
+        p_json = it.value();
+        return true;
+    }
+
+    it = m_failed.constFind(p_filePath);
+    if (it != m_failed.constEnd()) {
+        p_json = it.value();
+        return true;
+    }
+
+    return false;
+}
+
+void VDirConfigWriter::discard(const QString &p_filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    // Wait for the writes in progress since the file may be written again.
+    while (m_writing.contains(p_filePath)) {
+        m_writingCond.wait(&m_mutex);
+    }
+
+    m_pending.remove(p_filePath);
+    m_failed.remove(p_filePath);
+}
+
+bool VDirConfigWriter::flush()
+{
+    QHash<QString, QJsonObject> configs;
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!m_writing.isEmpty()) {
+            m_writingCond.wait(&m_mutex);
+        }
+
+        dropOrphans(m_failed);
+        configs = m_failed;
+        m_failed.clear();
+        for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+            configs.insert(it.key(), it.value());
+        }
+
+        m_pending.clear();
+        m_writing = configs;
+    }
+
+    if (configs.isEmpty()) {
+        return true;
+    }
+
+    QHash<QString, QJsonObject> failed = writeConfigs(configs);
+
+    QMutexLocker locker(&m_mutex);
+    removeWriting(configs);
+    m_writingCond.wakeAll();
+
+    // There may be new writes during the flush.
+    m_pendingCond.wakeAll();
+
+    if (failed.isEmpty()) {
+        return true;
+    }
+
+    for (auto it = failed.constBegin(); it != failed.constEnd(); ++it) {
+        if (!m_pending.contains(it.key())) {
+            m_failed.insert(it.key(), it.value());
+        }
+    }
+
+    return false;
+}
+
+void VDirConfigWriter::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_quit) {
+        if (m_pending.isEmpty() || !m_writing.isEmpty()) {
+            m_pendingCond.wait(&m_mutex);
+            continue;
+        }
+
+        qint64 remain = FLUSH_DELAY - m_pendingTimer.elapsed();
+        if (remain > 0) {
+            m_pendingCond.wait(&m_mutex, remain);
+            continue;
+        }
+
+        QHash<QString, QJsonObject> configs = m_pending;
+        m_pending.clear();
+        m_writing = configs;
+
+        locker.unlock();
+        QHash<QString, QJsonObject> failed = writeConfigs(configs);
+        locker.relock();
+
+        removeWriting(configs);
+        m_writingCond.wakeAll();
+
+        for (auto it = failed.constBegin(); it != failed.constEnd(); ++it) {
+            if (!m_pending.contains(it.key())) {
+                m_failed.insert(it.key(), it.value());
+            }
+        }
+
+        if (!failed.isEmpty()) {
+            locker.unlock();
+            for (auto it = failed.constBegin(); it != failed.constEnd(); ++it) {
+                emit writeFailed(it.key());
+            }
+
+            locker.relock();
+        }
+    }
+}
+
+void VDirConfigWriter::removeWriting(const QHash<QString, QJsonObject> &p_configs)
+{
+    // writeNow() may be writing other files meanwhile.
+    for (auto it = p_configs.constBegin(); it != p_configs.constEnd(); ++it) {
+        m_writing.remove(it.key());
+    }
+}
+
+QHash<QString, QJsonObject> VDirConfigWriter::writeConfigs(const QHash<QString, QJsonObject> &p_configs)
+{
+    QHash<QString, QJsonObject> failed;
+    for (auto it = p_configs.constBegin(); it != p_configs.constEnd(); ++it) {
+        if (!writeConfig(it.key(), it.value())) {
+            failed.insert(it.key(), it.value());
+            continue;
+        }
+
+        QFileInfo fi(it.key());
+        emit configWritten(it.key(), fi.lastModified().toMSecsSinceEpoch(), fi.size());
+    }
+
+    return failed;
+}
+
+bool VDirConfigWriter::writeConfig(const QString &p_filePath, const QJsonObject &p_json)
+{
+    // QSaveFile writes to a temporary file, syncs it to disk, and renames it.
+    QSaveFile file(p_filePath);
+    // We use Unix LF for config file.
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open directory configuration file for write:"
+                   << p_filePath;
+        return false;
+    }
+
+    QJsonDocument doc(p_json);
+    if (file.write(doc.toJson()) == -1 || !file.commit()) {
+        qWarning() << "fail to write directory configuration file:"
+                   << p_filePath << file.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+void VDirConfigWriter::dropOrphans(QHash<QString, QJsonObject> &p_configs)
+{
+    for (auto it = p_configs.begin(); it != p_configs.end();) {
+        if (QFileInfo(it.key()).dir().exists()) {
+            ++it;
+        } else {
+            qDebug() << "drop config of directory which no longer exists" << it.key();
+            it = p_configs.erase(it);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef VDIRCONFIGWRITER_H
+#define VDIRCONFIGWRITER_H
+
+#include <QThread>
+#include <QString>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+
+// Write-behind writer of directory configuration files.
+// Writes to the same file are coalesced and flushed by a background thread
+// within a bounded delay after the first pending write. Each file is written
+// to a temporary file, synced to disk, and then renamed over the old one.
+// Pending configs are visible to readers before they are flushed.
+// Structural changes which need to be rolled back on failure should use
+// writeNow() instead.
+class VDirConfigWriter : public QThread
+{
+    Q_OBJECT
+public:
+    // Should be called in the main thread first before any other thread could
+    // call it.
+    static VDirConfigWriter *getInstance();
+
+    ~VDirConfigWriter();
+
+    // Queue @p_json to be written to config file @p_filePath.
+    void write(const QString &p_filePath, const QJsonObject &p_json);
+
+    // Write @p_json to config file @p_filePath in the calling thread,
+    // superseding the pending config of it.
+    // Returns false if it fails, when the pending config is kept.
+    bool writeNow(const QString &p_filePath, const QJsonObject &p_json);
+
+    // Get the config of @p_filePath which has not been written yet.
+    // Returns false if there is none.
+    bool pendingConfig(const QString &p_filePath, QJsonObject &p_json) const;
+
+    // Drop the pending config of @p_filePath.
+    void discard(const QString &p_filePath);
+
+    // Write all the pending configs in the calling thread and wait until done.
+    // Should be called before the directories are moved or deleted.
+    // Returns false if any of them fails.
+    bool flush();
+
+signals:
+    // Emitted in the writing thread when config file @p_filePath is written.
+    // @p_modifiedTime, @p_size: state of the file right after the write.
+    void configWritten(const QString &p_filePath, qint64 p_modifiedTime, qint64 p_size);
+
+    // Emitted in the writer thread when a queued write of config file
+    // @p_filePath fails. It is retried at next write or flush.
+    void writeFailed(const QString &p_filePath);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    explicit VDirConfigWriter(QObject *p_parent = nullptr);
+
+    // Write @p_configs and return the failed ones.
+    QHash<QString, QJsonObject> writeConfigs(const QHash<QString, QJsonObject> &p_configs);
+
+    static bool writeConfig(const QString &p_filePath, const QJsonObject &p_json);
+
+    // Remove @p_configs from m_writing once written. Should be called with
+    // m_mutex held.
+    void removeWriting(const QHash<QString, QJsonObject> &p_configs);
+
+    // Drop the configs in @p_configs whose directory no longer exists, such as
+    // after it is deleted outside.
+    static void dropOrphans(QHash<QString, QJsonObject> &p_configs);
+
+    // Protect all the fields below.
+    mutable QMutex m_mutex;
+
+    // Wake the writer thread.
+    QWaitCondition m_pendingCond;
+
+    // Wake who waits for the writes in progress.
+    QWaitCondition m_writingCond;
+
+    QHash<QString, QJsonObject> m_pending;
+
+    // Configs being written.
+    QHash<QString, QJsonObject> m_writing;
+
+    // Configs failed to write in background. Retried at next write or flush.
+    QHash<QString, QJsonObject> m_failed;
+
+    // Started when m_pending becomes non-empty.
+    QElapsedTimer m_pendingTimer;
+
+    bool m_quit;
+
+    static VDirConfigWriter *s_instance;
+};
+
+#endif // VDIRCONFIGWRITER_H
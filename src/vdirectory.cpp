@@ -2,13 +2,21 @@
 #include <QDir>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QTimer>
 #include <QDebug>
 #include "vconfigmanager.h"
+#include "vdirconfigwriter.h"
+#include "vfilesaver.h"
 #include "vnotefile.h"
+#include "vnotebookmanifest.h"
 #include "utils/vutils.h"
+#include "utils/vcopyengine.h"
 
 extern VConfigManager *g_config;
 
+// Delay in ms to write the config updated by updateFileConfigLater().
+#define FILE_CONFIG_UPDATE_DELAY 500
+
 VDirectory::VDirectory(VNotebook *p_notebook,
                        VDirectory *p_parent,
                        const QString &p_name,
@@ -17,8 +25,10 @@ VDirectory::VDirectory(VNotebook *p_notebook,
       m_notebook(p_notebook),
       m_name(p_name),
       m_opened(false),
+      m_filesLoaded(false),
       m_expanded(false),
-      m_createdTimeUtc(p_createdTimeUtc)
+      m_createdTimeUtc(p_createdTimeUtc),
+      m_configUpdatePending(false)
 {
 }
 
@@ -50,18 +60,34 @@ bool VDirectory::open()
     }
 
     // [files] section
-    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
-    for (int i = 0; i < fileJson.size(); ++i) {
-        QJsonObject fileItem = fileJson[i].toObject();
-        VNoteFile *file = VNoteFile::fromJson(this,
+    // Files are created once used.
+    m_fileEntries = configJson[DirConfig::c_files].toArray();
+    m_filesLoaded = false;
+
+    m_opened = true;
+    return true;
+}
+
+void VDirectory::loadFiles() const
+{
+    if (m_filesLoaded) {
+        return;
+    }
+
+    VDirectory *dir = const_cast<VDirectory *>(this);
+    dir->m_filesLoaded = true;
+
+    dir->m_files.reserve(m_fileEntries.size());
+    for (int i = 0; i < m_fileEntries.size(); ++i) {
+        QJsonObject fileItem = m_fileEntries[i].toObject();
+        VNoteFile *file = VNoteFile::fromJson(dir,
                                               fileItem,
                                               FileType::Note,
                                               true);
-        m_files.append(file);
+        dir->m_files.append(file);
     }
 
-    m_opened = true;
-    return true;
+    dir->m_fileEntries = QJsonArray();
 }
 
 void VDirectory::close()
@@ -77,12 +103,18 @@ void VDirectory::close()
     }
     m_subDirs.clear();
 
+    // Close all the files before deleting any since closing a file may write
+    // the config of them.
     for (int i = 0; i < m_files.size(); ++i) {
-        VNoteFile *file = m_files[i];
-        file->close();
-        delete file;
+        m_files[i]->close();
+    }
+
+    for (int i = 0; i < m_files.size(); ++i) {
+        delete m_files[i];
     }
     m_files.clear();
+    m_fileEntries = QJsonArray();
+    m_filesLoaded = false;
 
     m_opened = false;
 }
@@ -135,12 +167,16 @@ QJsonObject VDirectory::toConfigJson() const
     }
     dirJson[DirConfig::c_subDirectories] = subDirs;
 
-    QJsonArray files;
-    for (int i = 0; i < m_files.size(); ++i) {
-        files.append(m_files[i]->toConfigJson());
-    }
+    if (m_filesLoaded) {
+        QJsonArray files;
+        for (int i = 0; i < m_files.size(); ++i) {
+            files.append(m_files[i]->toConfigJson());
+        }
 
-    dirJson[DirConfig::c_files] = files;
+        dirJson[DirConfig::c_files] = files;
+    } else {
+        dirJson[DirConfig::c_files] = m_fileEntries;
+    }
 
     return dirJson;
 }
@@ -150,7 +186,7 @@ bool VDirectory::readConfig()
     return true;
 }
 
-bool VDirectory::writeToConfig() const
+bool VDirectory::writeToConfig(bool p_later) const
 {
     QJsonObject json = toConfigJson();
 
@@ -160,19 +196,49 @@ bool VDirectory::writeToConfig() const
     }
 
     qDebug() << "folder" << m_name << "write to config" << json;
-    return writeToConfig(json);
+    return writeToConfig(json, p_later);
 }
 
 bool VDirectory::updateFileConfig(const VNoteFile *p_file)
 {
     Q_ASSERT(m_opened);
     Q_UNUSED(p_file);
+    m_configUpdatePending = false;
     return writeToConfig();
 }
 
-bool VDirectory::writeToConfig(const QJsonObject &p_json) const
+void VDirectory::updateFileConfigLater()
+{
+    if (m_configUpdatePending) {
+        return;
+    }
+
+    m_configUpdatePending = true;
+    QTimer::singleShot(FILE_CONFIG_UPDATE_DELAY, this, [this]() {
+                if (!flushFileConfig()) {
+                    qWarning() << "fail to update config of files in directory" << fetchPath();
+                }
+            });
+}
+
+bool VDirectory::flushFileConfig()
+{
+    if (!m_configUpdatePending) {
+        return true;
+    }
+
+    m_configUpdatePending = false;
+    return m_opened ? writeToConfig(true) : true;
+}
+
+bool VDirectory::writeToConfig(const QJsonObject &p_json, bool p_later) const
 {
-    return VConfigManager::writeDirectoryConfig(fetchPath(), p_json);
+    if (!VConfigManager::writeDirectoryConfig(fetchPath(), p_json, p_later)) {
+        return false;
+    }
+
+    m_notebook->updateManifest(fetchRelativePath(), p_json);
+    return true;
 }
 
 void VDirectory::addNotebookConfig(QJsonObject &p_json) const
@@ -261,6 +327,8 @@ VNoteFile *VDirectory::findFile(const QString &p_name, bool p_caseSensitive)
         return NULL;
     }
 
+    loadFiles();
+
     QString name = p_caseSensitive ? p_name : p_name.toLower();
     for (int i = 0; i < m_files.size(); ++i) {
         if (name == (p_caseSensitive ? m_files[i]->getName() : m_files[i]->getName().toLower())) {
@@ -305,6 +373,8 @@ VNoteFile *VDirectory::createFile(const QString &p_name)
 
     file.close();
 
+    loadFiles();
+
     QDateTime dateTime = QDateTime::currentDateTimeUtc();
     VNoteFile *ret = new VNoteFile(this,
                                    p_name,
@@ -331,6 +401,8 @@ bool VDirectory::addFile(VNoteFile *p_file, int p_index)
         return false;
     }
 
+    loadFiles();
+
     if (p_index == -1) {
         m_files.append(p_file);
     } else {
@@ -438,6 +510,10 @@ bool VDirectory::deleteDirectory(bool p_skipRecycleBin, QString *p_errMsg)
     // Delete the entire directory.
     bool ret = true;
     QString dirPath = fetchPath();
+
+    // Write pending configs before the directory is moved away.
+    VDirConfigWriter::getInstance()->flush();
+
     if (!VUtils::deleteDirectory(m_notebook, dirPath, p_skipRecycleBin)) {
         VUtils::addErrMsg(p_errMsg, tr("Fail to delete the directory %1.").arg(dirPath));
         ret = false;
@@ -492,6 +568,7 @@ bool VDirectory::removeFile(VNoteFile *p_file)
     V_ASSERT(m_opened);
     V_ASSERT(p_file);
 
+    loadFiles();
     int index = m_files.indexOf(p_file);
     V_ASSERT(index != -1);
     m_files.remove(index);
@@ -513,6 +590,13 @@ bool VDirectory::rename(const QString &p_name)
 
     VDirectory *parentDir = getParentDirectory();
     V_ASSERT(parentDir);
+    // Write pending notes and configs of the directory and its children first.
+    VFileSaver::getInstance()->flush();
+    if (!VDirConfigWriter::getInstance()->flush()) {
+        qWarning() << "fail to write pending configs before renaming folder" << m_name;
+        return false;
+    }
+
     // Rename it in disk.
     QDir dir(parentDir->fetchPath());
     if (!dir.rename(m_name, p_name)) {
@@ -539,7 +623,8 @@ bool VDirectory::copyDirectory(VDirectory *p_destDir,
                                VDirectory *p_dir,
                                bool p_isCut,
                                VDirectory **p_targetDir,
-                               QString *p_errMsg)
+                               QString *p_errMsg,
+                               VCopyEngine *p_engine)
 {
     bool ret = true;
     *p_targetDir = NULL;
@@ -561,8 +646,24 @@ bool VDirectory::copyDirectory(VDirectory *p_destDir,
 
     Q_ASSERT(paDir->isOpened());
 
+    // Write pending notes and configs before copying the files.
+    VFileSaver::getInstance()->flush();
+    if (!VDirConfigWriter::getInstance()->flush()) {
+        VUtils::addErrMsg(p_errMsg, tr("Fail to write the configuration of some folders."));
+        return false;
+    }
+
     // Copy the directory.
-    if (!VUtils::copyDirectory(srcPath, destPath, p_isCut)) {
+    // The configs inside are copied as is. Only the config of the target
+    // parent folder is written once after the copy.
+    VCopyEngine tmpEngine;
+    VCopyEngine *engine = p_engine ? p_engine : &tmpEngine;
+    if (!engine->copyDirectory(srcPath, destPath, p_isCut)) {
+        if (engine->isCancelled()) {
+            VUtils::addErrMsg(p_errMsg, tr("The %1 of the folder is cancelled.").arg(opStr));
+            return false;
+        }
+
         VUtils::addErrMsg(p_errMsg, tr("Fail to %1 the folder.").arg(opStr));
         qWarning() << "fail to" << opStr << "the folder directory" << srcPath << "to" << destPath;
         return false;
@@ -676,6 +777,7 @@ VDirectory *VDirectory::tryLoadDirectory(QStringList &p_filePath)
 bool VDirectory::sortFiles(const QVector<int> &p_sortedIdx)
 {
     V_ASSERT(m_opened);
+    loadFiles();
     V_ASSERT(p_sortedIdx.size() == m_files.size());
 
     auto ori = m_files;
@@ -718,6 +820,16 @@ bool VDirectory::sortSubDirectories(const QVector<int> &p_sortedIdx)
 QList<QString> VDirectory::collectFiles()
 {
     QList<QString> files;
+
+    // Use the manifest to avoid opening the whole sub-tree.
+    VNotebookManifest *manifest = m_notebook->getManifest();
+    if (manifest) {
+        QString relativePath = fetchRelativePath();
+        if (manifest->findFolder(relativePath)) {
+            return manifest->collectFiles(relativePath);
+        }
+    }
+
     bool opened = isOpened();
     if (!opened && !open()) {
         qWarning() << "fail to open directory" << fetchPath();
@@ -725,8 +837,15 @@ QList<QString> VDirectory::collectFiles()
     }
 
     // Files.
-    for (auto const & file : m_files) {
-        files.append(file->fetchPath());
+    if (m_filesLoaded) {
+        for (auto const & file : m_files) {
+            files.append(file->fetchPath());
+        }
+    } else {
+        QDir dir(fetchPath());
+        for (int i = 0; i < m_fileEntries.size(); ++i) {
+            files.append(dir.filePath(m_fileEntries[i].toObject()[DirConfig::c_name].toString()));
+        }
     }
 
     // Subfolders.
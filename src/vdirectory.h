@@ -6,11 +6,13 @@
 #include <QVector>
 #include <QPointer>
 #include <QJsonObject>
+#include <QJsonArray>
 #include <QDateTime>
 #include "vnotebook.h"
 
 class VFile;
 class VNoteFile;
+class VCopyEngine;
 
 class VDirectory : public QObject
 {
@@ -60,12 +62,15 @@ public:
 
     // Copy @p_dir as a sub-directory of @p_destDir with the new name @p_destName.
     // Return a directory representing the destination directory after copy/cut.
+    // @p_engine: engine to copy the files, which could be used to show the
+    // progress and cancel the copy. NULL to use a temporary one.
     static bool copyDirectory(VDirectory *p_destDir,
                               const QString &p_destName,
                               VDirectory *p_dir,
                               bool p_isCut,
                               VDirectory **p_targetDir,
-                              QString *p_errMsg = NULL);
+                              QString *p_errMsg = NULL,
+                              VCopyEngine *p_engine = NULL);
 
     const QVector<VDirectory *> &getSubDirs() const;
 
@@ -95,11 +100,19 @@ public:
     // Write current instance to config file.
     // If it is root directory, this will include sections belonging to
     // notebook.
-    bool writeToConfig() const;
+    // @p_later: write it in background, such as for the modified time.
+    bool writeToConfig(bool p_later = false) const;
 
     // Write the config of @p_file to config file.
     bool updateFileConfig(const VNoteFile *p_file);
 
+    // Write the config of files later so updates of several files are
+    // written once.
+    void updateFileConfigLater();
+
+    // Write the config in background now if there is an update pending.
+    bool flushFileConfig();
+
     // Try to load file given relative path @p_filePath.
     VNoteFile *tryLoadFile(QStringList &p_filePath);
 
@@ -129,7 +142,7 @@ private:
     QString fetchRelativePath(const VDirectory *p_dir) const;
 
     // Write @p_json to config.
-    bool writeToConfig(const QJsonObject &p_json) const;
+    bool writeToConfig(const QJsonObject &p_json, bool p_later) const;
 
     // Add notebook part config to @p_json.
     // Should only be called with root directory.
@@ -145,6 +158,9 @@ private:
     // Delete this directory in disk.
     bool deleteDirectory(bool p_skipRecycleBin = false, QString *p_errMsg = NULL);
 
+    // Create the VNoteFile of each entry in m_fileEntries if not created yet.
+    void loadFiles() const;
+
     // Notebook containing this folder.
     QPointer<VNotebook> m_notebook;
 
@@ -155,8 +171,17 @@ private:
     QVector<VDirectory *> m_subDirs;
 
     // Owner of the files
+    // Created from m_fileEntries on demand.
     QVector<VNoteFile *> m_files;
 
+    // Config entries of the files, kept in the compact form of the parsed
+    // config file until the files are used. Folders opened only to build the
+    // directory tree never create their files.
+    QJsonArray m_fileEntries;
+
+    // Whether m_files has been created from m_fileEntries.
+    bool m_filesLoaded;
+
     // Whether the directory has been opened.
     bool m_opened;
 
@@ -166,6 +191,10 @@ private:
     // UTC time when creating this directory.
     // Loaded after open().
     QDateTime m_createdTimeUtc;
+
+    // Whether there is an update of the config requested by
+    // updateFileConfigLater() not written yet.
+    bool m_configUpdatePending;
 };
 
 inline const QVector<VDirectory *> &VDirectory::getSubDirs() const
@@ -200,6 +229,7 @@ inline const VDirectory *VDirectory::getParentDirectory() const
 
 inline const QVector<VNoteFile *> &VDirectory::getFiles() const
 {
+    loadFiles();
     return m_files;
 }
 
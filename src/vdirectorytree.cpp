@@ -14,12 +14,24 @@
 #include "utils/viconutils.h"
 #include "vfilelist.h"
 #include "vhistorylist.h"
+#include "vnotebookloader.h"
+#include "vdirconfigprefetcher.h"
+#include "utils/vcopyengine.h"
 
 extern VMainWindow *g_mainWin;
 
 extern VConfigManager *g_config;
 extern VNote *g_vnote;
 
+// Levels of folders to read ahead under the children of an expanded folder.
+#define PREFETCH_DEPTH 2
+
+// Range of the progress dialog of pasting folders.
+#define PROGRESS_RANGE 1000
+
+// Show the progress dialog only if pasting takes longer than this in ms.
+#define PROGRESS_MIN_DURATION 500
+
 const QString VDirectoryTree::c_infoShortcutSequence = "F2";
 const QString VDirectoryTree::c_copyShortcutSequence = "Ctrl+C";
 const QString VDirectoryTree::c_cutShortcutSequence = "Ctrl+X";
@@ -28,6 +40,7 @@ const QString VDirectoryTree::c_pasteShortcutSequence = "Ctrl+V";
 VDirectoryTree::VDirectoryTree(QWidget *parent)
     : VTreeWidget(parent),
       VNavigationMode(),
+      m_notebookPending(false),
       m_editArea(NULL)
 {
     setColumnCount(1);
@@ -90,17 +103,45 @@ void VDirectoryTree::initShortcuts()
 
 void VDirectoryTree::setNotebook(VNotebook *p_notebook)
 {
-    if (m_notebook == p_notebook) {
+    if (m_notebook == p_notebook
+        && (!m_notebook || m_notebookPending || m_notebook->isOpened())) {
         return;
     }
 
     clear();
     m_notebook = p_notebook;
+    m_notebookPending = false;
     if (!m_notebook) {
         return;
     }
 
+    if (!m_notebook->isLoaded() && g_vnote->getNotebookLoader()->isLoading()) {
+        m_notebookPending = true;
+        return;
+    }
+
+    openNotebook(true);
+}
+
+void VDirectoryTree::handleNotebookLoaded(VNotebook *p_notebook)
+{
+    if (!m_notebookPending || m_notebook != p_notebook) {
+        return;
+    }
+
+    m_notebookPending = false;
+
+    // Invalid notebooks will be fixed after loading.
+    openNotebook(false);
+}
+
+void VDirectoryTree::openNotebook(bool p_warn)
+{
     if (!m_notebook->open()) {
+        if (!p_warn) {
+            return;
+        }
+
         VUtils::showMessage(QMessageBox::Warning,
                             tr("Warning"),
                             tr("Fail to open notebook <span style=\"%1\">%2</span>.")
@@ -145,6 +186,8 @@ void VDirectoryTree::updateDirectoryTree()
         buildSubTree(item, 1);
     }
 
+    prefetchChildren(NULL);
+
     if (!restoreCurrentItem() && topLevelItemCount() > 0) {
         setCurrentItem(topLevelItem(0));
     }
@@ -226,9 +269,33 @@ void VDirectoryTree::handleItemExpanded(QTreeWidgetItem *p_item)
 
         VDirectory *dir = getVDirectory(p_item);
         dir->setExpanded(true);
+
+        prefetchChildren(p_item);
     }
 }
 
+void VDirectoryTree::prefetchChildren(QTreeWidgetItem *p_item)
+{
+    QStringList paths;
+    int nrChild = p_item ? p_item->childCount() : topLevelItemCount();
+    for (int i = 0; i < nrChild; ++i) {
+        QTreeWidgetItem *childItem = p_item ? p_item->child(i) : topLevelItem(i);
+        VDirectory *dir = getVDirectory(childItem);
+        if (!dir || !dir->isOpened()) {
+            continue;
+        }
+
+        const QVector<VDirectory *> &subDirs = dir->getSubDirs();
+        for (auto subDir : subDirs) {
+            if (!subDir->isOpened()) {
+                paths.append(subDir->fetchPath());
+            }
+        }
+    }
+
+    VDirConfigPrefetcher::getInstance()->prefetch(paths, PREFETCH_DEPTH);
+}
+
 void VDirectoryTree::buildChildren(QTreeWidgetItem *p_item)
 {
     Q_ASSERT(p_item);
@@ -858,6 +925,28 @@ void VDirectoryTree::pasteDirectories(VDirectory *p_destDir,
             dirName = VUtils::generateCopiedDirName(p_destDir->fetchPath(), dirName);
         }
 
+        // Show the progress of a long copy modally since the folders could not
+        // be touched during the copy. User input is blocked until it shows up,
+        // so the user could do nothing but cancel.
+        QProgressDialog progress(tr("Pasting folder %1...").arg(dir->getName()),
+                                 tr("Cancel"),
+                                 0,
+                                 PROGRESS_RANGE,
+                                 this);
+        progress.setWindowModality(Qt::ApplicationModal);
+        progress.setMinimumDuration(PROGRESS_MIN_DURATION);
+
+        VCopyEngine engine;
+        connect(&engine, &VCopyEngine::progressChanged,
+                &progress, [&progress, &engine](qint64 p_copied, qint64 p_total) {
+                    progress.setValue(p_total > 0 ? (int)(p_copied * PROGRESS_RANGE / p_total) : 0);
+                    if (progress.isVisible()) {
+                        engine.setProcessUserInput(true);
+                    }
+                });
+        connect(&progress, &QProgressDialog::canceled,
+                &engine, &VCopyEngine::cancel);
+
         QString msg;
         VDirectory *destDir = NULL;
         bool ret = VDirectory::copyDirectory(p_destDir,
@@ -865,7 +954,13 @@ void VDirectoryTree::pasteDirectories(VDirectory *p_destDir,
                                              dir,
                                              p_isCut,
                                              &destDir,
-                                             &msg);
+                                             &msg,
+                                             &engine);
+        progress.reset();
+        if (!ret && engine.isCancelled()) {
+            continue;
+        }
+
         if (!ret) {
             VUtils::showMessage(QMessageBox::Warning,
                                 tr("Warning"),
@@ -1037,6 +1132,11 @@ bool VDirectoryTree::locateDirectory(const VDirectory *p_directory)
             return false;
         }
 
+        if (m_notebookPending) {
+            m_notebookPending = false;
+            openNotebook(true);
+        }
+
         QTreeWidgetItem *item = expandToVDirectory(p_directory);
         if (item) {
             setCurrentItem(item);
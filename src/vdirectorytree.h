@@ -43,8 +43,13 @@ signals:
 
 public slots:
     // Set directory tree to display a given notebook @p_notebook.
+    // If @p_notebook is still being loaded in background, the tree will be
+    // built once it is loaded.
     void setNotebook(VNotebook *p_notebook);
 
+    // Build the tree if it waits for @p_notebook to be loaded.
+    void handleNotebookLoaded(VNotebook *p_notebook);
+
     // Create a root folder.
     void newRootDirectory();
 
@@ -102,6 +107,10 @@ protected:
     void keyPressEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
 
 private:
+    // Open m_notebook and build the tree.
+    // @p_warn: whether show a warning if it fails to open.
+    void openNotebook(bool p_warn);
+
     // Build the subtree of @p_parent recursively to the depth @p_depth.
     // @p_depth: negative - infinite levels.
     // Will expand the item if the corresponding directory was expanded before.
@@ -127,6 +136,11 @@ private:
                           const QVector<QString> &p_dirs,
                           bool p_isCut);
 
+    // Read ahead in background the configs of the directories not opened yet
+    // under the children of @p_item (top level items if NULL), which will be
+    // opened once these children are expanded.
+    void prefetchChildren(QTreeWidgetItem *p_item);
+
     // Build the subtree of @p_item's children if it has not been built yet.
     // We need to fill the children before showing a item to get a correct render.
     void buildChildren(QTreeWidgetItem *p_item);
@@ -156,6 +170,9 @@ private:
 
     QPointer<VNotebook> m_notebook;
 
+    // Whether the tree waits for m_notebook to be loaded.
+    bool m_notebookPending;
+
     VEditArea *m_editArea;
 
     // Each notebook's current item's VDirectory.
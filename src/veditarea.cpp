@@ -14,6 +14,7 @@
 #include "vcaptain.h"
 #include "vfilelist.h"
 #include "vmathjaxpreviewhelper.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager *g_config;
 
@@ -65,6 +66,9 @@ VEditArea::VEditArea(QWidget *parent)
 
     timer->start();
 
+    connect(VFileWatcher::getInstance(), &VFileWatcher::fileChanged,
+            this, &VEditArea::handleWatchedFileChanged);
+
     m_autoSave = g_config->getEnableAutoSave();
 
     m_mathPreviewHelper = new VMathJaxPreviewHelper(this, this);
@@ -232,6 +236,8 @@ VEditTab *VEditArea::openFile(VFile *p_file, OpenFileMode p_mode, bool p_forceMo
     winIdx = curWindowIndex;
     tabIdx = openFileInWindow(winIdx, p_file, p_mode);
 
+    updateWatchedFiles();
+
 out:
     VEditTab *tab = getTab(winIdx, tabIdx);
 
@@ -1164,11 +1170,14 @@ void VEditArea::recordClosedFile(const VFileSessionInfo &p_file)
 
 void VEditArea::handleFileTimerTimeout()
 {
+    // Tabs may be closed or files may be renamed since last time.
+    updateWatchedFiles();
+
     int nrWin = splitter->count();
     for (int i = 0; i < nrWin; ++i) {
-        // Check whether opened files have been changed outside.
+        // Check whether opened files not watched have been changed outside.
         VEditWindow *win = getWindow(i);
-        win->checkFileChangeOutside();
+        win->checkFileChangeOutside(true);
 
         if (m_autoSave) {
             win->saveAll();
@@ -1176,6 +1185,36 @@ void VEditArea::handleFileTimerTimeout()
     }
 }
 
+void VEditArea::handleWatchedFileChanged(const QString &p_path)
+{
+    int nrWin = splitter->count();
+    for (int i = 0; i < nrWin; ++i) {
+        VEditWindow *win = getWindow(i);
+        int nrTab = win->count();
+        for (int j = 0; j < nrTab; ++j) {
+            VEditTab *tab = win->getTab(j);
+            if (tab->getFile()->fetchPath() == p_path) {
+                tab->checkFileChangeOutside();
+            }
+        }
+    }
+}
+
+void VEditArea::updateWatchedFiles()
+{
+    QStringList files;
+    int nrWin = splitter->count();
+    for (int i = 0; i < nrWin; ++i) {
+        VEditWindow *win = getWindow(i);
+        int nrTab = win->count();
+        for (int j = 0; j < nrTab; ++j) {
+            files.append(win->getTab(j)->getFile()->fetchPath());
+        }
+    }
+
+    VFileWatcher::getInstance()->setWatchedFiles(files);
+}
+
 QRect VEditArea::editAreaRect() const
 {
     QRect rt = rect();
@@ -174,8 +174,14 @@ private slots:
     // Handle the timeout signal of file timer.
     void handleFileTimerTimeout();
 
+    // Check the tabs of file @p_path reported changed by VFileWatcher.
+    void handleWatchedFileChanged(const QString &p_path);
+
 private:
     void setupUI();
+
+    // Watch the files of all the tabs with VFileWatcher.
+    void updateWatchedFiles();
     QVector<QPair<int, int> > findTabsByFile(const VFile *p_file);
     int openFileInWindow(int windowIndex, VFile *p_file, OpenFileMode p_mode);
     void setCurrentTab(int windowIndex, int tabIndex, bool setFocus);
@@ -34,6 +34,10 @@ public:
     // Save file.
     virtual bool saveFile() = 0;
 
+    // Save file without waiting for the disk write. A failure is reported
+    // once the write is done.
+    virtual void saveFileInBackground() { saveFile(); }
+
     bool isEditMode() const;
 
     virtual bool isModified() const;
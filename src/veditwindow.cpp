@@ -17,6 +17,7 @@
 #include "vhistorylist.h"
 #include "vnote.h"
 #include "vexplorer.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager *g_config;
 
@@ -1251,11 +1252,17 @@ QVector<VEditTab *> VEditWindow::getAllTabs() const
     return tabs;
 }
 
-void VEditWindow::checkFileChangeOutside()
+void VEditWindow::checkFileChangeOutside(bool p_unwatchedOnly)
 {
+    VFileWatcher *watcher = VFileWatcher::getInstance();
     int nrTab = count();
     for (int i = 0; i < nrTab; ++i) {
-        getTab(i)->checkFileChangeOutside();
+        VEditTab *tab = getTab(i);
+        if (p_unwatchedOnly && watcher->isWatched(tab->getFile()->fetchPath())) {
+            continue;
+        }
+
+        tab->checkFileChangeOutside();
     }
 }
 
@@ -1263,7 +1270,7 @@ void VEditWindow::saveAll()
 {
     int nrTab = count();
     for (int i = 0; i < nrTab; ++i) {
-        getTab(i)->saveFile();
+        getTab(i)->saveFileInBackground();
     }
 }
 
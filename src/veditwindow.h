@@ -92,7 +92,8 @@ public:
     void updateTabStatus(int p_index = -1);
 
     // Check whether opened files have been changed outside.
-    void checkFileChangeOutside();
+    // @p_unwatchedOnly: only check files not watched by VFileWatcher.
+    void checkFileChangeOutside(bool p_unwatchedOnly = false);
 
     // Auto save file.
     void saveAll();
@@ -6,13 +6,22 @@
 #include <QDebug>
 #include <QFile>
 #include <QTextStream>
+#include <QCoreApplication>
+#include <climits>
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
+#include "vfilesaver.h"
+#include "utils/veditjournal.h"
 
 extern VConfigManager *g_config;
 
+// Time of an invalid QDateTime.
+#define INVALID_TIME LLONG_MIN
+
 const QString VFile::c_backupFileHeadMagic = "vnote_backup_file_826537664";
 
+const QString VFile::c_journalFileHeadMagic = "vnote_journal_file_826537664";
+
 VFile::VFile(QObject *p_parent,
              const QString &p_name,
              FileType p_type,
@@ -25,13 +34,17 @@ VFile::VFile(QObject *p_parent,
       m_docType(VUtils::docTypeFromName(p_name)),
       m_type(p_type),
       m_modifiable(p_modifiable),
-      m_createdTimeUtc(p_createdTimeUtc),
-      m_modifiedTimeUtc(p_modifiedTimeUtc)
+      m_createdTimeUtc(toTime(p_createdTimeUtc)),
+      m_modifiedTimeUtc(toTime(p_modifiedTimeUtc)),
+      m_lastSize(-1),
+      m_saveSerial(0),
+      m_journal(NULL)
 {
 }
 
 VFile::~VFile()
 {
+    delete m_journal;
 }
 
 bool VFile::open()
@@ -49,7 +62,7 @@ bool VFile::open()
     }
 
     m_content = VUtils::readFileFromDisk(filePath);
-    m_lastModified = QFileInfo(filePath).lastModified();
+    updateLastDiskState(m_content);
     m_opened = true;
     return true;
 }
@@ -60,12 +73,17 @@ void VFile::close()
         return;
     }
 
+    waitForSaved();
+
     m_content.clear();
     if (!m_backupName.isEmpty()) {
         VUtils::deleteFile(fetchBackupFilePath());
         m_backupName.clear();
     }
 
+    delete m_journal;
+    m_journal = NULL;
+
     m_opened = false;
 }
 
@@ -74,15 +92,87 @@ bool VFile::save()
     Q_ASSERT(m_opened);
     Q_ASSERT(m_modifiable);
 
-    bool ret = VUtils::writeFileToDisk(fetchPath(), m_content);
-    if (ret) {
-        m_lastModified = QFileInfo(fetchPath()).lastModified();
-        m_modifiedTimeUtc = QDateTime::currentDateTimeUtc();
+    waitForSaved();
+
+    QByteArray hash = m_lastContentHash;
+    bool written = false;
+    QDateTime modified;
+    qint64 size = -1;
+    bool ret = VFileSaver::getInstance()->saveNow(fetchPath(),
+                                                  m_content,
+                                                  hash,
+                                                  m_lastModified,
+                                                  m_lastSize,
+                                                  written,
+                                                  modified,
+                                                  size);
+    if (ret && written) {
+        setLastDiskState(hash, modified, size);
+        m_modifiedTimeUtc = QDateTime::currentMSecsSinceEpoch();
     }
 
     return ret;
 }
 
+void VFile::saveInBackground()
+{
+    Q_ASSERT(m_opened);
+    Q_ASSERT(m_modifiable);
+
+    VFileSaver *saver = VFileSaver::getInstance();
+    if (m_saveSerial == 0) {
+        connect(saver, &VFileSaver::fileSaved,
+                this, &VFile::handleFileSaved);
+    }
+
+    m_saveSerial = saver->save(fetchPath(),
+                               m_content,
+                               m_lastContentHash,
+                               m_lastModified,
+                               m_lastSize);
+}
+
+void VFile::waitForSaved()
+{
+    if (m_saveSerial == 0) {
+        return;
+    }
+
+    VFileSaver::getInstance()->waitForSaved(fetchPath());
+
+    // Deliver the result now.
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+}
+
+void VFile::handleFileSaved(quint64 p_serial,
+                            bool p_ok,
+                            bool p_written,
+                            const QByteArray &p_hash,
+                            const QDateTime &p_modified,
+                            qint64 p_size)
+{
+    // Results of saves superseded by a later one are dropped.
+    if (p_serial != m_saveSerial) {
+        return;
+    }
+
+    m_saveSerial = 0;
+    disconnect(VFileSaver::getInstance(), &VFileSaver::fileSaved,
+               this, &VFile::handleFileSaved);
+
+    if (p_written) {
+        setLastDiskState(p_hash, p_modified, p_size);
+        m_modifiedTimeUtc = QDateTime::currentMSecsSinceEpoch();
+        savedInBackground();
+    }
+
+    emit backgroundSaveFinished(p_ok);
+}
+
+void VFile::savedInBackground()
+{
+}
+
 QUrl VFile::getBaseUrl() const
 {
     // Need to judge the path: Url, local file, resource file.
@@ -112,20 +202,73 @@ bool VFile::isInternalImageFolder(const QString &p_path) const
            || VUtils::equalPath(p_path, fetchImageFolderPath());
 }
 
-bool VFile::isChangedOutside() const
+bool VFile::isChangedOutside()
+{
+    // The file is being written by ourselves.
+    if (m_saveSerial != 0) {
+        return false;
+    }
+
+    QString filePath = fetchPath();
+    QFileInfo fi(filePath);
+    if (fi.lastModified() == m_lastModified && fi.size() == m_lastSize) {
+        return false;
+    }
+
+    if (!fi.exists()) {
+        return true;
+    }
+
+    // Confirm by the content.
+    QString content = VUtils::readFileFromDisk(filePath);
+    if (VFileSaver::contentHash(content) != m_lastContentHash) {
+        return true;
+    }
+
+    m_lastModified = fi.lastModified();
+    m_lastSize = fi.size();
+    return false;
+}
+
+qint64 VFile::toTime(const QDateTime &p_dateTime)
+{
+    return p_dateTime.isValid() ? p_dateTime.toMSecsSinceEpoch() : INVALID_TIME;
+}
+
+QDateTime VFile::fromTime(qint64 p_time)
+{
+    if (p_time == INVALID_TIME) {
+        return QDateTime();
+    }
+
+    return QDateTime::fromMSecsSinceEpoch(p_time, Qt::UTC);
+}
+
+void VFile::updateLastDiskState(const QString &p_content)
 {
-    QDateTime lm = QFileInfo(fetchPath()).lastModified();
-    return lm.toSecsSinceEpoch() != m_lastModified.toSecsSinceEpoch();
+    QFileInfo fi(fetchPath());
+    setLastDiskState(VFileSaver::contentHash(p_content), fi.lastModified(), fi.size());
+}
+
+void VFile::setLastDiskState(const QByteArray &p_hash,
+                             const QDateTime &p_modified,
+                             qint64 p_size)
+{
+    m_lastModified = p_modified;
+    m_lastSize = p_size;
+    m_lastContentHash = p_hash;
 }
 
 void VFile::reload()
 {
     Q_ASSERT(m_opened);
 
+    waitForSaved();
+
     QString filePath = fetchPath();
     Q_ASSERT(QFileInfo::exists(filePath));
     m_content = VUtils::readFileFromDisk(filePath);
-    m_lastModified = QFileInfo(filePath).lastModified();
+    updateLastDiskState(m_content);
 }
 
 QString VFile::backupFileOfPreviousSession() const
@@ -182,32 +325,80 @@ QStringList VFile::getPotentialBackupFiles(const QString &p_dir) const
     return files;
 }
 
-bool VFile::isBackupFile(const QString &p_file) const
+// Read the head line of backup file @p_file.
+static QString readBackupFileHead(const QString &p_file)
 {
     QFile file(p_file);
-    if (!file.open(QFile::ReadOnly | QIODevice::Text)) {
-        return false;
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QString();
     }
 
-    QTextStream st(&file);
-    QString head = st.readLine();
-    return head == fetchBackupFileHead();
+    QString head = QString::fromUtf8(file.readLine());
+    if (head.endsWith('\n')) {
+        head.chop(1);
+    }
+
+    return head;
+}
+
+bool VFile::isBackupFile(const QString &p_file) const
+{
+    QString head = readBackupFileHead(p_file);
+    return head == fetchBackupFileHead() || head == fetchLegacyBackupFileHead();
 }
 
 QString VFile::fetchBackupFileHead() const
+{
+    return c_journalFileHeadMagic + " " + fetchPath();
+}
+
+QString VFile::fetchLegacyBackupFileHead() const
 {
     return c_backupFileHeadMagic + " " + fetchPath();
 }
 
 bool VFile::writeBackupFile(const QString &p_content)
 {
-    return VUtils::writeFileToDisk(fetchBackupFilePath(),
-                                   fetchBackupFileHead() + "\n" + p_content);
+    if (!m_journal) {
+        m_journal = new VEditJournal();
+    }
+
+    return m_journal->start(fetchBackupFilePath(), fetchBackupFileHead(), p_content);
+}
+
+void VFile::addBackupChange(int p_position, const QString &p_inserted, int p_newLength)
+{
+    if (m_journal) {
+        m_journal->addChange(p_position, p_inserted, p_newLength);
+    }
+}
+
+bool VFile::flushBackupFile()
+{
+    // The backup file is moved with the note.
+    if (!m_journal
+        || m_journal->needsCompaction()
+        || m_journal->getFilePath() != fetchBackupFilePath()) {
+        return false;
+    }
+
+    return m_journal->flush();
 }
 
-QString VFile::readBackupFile(const QString &p_file)
+bool VFile::readBackupFile(const QString &p_file, QString &p_content)
 {
+    if (readBackupFileHead(p_file) == fetchBackupFileHead()) {
+        p_content.clear();
+        if (!VEditJournal::replay(p_file, p_content)) {
+            qWarning() << "fail to replay backup file" << p_file;
+            return false;
+        }
+
+        return true;
+    }
+
     const QString content = VUtils::readFileFromDisk(p_file);
     int idx = content.indexOf("\n");
-    return content.mid(idx + 1);
+    p_content = content.mid(idx + 1);
+    return true;
 }
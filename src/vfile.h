@@ -7,6 +7,8 @@
 #include <QDateTime>
 #include "vconstants.h"
 
+class VEditJournal;
+
 // VFile is an abstract class representing a file in VNote.
 class VFile : public QObject
 {
@@ -30,8 +32,16 @@ public:
     virtual void close();
 
     // Save m_content to the file.
+    // Nothing is written if the content is the same as the one on disk.
     virtual bool save();
 
+    // Save m_content to the file in background.
+    // backgroundSaveFinished() will be emitted once it is done.
+    void saveInBackground();
+
+    // Wait until the save in background is done and its result is handled.
+    void waitForSaved();
+
     // Reload content from disk.
     virtual void reload();
 
@@ -77,17 +87,43 @@ public:
     QDateTime getModifiedTimeUtc() const;
 
     // Whether this file was changed outside VNote.
-    bool isChangedOutside() const;
+    // A change of the modified time is confirmed by the content, so touching
+    // the file does not count.
+    bool isChangedOutside();
 
     // Return backup file of previous session if there exists one.
     QString backupFileOfPreviousSession() const;
 
-    // Write @p_content to backup file.
+    // Start the backup file with a snapshot @p_content, replacing the
+    // existing one. Changes are then recorded by addBackupChange().
     bool writeBackupFile(const QString &p_content);
 
-    QString readBackupFile(const QString &p_file);
+    // Record a change at @p_position inserting @p_inserted, after which the
+    // content is @p_newLength chars long.
+    // Ignored until the backup file is started.
+    void addBackupChange(int p_position, const QString &p_inserted, int p_newLength);
+
+    // Append the recorded changes to the backup file.
+    // Returns false if a new snapshot should be written by writeBackupFile().
+    bool flushBackupFile();
+
+    // Get the content recovered from backup file @p_file into @p_content.
+    // Returns false if nothing could be recovered from it.
+    bool readBackupFile(const QString &p_file, QString &p_content);
+
+signals:
+    // Emitted when the save in background is done.
+    void backgroundSaveFinished(bool p_ok);
 
 protected:
+    // Called after the content saved in background is written to disk.
+    virtual void savedInBackground();
+
+    // Convert between QDateTime and the time kept in the members.
+    static qint64 toTime(const QDateTime &p_dateTime);
+
+    static QDateTime fromTime(qint64 p_time);
+
     // Name of this file.
     QString m_name;
 
@@ -106,22 +142,54 @@ protected:
     // Whether this file is modifiable.
     bool m_modifiable;
 
-    // UTC time when creating this file.
-    QDateTime m_createdTimeUtc;
+    // UTC time in msecs since epoch when creating this file.
+    // INVALID_TIME if not known. Kept as int64 to save memory.
+    qint64 m_createdTimeUtc;
 
-    // UTC time of last modification to this file in VNote.
-    QDateTime m_modifiedTimeUtc;
+    // UTC time in msecs since epoch of last modification to this file in VNote.
+    qint64 m_modifiedTimeUtc;
 
     // Last modified date and local time when the file is last modified
     // corresponding to m_content.
     QDateTime m_lastModified;
 
+    // Size of the file corresponding to m_content.
+    qint64 m_lastSize;
+
+    // Hash of the content on disk corresponding to m_content.
+    QByteArray m_lastContentHash;
+
     // Name of the backup file.
     QString m_backupName;
 
     // Used to identify file path change.
     QString m_lastBackupFilePath;
 
+    // Journal of the backup file. NULL if not started.
+    VEditJournal *m_journal;
+
+    // Serial of the save in background whose result is not handled yet.
+    // 0 if there is none.
+    quint64 m_saveSerial;
+
+    // Update m_lastModified, m_lastSize, and m_lastContentHash after @p_content
+    // is read from or written to disk.
+    void updateLastDiskState(const QString &p_content);
+
+    // Update the disk state with hash @p_hash of the content and state
+    // @p_modified and @p_size of the file.
+    void setLastDiskState(const QByteArray &p_hash,
+                          const QDateTime &p_modified,
+                          qint64 p_size);
+
+private slots:
+    void handleFileSaved(quint64 p_serial,
+                         bool p_ok,
+                         bool p_written,
+                         const QByteArray &p_hash,
+                         const QDateTime &p_modified,
+                         qint64 p_size);
+
 private:
     // Fetch backup file path.
     QString fetchBackupFilePath();
@@ -133,7 +201,13 @@ private:
 
     QString fetchBackupFileHead() const;
 
+    // Head of backup files written by previous versions, which contain the
+    // whole content instead of a journal.
+    QString fetchLegacyBackupFileHead() const;
+
     static const QString c_backupFileHeadMagic;
+
+    static const QString c_journalFileHeadMagic;
 };
 
 inline const QString &VFile::getName() const
@@ -174,12 +248,12 @@ inline void VFile::setContent(const QString &p_content)
 
 inline QDateTime VFile::getCreatedTimeUtc() const
 {
-    return m_createdTimeUtc;
+    return fromTime(m_createdTimeUtc);
 }
 
 inline QDateTime VFile::getModifiedTimeUtc() const
 {
-    return m_modifiedTimeUtc;
+    return fromTime(m_modifiedTimeUtc);
 }
 
 #endif // VFILE_H
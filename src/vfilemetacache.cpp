@@ -0,0 +1,194 @@
+#include "vfilemetacache.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QTimer>
+#include <QDebug>
+
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+
+extern VConfigManager *g_config;
+
+// Magic and version of the cache file.
+#define FILE_META_MAGIC 0x564e4643
+#define FILE_META_VERSION 1
+
+// Delay in ms to save the cache after a change.
+#define FILE_META_SAVE_DELAY 10000
+
+// Max number of entries. The cache is reset if exceeded.
+#define FILE_META_MAX_ENTRIES 500000
+
+VFileMetaCache *VFileMetaCache::s_instance = NULL;
+
+static QDataStream &operator<<(QDataStream &p_out, const VFileMeta &p_meta)
+{
+    p_out << p_meta.m_size
+          << p_meta.m_modifiedTime
+          << (qint32)p_meta.m_kind
+          << p_meta.m_encoding
+          << (qint32)p_meta.m_lineCount;
+    return p_out;
+}
+
+static QDataStream &operator>>(QDataStream &p_in, VFileMeta &p_meta)
+{
+    qint32 kind = 0, lineCount = 0;
+    p_in >> p_meta.m_size
+         >> p_meta.m_modifiedTime
+         >> kind
+         >> p_meta.m_encoding
+         >> lineCount;
+    p_meta.m_kind = static_cast<VFileMeta::Kind>(kind);
+    p_meta.m_lineCount = lineCount;
+    return p_in;
+}
+
+VFileMetaCache::VFileMetaCache(QObject *p_parent)
+    : QObject(p_parent),
+      m_dirty(false)
+{
+    m_filePath = QDir(g_config->getCacheFolder()).filePath("filemeta.cache");
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(FILE_META_SAVE_DELAY);
+    connect(m_saveTimer, &QTimer::timeout,
+            this, &VFileMetaCache::save);
+
+    load();
+}
+
+VFileMetaCache::~VFileMetaCache()
+{
+    save();
+
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+}
+
+VFileMetaCache *VFileMetaCache::getInstance()
+{
+    if (!s_instance) {
+        // Saved on exit with the application.
+        s_instance = new VFileMetaCache(QCoreApplication::instance());
+    }
+
+    return s_instance;
+}
+
+bool VFileMetaCache::find(const QString &p_path,
+                          qint64 p_size,
+                          qint64 p_modifiedTime,
+                          VFileMeta &p_meta) const
+{
+    QReadLocker locker(&m_lock);
+    auto it = m_metas.constFind(p_path);
+    if (it == m_metas.constEnd()
+        || it->m_size != p_size
+        || it->m_modifiedTime != p_modifiedTime) {
+        return false;
+    }
+
+    p_meta = it.value();
+    return true;
+}
+
+void VFileMetaCache::insert(const QString &p_path, const VFileMeta &p_meta)
+{
+    QWriteLocker locker(&m_lock);
+    if (m_metas.size() >= FILE_META_MAX_ENTRIES && !m_metas.contains(p_path)) {
+        qDebug() << "reset file meta cache of size" << m_metas.size();
+        m_metas.clear();
+    }
+
+    m_metas.insert(p_path, p_meta);
+    m_dirty = true;
+}
+
+void VFileMetaCache::scheduleSave()
+{
+    {
+        QReadLocker locker(&m_lock);
+        if (!m_dirty) {
+            return;
+        }
+    }
+
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+void VFileMetaCache::load()
+{
+    QFile file(m_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    qint32 version = 0;
+    in >> magic >> version;
+    if (magic != FILE_META_MAGIC || version != FILE_META_VERSION) {
+        qDebug() << "obsolete file meta cache" << m_filePath;
+        return;
+    }
+
+    QHash<QString, VFileMeta> metas;
+    in >> metas;
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "invalid file meta cache" << m_filePath;
+        return;
+    }
+
+    QWriteLocker locker(&m_lock);
+    m_metas = metas;
+    m_dirty = false;
+}
+
+bool VFileMetaCache::save()
+{
+    m_saveTimer->stop();
+
+    QHash<QString, VFileMeta> metas;
+    {
+        QWriteLocker locker(&m_lock);
+        if (!m_dirty) {
+            return true;
+        }
+
+        metas = m_metas;
+        m_dirty = false;
+    }
+
+    if (!VUtils::makePath(VUtils::basePathFromPath(m_filePath))) {
+        return false;
+    }
+
+    QSaveFile file(m_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open file meta cache for write" << m_filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (quint32)FILE_META_MAGIC << (qint32)FILE_META_VERSION;
+    out << metas;
+
+    if (!file.commit()) {
+        qWarning() << "fail to write file meta cache" << m_filePath;
+        return false;
+    }
+
+    return true;
+}
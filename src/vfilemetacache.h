@@ -0,0 +1,101 @@
+#ifndef VFILEMETACACHE_H
+#define VFILEMETACACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+
+class QTimer;
+
+// Meta data of a file detected by search.
+struct VFileMeta
+{
+    enum Kind
+    {
+        Unknown = 0,
+        Text,
+        Binary
+    };
+
+    VFileMeta()
+        : m_size(-1),
+          m_modifiedTime(-1),
+          m_kind(Kind::Unknown),
+          m_lineCount(-1)
+    {
+    }
+
+    VFileMeta(qint64 p_size, qint64 p_modifiedTime)
+        : m_size(p_size),
+          m_modifiedTime(p_modifiedTime),
+          m_kind(Kind::Unknown),
+          m_lineCount(-1)
+    {
+    }
+
+    qint64 m_size;
+
+    // Milliseconds since epoch.
+    qint64 m_modifiedTime;
+
+    VFileMeta::Kind m_kind;
+
+    // Name of the text codec. Empty if not detected yet.
+    QByteArray m_encoding;
+
+    // -1 if not counted yet.
+    int m_lineCount;
+};
+
+
+// Cache of file meta data keyed by file path, shared by search workers.
+// An entry is valid only if the size and modified time of the file do not
+// change. It is persisted in the cache folder.
+// find() and insert() are thread-safe.
+class VFileMetaCache : public QObject
+{
+    Q_OBJECT
+public:
+    // Should be called in the main thread first.
+    static VFileMetaCache *getInstance();
+
+    ~VFileMetaCache();
+
+    // Returns false if there is no valid entry for @p_path.
+    bool find(const QString &p_path,
+              qint64 p_size,
+              qint64 p_modifiedTime,
+              VFileMeta &p_meta) const;
+
+    void insert(const QString &p_path, const VFileMeta &p_meta);
+
+    // Schedule a save if there is any change.
+    // Should be called in the main thread.
+    void scheduleSave();
+
+public slots:
+    bool save();
+
+private:
+    explicit VFileMetaCache(QObject *p_parent = nullptr);
+
+    void load();
+
+    QString m_filePath;
+
+    mutable QReadWriteLock m_lock;
+
+    // Protected by m_lock.
+    QHash<QString, VFileMeta> m_metas;
+
+    // Protected by m_lock.
+    bool m_dirty;
+
+    QTimer *m_saveTimer;
+
+    static VFileMetaCache *s_instance;
+};
+
+#endif // VFILEMETACACHE_H
@@ -0,0 +1,226 @@
+#include "vfilesaver.h"
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QCryptographicHash>
+#include <QDebug>
+
+VFileSaver *VFileSaver::s_instance = NULL;
+
+VFileSaver::VFileSaver(QObject *p_parent)
+    : QThread(p_parent),
+      m_serial(0),
+      m_quit(false)
+{
+}
+
+VFileSaver::~VFileSaver()
+{
+    // The pending saves are done before the thread quits.
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_pendingCond.wakeAll();
+    }
+
+    wait();
+
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+}
+
+VFileSaver *VFileSaver::getInstance()
+{
+    if (!s_instance) {
+        s_instance = new VFileSaver(QCoreApplication::instance());
+        s_instance->start();
+    }
+
+    return s_instance;
+}
+
+quint64 VFileSaver::save(const QString &p_filePath,
+                         const QString &p_content,
+                         const QByteArray &p_lastHash,
+                         const QDateTime &p_lastModified,
+                         qint64 p_lastSize)
+{
+    QMutexLocker locker(&m_mutex);
+    quint64 serial = ++m_serial;
+
+    // Replace the pending one which is not written yet.
+    for (auto & job : m_pending) {
+        if (job.m_filePath == p_filePath) {
+            job.m_serial = serial;
+            job.m_content = p_content;
+            return serial;
+        }
+    }
+
+    Job job;
+    job.m_serial = serial;
+    job.m_filePath = p_filePath;
+    job.m_content = p_content;
+    job.m_lastHash = p_lastHash;
+    job.m_lastModified = p_lastModified;
+    job.m_lastSize = p_lastSize;
+    m_pending.append(job);
+
+    m_pendingCond.wakeAll();
+    return serial;
+}
+
+bool VFileSaver::saveNow(const QString &p_filePath,
+                         const QString &p_content,
+                         QByteArray &p_hash,
+                         const QDateTime &p_lastModified,
+                         qint64 p_lastSize,
+                         bool &p_written,
+                         QDateTime &p_modified,
+                         qint64 &p_size)
+{
+    waitForSaved(p_filePath);
+    bool ret = writeFile(p_filePath,
+                         p_content,
+                         p_hash,
+                         p_lastModified,
+                         p_lastSize,
+                         p_written,
+                         p_modified,
+                         p_size);
+    if (ret && p_written) {
+        emit fileWritten(p_filePath);
+    }
+
+    return ret;
+}
+
+bool VFileSaver::isSavingLocked(const QString &p_filePath) const
+{
+    if (m_writingPath == p_filePath) {
+        return true;
+    }
+
+    for (auto const & job : m_pending) {
+        if (job.m_filePath == p_filePath) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VFileSaver::waitForSaved(const QString &p_filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    while (isSavingLocked(p_filePath)) {
+        m_doneCond.wait(&m_mutex);
+    }
+}
+
+void VFileSaver::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_pending.isEmpty() || !m_writingPath.isEmpty()) {
+        m_doneCond.wait(&m_mutex);
+    }
+}
+
+void VFileSaver::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        if (m_pending.isEmpty()) {
+            if (m_quit) {
+                break;
+            }
+
+            m_pendingCond.wait(&m_mutex);
+            continue;
+        }
+
+        Job job = m_pending.takeFirst();
+        m_writingPath = job.m_filePath;
+        locker.unlock();
+
+        QByteArray hash = job.m_lastHash;
+        bool written = false;
+        QDateTime modified;
+        qint64 size = -1;
+        bool ret = writeFile(job.m_filePath,
+                             job.m_content,
+                             hash,
+                             job.m_lastModified,
+                             job.m_lastSize,
+                             written,
+                             modified,
+                             size);
+
+        // Emit before the waiters are woken so the result is already posted.
+        emit fileSaved(job.m_serial, ret, written, hash, modified, size);
+        if (ret && written) {
+            emit fileWritten(job.m_filePath);
+        }
+
+        locker.relock();
+        m_writingPath.clear();
+        m_doneCond.wakeAll();
+    }
+}
+
+bool VFileSaver::writeFile(const QString &p_filePath,
+                           const QString &p_content,
+                           QByteArray &p_hash,
+                           const QDateTime &p_lastModified,
+                           qint64 p_lastSize,
+                           bool &p_written,
+                           QDateTime &p_modified,
+                           qint64 &p_size)
+{
+    p_written = false;
+
+    QByteArray hash = contentHash(p_content);
+    if (hash == p_hash) {
+        // @p_hash is the content we read or wrote last time. The file may have
+        // been changed outside since then.
+        QFileInfo fi(p_filePath);
+        if (fi.exists()
+            && fi.lastModified() == p_lastModified
+            && fi.size() == p_lastSize) {
+            qDebug() << "skip writing unchanged file" << p_filePath;
+            return true;
+        }
+    }
+
+    QSaveFile file(p_filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "fail to open file" << p_filePath << "to write";
+        return false;
+    }
+
+    QTextStream stream(&file);
+    stream << p_content;
+    stream.flush();
+    if (stream.status() != QTextStream::Ok || !file.commit()) {
+        qWarning() << "fail to write file" << p_filePath << file.errorString();
+        return false;
+    }
+
+    // Stat it here so the GUI thread need not touch the disk.
+    QFileInfo fi(p_filePath);
+    p_modified = fi.lastModified();
+    p_size = fi.size();
+
+    p_hash = hash;
+    p_written = true;
+    qDebug() << "write file content:" << p_filePath;
+    return true;
+}
+
+QByteArray VFileSaver::contentHash(const QString &p_content)
+{
+    return QCryptographicHash::hash(p_content.toUtf8(), QCryptographicHash::Md5);
+}
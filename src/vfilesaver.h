@@ -0,0 +1,131 @@
+#ifndef VFILESAVER_H
+#define VFILESAVER_H
+
+#include <QThread>
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QDateTime>
+#include <QMutex>
+#include <QWaitCondition>
+
+
+// Save note files in a background thread.
+// The content is hashed and the write is skipped if it equals the content on
+// disk and the file is not changed since then. Otherwise it is encoded and
+// written to a temporary file which is then renamed over the file, so a failed
+// write never truncates the note.
+// Saves to the same file are coalesced and done in order.
+class VFileSaver : public QThread
+{
+    Q_OBJECT
+public:
+    // Should be called in the main thread first.
+    static VFileSaver *getInstance();
+
+    ~VFileSaver();
+
+    // Queue @p_content to be written to @p_filePath.
+    // @p_lastHash: hash of the content on disk.
+    // @p_lastModified, @p_lastSize: state of the file when @p_lastHash is got.
+    // Returns the serial of this save passed back by fileSaved().
+    quint64 save(const QString &p_filePath,
+                 const QString &p_content,
+                 const QByteArray &p_lastHash,
+                 const QDateTime &p_lastModified,
+                 qint64 p_lastSize);
+
+    // Write @p_content to @p_filePath in the calling thread after the pending
+    // saves of it are done.
+    // @p_hash: hash of the content on disk, updated to the hash of @p_content.
+    // @p_lastModified, @p_lastSize: state of the file when @p_hash is got.
+    // @p_written: whether it is written. False if the content is not changed.
+    // @p_modified, @p_size: state of the file after the write.
+    bool saveNow(const QString &p_filePath,
+                 const QString &p_content,
+                 QByteArray &p_hash,
+                 const QDateTime &p_lastModified,
+                 qint64 p_lastSize,
+                 bool &p_written,
+                 QDateTime &p_modified,
+                 qint64 &p_size);
+
+    // Wait until the pending saves of @p_filePath are done.
+    void waitForSaved(const QString &p_filePath);
+
+    // Wait until all the pending saves are done.
+    void flush();
+
+    static QByteArray contentHash(const QString &p_content);
+
+signals:
+    // Emitted in the saver thread when save @p_serial is done.
+    // @p_hash: hash of the content on disk after the save.
+    // @p_modified, @p_size: state of the file right after it is written.
+    void fileSaved(quint64 p_serial,
+                   bool p_ok,
+                   bool p_written,
+                   const QByteArray &p_hash,
+                   const QDateTime &p_modified,
+                   qint64 p_size);
+
+    // Emitted in the writing thread once @p_filePath is written by save() or
+    // saveNow().
+    void fileWritten(const QString &p_filePath);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    struct Job
+    {
+        quint64 m_serial;
+
+        QString m_filePath;
+
+        QString m_content;
+
+        QByteArray m_lastHash;
+
+        QDateTime m_lastModified;
+
+        qint64 m_lastSize;
+    };
+
+    explicit VFileSaver(QObject *p_parent = nullptr);
+
+    // Whether there is a pending or ongoing save of @p_filePath.
+    // Should be called with m_mutex locked.
+    bool isSavingLocked(const QString &p_filePath) const;
+
+    static bool writeFile(const QString &p_filePath,
+                          const QString &p_content,
+                          QByteArray &p_hash,
+                          const QDateTime &p_lastModified,
+                          qint64 p_lastSize,
+                          bool &p_written,
+                          QDateTime &p_modified,
+                          qint64 &p_size);
+
+    // Protect all the fields below.
+    QMutex m_mutex;
+
+    // Wake the saver thread.
+    QWaitCondition m_pendingCond;
+
+    // Wake who waits for the saves.
+    QWaitCondition m_doneCond;
+
+    QList<Job> m_pending;
+
+    // File being written.
+    QString m_writingPath;
+
+    quint64 m_serial;
+
+    bool m_quit;
+
+    static VFileSaver *s_instance;
+};
+
+#endif // VFILESAVER_H
@@ -0,0 +1,153 @@
+#include "vfilewatcher.h"
+
+#include <QCoreApplication>
+#include <QFileSystemWatcher>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QStorageInfo>
+#include <QDebug>
+
+#if defined(Q_OS_LINUX)
+#include <sys/vfs.h>
+#endif
+
+// Delay in ms to coalesce notifications of the same file.
+// Editors may write a file with several operations.
+#define COALESCE_DELAY 200
+
+VFileWatcher *VFileWatcher::s_instance = NULL;
+
+VFileWatcher::VFileWatcher(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged,
+            this, &VFileWatcher::handleFileChanged);
+
+    m_coalesceTimer = new QTimer(this);
+    m_coalesceTimer->setSingleShot(true);
+    m_coalesceTimer->setInterval(COALESCE_DELAY);
+    connect(m_coalesceTimer, &QTimer::timeout,
+            this, &VFileWatcher::emitChangedFiles);
+}
+
+VFileWatcher *VFileWatcher::getInstance()
+{
+    if (!s_instance) {
+        s_instance = new VFileWatcher(QCoreApplication::instance());
+    }
+
+    return s_instance;
+}
+
+void VFileWatcher::setWatchedFiles(const QStringList &p_paths)
+{
+    QSet<QString> files = p_paths.toSet();
+    QSet<QString> watched = m_watcher->files().toSet();
+
+    QStringList removed;
+    for (auto const & file : watched) {
+        if (!files.contains(file)) {
+            removed.append(file);
+        }
+    }
+
+    if (!removed.isEmpty()) {
+        m_watcher->removePaths(removed);
+    }
+
+    m_files = files;
+    m_polledFiles.intersect(m_files);
+
+    // Files may be dropped by the watcher once replaced or removed, or fail to
+    // be watched before. Try them again.
+    QStringList added;
+    for (auto const & file : m_files) {
+        if (watched.contains(file)
+            || m_polledFiles.contains(file)
+            || !QFileInfo::exists(file)) {
+            continue;
+        }
+
+        if (isOnNetworkFileSystem(file)) {
+            qDebug() << "file on network file system, fall back to polling" << file;
+            m_polledFiles.insert(file);
+            continue;
+        }
+
+        added.append(file);
+    }
+
+    if (!added.isEmpty()) {
+        QStringList failed = m_watcher->addPaths(added);
+        if (!failed.isEmpty()) {
+            qDebug() << "fail to watch files, fall back to polling" << failed;
+        }
+    }
+}
+
+bool VFileWatcher::isWatched(const QString &p_path) const
+{
+    return m_watcher->files().contains(p_path);
+}
+
+void VFileWatcher::handleFileChanged(const QString &p_path)
+{
+    if (!m_files.contains(p_path)) {
+        return;
+    }
+
+    // The file may be replaced by a new one, which is no longer watched.
+    if (!m_watcher->files().contains(p_path) && QFileInfo::exists(p_path)) {
+        m_watcher->addPath(p_path);
+    }
+
+    m_changedFiles.insert(p_path);
+    m_coalesceTimer->start();
+}
+
+void VFileWatcher::emitChangedFiles()
+{
+    QSet<QString> files;
+    files.swap(m_changedFiles);
+    for (auto const & file : files) {
+        if (m_files.contains(file)) {
+            emit fileChanged(file);
+        }
+    }
+}
+
+bool VFileWatcher::isOnNetworkFileSystem(const QString &p_path)
+{
+#if defined(Q_OS_LINUX)
+    struct statfs st;
+    if (::statfs(QFile::encodeName(p_path).constData(), &st) != 0) {
+        return false;
+    }
+
+    switch ((unsigned long)st.f_type) {
+    case 0x6969:        // NFS
+    case 0x517b:        // SMB
+    case 0xff534d42:    // CIFS
+    case 0xfe534d42:    // SMB2
+    case 0x65735546:    // FUSE
+    case 0x5346414f:    // AFS
+    case 0x73757245:    // Coda
+    case 0x01021997:    // 9P
+    case 0x00c36400:    // Ceph
+        return true;
+
+    default:
+        return false;
+    }
+#else
+    QString type = QString::fromLatin1(QStorageInfo(p_path).fileSystemType()).toLower();
+    return type.startsWith(QStringLiteral("nfs"))
+           || type.startsWith(QStringLiteral("smb"))
+           || type.startsWith(QStringLiteral("cifs"))
+           || type.startsWith(QStringLiteral("afp"))
+           || type.startsWith(QStringLiteral("webdav"))
+           || type.contains(QStringLiteral("fuse"));
+#endif
+}
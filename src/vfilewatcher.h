@@ -0,0 +1,63 @@
+#ifndef VFILEWATCHER_H
+#define VFILEWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Watch files for changes made outside VNote with file system notifications.
+// Notifications of the same file within a short time are coalesced.
+// Files which could not be watched, such as files on file systems without
+// notifications, are left to be polled by the callers. So are files on network
+// file systems, whose notifications miss the changes made by other machines.
+class VFileWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    // Should be called in the main thread.
+    static VFileWatcher *getInstance();
+
+    // Watch exactly files @p_paths. Files not in @p_paths any more are unwatched.
+    void setWatchedFiles(const QStringList &p_paths);
+
+    // Whether file @p_path is watched with notifications.
+    // Returns false if it should be polled.
+    bool isWatched(const QString &p_path) const;
+
+signals:
+    // Emitted when watched file @p_path is changed, moved, or removed.
+    void fileChanged(const QString &p_path);
+
+private slots:
+    void handleFileChanged(const QString &p_path);
+
+    void emitChangedFiles();
+
+private:
+    explicit VFileWatcher(QObject *p_parent = nullptr);
+
+    // Whether file @p_path is on a network file system, such as NFS, SMB, or
+    // FUSE.
+    static bool isOnNetworkFileSystem(const QString &p_path);
+
+    QFileSystemWatcher *m_watcher;
+
+    // Files requested to watch.
+    QSet<QString> m_files;
+
+    // Files on network file systems, which are left to be polled.
+    QSet<QString> m_polledFiles;
+
+    // Changed files waiting to be emitted.
+    QSet<QString> m_changedFiles;
+
+    QTimer *m_coalesceTimer;
+
+    static VFileWatcher *s_instance;
+};
+
+#endif // VFILEWATCHER_H
@@ -0,0 +1,159 @@
+#include "vimagedecoder.h"
+
+#include <QCoreApplication>
+#include <QImageReader>
+#include <QDebug>
+
+// Max number of threads to decode images.
+#define MAX_DECODE_THREADS 2
+
+VImageDecoderWorker::VImageDecoderWorker(VImageDecoder *p_decoder, QObject *p_parent)
+    : QThread(p_parent),
+      m_decoder(p_decoder)
+{
+}
+
+void VImageDecoderWorker::run()
+{
+    VImageDecoder::Job job;
+    while (m_decoder->takeJob(job)) {
+        if (job.m_sizeOnly) {
+            QSize size = VImageDecoder::readImageSize(job.m_filePath);
+            emit m_decoder->imageSizeRead(job.m_serial, size);
+        } else {
+            QImage image = VImageDecoder::decodeImage(job.m_filePath, job.m_size);
+            emit m_decoder->imageDecoded(job.m_serial, image);
+        }
+    }
+}
+
+
+VImageDecoder *VImageDecoder::s_instance = NULL;
+
+VImageDecoder::VImageDecoder(QObject *p_parent)
+    : QObject(p_parent),
+      m_serial(0),
+      m_quit(false)
+{
+    int numThread = qBound(1, QThread::idealThreadCount() - 1, MAX_DECODE_THREADS);
+    for (int i = 0; i < numThread; ++i) {
+        VImageDecoderWorker *th = new VImageDecoderWorker(this, this);
+        m_workers.append(th);
+        th->start(QThread::LowPriority);
+    }
+}
+
+VImageDecoder::~VImageDecoder()
+{
+    // Pending jobs are dropped.
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_jobs.clear();
+        m_jobCond.wakeAll();
+    }
+
+    for (auto th : m_workers) {
+        th->wait();
+    }
+
+    if (s_instance == this) {
+        s_instance = NULL;
+    }
+}
+
+VImageDecoder *VImageDecoder::getInstance()
+{
+    if (!s_instance) {
+        s_instance = new VImageDecoder(QCoreApplication::instance());
+    }
+
+    return s_instance;
+}
+
+quint64 VImageDecoder::decode(const QString &p_filePath, const QSize &p_size)
+{
+    QMutexLocker locker(&m_mutex);
+    Job job;
+    job.m_serial = ++m_serial;
+    job.m_filePath = p_filePath;
+    job.m_size = p_size;
+    job.m_sizeOnly = false;
+    m_jobs.append(job);
+
+    m_jobCond.wakeOne();
+    return job.m_serial;
+}
+
+quint64 VImageDecoder::readSize(const QString &p_filePath)
+{
+    QMutexLocker locker(&m_mutex);
+    Job job;
+    job.m_serial = ++m_serial;
+    job.m_filePath = p_filePath;
+    job.m_sizeOnly = true;
+
+    // It is cheap and lays out the placeholder, so do it before decoding.
+    m_jobs.prepend(job);
+
+    m_jobCond.wakeOne();
+    return job.m_serial;
+}
+
+void VImageDecoder::cancel(quint64 p_serial)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < m_jobs.size(); ++i) {
+        if (m_jobs[i].m_serial == p_serial) {
+            m_jobs.removeAt(i);
+            break;
+        }
+    }
+}
+
+bool VImageDecoder::takeJob(Job &p_job)
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        if (m_quit) {
+            return false;
+        }
+
+        if (!m_jobs.isEmpty()) {
+            p_job = m_jobs.takeFirst();
+            return true;
+        }
+
+        m_jobCond.wait(&m_mutex);
+    }
+}
+
+QSize VImageDecoder::readImageSize(const QString &p_filePath)
+{
+    QImageReader reader(p_filePath);
+    reader.setDecideFormatFromContent(true);
+    return reader.size();
+}
+
+QImage VImageDecoder::decodeImage(const QString &p_filePath, const QSize &p_size)
+{
+    QImageReader reader(p_filePath);
+    reader.setDecideFormatFromContent(true);
+
+    if (p_size.isValid()) {
+        QSize size = reader.size();
+        if (!size.isValid()
+            || p_size.width() < size.width()
+            || p_size.height() < size.height()) {
+            // Some formats, such as JPEG, decode at the scaled size directly.
+            reader.setScaledSize(p_size);
+        }
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "fail to decode image" << p_filePath << reader.errorString();
+    }
+
+    return image;
+}
@@ -0,0 +1,109 @@
+#ifndef VIMAGEDECODER_H
+#define VIMAGEDECODER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+class VImageDecoder;
+
+// Worker decoding the queued images of the decoder.
+class VImageDecoderWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit VImageDecoderWorker(VImageDecoder *p_decoder, QObject *p_parent = nullptr);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    VImageDecoder *m_decoder;
+};
+
+
+// Decode image files in background threads.
+// Images are decoded by QImageReader directly at the requested size, which
+// saves the time and memory of decoding a large image at full resolution just
+// to show it scaled down.
+class VImageDecoder : public QObject
+{
+    Q_OBJECT
+
+    friend class VImageDecoderWorker;
+
+public:
+    // Should be called in the main thread first.
+    static VImageDecoder *getInstance();
+
+    ~VImageDecoder();
+
+    // Queue decoding image @p_filePath scaled to @p_size.
+    // @p_size: decode at the original size if invalid or not smaller.
+    // Returns the serial passed back by imageDecoded().
+    quint64 decode(const QString &p_filePath, const QSize &p_size);
+
+    // Queue reading the size of image @p_filePath from its header.
+    // Returns the serial passed back by imageSizeRead().
+    quint64 readSize(const QString &p_filePath);
+
+    // Cancel decoding or reading the size of @p_serial if it has not been
+    // started.
+    void cancel(quint64 p_serial);
+
+    // Read the size of image @p_filePath from its header without decoding it.
+    // Returns an invalid size if it could not be read.
+    static QSize readImageSize(const QString &p_filePath);
+
+signals:
+    // Emitted in a worker thread when decoding @p_serial is done.
+    // @p_image is null if it fails.
+    void imageDecoded(quint64 p_serial, const QImage &p_image);
+
+    // Emitted in a worker thread when reading the size of @p_serial is done.
+    // @p_size is invalid if it fails.
+    void imageSizeRead(quint64 p_serial, const QSize &p_size);
+
+private:
+    struct Job
+    {
+        quint64 m_serial;
+
+        QString m_filePath;
+
+        QSize m_size;
+
+        // Whether only the size is read.
+        bool m_sizeOnly;
+    };
+
+    explicit VImageDecoder(QObject *p_parent = nullptr);
+
+    // Take next job, waiting for one to be queued.
+    // Returns false if the decoder quits.
+    bool takeJob(Job &p_job);
+
+    static QImage decodeImage(const QString &p_filePath, const QSize &p_size);
+
+    // Protect all the fields below.
+    QMutex m_mutex;
+
+    QWaitCondition m_jobCond;
+
+    QList<Job> m_jobs;
+
+    quint64 m_serial;
+
+    bool m_quit;
+
+    QList<VImageDecoderWorker *> m_workers;
+
+    static VImageDecoder *s_instance;
+};
+
+#endif // VIMAGEDECODER_H
@@ -8,7 +8,17 @@ VImageResourceManager2::VImageResourceManager2()
 void VImageResourceManager2::addImage(const QString &p_name,
                                       const QPixmap &p_image)
 {
-    m_images.insert(p_name, p_image);
+    addImage(p_name, p_image, p_image.size());
+}
+
+void VImageResourceManager2::addImage(const QString &p_name,
+                                      const QPixmap &p_image,
+                                      const QSize &p_size)
+{
+    Image img;
+    img.m_pixmap = p_image;
+    img.m_size = p_size;
+    m_images.insert(p_name, img);
 }
 
 bool VImageResourceManager2::contains(const QString &p_name) const
@@ -19,13 +29,23 @@ bool VImageResourceManager2::contains(const QString &p_name) const
 const QPixmap *VImageResourceManager2::findImage(const QString &p_name) const
 {
     auto it = m_images.find(p_name);
-    if (it != m_images.end()) {
-        return &it.value();
+    if (it != m_images.end() && !it.value().m_pixmap.isNull()) {
+        return &it.value().m_pixmap;
     }
 
     return NULL;
 }
 
+QSize VImageResourceManager2::imageSize(const QString &p_name) const
+{
+    auto it = m_images.find(p_name);
+    if (it != m_images.end()) {
+        return it.value().m_size;
+    }
+
+    return QSize();
+}
+
 void VImageResourceManager2::clear()
 {
     m_images.clear();
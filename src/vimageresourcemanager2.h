@@ -4,6 +4,7 @@
 #include <QHash>
 #include <QString>
 #include <QPixmap>
+#include <QSize>
 
 
 class VImageResourceManager2
@@ -15,19 +16,35 @@ public:
     // If @p_name already exists in the resources, it will update it.
     void addImage(const QString &p_name, const QPixmap &p_image);
 
+    // Add an image which is laid out in @p_size, which may differ from the
+    // size of @p_image. A null @p_image is a placeholder, which takes space
+    // but draws nothing.
+    void addImage(const QString &p_name, const QPixmap &p_image, const QSize &p_size);
+
     // Remove image @p_name.
     void removeImage(const QString &p_name);
 
     // Whether the resources contains image with name @p_name.
     bool contains(const QString &p_name) const;
 
+    // Returns NULL if not exists or it is a placeholder.
     const QPixmap *findImage(const QString &p_name) const;
 
+    // Size in which image @p_name is laid out.
+    QSize imageSize(const QString &p_name) const;
+
     void clear();
 
 private:
+    struct Image
+    {
+        QPixmap m_pixmap;
+
+        QSize m_size;
+    };
+
     // All the images resources.
-    QHash<QString, QPixmap> m_images;
+    QHash<QString, Image> m_images;
 };
 
 #endif // VIMAGERESOURCEMANAGER2_H
@@ -237,6 +237,17 @@ QString VListFolderUE::currentItemFolder(int p_id)
     return folder;
 }
 
+// Sum of the scores of the keywords matched.
+static int rankScore(const QVector<VFuzzyMatcher> &p_matchers, const QString &p_name)
+{
+    int score = 0;
+    for (auto const & matcher : p_matchers) {
+        score += qMax(0, matcher.score(p_name));
+    }
+
+    return score;
+}
+
 bool VListFolderUE::listFolder(const QString &p_path, const QString &p_cmd)
 {
     VDirectory *dir = g_vnote->getInternalDirectory(p_path);
@@ -279,7 +290,7 @@ bool VListFolderUE::listFolder(const QString &p_path, const QString &p_cmd)
             addResultItem(item);
         }
     } else {
-        // Search the content.
+        // Search the content and list the results by how well they match.
         VSearchConfig config(VSearchConfig::CurrentFolder,
                              VSearchConfig::Name,
                              VSearchConfig::Note | VSearchConfig::Folder,
@@ -288,6 +299,13 @@ bool VListFolderUE::listFolder(const QString &p_path, const QString &p_cmd)
                              p_cmd,
                              QString());
 
+        // Names containing the keywords are ranked by the fuzzy score of them.
+        QVector<VFuzzyMatcher> matchers;
+        for (auto const & key : config.m_token.m_keywords) {
+            matchers.append(VFuzzyMatcher(key, config.m_token.m_caseSensitivity));
+        }
+
+        VTopK<QSharedPointer<VSearchResultItem> > ranker;
         for (auto const & it : dir->getSubDirs()) {
             QString name = it->getName();
             if (!config.m_token.matched(name)) {
@@ -298,7 +316,7 @@ bool VListFolderUE::listFolder(const QString &p_path, const QString &p_cmd)
                                                                          VSearchResultItem::LineNumber,
                                                                          name,
                                                                          it->fetchPath()));
-            addResultItem(item);
+            ranker.add(rankScore(matchers, name), item);
         }
 
         for (auto const & file : dir->getFiles()) {
@@ -311,6 +329,10 @@ bool VListFolderUE::listFolder(const QString &p_path, const QString &p_cmd)
                                                                          VSearchResultItem::LineNumber,
                                                                          name,
                                                                          file->fetchPath()));
+            ranker.add(rankScore(matchers, name), item);
+        }
+
+        for (auto const & item : ranker.takeSorted()) {
             addResultItem(item);
         }
     }
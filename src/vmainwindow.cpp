@@ -49,6 +49,8 @@
 #include "vexplorer.h"
 #include "vlistue.h"
 #include "vtagexplorer.h"
+#include "vdirconfigwriter.h"
+#include "vnotebookloader.h"
 
 extern VConfigManager *g_config;
 
@@ -266,6 +268,13 @@ void VMainWindow::setupUI()
             this, &VMainWindow::handleAreaTabStatusUpdated);
     connect(m_editArea, &VEditArea::statusMessage,
             this, &VMainWindow::showStatusMessage);
+    // Configs written in background could not be rolled back by the callers.
+    connect(VDirConfigWriter::getInstance(), &VDirConfigWriter::writeFailed,
+            this, [this](const QString &p_filePath) {
+                showStatusMessage(tr("Fail to write folder configuration %1. "
+                                     "It will be written again on next change.")
+                                    .arg(p_filePath));
+            });
     connect(m_editArea, &VEditArea::vimStatusUpdated,
             this, &VMainWindow::handleVimStatusUpdated);
     connect(m_findReplaceDialog, &VFindReplaceDialog::findTextChanged,
@@ -359,6 +368,12 @@ void VMainWindow::setupNotebookPanel()
     connect(m_notebookSelector, &VNotebookSelector::curNotebookChanged,
             this, &VMainWindow::handleCurrentNotebookChanged);
 
+    VNotebookLoader *loader = vnote->getNotebookLoader();
+    connect(loader, &VNotebookLoader::notebookLoaded,
+            m_notebookSelector, &VNotebookSelector::updateNotebookItem);
+    connect(loader, &VNotebookLoader::notebookLoaded,
+            m_dirTree, &VDirectoryTree::handleNotebookLoaded);
+
     connect(m_dirTree, &VDirectoryTree::currentDirectoryChanged,
             this, &VMainWindow::handleCurrentDirectoryChanged);
 
@@ -2185,6 +2200,17 @@ void VMainWindow::closeEvent(QCloseEvent *event)
             g_config->setLastOpenedFiles(fileInfos);
         }
 
+        // Write all the pending directory configs.
+        if (!VDirConfigWriter::getInstance()->flush()) {
+            VUtils::showMessage(QMessageBox::Warning,
+                                tr("Warning"),
+                                tr("Fail to write the configuration of some folders."),
+                                tr("Please check the log for details."),
+                                QMessageBox::Ok,
+                                QMessageBox::Ok,
+                                this);
+        }
+
         QMainWindow::closeEvent(event);
         qApp->quit();
     } else {
@@ -3222,6 +3248,8 @@ void VMainWindow::initUniversalEntry()
     m_ue->registerEntry('t', searchUE, VSearchUE::Name_Note_Buffer);
     m_ue->registerEntry('g', searchUE, VSearchUE::Content_Note_Buffer);
     m_ue->registerEntry('b', searchUE, VSearchUE::Outline_Note_Buffer);
+    m_ue->registerEntry('s', searchUE, VSearchUE::Outline_Note_AllNotebook);
+    m_ue->registerEntry('x', searchUE, VSearchUE::Outline_Note_CurrentNotebook);
     m_ue->registerEntry('u', searchUE, VSearchUE::Content_Note_ExplorerDirectory);
     m_ue->registerEntry('y', new VOutlineUE(this), 0);
     m_ue->registerEntry('h', searchUE, VSearchUE::Path_FolderNote_AllNotebook);
@@ -3286,15 +3314,33 @@ void VMainWindow::setToolBarVisible(bool p_visible)
 void VMainWindow::kickOffStartUpTimer(const QStringList &p_files)
 {
     QTimer::singleShot(300, [this, p_files]() {
-        checkNotebooks();
-        QCoreApplication::sendPostedEvents();
-        promptNewNotebookIfEmpty();
+        // Notebooks may still be loaded in background. The tree of current
+        // notebook will be built once it is loaded.
+        m_notebookSelector->restoreCurrentNotebook();
         QCoreApplication::sendPostedEvents();
         openStartupPages();
         openFiles(p_files, false, g_config->getNoteOpenMode(), false, true);
+
+        VNotebookLoader *loader = vnote->getNotebookLoader();
+        if (loader->isLoading()) {
+            connect(loader, &VNotebookLoader::finished,
+                    this, &VMainWindow::handleNotebooksLoaded);
+        } else {
+            handleNotebooksLoaded();
+        }
     });
 }
 
+void VMainWindow::handleNotebooksLoaded()
+{
+    disconnect(vnote->getNotebookLoader(), &VNotebookLoader::finished,
+               this, &VMainWindow::handleNotebooksLoaded);
+
+    checkNotebooks();
+    QCoreApplication::sendPostedEvents();
+    promptNewNotebookIfEmpty();
+}
+
 void VMainWindow::showNotebookPanel()
 {
     changePanelView(PanelViewState::VerticalMode);
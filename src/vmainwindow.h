@@ -141,6 +141,9 @@ private slots:
     // Display shortcuts help.
     void shortcutsHelp();
 
+    // Fix invalid notebooks after all notebooks are loaded in background.
+    void handleNotebooksLoaded();
+
     void changeExpandTab(bool checked);
     void setTabStopWidth(QAction *action);
     void setEditorBackgroundColor(QAction *action);
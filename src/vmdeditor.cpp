@@ -27,6 +27,16 @@
 
 extern VWebUtils *g_webUtils;
 
+// Files with more chars than this are loaded progressively.
+#define PROGRESSIVE_LOAD_THRESHOLD (512 * 1024)
+
+// Size in chars of each chunk to load, ended at a line boundary.
+// The first one should fill the first screen.
+#define LOAD_CHUNK_SIZE (32 * 1024)
+
+// Max time in ms to load chunks in one step.
+#define LOAD_STEP_BUDGET 15
+
 extern VConfigManager *g_config;
 
 VMdEditor::VMdEditor(VFile *p_file,
@@ -40,7 +50,9 @@ VMdEditor::VMdEditor(VFile *p_file,
       m_textToHtmlDialog(NULL),
       m_zoomDelta(0),
       m_editTab(NULL),
-      m_copyTimeStamp(0)
+      m_copyTimeStamp(0),
+      m_loadingPos(0),
+      m_readOnlyAfterLoading(true)
 {
     Q_ASSERT(p_file->getDocType() == DocType::Markdown);
 
@@ -102,6 +114,12 @@ VMdEditor::VMdEditor(VFile *p_file,
     connect(this, &VTextEdit::cursorPositionChanged,
             m_object, &VEditorObject::cursorPositionChanged);
 
+    m_loadTimer = new QTimer(this);
+    m_loadTimer->setSingleShot(false);
+    m_loadTimer->setInterval(0);
+    connect(m_loadTimer, &QTimer::timeout,
+            this, &VMdEditor::loadNextChunk);
+
     setDisplayScaleFactor(VUtils::calculateScaleFactor());
 
     updateFontAndPalette();
@@ -151,6 +169,13 @@ void VMdEditor::beginEdit()
 
     emit statusChanged();
 
+    if (isLoadingContent()) {
+        // Editing is enabled once the loading completes.
+        m_readOnlyAfterLoading = false;
+        setReadOnly(true);
+        return;
+    }
+
     if (m_freshEdit) {
         m_pegHighlighter->updateHighlight();
         relayout();
@@ -162,6 +187,7 @@ void VMdEditor::beginEdit()
 void VMdEditor::endEdit()
 {
     setReadOnlyAndHighlightCurrentLine(true);
+    m_readOnlyAfterLoading = true;
 
     clearUnusedImages();
 }
@@ -170,7 +196,7 @@ void VMdEditor::saveFile()
 {
     Q_ASSERT(m_file->isModifiable());
 
-    if (!document()->isModified()) {
+    if (isLoadingContent() || !document()->isModified()) {
         return;
     }
 
@@ -184,10 +210,18 @@ void VMdEditor::saveFile()
 
 void VMdEditor::reloadFile()
 {
+    stopLoadingContent();
+
+    const QString &content = m_file->getContent();
+    if (content.size() > PROGRESSIVE_LOAD_THRESHOLD) {
+        m_freshEdit = true;
+        loadContent(content);
+        return;
+    }
+
     bool readonly = isReadOnly();
     setReadOnly(true);
 
-    const QString &content = m_file->getContent();
     setPlainText(content);
     setModified(false);
     m_pegHighlighter->updateHighlightFast();
@@ -199,6 +233,83 @@ void VMdEditor::reloadFile()
     refreshPreview();
 }
 
+// Return the end of the chunk from @p_pos, which is after a new line if
+// possible.
+static int chunkEnd(const QString &p_content, int p_pos)
+{
+    int end = p_pos + LOAD_CHUNK_SIZE;
+    if (end >= p_content.size()) {
+        return p_content.size();
+    }
+
+    int idx = p_content.indexOf(QChar('\n'), end);
+    return idx == -1 ? p_content.size() : idx + 1;
+}
+
+void VMdEditor::loadContent(const QString &p_content)
+{
+    m_readOnlyAfterLoading = isReadOnly();
+    setReadOnly(true);
+
+    // Highlight once the whole content is loaded.
+    m_pegHighlighter->setParseSuspended(true);
+    document()->setUndoRedoEnabled(false);
+
+    m_loadingContent = p_content;
+    m_loadingPos = chunkEnd(p_content, 0);
+    setPlainText(p_content.left(m_loadingPos));
+    setModified(false);
+
+    qDebug() << "load content progressively" << p_content.size();
+    m_loadTimer->start();
+}
+
+void VMdEditor::loadNextChunk()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+    while (m_loadingPos < m_loadingContent.size()
+           && timer.elapsed() < LOAD_STEP_BUDGET) {
+        int end = chunkEnd(m_loadingContent, m_loadingPos);
+        cursor.insertText(m_loadingContent.mid(m_loadingPos, end - m_loadingPos));
+        m_loadingPos = end;
+    }
+
+    setModified(false);
+
+    if (m_loadingPos < m_loadingContent.size()) {
+        return;
+    }
+
+    stopLoadingContent();
+
+    m_pegHighlighter->updateHighlight();
+
+    refreshPreview();
+}
+
+void VMdEditor::stopLoadingContent()
+{
+    if (!isLoadingContent()) {
+        return;
+    }
+
+    m_loadTimer->stop();
+    m_loadingContent = QString();
+    m_loadingPos = 0;
+
+    document()->setUndoRedoEnabled(true);
+    m_pegHighlighter->setParseSuspended(false);
+
+    if (!m_readOnlyAfterLoading) {
+        setReadOnlyAndHighlightCurrentLine(false);
+        relayout();
+    }
+}
+
 bool VMdEditor::scrollToBlock(int p_blockNumber)
 {
     QTextBlock block = document()->findBlockByNumber(p_blockNumber);
@@ -609,11 +720,27 @@ void VMdEditor::initInitImages()
                                                        ImageLink::LocalRelativeInternal);
 }
 
+static QString imagePathKey(const QString &p_path)
+{
+    QString key = QDir::cleanPath(p_path);
+#if defined(Q_OS_WIN)
+    key = key.toLower();
+#endif
+
+    return key;
+}
+
 void VMdEditor::clearUnusedImages()
 {
     QVector<ImageLink> images = VUtils::fetchImagesFromMarkdownFile(m_file,
                                                                     ImageLink::LocalRelativeInternal);
 
+    // Paths of the images in the file, compared as VUtils::equalPath() does.
+    QSet<QString> usedImages;
+    for (auto const & img : images) {
+        usedImages.insert(imagePathKey(img.m_path));
+    }
+
     QSet<QString> unusedImages;
 
     if (!m_insertedImages.isEmpty()) {
@@ -624,15 +751,8 @@ void VMdEditor::clearUnusedImages()
                 continue;
             }
 
-            int j;
-            for (j = 0; j < images.size(); ++j) {
-                if (VUtils::equalPath(link.m_path, images[j].m_path)) {
-                    break;
-                }
-            }
-
             // This inserted image is no longer in the file.
-            if (j == images.size()) {
+            if (!usedImages.contains(imagePathKey(link.m_path))) {
                 unusedImages.insert(link.m_path);
             }
         }
@@ -645,15 +765,8 @@ void VMdEditor::clearUnusedImages()
 
         V_ASSERT(link.m_type == ImageLink::LocalRelativeInternal);
 
-        int j;
-        for (j = 0; j < images.size(); ++j) {
-            if (VUtils::equalPath(link.m_path, images[j].m_path)) {
-                break;
-            }
-        }
-
         // Original local relative image is no longer in the file.
-        if (j == images.size()) {
+        if (!usedImages.contains(imagePathKey(link.m_path))) {
             unusedImages.insert(link.m_path);
         }
     }
@@ -1071,11 +1184,17 @@ void VMdEditor::updateConfig()
 
 QString VMdEditor::getContent() const
 {
+    if (isLoadingContent()) {
+        return m_loadingContent;
+    }
+
     return toPlainText();
 }
 
 void VMdEditor::setContent(const QString &p_content, bool p_modified)
 {
+    stopLoadingContent();
+
     if (p_modified) {
         QTextCursor cursor = textCursor();
         cursor.select(QTextCursor::Document);
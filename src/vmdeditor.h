@@ -20,6 +20,7 @@ class VDocument;
 class VPreviewManager;
 class VCopyTextAsHtmlDialog;
 class VEditTab;
+class QTimer;
 
 class VMdEditor : public VTextEdit, public VEditor
 {
@@ -76,6 +77,9 @@ public:
 
     VPreviewManager *getPreviewManager() const;
 
+    // Whether a large file is being loaded.
+    bool isLoadingContent() const;
+
     void updateHeaderSequenceByConfigChange();
 
 public slots:
@@ -229,7 +233,16 @@ private slots:
     // Copy selected text as HTML.
     void handleCopyAsAction(QAction *p_act);
 
+    // Append next chunks of a large file being loaded within a time slice.
+    void loadNextChunk();
+
 private:
+    // Load @p_content into the document. A large one is loaded progressively
+    // in time-sliced steps after the first screen is shown.
+    void loadContent(const QString &p_content);
+
+    void stopLoadingContent();
+
     void updateHeadersHelper(const QVector<VElementRegion> &p_headerRegions, bool p_configChanged);
 
     // Update the config of VTextEdit according to global configurations.
@@ -280,6 +293,17 @@ private:
     VEditTab *m_editTab;
 
     int m_copyTimeStamp;
+
+    // Content being loaded progressively.
+    QString m_loadingContent;
+
+    // Position in m_loadingContent of the next chunk to load.
+    int m_loadingPos;
+
+    // Whether to be read-only after loading.
+    bool m_readOnlyAfterLoading;
+
+    QTimer *m_loadTimer;
 };
 
 inline PegMarkdownHighlighter *VMdEditor::getMarkdownHighlighter() const
@@ -291,4 +315,9 @@ inline VPreviewManager *VMdEditor::getPreviewManager() const
 {
     return m_previewMgr;
 }
+
+inline bool VMdEditor::isLoadingContent() const
+{
+    return !m_loadingContent.isNull();
+}
 #endif // VMDEDITOR_H
@@ -12,6 +12,9 @@
 #include "vconfigmanager.h"
 #include "vmarkdownconverter.h"
 #include "vnotebook.h"
+#include "vnotebookmanifest.h"
+#include "vnotefile.h"
+#include "vdirectory.h"
 #include "vtableofcontent.h"
 #include "dialog/vfindreplacedialog.h"
 #include "veditarea.h"
@@ -39,6 +42,7 @@ VMdTab::VMdTab(VFile *p_file, VEditArea *p_editArea,
       m_mdConType(g_config->getMdConverterType()),
       m_enableHeadingSequence(false),
       m_backupFileChecked(false),
+      m_backupRevision(-1),
       m_mode(Mode::InvalidMode),
       m_livePreviewHelper(NULL),
       m_mathjaxPreviewHelper(NULL)
@@ -47,6 +51,9 @@ VMdTab::VMdTab(VFile *p_file, VEditArea *p_editArea,
 
     m_file->open();
 
+    connect(m_file, &VFile::backgroundSaveFinished,
+            this, &VMdTab::handleBackgroundSaveFinished);
+
     HeadingSequenceType headingSequenceType = g_config->getHeadingSequenceType();
     if (headingSequenceType == HeadingSequenceType::Enabled) {
         m_enableHeadingSequence = true;
@@ -374,6 +381,7 @@ bool VMdTab::saveFile()
         } else {
             m_fileDiverged = false;
             m_checkFileChange = true;
+            updateOutlineIndex();
         }
     }
 
@@ -382,6 +390,48 @@ bool VMdTab::saveFile()
     return ret;
 }
 
+void VMdTab::saveFileInBackground()
+{
+    if (!m_isEditMode || !isModified()) {
+        return;
+    }
+
+    // Let saveFile() report the notes which could not be saved.
+    if (!m_file->isModifiable() || !QFileInfo::exists(m_file->fetchPath())) {
+        saveFile();
+        return;
+    }
+
+    // Snapshot the content. The encoding and write are done in background.
+    m_editor->saveFile();
+    m_file->saveInBackground();
+    m_fileDiverged = false;
+
+    updateStatus();
+}
+
+void VMdTab::handleBackgroundSaveFinished(bool p_ok)
+{
+    if (!p_ok) {
+        if (m_editor) {
+            m_editor->setModified(true);
+        }
+
+        updateStatus();
+
+        VUtils::showMessage(QMessageBox::Warning,
+                            tr("Warning"),
+                            tr("Fail to save note."),
+                            tr("Fail to write to disk when saving a note. Please try it again."),
+                            QMessageBox::Ok,
+                            QMessageBox::Ok,
+                            this);
+        return;
+    }
+
+    updateOutlineIndex();
+}
+
 bool VMdTab::isModified() const
 {
     return (m_editor ? m_editor->isModified() : false) || m_fileDiverged;
@@ -576,6 +626,30 @@ void VMdTab::updateOutlineFromHtml(const QString &p_tocHtml)
     emit outlineChanged(m_outline);
 }
 
+void VMdTab::updateOutlineIndex()
+{
+    if (m_file->getType() != FileType::Note
+        || m_outline.getType() != VTableOfContentType::BlockNumber) {
+        return;
+    }
+
+    QVector<VManifestHeading> headings;
+    const QVector<VTableOfContentItem> &table = m_outline.getTable();
+    headings.reserve(table.size());
+    for (auto const & it : table) {
+        if (it.isEmpty()) {
+            continue;
+        }
+
+        headings.append(VManifestHeading(it.m_level, it.m_name, it.m_blockNumber + 1));
+    }
+
+    VNoteFile *file = static_cast<VNoteFile *>((VFile *)m_file);
+    QString notePath = VNotebookManifest::childPath(file->getDirectory()->fetchRelativePath(),
+                                                    file->getName());
+    file->getNotebook()->updateManifestOutline(notePath, headings);
+}
+
 void VMdTab::updateOutlineFromHeaders(const QVector<VTableOfContentItem> &p_headers)
 {
     if (!m_isEditMode) {
@@ -1090,12 +1164,8 @@ void VMdTab::tabIsReady(TabReady p_mode)
         && p_mode == TabReady::EditMode) {
         // contentsChanged will be emitted even the content is not changed.
         connect(m_editor->document(), &QTextDocument::contentsChange,
-                this, [this]() {
-                    if (m_isEditMode) {
-                        m_backupTimer->stop();
-                        m_backupTimer->start();
-                    }
-                });
+                this, &VMdTab::handleContentsChange,
+                Qt::UniqueConnection);
     }
 
     if (m_editor
@@ -1106,10 +1176,53 @@ void VMdTab::tabIsReady(TabReady p_mode)
     }
 }
 
+void VMdTab::handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    // The highlighter re-formats blocks via contentsChange(pos, len, len)
+    // without touching the text, which does not bump the revision.
+    QTextDocument *doc = m_editor->document();
+    int revision = doc->revision();
+    if (p_charsRemoved == p_charsAdded && revision == m_backupRevision) {
+        return;
+    }
+
+    m_backupRevision = revision;
+
+    // Chars added may include the hidden last block separator.
+    int length = doc->characterCount() - 1;
+    int end = qMin(p_position + p_charsAdded, length);
+    QString inserted;
+    if (end > p_position) {
+        QTextCursor cursor(doc);
+        cursor.setPosition(p_position);
+        cursor.setPosition(end, QTextCursor::KeepAnchor);
+        inserted = cursor.selection().toPlainText();
+    }
+
+    // Record the changes in read mode too, such as of a reload, so the journal
+    // keeps up with the content. They are flushed with the next edit.
+    m_file->addBackupChange(p_position, inserted, length);
+
+    if (m_isEditMode) {
+        m_backupTimer->stop();
+        m_backupTimer->start();
+    }
+}
+
 void VMdTab::writeBackupFile()
 {
     Q_ASSERT(m_enableBackupFile && m_file->isModifiable());
-    m_file->writeBackupFile(m_editor->getContent());
+    // The content is not complete until a large file is loaded.
+    if (m_editor->isLoadingContent()) {
+        m_backupTimer->start();
+        return;
+    }
+
+    // Only the changes are appended. A snapshot of the whole content is
+    // written at first and once the changes outgrow it.
+    if (!m_file->flushBackupFile()) {
+        m_file->writeBackupFile(m_editor->getContent());
+    }
 }
 
 bool VMdTab::checkPreviousBackupFile()
@@ -1121,7 +1234,13 @@ bool VMdTab::checkPreviousBackupFile()
         return true;
     }
 
-    QString backupContent = m_file->readBackupFile(preFile);
+    QString backupContent;
+    if (!m_file->readBackupFile(preFile, backupContent)) {
+        // Nothing to recover from it.
+        VUtils::deleteFile(preFile);
+        return true;
+    }
+
     if (m_file->getContent() == backupContent) {
         // Found backup file with identical content.
         // Just discard the backup file.
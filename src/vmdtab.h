@@ -37,6 +37,8 @@ public:
     // Save file.
     bool saveFile() Q_DECL_OVERRIDE;
 
+    void saveFileInBackground() Q_DECL_OVERRIDE;
+
     bool isModified() const Q_DECL_OVERRIDE;
 
     // Scroll to @p_header.
@@ -136,6 +138,11 @@ private slots:
     // m_editor requests to save changes and enter read mode.
     void saveAndRead();
 
+    void handleBackgroundSaveFinished(bool p_ok);
+
+    // Record the change of the document to backup file.
+    void handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded);
+
     // m_editor requests to discard changes and enter read mode.
     void discardAndRead();
 
@@ -199,6 +206,10 @@ private:
     // Focus the proper child widget.
     void focusChild() Q_DECL_OVERRIDE;
 
+    // Update the outline index of the notebook with headers of the editor
+    // after the note is saved.
+    void updateOutlineIndex();
+
     // Get the markdown editor. If not init yet, init and return it.
     VMdEditor *getEditor();
 
@@ -243,6 +254,10 @@ private:
 
     bool m_backupFileChecked;
 
+    // Revision of the document when last change is recorded in the backup
+    // journal.
+    int m_backupRevision;
+
     // Used to scroll to the header of edit mode in read mode.
     VHeaderPointer m_headerFromEditMode;
 
@@ -171,6 +171,7 @@ void VNavigationMode::showNavigation(QTreeWidget *p_widget)
 void VNavigationMode::clearNavigation()
 {
     m_keyMap.clear();
+    m_indexKeyMap.clear();
     for (auto label : m_naviLabels) {
         delete label;
     }
@@ -209,3 +210,76 @@ bool VNavigationMode::handleKeyNavigation(QTreeWidget *p_widget,
 
     return ret;
 }
+
+QList<QModelIndex> VNavigationMode::getVisibleItems(const QTreeView *p_widget) const
+{
+    QList<QModelIndex> items;
+    QAbstractItemModel *model = p_widget->model();
+    if (!model) {
+        return items;
+    }
+
+    // indexBelow() only walks through expanded items.
+    QModelIndex index = model->index(0, 0);
+    while (index.isValid() && items.size() < 26) {
+        items.append(index);
+        index = p_widget->indexBelow(index);
+    }
+
+    return items;
+}
+
+void VNavigationMode::showNavigation(QTreeView *p_widget)
+{
+    clearNavigation();
+
+    if (!p_widget->isVisible()) {
+        return;
+    }
+
+    // Generate labels for visible items.
+    auto items = getVisibleItems(p_widget);
+    for (int i = 0; i < 26 && i < items.size(); ++i) {
+        QChar key('a' + i);
+        m_indexKeyMap[key] = QPersistentModelIndex(items[i]);
+
+        QString str = QString(m_majorKey) + key;
+        QLabel *label = new QLabel(str, p_widget);
+        label->setStyleSheet(g_vnote->getNavigationLabelStyle(str));
+        label->move(p_widget->visualRect(items[i]).topLeft());
+        label->show();
+        m_naviLabels.append(label);
+    }
+}
+
+bool VNavigationMode::handleKeyNavigation(QTreeView *p_widget,
+                                          bool &p_secondKey,
+                                          int p_key,
+                                          bool &p_succeed)
+{
+    bool ret = false;
+    p_succeed = false;
+    QChar keyChar = VUtils::keyToChar(p_key);
+    if (p_secondKey && !keyChar.isNull()) {
+        p_secondKey = false;
+        p_succeed = true;
+        auto it = m_indexKeyMap.find(keyChar);
+        if (it != m_indexKeyMap.end() && it.value().isValid()) {
+            ret = true;
+            p_widget->setCurrentIndex(it.value());
+            p_widget->setFocus();
+        }
+    } else if (keyChar == m_majorKey) {
+        // Major key pressed.
+        // Need second key if m_indexKeyMap is not empty.
+        if (m_indexKeyMap.isEmpty()) {
+            p_succeed = true;
+        } else {
+            p_secondKey = true;
+        }
+
+        ret = true;
+    }
+
+    return ret;
+}
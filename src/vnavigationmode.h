@@ -5,12 +5,14 @@
 #include <QVector>
 #include <QMap>
 #include <QList>
+#include <QPersistentModelIndex>
 
 class QLabel;
 class QListWidget;
 class QListWidgetItem;
 class QTreeWidget;
 class QTreeWidgetItem;
+class QTreeView;
 
 // Interface class for Navigation Mode in Captain Mode.
 class VNavigationMode
@@ -37,6 +39,8 @@ protected:
 
     void showNavigation(QTreeWidget *p_widget);
 
+    void showNavigation(QTreeView *p_widget);
+
     bool handleKeyNavigation(QListWidget *p_widget,
                              bool &p_secondKey,
                              int p_key,
@@ -47,17 +51,27 @@ protected:
                              int p_key,
                              bool &p_succeed);
 
+    bool handleKeyNavigation(QTreeView *p_widget,
+                             bool &p_secondKey,
+                             int p_key,
+                             bool &p_succeed);
+
     QChar m_majorKey;
 
     // Map second key to item.
     QMap<QChar, void *> m_keyMap;
 
+    // Map second key to index for model-based views.
+    QMap<QChar, QPersistentModelIndex> m_indexKeyMap;
+
     QVector<QLabel *> m_naviLabels;
 
 private:
     QList<QListWidgetItem *> getVisibleItems(const QListWidget *p_widget) const;
 
     QList<QTreeWidgetItem *> getVisibleItems(const QTreeWidget *p_widget) const;
+
+    QList<QModelIndex> getVisibleItems(const QTreeView *p_widget) const;
 };
 
 
@@ -13,6 +13,7 @@
 #include "vorphanfile.h"
 #include "vnotefile.h"
 #include "vpalette.h"
+#include "vnotebookloader.h"
 
 extern VConfigManager *g_config;
 
@@ -72,6 +73,9 @@ VNote::VNote(QObject *parent)
 
     g_config->getNotebooks(m_notebooks, this);
 
+    m_notebookLoader = new VNotebookLoader(this);
+    m_notebookLoader->load(m_notebooks);
+
     g_mwMgr = &m_metaWordMgr;
 }
 
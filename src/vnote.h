@@ -16,6 +16,7 @@
 
 class VOrphanFile;
 class VNoteFile;
+class VNotebookLoader;
 
 
 class VNote : public QObject
@@ -27,6 +28,9 @@ public:
     const QVector<VNotebook *> &getNotebooks() const;
     QVector<VNotebook *> &getNotebooks();
 
+    // Loader of the notebooks in background at startup.
+    VNotebookLoader *getNotebookLoader() const;
+
     void initTemplate();
 
     static QString s_sloganTemplate;
@@ -131,6 +135,8 @@ private:
     // Maintain all the notebooks. Other holder should use QPointer.
     QVector<VNotebook *> m_notebooks;
 
+    VNotebookLoader *m_notebookLoader;
+
     VMetaWordManager m_metaWordMgr;
 
     // Hold all external file: Orphan File.
@@ -138,4 +144,9 @@ private:
     QList<VOrphanFile *> m_externalFiles;
 };
 
+inline VNotebookLoader *VNote::getNotebookLoader() const
+{
+    return m_notebookLoader;
+}
+
 #endif // VNOTE_H
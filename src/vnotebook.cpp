@@ -7,12 +7,15 @@
 #include "vdirectory.h"
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
+#include "vdirconfigwriter.h"
 #include "vnotefile.h"
+#include "vnotebookmanifest.h"
+#include "utils/vstringpool.h"
 
 extern VConfigManager *g_config;
 
 VNotebook::VNotebook(const QString &name, const QString &path, QObject *parent)
-    : QObject(parent), m_name(name), m_valid(false)
+    : QObject(parent), m_name(name), m_valid(false), m_loaded(false), m_manifest(NULL)
 {
     setPath(path);
     m_recycleBinFolder = g_config->getRecycleBinFolder();
@@ -39,35 +42,41 @@ void VNotebook::setPath(const QString &p_path)
 
 bool VNotebook::readConfigNotebook()
 {
-    QJsonObject configJson = VConfigManager::readDirectoryConfig(m_path);
-    if (configJson.isEmpty()) {
+    return readConfigNotebook(VConfigManager::readDirectoryConfig(m_path));
+}
+
+bool VNotebook::readConfigNotebook(const QJsonObject &p_configJson)
+{
+    m_loaded = true;
+    if (p_configJson.isEmpty()) {
         qWarning() << "fail to read notebook configuration" << m_path;
         m_valid = false;
         return false;
     }
 
     // [image_folder] section.
-    auto it = configJson.find(DirConfig::c_imageFolder);
-    if (it != configJson.end()) {
+    auto it = p_configJson.find(DirConfig::c_imageFolder);
+    if (it != p_configJson.end()) {
         m_imageFolder = it.value().toString();
     }
 
     // [recycle_bin_folder] section.
-    it = configJson.find(DirConfig::c_recycleBinFolder);
-    if (it != configJson.end()) {
+    it = p_configJson.find(DirConfig::c_recycleBinFolder);
+    if (it != p_configJson.end()) {
         m_recycleBinFolder = it.value().toString();
     }
 
     // [tags] section.
-    QJsonArray tagsJson = configJson[DirConfig::c_tags].toArray();
+    m_tags.clear();
+    QJsonArray tagsJson = p_configJson[DirConfig::c_tags].toArray();
     for (int i = 0; i < tagsJson.size(); ++i) {
-        m_tags.append(tagsJson[i].toString());
+        m_tags.append(VStringPool::intern(tagsJson[i].toString()));
     }
 
     // [attachment_folder] section.
     // SHOULD be processed at last.
-    it = configJson.find(DirConfig::c_attachmentFolder);
-    if (it != configJson.end()) {
+    it = p_configJson.find(DirConfig::c_attachmentFolder);
+    if (it != p_configJson.end()) {
         m_attachmentFolder = it.value().toString();
     }
 
@@ -82,6 +91,13 @@ bool VNotebook::readConfigNotebook()
     return true;
 }
 
+void VNotebook::ensureLoaded() const
+{
+    if (!m_loaded) {
+        const_cast<VNotebook *>(this)->readConfigNotebook();
+    }
+}
+
 QJsonObject VNotebook::toConfigJsonNotebook() const
 {
     QJsonObject json;
@@ -122,11 +138,19 @@ QJsonObject VNotebook::toConfigJson() const
 
 bool VNotebook::writeToConfig() const
 {
-    return VConfigManager::writeDirectoryConfig(m_path, toConfigJson());
+    QJsonObject json = toConfigJson();
+    if (!VConfigManager::writeDirectoryConfig(m_path, json)) {
+        return false;
+    }
+
+    updateManifest(QString(), json);
+    return true;
 }
 
 bool VNotebook::writeConfigNotebook() const
 {
+    ensureLoaded();
+
     QJsonObject nbJson = toConfigJsonNotebook();
 
     QJsonObject configJson = VConfigManager::readDirectoryConfig(m_path);
@@ -139,7 +163,12 @@ bool VNotebook::writeConfigNotebook() const
         configJson[it.key()] = it.value();
     }
 
-    return VConfigManager::writeDirectoryConfig(m_path, configJson);
+    if (!VConfigManager::writeDirectoryConfig(m_path, configJson)) {
+        return false;
+    }
+
+    updateManifest(QString(), configJson);
+    return true;
 }
 
 void VNotebook::close()
@@ -149,7 +178,7 @@ void VNotebook::close()
 
 bool VNotebook::open()
 {
-    if (!m_valid) {
+    if (!isValid()) {
         return false;
     }
 
@@ -174,6 +203,8 @@ VNotebook *VNotebook::createNotebook(const QString &p_name,
                                      QObject *p_parent)
 {
     VNotebook *nb = new VNotebook(p_name, p_path, p_parent);
+    // Do not read the config which may not exist yet.
+    nb->m_loaded = true;
 
     // If @p_imageFolder is empty, it will report global configured folder as
     // its image folder.
@@ -230,6 +261,9 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
             VDirectory::deleteDirectory(dir, true);
         }
 
+        // Write pending configs before the folders are removed.
+        VDirConfigWriter::getInstance()->flush();
+
         // Delete the recycle bin.
         QDir recycleDir(p_notebook->getRecycleBinFolderPath());
         if (!recycleDir.removeRecursively()) {
@@ -254,9 +288,15 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
     }
 
 exit:
+    QString path = p_notebook->getPath();
+
     p_notebook->close();
     delete p_notebook;
 
+    if (p_deleteFiles) {
+        VNotebookManifest::deleteCache(path);
+    }
+
     return ret;
 }
 
@@ -338,6 +378,7 @@ VDirectory *VNotebook::tryLoadDirectory(const QString &p_path)
 
 const QString &VNotebook::getImageFolder() const
 {
+    ensureLoaded();
     if (m_imageFolder.isEmpty()) {
         return g_config->getImageFolder();
     } else {
@@ -352,11 +393,13 @@ void VNotebook::setImageFolder(const QString &p_imageFolder)
 
 const QString &VNotebook::getImageFolderConfig() const
 {
+    ensureLoaded();
     return m_imageFolder;
 }
 
 const QString &VNotebook::getAttachmentFolder() const
 {
+    ensureLoaded();
     return m_attachmentFolder;
 }
 
@@ -383,6 +426,7 @@ QDateTime VNotebook::getCreatedTimeUtc()
 
 QString VNotebook::getRecycleBinFolderPath() const
 {
+    ensureLoaded();
     QFileInfo fi(m_recycleBinFolder);
     if (fi.isAbsolute()) {
         return m_recycleBinFolder;
@@ -395,6 +439,11 @@ QList<QString> VNotebook::collectFiles()
 {
     QList<QString> files;
 
+    VNotebookManifest *manifest = getManifest();
+    if (manifest) {
+        return manifest->collectFiles(QString());
+    }
+
     bool opened = isOpened();
     if (!opened && !open()) {
         qWarning() << "fail to open notebook %1" << m_path;
@@ -414,7 +463,12 @@ void VNotebook::updatePath(const QString &p_path)
 {
     Q_ASSERT(!isOpened());
     m_valid = false;
+    m_loaded = false;
     setPath(p_path);
+
+    delete m_manifest;
+    m_manifest = NULL;
+
     delete m_rootDir;
     m_rootDir = new VDirectory(this,
                                NULL,
@@ -432,7 +486,7 @@ bool VNotebook::addTag(const QString &p_tag)
         return false;
     }
 
-    m_tags.append(p_tag);
+    m_tags.append(VStringPool::intern(p_tag));
     if (!writeConfigNotebook()) {
         qWarning() << "fail to update config of notebook" << m_name
                    << "in directory" << m_path;
@@ -457,3 +511,38 @@ void VNotebook::removeTag(const QString &p_tag)
         }
     }
 }
+
+VNotebookManifest *VNotebook::getManifest(bool p_wait)
+{
+    if (!isValid()) {
+        return NULL;
+    }
+
+    if (!m_manifest) {
+        m_manifest = new VNotebookManifest(m_path, this);
+        connect(m_manifest, &VNotebookManifest::loaded,
+                this, &VNotebook::manifestLoaded);
+    }
+
+    bool ret = p_wait ? m_manifest->load() : m_manifest->loadInBackground();
+    if (!ret) {
+        return NULL;
+    }
+
+    return m_manifest;
+}
+
+void VNotebook::updateManifest(const QString &p_relativePath, const QJsonObject &p_json) const
+{
+    if (m_manifest) {
+        m_manifest->updateFolder(p_relativePath, p_json);
+    }
+}
+
+void VNotebook::updateManifestOutline(const QString &p_notePath,
+                                      const QVector<VManifestHeading> &p_headings)
+{
+    if (m_manifest) {
+        m_manifest->updateOutline(p_notePath, p_headings);
+    }
+}
@@ -5,10 +5,14 @@
 #include <QString>
 #include <QDateTime>
 #include <QStringList>
+#include <QVector>
+#include <QJsonObject>
 
 class VDirectory;
 class VFile;
 class VNoteFile;
+class VNotebookManifest;
+struct VManifestHeading;
 
 class VNotebook : public QObject
 {
@@ -98,6 +102,13 @@ public:
     // Read configurations (only notebook part) directly from root directory config file.
     bool readConfigNotebook();
 
+    // Read configurations (only notebook part) from @p_configJson, the parsed
+    // root directory config file.
+    bool readConfigNotebook(const QJsonObject &p_configJson);
+
+    // Whether the configurations of this notebook have been read.
+    bool isLoaded() const;
+
     // Write configurations only related to notebook to root directory config file.
     bool writeConfigNotebook() const;
 
@@ -111,6 +122,24 @@ public:
 
     QList<QString> collectFiles();
 
+    // Get the loaded manifest of this notebook.
+    // The manifest is loaded in background at first, and NULL is returned
+    // until manifestLoaded() is emitted.
+    // @p_wait: load it synchronously if not loaded yet.
+    // Returns NULL if it fails to load.
+    VNotebookManifest *getManifest(bool p_wait = false);
+
+    // Update the manifest after the config of folder @p_relativePath is written.
+    void updateManifest(const QString &p_relativePath, const QJsonObject &p_json) const;
+
+    // Update the outline index after note @p_notePath (relative path) is saved.
+    void updateManifestOutline(const QString &p_notePath,
+                               const QVector<VManifestHeading> &p_headings);
+
+signals:
+    // Emitted when the manifest is loaded in background.
+    void manifestLoaded();
+
 private:
     // Serialize current instance to json.
     QJsonObject toConfigJson() const;
@@ -120,6 +149,10 @@ private:
 
     void setPath(const QString &p_path);
 
+    // Read the configurations synchronously if they have not been read yet.
+    // Notebooks are loaded in background at startup.
+    void ensureLoaded() const;
+
     QString m_name;
 
     QString m_path;
@@ -151,6 +184,13 @@ private:
     // Whether this notebook is valid.
     // Will set to true after readConfigNotebook().
     bool m_valid;
+
+    // Whether readConfigNotebook() has been called.
+    bool m_loaded;
+
+    // Flat manifest of folders and notes.
+    // Created on demand.
+    VNotebookManifest *m_manifest;
 };
 
 inline VDirectory *VNotebook::getRootDir() const
@@ -160,14 +200,21 @@ inline VDirectory *VNotebook::getRootDir() const
 
 inline const QString &VNotebook::getRecycleBinFolder() const
 {
+    ensureLoaded();
     return m_recycleBinFolder;
 }
 
 inline bool VNotebook::isValid() const
 {
+    ensureLoaded();
     return m_valid;
 }
 
+inline bool VNotebook::isLoaded() const
+{
+    return m_loaded;
+}
+
 inline const QString &VNotebook::getPath() const
 {
     return m_path;
@@ -185,11 +232,13 @@ inline const QString &VNotebook::getName() const
 
 inline bool VNotebook::hasTag(const QString &p_tag) const
 {
+    ensureLoaded();
     return m_tags.contains(p_tag);
 }
 
 inline const QStringList &VNotebook::getTags() const
 {
+    ensureLoaded();
     return m_tags;
 }
 #endif // VNOTEBOOK_H
@@ -0,0 +1,170 @@
+#include "vnotebookloader.h"
+
+#include <QDir>
+#include <QJsonArray>
+#include <QDebug>
+
+#include "vnotebook.h"
+#include "vconstants.h"
+#include "vdirconfigcache.h"
+
+// Max number of threads to load notebooks.
+#define MAX_LOADING_THREADS 8
+
+VNotebookLoaderWorker::VNotebookLoaderWorker(VNotebookLoader *p_loader, QObject *p_parent)
+    : QThread(p_parent),
+      m_loader(p_loader),
+      m_stop(0)
+{
+}
+
+void VNotebookLoaderWorker::stop()
+{
+    m_stop.store(1);
+}
+
+void VNotebookLoaderWorker::run()
+{
+    VDirConfigCache *cache = VDirConfigCache::getInstance();
+
+    QString path;
+    while (m_stop.load() == 0 && m_loader->takePath(path)) {
+        QJsonObject json = cache->prefetch(path);
+        emit notebookConfigRead(path, json);
+
+        // Read ahead the first level folders, which will be read once the
+        // notebook is opened.
+        QDir dir(path);
+        QJsonArray dirJson = json[DirConfig::c_subDirectories].toArray();
+        for (int i = 0; i < dirJson.size(); ++i) {
+            if (m_stop.load() == 1) {
+                break;
+            }
+
+            QString name = dirJson[i].toObject()[DirConfig::c_name].toString();
+            if (!name.isEmpty()) {
+                cache->prefetch(dir.filePath(name));
+            }
+        }
+    }
+}
+
+
+VNotebookLoader::VNotebookLoader(QObject *p_parent)
+    : QObject(p_parent),
+      m_finishedWorkers(0)
+{
+}
+
+VNotebookLoader::~VNotebookLoader()
+{
+    clearAllWorkers();
+}
+
+void VNotebookLoader::load(const QVector<VNotebook *> &p_notebooks)
+{
+    clearAllWorkers();
+
+    m_notebooks.clear();
+    QStringList paths;
+    for (auto nb : p_notebooks) {
+        if (nb->isLoaded()) {
+            continue;
+        }
+
+        m_notebooks.insert(nb->getPath(), nb);
+        paths.append(nb->getPath());
+    }
+
+    if (paths.isEmpty()) {
+        emit finished();
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue = paths;
+    }
+
+    int numThread = qMin(paths.size(), MAX_LOADING_THREADS);
+    m_workers.reserve(numThread);
+    m_finishedWorkers = 0;
+    for (int i = 0; i < numThread; ++i) {
+        VNotebookLoaderWorker *th = new VNotebookLoaderWorker(this, this);
+        connect(th, &VNotebookLoaderWorker::notebookConfigRead,
+                this, &VNotebookLoader::handleNotebookConfigRead);
+        connect(th, &VNotebookLoaderWorker::finished,
+                this, &VNotebookLoader::handleWorkerFinished);
+
+        m_workers.append(th);
+        th->start();
+    }
+
+    qDebug() << "start loading" << paths.size() << "notebooks with threads" << numThread;
+}
+
+bool VNotebookLoader::takePath(QString &p_path)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_queue.isEmpty()) {
+        return false;
+    }
+
+    p_path = m_queue.takeFirst();
+    return true;
+}
+
+void VNotebookLoader::handleNotebookConfigRead(const QString &p_path, const QJsonObject &p_json)
+{
+    QPointer<VNotebook> nb = m_notebooks.take(p_path);
+    if (!nb) {
+        return;
+    }
+
+    // It may have been loaded on demand.
+    if (!nb->isLoaded()) {
+        nb->readConfigNotebook(p_json);
+    }
+
+    emit notebookLoaded(nb);
+}
+
+void VNotebookLoader::handleWorkerFinished()
+{
+    ++m_finishedWorkers;
+    if (m_finishedWorkers < m_workers.size()) {
+        return;
+    }
+
+    for (auto const & th : m_workers) {
+        Q_ASSERT(th->isFinished());
+        th->deleteLater();
+    }
+
+    m_workers.clear();
+    m_finishedWorkers = 0;
+
+    // Notebooks failed to be handed over will load themselves on demand.
+    m_notebooks.clear();
+
+    qDebug() << "notebooks loaded";
+    emit finished();
+}
+
+void VNotebookLoader::clearAllWorkers()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_queue.clear();
+    }
+
+    for (auto const & th : m_workers) {
+        th->stop();
+        th->wait();
+
+        delete th;
+    }
+
+    m_workers.clear();
+    m_finishedWorkers = 0;
+}
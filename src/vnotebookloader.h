@@ -0,0 +1,99 @@
+#ifndef VNOTEBOOKLOADER_H
+#define VNOTEBOOKLOADER_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QPointer>
+#include <QJsonObject>
+#include <QAtomicInt>
+#include <QMutex>
+
+class VNotebook;
+class VNotebookLoader;
+
+// Worker reading the configs of notebooks from the queue of the loader until
+// there is no more.
+class VNotebookLoaderWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit VNotebookLoaderWorker(VNotebookLoader *p_loader, QObject *p_parent = nullptr);
+
+    void stop();
+
+signals:
+    // @p_json: the root config of notebook @p_path, empty if it fails.
+    void notebookConfigRead(const QString &p_path, const QJsonObject &p_json);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    VNotebookLoader *m_loader;
+
+    QAtomicInt m_stop;
+};
+
+
+// Read the configs of notebooks in parallel in background at startup.
+// The root config of each notebook is parsed by workers and handed to the
+// notebook in the main thread. The configs of the first level folders are read
+// ahead into VDirConfigCache to speed up opening the notebook.
+// Notebooks not loaded yet will load themselves synchronously once used.
+class VNotebookLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VNotebookLoader(QObject *p_parent = nullptr);
+
+    ~VNotebookLoader();
+
+    // Start loading @p_notebooks.
+    void load(const QVector<VNotebook *> &p_notebooks);
+
+    // Whether there are notebooks being loaded.
+    bool isLoading() const;
+
+    // Called by workers to take the path of next notebook to load.
+    // Returns false if there is no more.
+    bool takePath(QString &p_path);
+
+signals:
+    // Emitted when the config of @p_notebook is read.
+    void notebookLoaded(VNotebook *p_notebook);
+
+    // Emitted when all notebooks are loaded.
+    void finished();
+
+private slots:
+    void handleNotebookConfigRead(const QString &p_path, const QJsonObject &p_json);
+
+    void handleWorkerFinished();
+
+private:
+    void clearAllWorkers();
+
+    QList<VNotebookLoaderWorker *> m_workers;
+
+    int m_finishedWorkers;
+
+    // Notebooks being loaded, keyed by path.
+    QHash<QString, QPointer<VNotebook> > m_notebooks;
+
+    // Protect m_queue.
+    QMutex m_mutex;
+
+    QStringList m_queue;
+};
+
+inline bool VNotebookLoader::isLoading() const
+{
+    return !m_workers.isEmpty();
+}
+
+#endif // VNOTEBOOKLOADER_H
@@ -0,0 +1,960 @@
+#include "vnotebookmanifest.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QTimer>
+#include <QCryptographicHash>
+#include <QRegExp>
+#include <QDebug>
+
+#include "vconfigmanager.h"
+#include "vconstants.h"
+#include "vdirconfigwriter.h"
+#include "utils/vutils.h"
+
+extern VConfigManager *g_config;
+
+// Magic and version of the cache file.
+#define MANIFEST_MAGIC 0x564e4d46
+#define MANIFEST_VERSION 2
+
+// Delay in ms to save the manifest after a change.
+#define MANIFEST_SAVE_DELAY 5000
+
+static QDataStream &operator<<(QDataStream &p_out, const VManifestNote &p_note)
+{
+    p_out << p_note.m_name
+          << p_note.m_createdTimeUtc
+          << p_note.m_modifiedTimeUtc
+          << p_note.m_tags
+          << p_note.m_attachments;
+    return p_out;
+}
+
+static QDataStream &operator>>(QDataStream &p_in, VManifestNote &p_note)
+{
+    p_in >> p_note.m_name
+         >> p_note.m_createdTimeUtc
+         >> p_note.m_modifiedTimeUtc
+         >> p_note.m_tags
+         >> p_note.m_attachments;
+    return p_in;
+}
+
+static QDataStream &operator<<(QDataStream &p_out, const VManifestFolder &p_folder)
+{
+    p_out << p_folder.m_name
+          << p_folder.m_createdTimeUtc
+          << p_folder.m_configModifiedTime
+          << p_folder.m_configSize
+          << p_folder.m_subDirs
+          << p_folder.m_notes;
+    return p_out;
+}
+
+static QDataStream &operator>>(QDataStream &p_in, VManifestFolder &p_folder)
+{
+    p_in >> p_folder.m_name
+         >> p_folder.m_createdTimeUtc
+         >> p_folder.m_configModifiedTime
+         >> p_folder.m_configSize
+         >> p_folder.m_subDirs
+         >> p_folder.m_notes;
+    return p_in;
+}
+
+static QDataStream &operator<<(QDataStream &p_out, const VManifestHeading &p_heading)
+{
+    p_out << (qint32)p_heading.m_level
+          << p_heading.m_text
+          << (qint32)p_heading.m_lineNumber;
+    return p_out;
+}
+
+static QDataStream &operator>>(QDataStream &p_in, VManifestHeading &p_heading)
+{
+    qint32 level = -1, lineNumber = -1;
+    p_in >> level
+         >> p_heading.m_text
+         >> lineNumber;
+    p_heading.m_level = level;
+    p_heading.m_lineNumber = lineNumber;
+    return p_in;
+}
+
+static QDataStream &operator<<(QDataStream &p_out, const VManifestOutline &p_outline)
+{
+    p_out << p_outline.m_fileModifiedTime
+          << p_outline.m_fileSize
+          << p_outline.m_headings;
+    return p_out;
+}
+
+static QDataStream &operator>>(QDataStream &p_in, VManifestOutline &p_outline)
+{
+    p_in >> p_outline.m_fileModifiedTime
+         >> p_outline.m_fileSize
+         >> p_outline.m_headings;
+    return p_in;
+}
+
+static qint64 msecsFromString(const QString &p_str)
+{
+    QDateTime dt = QDateTime::fromString(p_str, Qt::ISODate);
+    return dt.isValid() ? dt.toMSecsSinceEpoch() : 0;
+}
+
+static QString absolutePath(const QString &p_notebookPath, const QString &p_relativePath)
+{
+    if (p_relativePath.isEmpty()) {
+        return p_notebookPath;
+    }
+
+    return QDir(p_notebookPath).filePath(p_relativePath);
+}
+
+// Whether note file @p_filePath is not changed since @p_outline is built.
+static bool isOutlineUpToDate(const QString &p_filePath, const VManifestOutline &p_outline)
+{
+    QFileInfo fi(p_filePath);
+    return p_outline.m_fileModifiedTime == fi.lastModified().toMSecsSinceEpoch()
+           && p_outline.m_fileSize == fi.size();
+}
+
+static QString folderNameOf(const QString &p_notebookPath, const QString &p_relativePath)
+{
+    if (p_relativePath.isEmpty()) {
+        return VUtils::directoryNameFromPath(p_notebookPath);
+    }
+
+    return VUtils::fileNameFromPath(p_relativePath);
+}
+
+// Fill config file info of folder @p_relativePath into @p_folder.
+static void fetchConfigInfoOf(const QString &p_notebookPath,
+                              const QString &p_relativePath,
+                              VManifestFolder &p_folder)
+{
+    QString configFile = VConfigManager::fetchDirConfigFilePath(absolutePath(p_notebookPath,
+                                                                             p_relativePath));
+    QJsonObject pendingJson;
+    if (VDirConfigWriter::getInstance()->pendingConfig(configFile, pendingJson)) {
+        // The file on disk is stale. Taken as changed until it is written.
+        p_folder.m_configModifiedTime = -1;
+        p_folder.m_configSize = -1;
+        return;
+    }
+
+    QFileInfo fi(configFile);
+    p_folder.m_configModifiedTime = fi.lastModified().toMSecsSinceEpoch();
+    p_folder.m_configSize = fi.size();
+}
+
+
+const VManifestFolder *VManifestSnapshot::findFolder(const QString &p_relativePath) const
+{
+    auto it = m_folders.find(p_relativePath);
+    if (it == m_folders.end()) {
+        return NULL;
+    }
+
+    return &it.value();
+}
+
+QString VManifestSnapshot::fetchPath(const QString &p_relativePath) const
+{
+    return absolutePath(m_notebookPath, p_relativePath);
+}
+
+const VManifestOutline *VManifestSnapshot::findOutline(const QString &p_notePath) const
+{
+    auto it = m_outlines.find(p_notePath);
+    if (it == m_outlines.end() || !isOutlineUpToDate(fetchPath(p_notePath), it.value())) {
+        return NULL;
+    }
+
+    return &it.value();
+}
+
+
+VManifestBuilder::VManifestBuilder(const QString &p_notebookPath, QObject *p_parent)
+    : QThread(p_parent),
+      m_notebookPath(p_notebookPath),
+      m_validation(false),
+      m_succeeded(false),
+      m_changed(false)
+{
+}
+
+VManifestBuilder::VManifestBuilder(const QString &p_notebookPath,
+                                   const QHash<QString, VManifestFolder> &p_folders,
+                                   QObject *p_parent)
+    : QThread(p_parent),
+      m_notebookPath(p_notebookPath),
+      m_validation(true),
+      m_succeeded(false),
+      m_changed(false),
+      m_folders(p_folders)
+{
+}
+
+void VManifestBuilder::run()
+{
+    build();
+}
+
+void VManifestBuilder::build()
+{
+    if (m_validation || readFromCache()) {
+        validate();
+        m_succeeded = m_folders.contains(QString());
+        return;
+    }
+
+    m_folders.clear();
+    m_outlines.clear();
+    m_changed = true;
+    if (!loadFolder(QString())) {
+        qWarning() << "fail to build manifest of notebook" << m_notebookPath;
+        m_folders.clear();
+        return;
+    }
+
+    m_succeeded = true;
+}
+
+bool VManifestBuilder::readFromCache()
+{
+    QFile file(VNotebookManifest::cacheFilePath(m_notebookPath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    qint32 version = 0;
+    QString path;
+    in >> magic >> version;
+    if (magic != MANIFEST_MAGIC || version != MANIFEST_VERSION) {
+        qDebug() << "obsolete notebook manifest cache" << file.fileName();
+        return false;
+    }
+
+    in >> path;
+    if (path != m_notebookPath) {
+        return false;
+    }
+
+    QHash<QString, VManifestFolder> folders;
+    QHash<QString, VManifestOutline> outlines;
+    in >> folders >> outlines;
+    if (in.status() != QDataStream::Ok || !folders.contains(QString())) {
+        qWarning() << "invalid notebook manifest cache" << file.fileName();
+        return false;
+    }
+
+    m_folders = folders;
+    m_outlines = outlines;
+    return true;
+}
+
+bool VManifestBuilder::loadFolder(const QString &p_relativePath)
+{
+    VManifestFolder folder;
+    if (!readFolder(m_notebookPath, p_relativePath, folder)) {
+        return false;
+    }
+
+    m_folders.insert(p_relativePath, folder);
+
+    for (auto const & sub : folder.m_subDirs) {
+        QString subPath = VNotebookManifest::childPath(p_relativePath, sub);
+        if (!loadFolder(subPath)) {
+            qWarning() << "fail to read folder config for manifest"
+                       << absolutePath(m_notebookPath, subPath);
+        }
+    }
+
+    return true;
+}
+
+void VManifestBuilder::validate()
+{
+    QHash<QString, VManifestFolder> folders;
+    validateFolder(QString(), folders);
+
+    // Folders not reachable from root are dropped.
+    if (folders.size() != m_folders.size()) {
+        m_changed = true;
+    }
+
+    m_folders = folders;
+}
+
+void VManifestBuilder::validateFolder(const QString &p_relativePath,
+                                      QHash<QString, VManifestFolder> &p_folders)
+{
+    auto it = m_folders.find(p_relativePath);
+    if (it == m_folders.end() || configChanged(m_notebookPath, p_relativePath, it.value())) {
+        VManifestFolder folder;
+        if (!readFolder(m_notebookPath, p_relativePath, folder)) {
+            return;
+        }
+
+        p_folders.insert(p_relativePath, folder);
+        m_changed = true;
+    } else {
+        p_folders.insert(p_relativePath, it.value());
+    }
+
+    const QStringList subDirs = p_folders[p_relativePath].m_subDirs;
+    for (auto const & sub : subDirs) {
+        validateFolder(VNotebookManifest::childPath(p_relativePath, sub), p_folders);
+    }
+}
+
+bool VManifestBuilder::configChanged(const QString &p_notebookPath,
+                                     const QString &p_relativePath,
+                                     const VManifestFolder &p_folder)
+{
+    QFileInfo fi(VConfigManager::fetchDirConfigFilePath(absolutePath(p_notebookPath,
+                                                                     p_relativePath)));
+    return fi.lastModified().toMSecsSinceEpoch() != p_folder.m_configModifiedTime
+           || fi.size() != p_folder.m_configSize;
+}
+
+bool VManifestBuilder::readFolder(const QString &p_notebookPath,
+                                  const QString &p_relativePath,
+                                  VManifestFolder &p_folder)
+{
+    QString folderPath = absolutePath(p_notebookPath, p_relativePath);
+    QJsonObject json = VConfigManager::readDirectoryConfig(folderPath);
+    if (json.isEmpty()) {
+        return false;
+    }
+
+    p_folder = VNotebookManifest::folderFromJson(folderNameOf(p_notebookPath, p_relativePath),
+                                                 json);
+    fetchConfigInfoOf(p_notebookPath, p_relativePath, p_folder);
+    return true;
+}
+
+VNotebookManifest::VNotebookManifest(const QString &p_notebookPath, QObject *p_parent)
+    : QObject(p_parent),
+      m_notebookPath(p_notebookPath),
+      m_loaded(false),
+      m_dirty(false),
+      m_builder(NULL)
+{
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(MANIFEST_SAVE_DELAY);
+    connect(m_saveTimer, &QTimer::timeout,
+            this, &VNotebookManifest::save);
+
+    connect(VDirConfigWriter::getInstance(), &VDirConfigWriter::configWritten,
+            this, &VNotebookManifest::handleConfigWritten);
+}
+
+VNotebookManifest::~VNotebookManifest()
+{
+    if (m_builder) {
+        m_builder->wait();
+    }
+
+    if (m_dirty) {
+        save();
+    }
+}
+
+bool VNotebookManifest::load()
+{
+    if (m_loaded) {
+        return true;
+    }
+
+    if (m_builder) {
+        m_builder->wait();
+        handleBuilderFinished();
+        return m_loaded;
+    }
+
+    VManifestBuilder builder(m_notebookPath);
+    builder.build();
+    takeBuilderResults(&builder);
+    return m_loaded;
+}
+
+bool VNotebookManifest::loadInBackground()
+{
+    if (m_loaded || m_builder) {
+        return m_loaded;
+    }
+
+    m_updatedFolders.clear();
+    m_builder = new VManifestBuilder(m_notebookPath, this);
+    connect(m_builder, &QThread::finished,
+            this, &VNotebookManifest::handleBuilderFinished);
+    m_builder->start();
+    return false;
+}
+
+void VNotebookManifest::revalidate()
+{
+    if (!m_loaded || m_builder) {
+        return;
+    }
+
+    m_updatedFolders.clear();
+    m_builder = new VManifestBuilder(m_notebookPath, m_folders, this);
+    connect(m_builder, &QThread::finished,
+            this, &VNotebookManifest::handleBuilderFinished);
+    m_builder->start();
+}
+
+void VNotebookManifest::handleBuilderFinished()
+{
+    // May be taken already by load().
+    if (!m_builder || !m_builder->isFinished()) {
+        return;
+    }
+
+    VManifestBuilder *builder = m_builder;
+    m_builder = NULL;
+
+    bool wasLoaded = m_loaded;
+    takeBuilderResults(builder);
+    builder->deleteLater();
+
+    if (!wasLoaded && m_loaded) {
+        emit loaded();
+    }
+}
+
+void VNotebookManifest::takeBuilderResults(VManifestBuilder *p_builder)
+{
+    if (!p_builder->isSucceeded()) {
+        if (!p_builder->isValidation()) {
+            m_folders.clear();
+            m_tagIndex.clear();
+            m_loaded = false;
+        }
+
+        return;
+    }
+
+    m_folders = p_builder->getFolders();
+    if (!p_builder->isValidation()) {
+        m_outlines = p_builder->getOutlines();
+    }
+
+    m_loaded = true;
+    rebuildTagIndex();
+
+    // Apply the updates which the builder may have missed.
+    const QSet<QString> updatedFolders = m_updatedFolders;
+    m_updatedFolders.clear();
+    for (auto const & path : updatedFolders) {
+        QJsonObject json = VConfigManager::readDirectoryConfig(fetchPath(path));
+        if (!json.isEmpty()) {
+            updateFolder(path, json);
+        }
+    }
+
+    pruneOutlines();
+
+    if (p_builder->isChanged()) {
+        markDirty();
+    }
+
+    qDebug() << "manifest of notebook" << m_notebookPath << "loaded with"
+             << m_folders.size() << "folders";
+}
+
+bool VNotebookManifest::save()
+{
+    m_saveTimer->stop();
+
+    if (!m_loaded) {
+        return false;
+    }
+
+    QString filePath = cacheFilePath(m_notebookPath);
+    if (!VUtils::makePath(VUtils::basePathFromPath(filePath))) {
+        return false;
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open notebook manifest cache for write" << filePath;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (quint32)MANIFEST_MAGIC << (qint32)MANIFEST_VERSION;
+    out << m_notebookPath;
+    out << m_folders;
+    out << m_outlines;
+
+    if (!file.commit()) {
+        qWarning() << "fail to write notebook manifest cache" << filePath;
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+void VNotebookManifest::markDirty()
+{
+    m_dirty = true;
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+void VNotebookManifest::updateFolder(const QString &p_relativePath, const QJsonObject &p_json)
+{
+    if (m_builder) {
+        m_updatedFolders.insert(p_relativePath);
+    }
+
+    if (!m_loaded) {
+        // The cache will be checked against the config files when loaded.
+        return;
+    }
+
+    VManifestFolder folder = folderFromJson(folderName(p_relativePath), p_json);
+    fetchConfigInfo(p_relativePath, folder);
+
+    QStringList oldSubDirs;
+    auto it = m_folders.find(p_relativePath);
+    if (it != m_folders.end()) {
+        oldSubDirs = it.value().m_subDirs;
+        removeFolderFromTagIndex(p_relativePath, it.value());
+        removeOutlines(p_relativePath, it.value(), &folder);
+    }
+
+    m_folders.insert(p_relativePath, folder);
+    addFolderToTagIndex(p_relativePath, folder);
+
+    // Folders removed or renamed.
+    for (auto const & sub : oldSubDirs) {
+        if (!folder.m_subDirs.contains(sub)) {
+            removeFolder(childPath(p_relativePath, sub));
+        }
+    }
+
+    // Folders added, copied, or moved in.
+    for (auto const & sub : folder.m_subDirs) {
+        QString subPath = childPath(p_relativePath, sub);
+        if (!m_folders.contains(subPath)) {
+            loadFolder(subPath);
+        }
+    }
+
+    markDirty();
+}
+
+bool VNotebookManifest::loadFolder(const QString &p_relativePath)
+{
+    VManifestFolder folder;
+    if (!VManifestBuilder::readFolder(m_notebookPath, p_relativePath, folder)) {
+        return false;
+    }
+
+    m_folders.insert(p_relativePath, folder);
+    addFolderToTagIndex(p_relativePath, folder);
+
+    for (auto const & sub : folder.m_subDirs) {
+        QString subPath = childPath(p_relativePath, sub);
+        if (!loadFolder(subPath)) {
+            qWarning() << "fail to read folder config for manifest" << fetchPath(subPath);
+        }
+    }
+
+    return true;
+}
+
+void VNotebookManifest::removeFolder(const QString &p_relativePath)
+{
+    auto it = m_folders.find(p_relativePath);
+    if (it == m_folders.end()) {
+        return;
+    }
+
+    QStringList subDirs = it.value().m_subDirs;
+    removeFolderFromTagIndex(p_relativePath, it.value());
+    removeOutlines(p_relativePath, it.value());
+    m_folders.erase(it);
+
+    for (auto const & sub : subDirs) {
+        removeFolder(childPath(p_relativePath, sub));
+    }
+}
+
+void VNotebookManifest::fetchConfigInfo(const QString &p_relativePath,
+                                        VManifestFolder &p_folder) const
+{
+    fetchConfigInfoOf(m_notebookPath, p_relativePath, p_folder);
+}
+
+void VNotebookManifest::handleConfigWritten(const QString &p_filePath,
+                                            qint64 p_modifiedTime,
+                                            qint64 p_size)
+{
+    if (!m_loaded) {
+        return;
+    }
+
+    QString relativePath = QDir(m_notebookPath).relativeFilePath(QFileInfo(p_filePath).path());
+    if (relativePath == ".") {
+        relativePath.clear();
+    } else if (relativePath == ".."
+               || relativePath.startsWith("../")
+               || QDir::isAbsolutePath(relativePath)) {
+        // Not in this notebook.
+        return;
+    }
+
+    auto it = m_folders.find(relativePath);
+    if (it == m_folders.end()) {
+        return;
+    }
+
+    it.value().m_configModifiedTime = p_modifiedTime;
+    it.value().m_configSize = p_size;
+    markDirty();
+}
+
+QString VNotebookManifest::fetchPath(const QString &p_relativePath) const
+{
+    return absolutePath(m_notebookPath, p_relativePath);
+}
+
+QString VNotebookManifest::folderName(const QString &p_relativePath) const
+{
+    return folderNameOf(m_notebookPath, p_relativePath);
+}
+
+QList<QString> VNotebookManifest::collectFiles(const QString &p_relativePath) const
+{
+    QList<QString> files;
+    collectFiles(p_relativePath, files);
+    return files;
+}
+
+void VNotebookManifest::collectFiles(const QString &p_relativePath, QList<QString> &p_files) const
+{
+    const VManifestFolder *folder = findFolder(p_relativePath);
+    if (!folder) {
+        return;
+    }
+
+    QDir dir(fetchPath(p_relativePath));
+    for (auto const & note : folder->m_notes) {
+        p_files.append(dir.filePath(note.m_name));
+    }
+
+    for (auto const & sub : folder->m_subDirs) {
+        collectFiles(childPath(p_relativePath, sub), p_files);
+    }
+}
+
+void VNotebookManifest::addFolderToTagIndex(const QString &p_relativePath,
+                                            const VManifestFolder &p_folder)
+{
+    for (auto const & note : p_folder.m_notes) {
+        if (note.m_tags.isEmpty()) {
+            continue;
+        }
+
+        QString notePath = childPath(p_relativePath, note.m_name);
+        for (auto const & tag : note.m_tags) {
+            m_tagIndex[tag].insert(notePath);
+        }
+    }
+}
+
+void VNotebookManifest::removeFolderFromTagIndex(const QString &p_relativePath,
+                                                 const VManifestFolder &p_folder)
+{
+    for (auto const & note : p_folder.m_notes) {
+        if (note.m_tags.isEmpty()) {
+            continue;
+        }
+
+        QString notePath = childPath(p_relativePath, note.m_name);
+        for (auto const & tag : note.m_tags) {
+            auto it = m_tagIndex.find(tag);
+            if (it == m_tagIndex.end()) {
+                continue;
+            }
+
+            it.value().remove(notePath);
+            if (it.value().isEmpty()) {
+                m_tagIndex.erase(it);
+            }
+        }
+    }
+}
+
+void VNotebookManifest::rebuildTagIndex()
+{
+    m_tagIndex.clear();
+    for (auto it = m_folders.constBegin(); it != m_folders.constEnd(); ++it) {
+        addFolderToTagIndex(it.key(), it.value());
+    }
+}
+
+QStringList VNotebookManifest::fetchNotesByTags(const QStringList &p_tags, bool p_matchAll) const
+{
+    QSet<QString> notes;
+    bool first = true;
+    for (auto const & tag : p_tags) {
+        auto it = m_tagIndex.find(tag);
+        if (it == m_tagIndex.end()) {
+            if (p_matchAll) {
+                return QStringList();
+            }
+
+            continue;
+        }
+
+        if (first) {
+            notes = it.value();
+            first = false;
+        } else if (p_matchAll) {
+            notes.intersect(it.value());
+        } else {
+            notes.unite(it.value());
+        }
+    }
+
+    QStringList res = notes.toList();
+    res.sort();
+    return res;
+}
+
+void VNotebookManifest::removeOutlines(const QString &p_relativePath,
+                                       const VManifestFolder &p_oldFolder,
+                                       const VManifestFolder *p_newFolder)
+{
+    if (m_outlines.isEmpty()) {
+        return;
+    }
+
+    for (auto const & note : p_oldFolder.m_notes) {
+        if (p_newFolder) {
+            bool found = false;
+            for (auto const & newNote : p_newFolder->m_notes) {
+                if (newNote.m_name == note.m_name) {
+                    found = true;
+                    break;
+                }
+            }
+
+            if (found) {
+                continue;
+            }
+        }
+
+        m_outlines.remove(childPath(p_relativePath, note.m_name));
+    }
+}
+
+void VNotebookManifest::pruneOutlines()
+{
+    QSet<QString> notes;
+    for (auto it = m_folders.constBegin(); it != m_folders.constEnd(); ++it) {
+        for (auto const & note : it.value().m_notes) {
+            notes.insert(childPath(it.key(), note.m_name));
+        }
+    }
+
+    bool changed = false;
+    for (auto it = m_outlines.begin(); it != m_outlines.end();) {
+        if (notes.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_outlines.erase(it);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        markDirty();
+    }
+}
+
+void VNotebookManifest::fetchFileInfo(const QString &p_notePath, VManifestOutline &p_outline) const
+{
+    QFileInfo fi(fetchPath(p_notePath));
+    p_outline.m_fileModifiedTime = fi.lastModified().toMSecsSinceEpoch();
+    p_outline.m_fileSize = fi.size();
+}
+
+void VNotebookManifest::updateOutline(const QString &p_notePath,
+                                      const QVector<VManifestHeading> &p_headings)
+{
+    if (!m_loaded) {
+        // The note will be parsed on demand.
+        return;
+    }
+
+    VManifestOutline &outline = m_outlines[p_notePath];
+    outline.m_headings = p_headings;
+    fetchFileInfo(p_notePath, outline);
+    markDirty();
+}
+
+const VManifestOutline *VNotebookManifest::findOutline(const QString &p_notePath) const
+{
+    if (!m_loaded) {
+        return NULL;
+    }
+
+    auto it = m_outlines.find(p_notePath);
+    if (it == m_outlines.end() || !isOutlineUpToDate(fetchPath(p_notePath), it.value())) {
+        return NULL;
+    }
+
+    return &it.value();
+}
+
+VManifestSnapshot VNotebookManifest::snapshot() const
+{
+    VManifestSnapshot snap;
+    snap.m_notebookPath = m_notebookPath;
+    if (m_loaded) {
+        snap.m_folders = m_folders;
+        snap.m_tagIndex = m_tagIndex;
+        snap.m_outlines = m_outlines;
+    }
+
+    return snap;
+}
+
+void VNotebookManifest::addOutline(const QString &p_notePath, const VManifestOutline &p_outline)
+{
+    if (!m_loaded) {
+        return;
+    }
+
+    m_outlines.insert(p_notePath, p_outline);
+    markDirty();
+}
+
+bool VNotebookManifest::buildOutline(const QString &p_filePath, VManifestOutline &p_outline)
+{
+    QFileInfo fi(p_filePath);
+    if (!fi.exists()) {
+        return false;
+    }
+
+    // Stat before reading so that a change during reading is detected next time.
+    p_outline.m_fileModifiedTime = fi.lastModified().toMSecsSinceEpoch();
+    p_outline.m_fileSize = fi.size();
+    p_outline.m_headings = parseHeadings(VUtils::readFileFromDisk(p_filePath));
+    return true;
+}
+
+QVector<VManifestHeading> VNotebookManifest::parseHeadings(const QString &p_text)
+{
+    QVector<VManifestHeading> headings;
+    if (p_text.isEmpty()) {
+        return headings;
+    }
+
+    // Only support # syntax and skip fenced code blocks, like the editor.
+    QRegExp headerReg(VUtils::c_headerRegExp);
+    QRegExp codeBlockStartReg(VUtils::c_fencedCodeBlockStartRegExp);
+    QRegExp codeBlockEndReg(VUtils::c_fencedCodeBlockEndRegExp);
+    bool inCodeBlock = false;
+    const QStringList lines = p_text.split('\n');
+    for (int i = 0; i < lines.size(); ++i) {
+        QString line = lines[i];
+        if (line.endsWith('\r')) {
+            line.chop(1);
+        }
+
+        if (inCodeBlock) {
+            if (codeBlockEndReg.exactMatch(line)) {
+                inCodeBlock = false;
+            }
+
+            continue;
+        } else if (codeBlockStartReg.exactMatch(line)) {
+            inCodeBlock = true;
+            continue;
+        }
+
+        if (headerReg.exactMatch(line)) {
+            headings.append(VManifestHeading(headerReg.cap(1).length(),
+                                             headerReg.cap(2).trimmed(),
+                                             i + 1));
+        }
+    }
+
+    return headings;
+}
+
+VManifestFolder VNotebookManifest::folderFromJson(const QString &p_name, const QJsonObject &p_json)
+{
+    VManifestFolder folder;
+    folder.m_name = p_name;
+    folder.m_createdTimeUtc = msecsFromString(p_json[DirConfig::c_createdTime].toString());
+
+    // [sub_directories] section.
+    QJsonArray dirJson = p_json[DirConfig::c_subDirectories].toArray();
+    for (int i = 0; i < dirJson.size(); ++i) {
+        folder.m_subDirs.append(dirJson[i].toObject()[DirConfig::c_name].toString());
+    }
+
+    // [files] section.
+    QJsonArray fileJson = p_json[DirConfig::c_files].toArray();
+    folder.m_notes.reserve(fileJson.size());
+    for (int i = 0; i < fileJson.size(); ++i) {
+        QJsonObject fileItem = fileJson[i].toObject();
+        VManifestNote note;
+        note.m_name = fileItem[DirConfig::c_name].toString();
+        note.m_createdTimeUtc = msecsFromString(fileItem[DirConfig::c_createdTime].toString());
+        note.m_modifiedTimeUtc = msecsFromString(fileItem[DirConfig::c_modifiedTime].toString());
+
+        QJsonArray attachmentJson = fileItem[DirConfig::c_attachments].toArray();
+        for (int j = 0; j < attachmentJson.size(); ++j) {
+            note.m_attachments.append(attachmentJson[j].toObject()[DirConfig::c_name].toString());
+        }
+
+        QJsonArray tagsJson = fileItem[DirConfig::c_tags].toArray();
+        for (int j = 0; j < tagsJson.size(); ++j) {
+            note.m_tags.append(tagsJson[j].toString());
+        }
+
+        folder.m_notes.append(note);
+    }
+
+    return folder;
+}
+
+QString VNotebookManifest::cacheFilePath(const QString &p_notebookPath)
+{
+    QByteArray hash = QCryptographicHash::hash(p_notebookPath.toUtf8(),
+                                               QCryptographicHash::Sha1);
+    return QDir(g_config->getCacheFolder()).filePath(QString::fromLatin1(hash.toHex())
+                                                     + QStringLiteral(".manifest"));
+}
+
+void VNotebookManifest::deleteCache(const QString &p_notebookPath)
+{
+    QFile::remove(cacheFilePath(p_notebookPath));
+}
+
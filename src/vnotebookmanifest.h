@@ -0,0 +1,421 @@
+#ifndef VNOTEBOOKMANIFEST_H
+#define VNOTEBOOKMANIFEST_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QJsonObject>
+
+class QTimer;
+class QDataStream;
+
+// Compact info of a note in the manifest.
+struct VManifestNote
+{
+    VManifestNote()
+        : m_createdTimeUtc(0),
+          m_modifiedTimeUtc(0)
+    {
+    }
+
+    QString m_name;
+
+    // Milliseconds since epoch.
+    qint64 m_createdTimeUtc;
+
+    qint64 m_modifiedTimeUtc;
+
+    QStringList m_tags;
+
+    // Names of the attachments.
+    QStringList m_attachments;
+};
+
+
+// A heading of a note in the outline index.
+struct VManifestHeading
+{
+    VManifestHeading()
+        : m_level(-1),
+          m_lineNumber(-1)
+    {
+    }
+
+    VManifestHeading(int p_level, const QString &p_text, int p_lineNumber)
+        : m_level(p_level),
+          m_text(p_text),
+          m_lineNumber(p_lineNumber)
+    {
+    }
+
+    int m_level;
+
+    QString m_text;
+
+    // 1-based line number.
+    int m_lineNumber;
+};
+
+
+// Indexed outline of a note.
+struct VManifestOutline
+{
+    VManifestOutline()
+        : m_fileModifiedTime(0),
+          m_fileSize(0)
+    {
+    }
+
+    // Last modified time and size of the note file when indexed.
+    qint64 m_fileModifiedTime;
+
+    qint64 m_fileSize;
+
+    QVector<VManifestHeading> m_headings;
+};
+
+
+// Compact info of a folder in the manifest.
+struct VManifestFolder
+{
+    VManifestFolder()
+        : m_createdTimeUtc(0),
+          m_configModifiedTime(0),
+          m_configSize(0)
+    {
+    }
+
+    QString m_name;
+
+    // Milliseconds since epoch.
+    qint64 m_createdTimeUtc;
+
+    // Last modified time and size of the config file of this folder.
+    // Used to detect changes made outside.
+    qint64 m_configModifiedTime;
+
+    qint64 m_configSize;
+
+    // Names of sub-folders in the order of config.
+    QStringList m_subDirs;
+
+    QVector<VManifestNote> m_notes;
+};
+
+
+// Copy of the folders and indexes of a manifest, which could be read in another
+// thread while the manifest itself keeps being updated.
+struct VManifestSnapshot
+{
+    // Return NULL if not found.
+    const VManifestFolder *findFolder(const QString &p_relativePath) const;
+
+    // Absolute path of folder @p_relativePath.
+    QString fetchPath(const QString &p_relativePath) const;
+
+    // Return NULL if the note is not indexed or has been changed.
+    const VManifestOutline *findOutline(const QString &p_notePath) const;
+
+    QString m_notebookPath;
+
+    QHash<QString, VManifestFolder> m_folders;
+
+    QHash<QString, QSet<QString>> m_tagIndex;
+
+    QHash<QString, VManifestOutline> m_outlines;
+};
+
+
+// Read the folders of a manifest from the cache file or the config files, or
+// validate them against the config files, in background so the GUI thread
+// does not read the config files of the whole notebook.
+class VManifestBuilder : public QThread
+{
+    Q_OBJECT
+public:
+    // Read the manifest from the cache file and validate it, or build it from
+    // the config files if there is no valid cache.
+    explicit VManifestBuilder(const QString &p_notebookPath, QObject *p_parent = nullptr);
+
+    // Validate @p_folders against the config files.
+    VManifestBuilder(const QString &p_notebookPath,
+                     const QHash<QString, VManifestFolder> &p_folders,
+                     QObject *p_parent = nullptr);
+
+    // Do the work in the calling thread.
+    void build();
+
+    // Results below should be taken after finished.
+    bool isSucceeded() const;
+
+    // Whether the folders differ from the cache or the given ones.
+    bool isChanged() const;
+
+    // Whether it is to validate given folders.
+    bool isValidation() const;
+
+    const QHash<QString, VManifestFolder> &getFolders() const;
+
+    // Outlines read from the cache file.
+    const QHash<QString, VManifestOutline> &getOutlines() const;
+
+    // Whether folder @p_relativePath with info @p_folder has its config
+    // changed since it is read. Could be called in any thread.
+    static bool configChanged(const QString &p_notebookPath,
+                              const QString &p_relativePath,
+                              const VManifestFolder &p_folder);
+
+    // Read folder @p_relativePath from its config. Could be called in any
+    // thread.
+    static bool readFolder(const QString &p_notebookPath,
+                           const QString &p_relativePath,
+                           VManifestFolder &p_folder);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    bool readFromCache();
+
+    // Read folder @p_relativePath and its sub-folders into m_folders.
+    bool loadFolder(const QString &p_relativePath);
+
+    // Re-read folders whose config file has been changed outside.
+    void validate();
+
+    void validateFolder(const QString &p_relativePath,
+                        QHash<QString, VManifestFolder> &p_folders);
+
+    QString m_notebookPath;
+
+    bool m_validation;
+
+    bool m_succeeded;
+
+    bool m_changed;
+
+    QHash<QString, VManifestFolder> m_folders;
+
+    QHash<QString, VManifestOutline> m_outlines;
+};
+
+
+// A flat manifest of all the folders and notes of one notebook.
+// It is persisted in the cache folder as one binary file so that name, path,
+// and tag searches could be done without reading each folder's config.
+// Folders are keyed by the path relative to the notebook root ("" for root).
+class VNotebookManifest : public QObject
+{
+    Q_OBJECT
+
+    friend class VManifestBuilder;
+
+public:
+    VNotebookManifest(const QString &p_notebookPath, QObject *p_parent = nullptr);
+
+    ~VNotebookManifest();
+
+    // Load the manifest from cache and check it against the config files.
+    // Rebuild it from disk if there is no valid cache.
+    // Wait for the loading in background if there is one.
+    bool load();
+
+    // Start loading the manifest in background if not loaded yet.
+    // Returns whether it is loaded. loaded() will be emitted once loaded.
+    bool loadInBackground();
+
+    bool isLoaded() const;
+
+    // Check the folders against the config files in background, such as after
+    // a search finds a config changed outside.
+    void revalidate();
+
+    // Write the manifest to the cache file.
+    bool save();
+
+    // Update the folder @p_relativePath with its config @p_json which has
+    // just been queued to write.
+    void updateFolder(const QString &p_relativePath, const QJsonObject &p_json);
+
+    // Return NULL if not found.
+    const VManifestFolder *findFolder(const QString &p_relativePath) const;
+
+    // Absolute path of folder @p_relativePath.
+    QString fetchPath(const QString &p_relativePath) const;
+
+    // Return paths of notes in folder @p_relativePath recursively.
+    QList<QString> collectFiles(const QString &p_relativePath) const;
+
+    // Inverted index from tag to relative paths of notes with that tag.
+    const QHash<QString, QSet<QString>> &getTagIndex() const;
+
+    // Return relative paths of notes with tags @p_tags sorted.
+    // @p_matchAll: whether a note should have all the tags or any of them.
+    QStringList fetchNotesByTags(const QStringList &p_tags, bool p_matchAll) const;
+
+    // Update the outline of note @p_notePath (relative path) which has just
+    // been saved.
+    void updateOutline(const QString &p_notePath, const QVector<VManifestHeading> &p_headings);
+
+    // Return the indexed outline of note @p_notePath (relative path).
+    // Return NULL if the note is not indexed yet or has been changed.
+    const VManifestOutline *findOutline(const QString &p_notePath) const;
+
+    // Add outline @p_outline of note @p_notePath built by buildOutline().
+    void addOutline(const QString &p_notePath, const VManifestOutline &p_outline);
+
+    // Copy of current folders and indexes. Cheap since the data are implicitly
+    // shared until the manifest is changed.
+    VManifestSnapshot snapshot() const;
+
+    // Build the outline of note file @p_filePath into @p_outline.
+    // Could be called in any thread.
+    // Returns false if the note could not be read.
+    static bool buildOutline(const QString &p_filePath, VManifestOutline &p_outline);
+
+    // Parse headings from Markdown text @p_text.
+    static QVector<VManifestHeading> parseHeadings(const QString &p_text);
+
+    // Delete the cache file of notebook @p_notebookPath.
+    static void deleteCache(const QString &p_notebookPath);
+
+    static QString childPath(const QString &p_relativePath, const QString &p_name);
+
+    // Could be called in any thread.
+    static VManifestFolder folderFromJson(const QString &p_name, const QJsonObject &p_json);
+
+signals:
+    // Emitted when the manifest is loaded in background.
+    void loaded();
+
+private slots:
+    // Record the config file info of a folder once its config is written.
+    void handleConfigWritten(const QString &p_filePath, qint64 p_modifiedTime, qint64 p_size);
+
+    void handleBuilderFinished();
+
+private:
+    // Read folder @p_relativePath and its sub-folders from disk.
+    bool loadFolder(const QString &p_relativePath);
+
+    // Remove folder @p_relativePath and its sub-folders.
+    void removeFolder(const QString &p_relativePath);
+
+    // Take the results of @p_builder which is finished.
+    void takeBuilderResults(VManifestBuilder *p_builder);
+
+    void collectFiles(const QString &p_relativePath, QList<QString> &p_files) const;
+
+    void addFolderToTagIndex(const QString &p_relativePath, const VManifestFolder &p_folder);
+
+    void removeFolderFromTagIndex(const QString &p_relativePath, const VManifestFolder &p_folder);
+
+    void rebuildTagIndex();
+
+    // Remove outlines of notes in @p_oldFolder which are not in @p_newFolder.
+    void removeOutlines(const QString &p_relativePath,
+                        const VManifestFolder &p_oldFolder,
+                        const VManifestFolder *p_newFolder = NULL);
+
+    // Remove outlines of notes not in the manifest.
+    void pruneOutlines();
+
+    // Fill file info of note @p_notePath into @p_outline.
+    void fetchFileInfo(const QString &p_notePath, VManifestOutline &p_outline) const;
+
+    // Fill config file info of @p_folder.
+    // The info is left invalid if its config is not written yet, which will be
+    // filled by handleConfigWritten().
+    void fetchConfigInfo(const QString &p_relativePath, VManifestFolder &p_folder) const;
+
+    QString folderName(const QString &p_relativePath) const;
+
+    // Schedule a save to the cache file.
+    void markDirty();
+
+    static QString cacheFilePath(const QString &p_notebookPath);
+
+    QString m_notebookPath;
+
+    bool m_loaded;
+
+    bool m_dirty;
+
+    QHash<QString, VManifestFolder> m_folders;
+
+    // Built from m_folders after loaded and maintained along with it.
+    QHash<QString, QSet<QString>> m_tagIndex;
+
+    // Outline index keyed by the relative path of notes.
+    // Notes are indexed on save or lazily on the first outline search.
+    QHash<QString, VManifestOutline> m_outlines;
+
+    // Timer to save the manifest to cache file.
+    QTimer *m_saveTimer;
+
+    // Loading or validating in background.
+    VManifestBuilder *m_builder;
+
+    // Folders updated while the builder is running, which may have been read
+    // by it before the update.
+    QSet<QString> m_updatedFolders;
+};
+
+inline bool VManifestBuilder::isSucceeded() const
+{
+    return m_succeeded;
+}
+
+inline bool VManifestBuilder::isChanged() const
+{
+    return m_changed;
+}
+
+inline bool VManifestBuilder::isValidation() const
+{
+    return m_validation;
+}
+
+inline const QHash<QString, VManifestFolder> &VManifestBuilder::getFolders() const
+{
+    return m_folders;
+}
+
+inline const QHash<QString, VManifestOutline> &VManifestBuilder::getOutlines() const
+{
+    return m_outlines;
+}
+
+inline bool VNotebookManifest::isLoaded() const
+{
+    return m_loaded;
+}
+
+inline const VManifestFolder *VNotebookManifest::findFolder(const QString &p_relativePath) const
+{
+    auto it = m_folders.find(p_relativePath);
+    if (it == m_folders.end()) {
+        return NULL;
+    }
+
+    return &it.value();
+}
+
+inline const QHash<QString, QSet<QString>> &VNotebookManifest::getTagIndex() const
+{
+    return m_tagIndex;
+}
+
+inline QString VNotebookManifest::childPath(const QString &p_relativePath, const QString &p_name)
+{
+    if (p_relativePath.isEmpty()) {
+        return p_name;
+    }
+
+    return p_relativePath + '/' + p_name;
+}
+#endif // VNOTEBOOKMANIFEST_H
@@ -9,6 +9,8 @@
 #include <QLabel>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QProgressDialog>
+#include <QPushButton>
 #include "vnotebook.h"
 #include "vconfigmanager.h"
 #include "dialog/vnewnotebookdialog.h"
@@ -23,9 +25,18 @@
 #include "vmainwindow.h"
 #include "utils/vimnavigationforwidget.h"
 #include "utils/viconutils.h"
+#include "vresourceindex.h"
+#include "vfilesaver.h"
+#include "dialog/vconfirmdeletiondialog.h"
 
 extern VConfigManager *g_config;
 
+// Range of the progress dialog of cleaning up unused files.
+#define PROGRESS_RANGE 1000
+
+// Min duration in ms before showing the progress dialog.
+#define PROGRESS_MIN_DURATION 500
+
 extern VNote *g_vnote;
 
 extern VMainWindow *g_mainWin;
@@ -350,11 +361,30 @@ void VNotebookSelector::addNotebookItem(const VNotebook *p_notebook)
     fillItem(item, p_notebook);
 }
 
+void VNotebookSelector::updateNotebookItem(const VNotebook *p_notebook)
+{
+    int idx = itemIndexOfNotebook(p_notebook);
+    if (idx == -1) {
+        return;
+    }
+
+    fillItem(m_listWidget->item(idx), p_notebook);
+}
+
 void VNotebookSelector::fillItem(QListWidgetItem *p_item,
                                  const VNotebook *p_notebook) const
 {
     p_item->setText(p_notebook->getName());
-    p_item->setToolTip(p_notebook->getName());
+
+    // Do not check the validity of a notebook not loaded, which will load it.
+    if (!p_notebook->isLoaded()) {
+        p_item->setToolTip(tr("%1 (loading)").arg(p_notebook->getName()));
+    } else if (!p_notebook->isValid()) {
+        p_item->setToolTip(tr("%1 (unavailable)").arg(p_notebook->getName()));
+    } else {
+        p_item->setToolTip(p_notebook->getName());
+    }
+
     p_item->setIcon(VIconUtils::comboBoxIcon(":/resources/icons/notebook_item.svg"));
     p_item->setData(Qt::UserRole, (qulonglong)p_notebook);
 }
@@ -463,6 +493,15 @@ void VNotebookSelector::popupListContextMenuRequested(QPoint p_pos)
                     }
                 });
         menu.addAction(emptyRecycleBinAct);
+
+        QAction *cleanUpAct = new QAction(VIconUtils::menuDangerIcon(":/resources/icons/clear_attachment.svg"),
+                                          tr("&Clean Up Unused Files"),
+                                          &menu);
+        cleanUpAct->setToolTip(tr("Find and delete the images and attachments not used by "
+                                  "any note of this notebook"));
+        connect(cleanUpAct, &QAction::triggered,
+                this, &VNotebookSelector::cleanUpUnusedFiles);
+        menu.addAction(cleanUpAct);
     }
 
     menu.addSeparator();
@@ -638,3 +677,185 @@ VNotebook *VNotebookSelector::currentNotebook() const
 {
     return getNotebook(currentIndex());
 }
+
+// Return @p_size in bytes in a readable unit.
+static QString displaySize(qint64 p_size)
+{
+    if (p_size < 1024) {
+        return QObject::tr("%1 B").arg(p_size);
+    } else if (p_size < 1024 * 1024) {
+        return QObject::tr("%1 KB").arg(p_size / 1024.0, 0, 'f', 1);
+    } else {
+        return QObject::tr("%1 MB").arg(p_size / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+}
+
+void VNotebookSelector::cleanUpUnusedFiles()
+{
+    QList<QListWidgetItem *> items = m_listWidget->selectedItems();
+    if (items.isEmpty()) {
+        return;
+    }
+
+    Q_ASSERT(items.size() == 1);
+    VNotebook *notebook = getNotebook(items[0]);
+    if (!notebook || !notebook->isValid()) {
+        return;
+    }
+
+    // Images inserted into notes not saved yet are not referenced on disk.
+    if (!g_mainWin->getEditArea()->closeFile(notebook, false)) {
+        return;
+    }
+
+    VFileSaver::getInstance()->flush();
+
+    QProgressDialog progress(tr("Finding unused files of notebook %1...").arg(notebook->getName()),
+                             tr("Cancel"),
+                             0,
+                             PROGRESS_RANGE,
+                             this);
+    progress.setWindowModality(Qt::ApplicationModal);
+    progress.setMinimumDuration(PROGRESS_MIN_DURATION);
+
+    // User input is blocked until the modal progress dialog shows up, since
+    // the notebook is held during the build.
+    VResourceIndex index;
+    connect(&index, &VResourceIndex::progressChanged,
+            &progress, [&progress, &index](int p_done, int p_total) {
+                progress.setValue(p_total > 0 ? (int)((qint64)p_done * PROGRESS_RANGE / p_total) : 0);
+                if (progress.isVisible()) {
+                    index.setProcessUserInput(true);
+                }
+            });
+    connect(&progress, &QProgressDialog::canceled,
+            &index, &VResourceIndex::cancel);
+
+    bool ret = index.build(notebook);
+    progress.reset();
+    if (!ret) {
+        if (index.hasFailed()) {
+            VUtils::showMessage(QMessageBox::Warning,
+                                tr("Warning"),
+                                tr("Fail to find unused files of notebook "
+                                   "<span style=\"%1\">%2</span>.")
+                                  .arg(g_config->c_dataTextStyle)
+                                  .arg(notebook->getName()),
+                                index.getError(),
+                                QMessageBox::Ok,
+                                QMessageBox::Ok,
+                                this);
+        }
+
+        return;
+    }
+
+    QVector<VResourceFile> files = index.getUnreferencedFiles();
+    if (files.isEmpty()) {
+        VUtils::showMessage(QMessageBox::Information,
+                            tr("Information"),
+                            tr("No unused images or attachments found in notebook "
+                               "<span style=\"%1\">%2</span>.")
+                              .arg(g_config->c_dataTextStyle)
+                              .arg(notebook->getName()),
+                            "",
+                            QMessageBox::Ok,
+                            QMessageBox::Ok,
+                            this);
+        return;
+    }
+
+    qint64 totalSize = 0;
+    QVector<ConfirmItemInfo> confirmItems;
+    for (int i = 0; i < files.size(); ++i) {
+        const VResourceFile &file = files[i];
+        totalSize += file.m_size;
+        confirmItems.push_back(ConfirmItemInfo(file.m_path,
+                                               tr("%1 (%2)").arg(file.m_path)
+                                                            .arg(displaySize(file.m_size)),
+                                               file.m_path,
+                                               (void *)(qintptr)i));
+    }
+
+    QString text = tr("Following %1 images and attachments (%2) are not used by any note of "
+                      "notebook <span style=\"%3\">%4</span>. Please confirm the files to "
+                      "clean up.")
+                     .arg(files.size())
+                     .arg(displaySize(totalSize))
+                     .arg(g_config->c_dataTextStyle)
+                     .arg(notebook->getName());
+
+    QString info = tr("Images or attachments linked in ways VNote could not recognize "
+                      "may be listed.<br>"
+                      "Click \"Cancel\" to leave them untouched.");
+
+    VConfirmDeletionDialog dialog(tr("Confirm Cleaning Up Unused Files"),
+                                  text,
+                                  info,
+                                  confirmItems,
+                                  false,
+                                  false,
+                                  true,
+                                  this);
+    if (!dialog.exec()) {
+        return;
+    }
+
+    confirmItems = dialog.getConfirmedItems();
+    if (confirmItems.isEmpty()) {
+        return;
+    }
+
+    QMessageBox box(QMessageBox::Question,
+                    tr("Clean Up Unused Files"),
+                    tr("Move the %1 files to the recycle bin of the notebook or delete them "
+                       "permanently?").arg(confirmItems.size()),
+                    QMessageBox::NoButton,
+                    this);
+    QPushButton *recycleBtn = box.addButton(tr("Move To Recycle Bin"), QMessageBox::AcceptRole);
+    QPushButton *deleteBtn = box.addButton(tr("Delete Permanently"), QMessageBox::DestructiveRole);
+    box.addButton(QMessageBox::Cancel);
+    box.setDefaultButton(recycleBtn);
+    box.exec();
+
+    QAbstractButton *btn = box.clickedButton();
+    if (btn != recycleBtn && btn != deleteBtn) {
+        return;
+    }
+
+    bool skipRecycleBin = btn == deleteBtn;
+    int nrCleaned = 0;
+    qint64 cleanedSize = 0;
+    for (auto const & item : confirmItems) {
+        const VResourceFile &file = files[(int)(qintptr)item.m_data];
+        if (VUtils::deleteFile(notebook, file.m_path, skipRecycleBin)) {
+            ++nrCleaned;
+            cleanedSize += file.m_size;
+        } else {
+            qWarning() << "fail to clean up unused file" << file.m_path;
+        }
+    }
+
+    QString msg;
+    if (skipRecycleBin) {
+        msg = tr("Deleted %1 files and reclaimed %2.")
+                .arg(nrCleaned)
+                .arg(displaySize(cleanedSize));
+    } else {
+        msg = tr("Moved %1 files (%2) to the recycle bin. Empty the recycle bin to reclaim "
+                 "the space.")
+                .arg(nrCleaned)
+                .arg(displaySize(cleanedSize));
+    }
+
+    VUtils::showMessage(nrCleaned == confirmItems.size() ? QMessageBox::Information
+                                                         : QMessageBox::Warning,
+                        tr("Information"),
+                        msg,
+                        nrCleaned == confirmItems.size() ? QString()
+                                                         : tr("Fail to clean up some files. "
+                                                              "Please check the log for details."),
+                        QMessageBox::Ok,
+                        QMessageBox::Ok,
+                        this);
+}
@@ -49,6 +49,9 @@ public slots:
     // Popup a dialog to prompt user to create a notebook.
     bool newNotebook();
 
+    // Update the item of @p_notebook, such as after it is loaded.
+    void updateNotebookItem(const VNotebook *p_notebook);
+
 protected:
     bool eventFilter(QObject *watched, QEvent *event) Q_DECL_OVERRIDE;
 
@@ -64,6 +67,10 @@ private slots:
     // View and edit notebook information of selected notebook.
     void editNotebookInfo();
 
+    // Find the images and attachments not used by any note of selected
+    // notebook and clean them up.
+    void cleanUpUnusedFiles();
+
 private:
     // Update Combox from m_notebooks.
     void updateComboBox();
@@ -9,6 +9,7 @@
 #include <QDebug>
 
 #include "vdirectory.h"
+#include "utils/vstringpool.h"
 
 VNoteFile::VNoteFile(VDirectory *p_directory,
                      const QString &p_name,
@@ -62,6 +63,8 @@ bool VNoteFile::rename(const QString &p_name)
     VDirectory *dir = getDirectory();
     Q_ASSERT(dir);
 
+    waitForSaved();
+
     // Rename it in disk.
     QDir diskDir(dir->fetchPath());
     if (!diskDir.rename(m_name, p_name)) {
@@ -147,7 +150,7 @@ VNoteFile *VNoteFile::fromJson(VDirectory *p_directory,
     // Tags.
     QJsonArray tagsJson = p_json[DirConfig::c_tags].toArray();
     for (int i = 0; i < tagsJson.size(); ++i) {
-        file->m_tags.append(tagsJson[i].toString());
+        file->m_tags.append(VStringPool::intern(tagsJson[i].toString()));
     }
 
     return file;
@@ -157,8 +160,8 @@ QJsonObject VNoteFile::toConfigJson() const
 {
     QJsonObject item;
     item[DirConfig::c_name] = m_name;
-    item[DirConfig::c_createdTime] = m_createdTimeUtc.toString(Qt::ISODate);
-    item[DirConfig::c_modifiedTime] = m_modifiedTimeUtc.toString(Qt::ISODate);
+    item[DirConfig::c_createdTime] = getCreatedTimeUtc().toString(Qt::ISODate);
+    item[DirConfig::c_modifiedTime] = getModifiedTimeUtc().toString(Qt::ISODate);
     item[DirConfig::c_attachmentFolder] = m_attachmentFolder;
 
     // Attachments.
@@ -473,6 +476,8 @@ bool VNoteFile::copyFile(VDirectory *p_destDir,
         return false;
     }
 
+    p_file->waitForSaved();
+
     QString opStr = p_isCut ? tr("cut") : tr("copy");
     VDirectory *srcDir = p_file->getDirectory();
     DocType docType = p_file->getDocType();
@@ -642,7 +647,7 @@ bool VNoteFile::addTag(const QString &p_tag)
         return false;
     }
 
-    m_tags.append(p_tag);
+    m_tags.append(VStringPool::intern(p_tag));
     if (!getDirectory()->updateFileConfig(this)) {
         qWarning() << "fail to update config of file" << m_name
                    << "in directory" << fetchBasePath();
@@ -655,8 +660,10 @@ bool VNoteFile::addTag(const QString &p_tag)
 
 bool VNoteFile::save()
 {
+    qint64 modifiedTime = m_modifiedTimeUtc;
     bool ret = VFile::save();
-    if (ret) {
+    // The modified time is not updated if nothing is written.
+    if (ret && m_modifiedTimeUtc != modifiedTime) {
         if (!getDirectory()->updateFileConfig(this)) {
             qWarning() << "fail to update config of file" << m_name
                        << "in directory" << fetchBasePath();
@@ -666,3 +673,20 @@ bool VNoteFile::save()
 
     return ret;
 }
+
+void VNoteFile::savedInBackground()
+{
+    getDirectory()->updateFileConfigLater();
+}
+
+void VNoteFile::close()
+{
+    bool opened = isOpened();
+
+    VFile::close();
+
+    if (opened) {
+        // Write the modified time of the last save in background.
+        getDirectory()->flushFileConfig();
+    }
+}
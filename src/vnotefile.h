@@ -49,6 +49,8 @@ public:
 
     bool save() Q_DECL_OVERRIDE;
 
+    void close() Q_DECL_OVERRIDE;
+
     // Set the name of this file.
     void setName(const QString &p_name);
 
@@ -145,6 +147,9 @@ public:
                                    int *p_nrImageCopied,
                                    QString *p_errMsg = NULL);
 
+protected:
+    void savedInBackground() Q_DECL_OVERRIDE;
+
 private:
     // Delete internal images of this file.
     // Return true only when all internal images were deleted successfully.
@@ -5,14 +5,24 @@
 #include <QUrl>
 #include <QVector>
 #include <QTextLayout>
+#include <QTimer>
+#include <QEvent>
 
 #include "vconfigmanager.h"
 #include "utils/vutils.h"
 #include "vdownloader.h"
+#include "vimagedecoder.h"
 #include "pegmarkdownhighlighter.h"
 
 extern VConfigManager *g_config;
 
+// Images are decoded for the width of the editor rounded up to multiple of
+// this, so resizing a bit will not decode them again.
+#define DECODE_WIDTH_STEP 256
+
+// Delay in ms to decode images again after the editor is resized.
+#define REDECODE_DELAY 500
+
 VPreviewManager::VPreviewManager(VMdEditor *p_editor, PegMarkdownHighlighter *p_highlighter)
     : QObject(p_editor),
       m_editor(p_editor),
@@ -27,6 +37,30 @@ VPreviewManager::VPreviewManager(VMdEditor *p_editor, PegMarkdownHighlighter *p_
     m_downloader = new VDownloader(this);
     connect(m_downloader, &VDownloader::downloadFinished,
             this, &VPreviewManager::imageDownloaded);
+
+    connect(VImageDecoder::getInstance(), &VImageDecoder::imageDecoded,
+            this, &VPreviewManager::handleImageDecoded);
+    connect(VImageDecoder::getInstance(), &VImageDecoder::imageSizeRead,
+            this, &VPreviewManager::handleImageSizeRead);
+
+    m_redecodeTimer = new QTimer(this);
+    m_redecodeTimer->setSingleShot(true);
+    m_redecodeTimer->setInterval(REDECODE_DELAY);
+    connect(m_redecodeTimer, &QTimer::timeout,
+            this, &VPreviewManager::redecodeImages);
+
+    m_editor->viewport()->installEventFilter(this);
+}
+
+bool VPreviewManager::eventFilter(QObject *p_obj, QEvent *p_event)
+{
+    if (p_event->type() == QEvent::Resize
+        && p_obj == m_editor->viewport()
+        && !m_localImages.isEmpty()) {
+        m_redecodeTimer->start();
+    }
+
+    return QObject::eventFilter(p_obj, p_event);
 }
 
 void VPreviewManager::updateImageLinks(const QVector<VElementRegion> &p_imageRegions)
@@ -253,6 +287,29 @@ void VPreviewManager::fetchImageInfoToPreview(const QString &p_text, ImageLinkIn
     p_info.m_linkUrl = imagePath;
 }
 
+// Get the size to layout an image of @p_size with width @p_width and height
+// @p_height specified by its link.
+static QSize imageLayoutSize(const QSize &p_size, int p_width, int p_height)
+{
+    qreal sf = VUtils::calculateScaleFactor();
+    if (p_width > 0) {
+        if (p_height > 0) {
+            return QSize(p_width * sf, p_height * sf);
+        }
+
+        int width = p_width * sf;
+        return QSize(width, qRound((qreal)p_size.height() * width / p_size.width()));
+    } else if (p_height > 0) {
+        int height = p_height * sf;
+        return QSize(qRound((qreal)p_size.width() * height / p_size.height()), height);
+    } else if (sf < 1.1) {
+        return p_size;
+    } else {
+        int width = p_size.width() * sf;
+        return QSize(width, qRound((qreal)p_size.height() * width / p_size.width()));
+    }
+}
+
 QString VPreviewManager::imageResourceName(const ImageLinkInfo &p_link)
 {
     // Add size info to the name.
@@ -263,45 +320,179 @@ QString VPreviewManager::imageResourceName(const ImageLinkInfo &p_link)
         return name;
     }
 
-    // Add it to the resource.
-    QPixmap image;
     QString imgPath = p_link.m_linkUrl;
-    if (QFileInfo::exists(imgPath)) {
-        // Local file.
-        image = VUtils::pixmapFromFile(imgPath);
-    } else {
+    if (!QFileInfo::exists(imgPath)) {
         // URL. Try to download it.
         m_downloader->download(imgPath);
         m_urlToName.insert(imgPath, name);
+        return QString();
     }
 
-    if (image.isNull()) {
+    // Local file. Read its size and decode it in background.
+    auto it = m_localImages.constFind(name);
+    if (it != m_localImages.constEnd()
+        && it.value().m_serial != 0
+        && !it.value().m_size.isValid()) {
+        // It will be added once its size is read or it is decoded.
         return QString();
     }
 
-    // Resize the image.
-    Qt::TransformationMode tMode = Qt::SmoothTransformation;
-    qreal sf = VUtils::calculateScaleFactor();
-    if (p_link.m_width > 0) {
-        if (p_link.m_height > 0) {
-            m_editor->addImage(name, image.scaled(p_link.m_width * sf,
-                                                  p_link.m_height * sf,
-                                                  Qt::IgnoreAspectRatio,
-                                                  tMode));
-        } else {
-            m_editor->addImage(name, image.scaledToWidth(p_link.m_width * sf, tMode));
-        }
-    } else if (p_link.m_height > 0) {
-        m_editor->addImage(name, image.scaledToHeight(p_link.m_height * sf, tMode));
-    } else {
-        if (sf < 1.1) {
-            m_editor->addImage(name, image);
-        } else {
-            m_editor->addImage(name, image.scaledToWidth(image.width() * sf, tMode));
-        }
+    removeLocalImage(name);
+
+    LocalImage img;
+    img.m_path = imgPath;
+    img.m_width = p_link.m_width;
+    img.m_height = p_link.m_height;
+    img.m_serial = VImageDecoder::getInstance()->readSize(imgPath);
+
+    m_localImages.insert(name, img);
+    m_decodingImages.insert(img.m_serial, name);
+    return QString();
+}
+
+QSize VPreviewManager::decodeSize(const QSize &p_size) const
+{
+    if (!p_size.isValid() || !g_config->getEnablePreviewImageConstraint()) {
+        return p_size;
     }
 
-    return name;
+    int width = (m_editor->viewport()->width() / DECODE_WIDTH_STEP + 1) * DECODE_WIDTH_STEP;
+    if (p_size.width() <= width) {
+        return p_size;
+    }
+
+    return p_size.scaled(width, p_size.height(), Qt::KeepAspectRatio);
+}
+
+void VPreviewManager::decodeLocalImage(const QString &p_name)
+{
+    auto it = m_localImages.find(p_name);
+    if (it == m_localImages.end()) {
+        return;
+    }
+
+    LocalImage &img = it.value();
+    QSize size = decodeSize(img.m_size);
+    if (img.m_decodedSize.isValid()
+        && size.isValid()
+        && size.width() <= img.m_decodedSize.width()) {
+        // The decoded one is large enough to be scaled down.
+        return;
+    }
+
+    VImageDecoder *decoder = VImageDecoder::getInstance();
+    if (img.m_serial != 0) {
+        decoder->cancel(img.m_serial);
+        m_decodingImages.remove(img.m_serial);
+    }
+
+    img.m_decodedSize = size;
+    img.m_serial = decoder->decode(img.m_path, size);
+    m_decodingImages.insert(img.m_serial, p_name);
+}
+
+void VPreviewManager::removeLocalImage(const QString &p_name)
+{
+    auto it = m_localImages.find(p_name);
+    if (it == m_localImages.end()) {
+        return;
+    }
+
+    if (it.value().m_serial != 0) {
+        VImageDecoder::getInstance()->cancel(it.value().m_serial);
+        m_decodingImages.remove(it.value().m_serial);
+    }
+
+    m_localImages.erase(it);
+}
+
+void VPreviewManager::handleImageSizeRead(quint64 p_serial, const QSize &p_size)
+{
+    // It may be requested by other editors or obsolete.
+    auto it = m_decodingImages.find(p_serial);
+    if (it == m_decodingImages.end()) {
+        return;
+    }
+
+    QString name = it.value();
+    m_decodingImages.erase(it);
+
+    auto imgIt = m_localImages.find(name);
+    if (imgIt == m_localImages.end() || imgIt.value().m_serial != p_serial) {
+        return;
+    }
+
+    LocalImage &img = imgIt.value();
+    img.m_serial = 0;
+
+    // Layout a placeholder while decoding it. Otherwise it is added once
+    // decoded.
+    if (p_size.isValid() && !p_size.isEmpty()) {
+        img.m_size = imageLayoutSize(p_size, img.m_width, img.m_height);
+        m_editor->addImage(name, QPixmap(), img.m_size);
+    }
+
+    decodeLocalImage(name);
+
+    if (m_editor->containsImage(name)) {
+        // Preview it on next update.
+        emit requestUpdateImageLinks();
+    }
+}
+
+void VPreviewManager::handleImageDecoded(quint64 p_serial, const QImage &p_image)
+{
+    // It may be requested by other editors or obsolete.
+    auto it = m_decodingImages.find(p_serial);
+    if (it == m_decodingImages.end()) {
+        return;
+    }
+
+    QString name = it.value();
+    m_decodingImages.erase(it);
+
+    auto imgIt = m_localImages.find(name);
+    if (imgIt == m_localImages.end() || imgIt.value().m_serial != p_serial) {
+        return;
+    }
+
+    LocalImage &img = imgIt.value();
+    img.m_serial = 0;
+    if (p_image.isNull()) {
+        // Keep the placeholder.
+        return;
+    }
+
+    if (!img.m_size.isValid()) {
+        // The size is known only now. Preview it on next update.
+        img.m_size = imageLayoutSize(p_image.size(), img.m_width, img.m_height);
+        img.m_decodedSize = p_image.size();
+        m_editor->addImage(name, QPixmap::fromImage(p_image), img.m_size);
+        emit requestUpdateImageLinks();
+        return;
+    }
+
+    if (!m_editor->containsImage(name)) {
+        return;
+    }
+
+    // The placeholder takes the same space, so just paint it.
+    m_editor->addImage(name, QPixmap::fromImage(p_image), img.m_size);
+    m_editor->viewport()->update();
+}
+
+void VPreviewManager::redecodeImages()
+{
+    if (!m_previewEnabled) {
+        return;
+    }
+
+    QStringList names = m_localImages.keys();
+    for (auto const & name : names) {
+        if (m_localImages.value(name).m_size.isValid()) {
+            decodeLocalImage(name);
+        }
+    }
 }
 
 QString VPreviewManager::imageResourceNameForSource(PreviewSource p_source,
@@ -456,6 +647,7 @@ void VPreviewManager::clearObsoleteImages(long long p_timeStamp, PreviewSource p
     for (auto it = cache.begin(); it != cache.end();) {
         if (it.value() < p_timeStamp) {
             m_editor->removeImage(it.key());
+            removeLocalImage(it.key());
             it = cache.erase(it);
         } else {
             ++it;
@@ -7,12 +7,14 @@
 #include <QHash>
 #include <QVector>
 #include <QSharedPointer>
+#include <QImage>
 
 #include "markdownhighlighterdata.h"
 #include "vmdeditor.h"
 #include "vtextblockdata.h"
 
 class VDownloader;
+class QTimer;
 
 typedef long long TS;
 
@@ -78,6 +80,9 @@ public:
     // Calculate the block margin (prefix spaces) in pixels.
     static int calculateBlockMargin(const QTextBlock &p_block, int p_tabStopWidth);
 
+protected:
+    bool eventFilter(QObject *p_obj, QEvent *p_event) Q_DECL_OVERRIDE;
+
 public slots:
     // Image links were updated from the highlighter.
     void updateImageLinks(const QVector<VElementRegion> &p_imageRegions);
@@ -96,6 +101,16 @@ private slots:
     // Non-local image downloaded for preview.
     void imageDownloaded(const QByteArray &p_data, const QString &p_url);
 
+    // Local image decoded in background for preview.
+    void handleImageDecoded(quint64 p_serial, const QImage &p_image);
+
+    // Size of local image read in background.
+    void handleImageSizeRead(quint64 p_serial, const QSize &p_size);
+
+    // Decode the local images again if the editor gets wider than they are
+    // decoded for.
+    void redecodeImages();
+
 private:
     struct ImageLinkInfo
     {
@@ -196,11 +211,23 @@ private:
 
     // Get the name of the image in the resource manager.
     // Will add the image to the resource manager if not exists.
-    // Returns empty if fail to add the image to the resource manager.
+    // Returns empty if fail to add the image to the resource manager, or if a
+    // local image will be added once its size is read in background.
     QString imageResourceName(const ImageLinkInfo &p_link);
 
     QString imageResourceNameForSource(PreviewSource p_source, const QSharedPointer<VImageToPreview> &p_image);
 
+    // Queue decoding local image @p_name unless it has been decoded at a
+    // large enough size.
+    void decodeLocalImage(const QString &p_name);
+
+    // Remove local image @p_name and cancel its decoding.
+    void removeLocalImage(const QString &p_name);
+
+    // Size to decode an image laid out in @p_size.
+    // It is limited to the width of the editor if image width is constrained.
+    QSize decodeSize(const QSize &p_size) const;
+
     QHash<QString, long long> &imageCache(PreviewSource p_source);
 
     void clearObsoleteImages(long long p_timeStamp, PreviewSource p_source);
@@ -226,6 +253,44 @@ private:
     // Used for downloading images.
     QHash<QString, QString> m_urlToName;
 
+    // Local image decoded in background.
+    struct LocalImage
+    {
+        LocalImage()
+            : m_width(-1),
+              m_height(-1),
+              m_serial(0)
+        {
+        }
+
+        QString m_path;
+
+        // Width and height specified by the link, -1 for not specified.
+        int m_width;
+
+        int m_height;
+
+        // Size to layout the image.
+        // Invalid until its size is read, or if it could not be read before
+        // decoding.
+        QSize m_size;
+
+        // Size the image is decoded or being decoded at.
+        QSize m_decodedSize;
+
+        // Serial of current decoding or size reading, 0 for none.
+        quint64 m_serial;
+    };
+
+    // Local images added to the editor by name.
+    QHash<QString, LocalImage> m_localImages;
+
+    // Name of the image of each ongoing decoding or size reading.
+    QHash<quint64, QString> m_decodingImages;
+
+    // Delay decoding images again when the editor is being resized.
+    QTimer *m_redecodeTimer;
+
     // Timestamp per each preview source.
     TS m_timeStamps[(int)PreviewSource::MaxNumberOfSources];
 
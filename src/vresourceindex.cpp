@@ -0,0 +1,365 @@
+#include "vresourceindex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+
+#include "vconstants.h"
+#include "vconfigmanager.h"
+#include "vnotebook.h"
+#include "utils/vutils.h"
+
+// Max number of threads to read and parse notes.
+#define MAX_INDEX_THREADS 4
+
+// Interval in ms to report the progress.
+#define PROGRESS_INTERVAL 100
+
+VResourceIndexWorker::VResourceIndexWorker(VResourceIndex *p_index, QObject *p_parent)
+    : QThread(p_parent),
+      m_index(p_index)
+{
+}
+
+void VResourceIndexWorker::run()
+{
+    VResourceIndex::Job job;
+    while (m_index->takeJob(job)) {
+        if (job.m_type == VResourceIndex::Job::Directory) {
+            m_index->processDirectory(job.m_path);
+        } else {
+            m_index->processNote(job.m_path);
+        }
+
+        m_index->finishJob();
+    }
+}
+
+
+VResourceIndex::VResourceIndex(QObject *p_parent)
+    : QObject(p_parent),
+      m_unfinishedJobs(0),
+      m_finishedJobs(0),
+      m_totalJobs(0),
+      m_cancelled(0),
+      m_failed(0),
+      m_processUserInput(false),
+      m_loop(NULL)
+{
+}
+
+void VResourceIndex::setProcessUserInput(bool p_enabled)
+{
+    if (m_processUserInput == p_enabled) {
+        return;
+    }
+
+    m_processUserInput = p_enabled;
+
+    // Run the nested loop again with the new flags.
+    if (m_loop) {
+        m_loop->quit();
+    }
+}
+
+void VResourceIndex::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cancelled.store(1);
+    m_jobCond.wakeAll();
+}
+
+bool VResourceIndex::build(const VNotebook *p_notebook)
+{
+    m_imageFolder = p_notebook->getImageFolder();
+    m_attachmentFolder = p_notebook->getAttachmentFolder();
+
+    m_cancelled.store(0);
+    m_failed.store(0);
+    m_error.clear();
+    m_jobs.clear();
+    m_unfinishedJobs = m_finishedJobs = m_totalJobs = 0;
+    m_references.clear();
+    m_files.clear();
+    m_collectedFolders.clear();
+
+    addJob(Job::Directory, p_notebook->getPath());
+
+    int numThread = qBound(1, QThread::idealThreadCount(), MAX_INDEX_THREADS);
+
+    QEventLoop loop;
+    int finishedWorkers = 0;
+    QList<VResourceIndexWorker *> workers;
+    for (int i = 0; i < numThread; ++i) {
+        VResourceIndexWorker *th = new VResourceIndexWorker(this, this);
+        connect(th, &VResourceIndexWorker::finished,
+                &loop, [&loop, &finishedWorkers, numThread]() {
+                    if (++finishedWorkers == numThread) {
+                        loop.quit();
+                    }
+                });
+
+        workers.append(th);
+        th->start(QThread::LowPriority);
+    }
+
+    QTimer timer;
+    timer.setInterval(PROGRESS_INTERVAL);
+    connect(&timer, &QTimer::timeout,
+            this, [this]() {
+                int done, total;
+                {
+                    QMutexLocker locker(&m_mutex);
+                    done = m_finishedJobs;
+                    total = m_totalJobs;
+                }
+
+                emit progressChanged(done, total);
+            });
+    timer.start();
+
+    m_loop = &loop;
+    while (finishedWorkers < numThread) {
+        loop.exec(m_processUserInput ? QEventLoop::AllEvents
+                                     : QEventLoop::ExcludeUserInputEvents);
+    }
+
+    m_loop = NULL;
+    timer.stop();
+
+    for (auto th : workers) {
+        th->wait();
+        delete th;
+    }
+
+    qDebug() << "resource index of notebook" << p_notebook->getName()
+             << m_finishedJobs << "jobs" << m_references.size() << "references"
+             << m_files.size() << "files" << (isCancelled() ? "cancelled" : "")
+             << (hasFailed() ? "failed" : "");
+
+    return !isCancelled() && !hasFailed();
+}
+
+void VResourceIndex::addJob(Job::Type p_type, const QString &p_path)
+{
+    Job job;
+    job.m_type = p_type;
+    job.m_path = p_path;
+
+    QMutexLocker locker(&m_mutex);
+    // Directories go first to find more jobs.
+    if (p_type == Job::Directory) {
+        m_jobs.prepend(job);
+    } else {
+        m_jobs.append(job);
+    }
+
+    ++m_unfinishedJobs;
+    ++m_totalJobs;
+    m_jobCond.wakeOne();
+}
+
+bool VResourceIndex::takeJob(Job &p_job)
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        if (isCancelled() || m_unfinishedJobs == 0) {
+            return false;
+        }
+
+        if (!m_jobs.isEmpty()) {
+            p_job = m_jobs.takeFirst();
+            return true;
+        }
+
+        // Jobs being processed may add more.
+        m_jobCond.wait(&m_mutex);
+    }
+}
+
+void VResourceIndex::finishJob()
+{
+    QMutexLocker locker(&m_mutex);
+    --m_unfinishedJobs;
+    ++m_finishedJobs;
+    if (m_unfinishedJobs == 0) {
+        m_jobCond.wakeAll();
+    }
+}
+
+void VResourceIndex::processDirectory(const QString &p_path)
+{
+    QJsonObject configJson = VConfigManager::readDirectoryConfig(p_path);
+    if (configJson.isEmpty()) {
+        return;
+    }
+
+    QDir dir(p_path);
+
+    QJsonArray dirJson = configJson[DirConfig::c_subDirectories].toArray();
+    for (int i = 0; i < dirJson.size(); ++i) {
+        QString name = dirJson[i].toObject()[DirConfig::c_name].toString();
+        if (!name.isEmpty()) {
+            addJob(Job::Directory, dir.filePath(name));
+        }
+    }
+
+    QString attachmentFolderPath = dir.filePath(m_attachmentFolder);
+    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
+    for (int i = 0; i < fileJson.size(); ++i) {
+        QJsonObject item = fileJson[i].toObject();
+        QString name = item[DirConfig::c_name].toString();
+        if (name.isEmpty()) {
+            continue;
+        }
+
+        QString notePath = dir.filePath(name);
+        addJob(Job::Note, notePath);
+
+        // Attachments are referenced by the config.
+        QString folder = item[DirConfig::c_attachmentFolder].toString();
+        QJsonArray attaJson = item[DirConfig::c_attachments].toArray();
+        if (folder.isEmpty() || attaJson.isEmpty()) {
+            continue;
+        }
+
+        QDir attaDir(QDir(attachmentFolderPath).filePath(folder));
+        QStringList attachments;
+        for (int j = 0; j < attaJson.size(); ++j) {
+            QString attaName = attaJson[j].toObject()[DirConfig::c_name].toString();
+            if (!attaName.isEmpty()) {
+                attachments.append(attaDir.filePath(attaName));
+            }
+        }
+
+        addReferences(attachments, notePath);
+    }
+
+    // An absolute folder may be shared by other notebooks whose references
+    // are not indexed.
+    if (QDir::isRelativePath(m_imageFolder)) {
+        collectFiles(dir.filePath(m_imageFolder), VResourceFile::Image, false);
+    }
+
+    if (QDir::isRelativePath(m_attachmentFolder)) {
+        collectFiles(attachmentFolderPath, VResourceFile::Attachment, true);
+    }
+}
+
+void VResourceIndex::processNote(const QString &p_path)
+{
+    // A note not read would reference nothing and its images would be taken
+    // as unused, so stop the build.
+    QFile file(p_path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning() << "fail to read note" << p_path << file.errorString();
+        fail(tr("Fail to read note %1 (%2).").arg(p_path).arg(file.errorString()));
+        return;
+    }
+
+    QString content(file.readAll());
+    if (file.error() != QFileDevice::NoError) {
+        qWarning() << "fail to read note" << p_path << file.errorString();
+        fail(tr("Fail to read note %1 (%2).").arg(p_path).arg(file.errorString()));
+        return;
+    }
+
+    bool isMarkdown = VUtils::docTypeFromName(p_path) == DocType::Markdown;
+    QStringList images = VUtils::fetchLocalImagePathsFromText(content,
+                                                              VUtils::basePathFromPath(p_path),
+                                                              isMarkdown);
+    addReferences(images, p_path);
+}
+
+void VResourceIndex::fail(const QString &p_err)
+{
+    {
+        QMutexLocker locker(&m_resultMutex);
+        if (m_error.isEmpty()) {
+            m_error = p_err;
+        }
+    }
+
+    m_failed.store(1);
+    cancel();
+}
+
+void VResourceIndex::collectFiles(const QString &p_folderPath,
+                                  VResourceFile::Type p_type,
+                                  bool p_recursive)
+{
+    if (!QFileInfo(p_folderPath).isDir()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_resultMutex);
+        QString key = pathKey(p_folderPath);
+        if (m_collectedFolders.contains(key)) {
+            return;
+        }
+
+        m_collectedFolders.insert(key);
+    }
+
+    QVector<VResourceFile> files;
+    QDirIterator it(p_folderPath,
+                    QDir::Files | QDir::NoSymLinks,
+                    p_recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo fi = it.fileInfo();
+        files.append(VResourceFile(QDir::cleanPath(fi.absoluteFilePath()), fi.size(), p_type));
+    }
+
+    QMutexLocker locker(&m_resultMutex);
+    m_files += files;
+}
+
+void VResourceIndex::addReferences(const QStringList &p_paths, const QString &p_notePath)
+{
+    if (p_paths.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_resultMutex);
+    for (auto const & path : p_paths) {
+        m_references[pathKey(path)].append(p_notePath);
+    }
+}
+
+QString VResourceIndex::pathKey(const QString &p_path)
+{
+    QString key = QDir::cleanPath(p_path);
+#if defined(Q_OS_WIN)
+    key = key.toLower();
+#endif
+
+    return key;
+}
+
+QStringList VResourceIndex::getReferencingNotes(const QString &p_path) const
+{
+    QMutexLocker locker(&m_resultMutex);
+    return m_references.value(pathKey(p_path));
+}
+
+QVector<VResourceFile> VResourceIndex::getUnreferencedFiles() const
+{
+    QVector<VResourceFile> files;
+
+    QMutexLocker locker(&m_resultMutex);
+    for (auto const & file : m_files) {
+        if (!m_references.contains(pathKey(file.m_path))) {
+            files.append(file);
+        }
+    }
+
+    return files;
+}
@@ -0,0 +1,215 @@
+#ifndef VRESOURCEINDEX_H
+#define VRESOURCEINDEX_H
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+class QEventLoop;
+class VNotebook;
+class VResourceIndex;
+
+// Worker processing the jobs of the index until there is no more.
+class VResourceIndexWorker : public QThread
+{
+    Q_OBJECT
+public:
+    explicit VResourceIndexWorker(VResourceIndex *p_index, QObject *p_parent = nullptr);
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    VResourceIndex *m_index;
+};
+
+
+// An image or attachment file of a notebook.
+struct VResourceFile
+{
+    enum Type
+    {
+        Image = 0,
+        Attachment
+    };
+
+    VResourceFile()
+        : m_size(0), m_type(Type::Image)
+    {
+    }
+
+    VResourceFile(const QString &p_path, qint64 p_size, Type p_type)
+        : m_path(p_path), m_size(p_size), m_type(p_type)
+    {
+    }
+
+    QString m_path;
+
+    // Size in bytes.
+    qint64 m_size;
+
+    Type m_type;
+};
+
+
+// Index of the images and attachments of a notebook and the notes referencing
+// them. Images are referenced by the image links in the notes, which are read
+// and parsed by background threads in parallel. Attachments are referenced by
+// the configs of the notes.
+// Files in the image and attachment folders which are not referenced by any
+// note are garbage.
+class VResourceIndex : public QObject
+{
+    Q_OBJECT
+
+    friend class VResourceIndexWorker;
+
+public:
+    explicit VResourceIndex(QObject *p_parent = nullptr);
+
+    // Build the index of @p_notebook from the notes on disk.
+    // Returns after it is done. Non-user-input events are processed meanwhile
+    // so the progress could be shown. User input is processed only if
+    // setProcessUserInput() is enabled.
+    // Returns false if it is cancelled or fails.
+    bool build(const VNotebook *p_notebook);
+
+    // Whether to process user input events during the build.
+    // Should be enabled only once a modal dialog is shown, so the user could
+    // do nothing but cancel the build, while the caller still holds the
+    // notebook. Could be changed during the build.
+    void setProcessUserInput(bool p_enabled);
+
+    // Get the notes referencing image or attachment @p_path.
+    QStringList getReferencingNotes(const QString &p_path) const;
+
+    // Get the files in the image and attachment folders not referenced by
+    // any note.
+    QVector<VResourceFile> getUnreferencedFiles() const;
+
+    bool isCancelled() const;
+
+    // Whether the build fails since some note could not be read, in which
+    // case the references are incomplete.
+    bool hasFailed() const;
+
+    const QString &getError() const;
+
+public slots:
+    // Cancel current build.
+    void cancel();
+
+signals:
+    // Emitted periodically during the build.
+    void progressChanged(int p_done, int p_total);
+
+private:
+    struct Job
+    {
+        enum Type
+        {
+            Directory = 0,
+            Note
+        };
+
+        Type m_type;
+
+        QString m_path;
+    };
+
+    void addJob(Job::Type p_type, const QString &p_path);
+
+    // Take next job, waiting for the ones being processed to add more.
+    // Returns false if there is no more or it is cancelled.
+    bool takeJob(Job &p_job);
+
+    void finishJob();
+
+    // Read the config of a directory to queue its notes and sub-directories,
+    // and collect the files in its image and attachment folders.
+    void processDirectory(const QString &p_path);
+
+    // Read a note to collect the images it links.
+    void processNote(const QString &p_path);
+
+    // Record error @p_err and stop the build.
+    void fail(const QString &p_err);
+
+    // Collect files in @p_folderPath, recursively if @p_recursive is true.
+    void collectFiles(const QString &p_folderPath,
+                      VResourceFile::Type p_type,
+                      bool p_recursive);
+
+    void addReferences(const QStringList &p_paths, const QString &p_notePath);
+
+    // Key of @p_path in m_references.
+    static QString pathKey(const QString &p_path);
+
+    // Names of the image and attachment folders in each directory.
+    QString m_imageFolder;
+
+    QString m_attachmentFolder;
+
+    // Protect m_jobs and the counters.
+    QMutex m_mutex;
+
+    QWaitCondition m_jobCond;
+
+    QList<Job> m_jobs;
+
+    // Jobs queued or being processed.
+    int m_unfinishedJobs;
+
+    int m_finishedJobs;
+
+    int m_totalJobs;
+
+    // Protect the results below.
+    mutable QMutex m_resultMutex;
+
+    // Notes referencing each file.
+    QHash<QString, QStringList> m_references;
+
+    // Files in the image and attachment folders.
+    QVector<VResourceFile> m_files;
+
+    // Folders whose files have been collected.
+    QSet<QString> m_collectedFolders;
+
+    QAtomicInt m_cancelled;
+
+    QAtomicInt m_failed;
+
+    // Protected by m_resultMutex.
+    QString m_error;
+
+    bool m_processUserInput;
+
+    // The nested event loop of current build.
+    QEventLoop *m_loop;
+};
+
+inline bool VResourceIndex::isCancelled() const
+{
+    return m_cancelled.load() == 1;
+}
+
+inline bool VResourceIndex::hasFailed() const
+{
+    return m_failed.load() == 1;
+}
+
+inline const QString &VResourceIndex::getError() const
+{
+    return m_error;
+}
+
+#endif // VRESOURCEINDEX_H
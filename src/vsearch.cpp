@@ -1,5 +1,7 @@
 #include "vsearch.h"
 
+#include <QFileInfo>
+
 #include "utils/vutils.h"
 #include "vnotefile.h"
 #include "vdirectory.h"
@@ -8,15 +10,100 @@
 #include "vmainwindow.h"
 #include "vtableofcontent.h"
 #include "vsearchengine.h"
+#include "vnotebookmanifest.h"
+#include "vsearchtraverser.h"
+#include "vfilesaver.h"
+#include "vdirconfigwriter.h"
 
 extern VMainWindow *g_mainWin;
 
+// Max number of matches to keep for refining the following search.
+#define MAX_RECORDED_MATCHES 100000
+
+// Interval in seconds within which the last search could be refined.
+#define REFINE_INTERVAL 60
+
 VSearch::VSearch(QObject *p_parent)
     : QObject(p_parent),
       m_askedToStop(false),
-      m_engine(NULL)
+      m_engine(NULL),
+      m_numOfFedItems(0),
+      m_numOfRunningTraversers(0),
+      m_rankingLimit(0),
+      m_ranking(false)
 {
     m_slashReg = QRegExp("[\\/]");
+
+    connect(this, &VSearch::resultItemAdded,
+            this, &VSearch::recordItem);
+    connect(this, &VSearch::resultItemsAdded,
+            this, [this](const QList<QSharedPointer<VSearchResultItem> > &p_items) {
+                for (auto const & it : p_items) {
+                    recordItem(it);
+                }
+            });
+    connect(this, &VSearch::finished,
+            this, &VSearch::finishRecord);
+
+    // Notes saved or folders changed may not match the recorded results.
+    connect(VFileSaver::getInstance(), &VFileSaver::fileWritten,
+            this, &VSearch::invalidateRecord);
+    connect(VDirConfigWriter::getInstance(), &VDirConfigWriter::configWritten,
+            this, &VSearch::invalidateRecord);
+}
+
+VSearch::~VSearch()
+{
+    clearTraversers();
+}
+
+static bool isUnderRoots(const QString &p_path, const QStringList &p_roots)
+{
+    QStringList parts;
+    for (auto const & root : p_roots) {
+        if (VUtils::splitPathInBasePath(root, p_path, parts)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Whether any text matched by @p_new is also matched by @p_old.
+// Only AND-ed raw strings are supported.
+static bool isRefinedToken(const VSearchToken &p_old, const VSearchToken &p_new)
+{
+    if (p_old.m_type != VSearchToken::RawString
+        || p_new.m_type != VSearchToken::RawString
+        || p_old.m_caseSensitivity != p_new.m_caseSensitivity) {
+        return false;
+    }
+
+    if (p_old.tokenSize() == 0 || p_new.tokenSize() == 0) {
+        return false;
+    }
+
+    if ((p_old.tokenSize() > 1 && p_old.m_op != VSearchToken::And)
+        || (p_new.tokenSize() > 1 && p_new.m_op != VSearchToken::And)) {
+        return false;
+    }
+
+    // Each old keyword should be contained in one new keyword.
+    for (auto const & oldKey : p_old.m_keywords) {
+        bool found = false;
+        for (auto const & newKey : p_new.m_keywords) {
+            if (newKey.contains(oldKey, p_old.m_caseSensitivity)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 QSharedPointer<VSearchResult> VSearch::search(const QVector<VFile *> &p_files)
@@ -38,6 +125,21 @@ QSharedPointer<VSearchResult> VSearch::search(const QVector<VFile *> &p_files)
 
     result->m_state = VSearchState::Busy;
 
+    QStringList roots;
+    for (auto const & it : p_files) {
+        if (it) {
+            roots << it->fetchPath();
+        }
+    }
+
+    if (refineLastSearch(roots, false, result)) {
+        return result;
+    }
+
+    startRecord(roots, false);
+    startRanking();
+    resetSecondPhase();
+
     for (auto const & it : p_files) {
         if (!it) {
             continue;
@@ -52,10 +154,18 @@ QSharedPointer<VSearchResult> VSearch::search(const QVector<VFile *> &p_files)
         }
     }
 
-    if (result->m_state == VSearchState::Busy) {
+    finishRanking();
+
+    if (result->hasSecondPhaseItems()) {
+        searchSecondPhase(result);
+    } else if (result->m_state == VSearchState::Busy) {
         result->m_state = VSearchState::Success;
     }
 
+    if (result->m_state != VSearchState::Busy) {
+        finishRecord(result);
+    }
+
     return result;
 }
 
@@ -70,9 +180,8 @@ QSharedPointer<VSearchResult> VSearch::search(VDirectory *p_directory)
         return result;
     }
 
-    if ((!testTarget(VSearchConfig::Note)
-         && !testTarget(VSearchConfig::Folder))
-        || testObject(VSearchConfig::Outline)) {
+    if (!testTarget(VSearchConfig::Note)
+        && !testTarget(VSearchConfig::Folder)) {
         qDebug() << "search is not applicable for folder";
         result->m_state = VSearchState::Success;
         return result;
@@ -80,14 +189,27 @@ QSharedPointer<VSearchResult> VSearch::search(VDirectory *p_directory)
 
     result->m_state = VSearchState::Busy;
 
-    searchFirstPhase(p_directory, result);
+    QStringList roots(p_directory->fetchPath());
+    if (refineLastSearch(roots, true, result)) {
+        return result;
+    }
 
-    if (result->hasSecondPhaseItems()) {
-        searchSecondPhase(result);
-    } else if (result->m_state == VSearchState::Busy) {
-        result->m_state = VSearchState::Success;
+    startRecord(roots, true);
+    startRanking();
+    resetSecondPhase();
+
+    VNotebook *notebook = p_directory->getNotebook();
+    VNotebookManifest *manifest = notebook->getManifest();
+    QString relativePath = p_directory->fetchRelativePath();
+    VSearchTraverser *th = new VSearchTraverser(0, *m_config, m_ranking, m_rankingLimit, this);
+    if (manifest && manifest->findFolder(relativePath)) {
+        th->setManifest(manifest->snapshot(), relativePath, true);
+    } else {
+        manifest = NULL;
+        th->setNotebook(notebook->getPath(), relativePath, true);
     }
 
+    startTraverser(th, manifest, result);
     return result;
 }
 
@@ -102,32 +224,66 @@ QSharedPointer<VSearchResult> VSearch::search(const QVector<VNotebook *> &p_note
         return result;
     }
 
-    if (testObject(VSearchConfig::Outline)) {
-        qDebug() << "search is not applicable for notebook";
-        result->m_state = VSearchState::Success;
+    result->m_state = VSearchState::Busy;
+
+    QStringList roots;
+    for (auto const & nb : p_notebooks) {
+        if (nb) {
+            roots << nb->getPath();
+        }
+    }
+
+    if (refineLastSearch(roots, true, result)) {
         return result;
     }
 
-    result->m_state = VSearchState::Busy;
+    startRecord(roots, true);
+    startRanking();
+    resetSecondPhase();
 
+    // Each notebook is walked through by its own traverser concurrently, and
+    // its notes are searched as a separate stream of the engine.
+    QVector<VNotebook *> notebooks;
     for (auto const & nb : p_notebooks) {
-        if (!nb) {
-            continue;
+        if (nb) {
+            notebooks.append(nb);
+            NotebookProgress pro;
+            pro.m_name = nb->getName();
+            m_notebookProgress.append(pro);
         }
+    }
 
-        searchFirstPhase(nb, result);
+    bool traverse = testTarget(VSearchConfig::Note) || testTarget(VSearchConfig::Folder);
+    for (int i = 0; i < notebooks.size(); ++i) {
+        VNotebook *nb = notebooks[i];
+        if (testTarget(VSearchConfig::Notebook)
+            && testObject(VSearchConfig::Name)) {
+            searchForName(VSearchResultItem::Notebook, nb->getName(), nb->getPath());
+        }
 
-        if (askedToStop()) {
-            qDebug() << "asked to cancel the search";
-            result->m_state = VSearchState::Cancelled;
-            break;
+        if (!traverse) {
+            m_notebookProgress[i].m_traversed = true;
+            continue;
+        }
+
+        // No need to read the folder configs if the manifest is available.
+        VNotebookManifest *manifest = nb->getManifest();
+        VSearchTraverser *th = new VSearchTraverser(i, *m_config, m_ranking, m_rankingLimit, this);
+        if (manifest) {
+            th->setManifest(manifest->snapshot(), QString(), false);
+        } else {
+            th->setNotebook(nb->getPath(), QString(), false);
         }
+
+        startTraverser(th, manifest, result);
     }
 
-    if (result->hasSecondPhaseItems()) {
-        searchSecondPhase(result);
-    } else if (result->m_state == VSearchState::Busy) {
+    emit notebookProgressChanged();
+
+    if (m_traversers.isEmpty()) {
+        finishRanking();
         result->m_state = VSearchState::Success;
+        finishRecord(result);
     }
 
     return result;
@@ -155,14 +311,18 @@ QSharedPointer<VSearchResult> VSearch::search(const QString &p_directoryPath)
 
     result->m_state = VSearchState::Busy;
 
-    searchFirstPhase(p_directoryPath, p_directoryPath, result);
-
-    if (result->hasSecondPhaseItems()) {
-        searchSecondPhase(result);
-    } else if (result->m_state == VSearchState::Busy) {
-        result->m_state = VSearchState::Success;
+    QStringList roots(p_directoryPath);
+    if (refineLastSearch(roots, true, result)) {
+        return result;
     }
 
+    startRecord(roots, true);
+    startRanking();
+    resetSecondPhase();
+
+    VSearchTraverser *th = new VSearchTraverser(0, *m_config, m_ranking, m_rankingLimit, this);
+    th->setDirectory(p_directoryPath);
+    startTraverser(th, NULL, result);
     return result;
 }
 
@@ -179,14 +339,7 @@ void VSearch::searchFirstPhase(VFile *p_file,
 
     QString filePath = p_file->fetchPath();
     if (testObject(VSearchConfig::Name)) {
-        if (matchNonContent(name)) {
-            VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Note,
-                                                            VSearchResultItem::LineNumber,
-                                                            name,
-                                                            filePath);
-            QSharedPointer<VSearchResultItem> pitem(item);
-            emit resultItemAdded(pitem);
-        }
+        searchForName(VSearchResultItem::Note, name, filePath);
     }
 
     if (testObject(VSearchConfig::Path)) {
@@ -225,247 +378,175 @@ void VSearch::searchFirstPhase(VFile *p_file,
     }
 
     if (testObject(VSearchConfig::Content)) {
-        // Search content in first phase.
-        if (p_searchContent) {
-            VSearchResultItem *item = searchForContent(p_file);
-            if (item) {
-                QSharedPointer<VSearchResultItem> pitem(item);
-                emit resultItemAdded(pitem);
-            }
+        // Add an item for second phase process.
+        if (p_searchContent && p_file->isOpened()) {
+            // Search the content in memory which may not be saved yet.
+            p_result->addSecondPhaseItem(filePath, p_file->getContent());
         } else {
-            // Add an item for second phase process.
             p_result->addSecondPhaseItem(filePath);
         }
     }
 }
 
-void VSearch::searchFirstPhase(VDirectory *p_directory,
-                               const QSharedPointer<VSearchResult> &p_result)
+void VSearch::startTraverser(VSearchTraverser *p_traverser,
+                             VNotebookManifest *p_manifest,
+                             const QSharedPointer<VSearchResult> &p_result)
 {
-    Q_ASSERT(testTarget(VSearchConfig::Note) || testTarget(VSearchConfig::Folder));
-
-    bool opened = p_directory->isOpened();
-    if (!opened && !p_directory->open()) {
-        p_result->logError(QString("Fail to open folder %1.").arg(p_directory->fetchRelativePath()));
-        p_result->m_state = VSearchState::Fail;
-        return;
-    }
-
-    if (testTarget(VSearchConfig::Folder)) {
-        QString name = p_directory->getName();
-        QString dirPath = p_directory->fetchPath();
-        if (testObject(VSearchConfig::Name)) {
-            if (matchNonContent(name)) {
-                VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Folder,
-                                                                VSearchResultItem::LineNumber,
-                                                                name,
-                                                                dirPath);
-                QSharedPointer<VSearchResultItem> pitem(item);
-                emit resultItemAdded(pitem);
-            }
-        }
+    QPointer<VNotebookManifest> manifest(p_manifest);
+
+    // Signals are queued to this thread. Pending ones are dropped along with
+    // the traverser.
+    connect(p_traverser, &VSearchTraverser::resultsReady,
+            p_traverser, [this, p_traverser, manifest, p_result]() {
+                takeTraverserResults(p_traverser, manifest, p_result);
+            });
+    connect(p_traverser, &VSearchTraverser::finished,
+            p_traverser, [this, p_traverser, manifest, p_result]() {
+                finishTraverser(p_traverser, manifest, p_result);
+            });
+
+    m_traversers.append(p_traverser);
+    ++m_numOfRunningTraversers;
+    p_traverser->start();
+}
 
-        if (testObject(VSearchConfig::Path)) {
-            QString normPath(p_directory->fetchRelativePath());
-            removeSlashFromPath(normPath);
-            if (matchNonContent(normPath)) {
-                VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Folder,
-                                                                VSearchResultItem::LineNumber,
-                                                                name,
-                                                                dirPath);
-                QSharedPointer<VSearchResultItem> pitem(item);
-                emit resultItemAdded(pitem);
-            }
+void VSearch::takeTraverserResults(VSearchTraverser *p_traverser,
+                                   const QPointer<VNotebookManifest> &p_manifest,
+                                   const QSharedPointer<VSearchResult> &p_result)
+{
+    QList<QSharedPointer<VSearchResultItem> > items;
+    QStringList secondPhaseItems;
+    QHash<QString, VManifestOutline> outlines;
+    p_traverser->takeResults(items, secondPhaseItems, outlines);
+
+    // Index the outlines built during traversal for following searches.
+    if (p_manifest) {
+        for (auto it = outlines.constBegin(); it != outlines.constEnd(); ++it) {
+            p_manifest->addOutline(it.key(), it.value());
         }
     }
 
-    // Search files.
-    if (testTarget(VSearchConfig::Note)) {
-        for (auto const & file : p_directory->getFiles()) {
-            if (askedToStop()) {
-                qDebug() << "asked to cancel the search";
-                p_result->m_state = VSearchState::Cancelled;
-                goto exit;
-            }
-
-            searchFirstPhase(file, p_result);
-        }
+    int stream = p_traverser->getStream();
+    if (m_askedToStop
+        || (stream < m_notebookProgress.size() && m_notebookProgress[stream].m_cancelled)) {
+        // Drop the items of a skipped notebook.
+        return;
     }
 
-    // Search subfolders.
-    for (auto const & dir : p_directory->getSubDirs()) {
-        if (askedToStop()) {
-            qDebug() << "asked to cancel the search";
-            p_result->m_state = VSearchState::Cancelled;
-            goto exit;
-        }
-
-        searchFirstPhase(dir, p_result);
+    if (!items.isEmpty()) {
+        emit resultItemsAdded(items);
     }
 
-exit:
-    if (!opened) {
-        p_directory->close();
+    if (!secondPhaseItems.isEmpty()) {
+        p_result->m_secondPhaseItems.append(secondPhaseItems);
+        feedSecondPhase(p_result, stream);
     }
 }
 
-void VSearch::searchFirstPhase(VNotebook *p_notebook,
-                               const QSharedPointer<VSearchResult> &p_result)
+void VSearch::finishTraverser(VSearchTraverser *p_traverser,
+                              const QPointer<VNotebookManifest> &p_manifest,
+                              const QSharedPointer<VSearchResult> &p_result)
 {
-    bool opened = p_notebook->isOpened();
-    if (!opened && !p_notebook->open()) {
-        p_result->logError(QString("Fail to open notebook %1.").arg(p_notebook->getName()));
-        p_result->m_state = VSearchState::Fail;
-        return;
-    }
+    takeTraverserResults(p_traverser, p_manifest, p_result);
 
-    if (testTarget(VSearchConfig::Notebook)
-        && testObject(VSearchConfig::Name)) {
-        QString text = p_notebook->getName();
-        if (matchNonContent(text)) {
-            VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Notebook,
-                                                            VSearchResultItem::LineNumber,
-                                                            text,
-                                                            p_notebook->getPath());
-            QSharedPointer<VSearchResultItem> pitem(item);
-            emit resultItemAdded(pitem);
-        }
+    // Folders changed outside are read by the traverser, but the manifest
+    // should catch up for following searches.
+    if (p_manifest && p_traverser->isManifestStale()) {
+        p_manifest->revalidate();
     }
 
-    if (!testTarget(VSearchConfig::Note)
-        && !testTarget(VSearchConfig::Folder)) {
-        goto exit;
+    int stream = p_traverser->getStream();
+    bool skipped = stream < m_notebookProgress.size() && m_notebookProgress[stream].m_cancelled;
+    if (skipped) {
+        qDebug() << "skip notebook" << m_notebookProgress[stream].m_name;
+    } else if (p_traverser->getState() == VSearchState::Fail) {
+        p_result->logError(p_traverser->getError());
+        p_result->m_state = VSearchState::Fail;
     }
 
-    // Search for subfolders.
-    for (auto const & dir : p_notebook->getRootDir()->getSubDirs()) {
-        if (askedToStop()) {
-            qDebug() << "asked to cancel the search";
-            p_result->m_state = VSearchState::Cancelled;
-            goto exit;
-        }
-
-        searchFirstPhase(dir, p_result);
+    if (stream < m_notebookProgress.size()) {
+        m_notebookProgress[stream].m_traversed = true;
+        emit notebookProgressChanged();
     }
 
-exit:
-    if (!opened) {
-        p_notebook->close();
+    Q_ASSERT(m_numOfRunningTraversers > 0);
+    if (--m_numOfRunningTraversers == 0) {
+        finishFirstPhase(p_result);
     }
 }
 
-void VSearch::searchFirstPhase(const QString &p_basePath,
-                               const QString &p_directoryPath,
-                               const QSharedPointer<VSearchResult> &p_result)
+void VSearch::finishFirstPhase(const QSharedPointer<VSearchResult> &p_result)
 {
-    Q_ASSERT(testTarget(VSearchConfig::Note) || testTarget(VSearchConfig::Folder));
-    Q_ASSERT(!p_directoryPath.isEmpty());
-
-    QDir dir(p_directoryPath);
-    if (!dir.exists()) {
-        p_result->logError(QString("Directory %1 does not exist.").arg(p_directoryPath));
-        p_result->m_state = VSearchState::Fail;
-        return;
-    }
-
-    Q_ASSERT(dir.isAbsolute());
-
-    if (testTarget(VSearchConfig::Folder)) {
-        QString name = dir.dirName();
-        if (testObject(VSearchConfig::Name)) {
-            if (matchNonContent(name)) {
-                VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Folder,
-                                                                VSearchResultItem::LineNumber,
-                                                                name,
-                                                                p_directoryPath);
-                QSharedPointer<VSearchResultItem> pitem(item);
-                emit resultItemAdded(pitem);
+    // Merge the results of name search in the order of streams.
+    if (m_ranking) {
+        for (auto th : m_traversers) {
+            int stream = th->getStream();
+            if (stream < m_notebookProgress.size() && m_notebookProgress[stream].m_cancelled) {
+                continue;
             }
-        }
 
-        if (testObject(VSearchConfig::Path)) {
-            QString normPath(QDir(p_basePath).relativeFilePath(p_directoryPath));
-            removeSlashFromPath(normPath);
-            if (matchNonContent(normPath)) {
-                VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Folder,
-                                                                VSearchResultItem::LineNumber,
-                                                                name,
-                                                                p_directoryPath);
-                QSharedPointer<VSearchResultItem> pitem(item);
-                emit resultItemAdded(pitem);
+            auto ranked = th->takeRankedItems();
+            for (auto const & it : ranked) {
+                m_ranker.add(it.first, it.second);
             }
         }
     }
 
-    if (testTarget(VSearchConfig::Note)) {
-        QStringList files = dir.entryList(QDir::Files);
-        for (auto const & file : files) {
-            if (askedToStop()) {
-                qDebug() << "asked to cancel the search";
-                p_result->m_state = VSearchState::Cancelled;
-                return;
-            }
+    finishRanking();
 
-            searchFirstPhaseFile(p_basePath, dir.absoluteFilePath(file), p_result);
-        }
+    if (m_askedToStop) {
+        qDebug() << "asked to cancel the search";
+        p_result->m_state = VSearchState::Cancelled;
     }
 
-    // Search subfolders.
-    QStringList subdirs = dir.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
-    for (auto const & sub : subdirs) {
-        if (askedToStop()) {
-            qDebug() << "asked to cancel the search";
-            p_result->m_state = VSearchState::Cancelled;
-            return;
-        }
+    if (p_result->m_state == VSearchState::Busy && m_engine) {
+        // The engine emits finished() once all the notes are searched.
+        m_engine->finishItems();
+        return;
+    }
 
-        searchFirstPhase(p_basePath, dir.absoluteFilePath(sub), p_result);
+    if (m_engine) {
+        // The search failed or is cancelled, so the results of the engine
+        // are of no use.
+        disconnect(m_engine, &ISearchEngine::finished,
+                   this, &VSearch::finished);
+        m_engine->stop();
+    }
+
+    if (p_result->m_state == VSearchState::Busy) {
+        p_result->m_state = VSearchState::Success;
     }
+
+    emit finished(p_result);
 }
 
-void VSearch::searchFirstPhaseFile(const QString &p_basePath,
-                                   const QString &p_filePath,
-                                   const QSharedPointer<VSearchResult> &p_result)
+void VSearch::clearTraversers()
 {
-    Q_ASSERT(testTarget(VSearchConfig::Note));
-
-    QString name = VUtils::fileNameFromPath(p_filePath);
-    if (!matchPattern(name)) {
-        return;
+    for (auto th : m_traversers) {
+        th->stop();
     }
 
-    if (testObject(VSearchConfig::Name)) {
-        if (matchNonContent(name)) {
-            VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Note,
-                                                            VSearchResultItem::LineNumber,
-                                                            name,
-                                                            p_filePath);
-            QSharedPointer<VSearchResultItem> pitem(item);
-            emit resultItemAdded(pitem);
-        }
-    }
+    for (auto th : m_traversers) {
+        th->wait();
 
-    if (testObject(VSearchConfig::Path)) {
-        QString normFilePath(QDir(p_basePath).relativeFilePath(p_filePath));
-        removeSlashFromPath(normFilePath);
-        if (matchNonContent(normFilePath)) {
-            VSearchResultItem *item = new VSearchResultItem(VSearchResultItem::Note,
-                                                            VSearchResultItem::LineNumber,
-                                                            name,
-                                                            p_filePath);
-            QSharedPointer<VSearchResultItem> pitem(item);
-            emit resultItemAdded(pitem);
-        }
+        // Drop its pending signals which belong to the previous search. It may
+        // be in the middle of delivering one, so delete it later.
+        th->disconnect();
+        QCoreApplication::removePostedEvents(th, QEvent::MetaCall);
+        th->deleteLater();
     }
 
-    if (testObject(VSearchConfig::Content)) {
-        // Add an item for second phase process.
-        p_result->addSecondPhaseItem(p_filePath);
-    }
+    m_traversers.clear();
+    m_numOfRunningTraversers = 0;
 }
 
 VSearchResultItem *VSearch::searchForOutline(const VFile *p_file) const
 {
+    // There is no main window in the search benchmark.
+    if (!g_mainWin) {
+        return NULL;
+    }
+
     VEditTab *tab = g_mainWin->getEditArea()->getTab(p_file);
     if (!tab) {
         return NULL;
@@ -504,127 +585,113 @@ VSearchResultItem *VSearch::searchForTag(const VFile *p_file) const
     }
 
     const VNoteFile *file = static_cast<const VNoteFile *>(p_file);
-    const QStringList &tags = file->getTags();
-    for (auto const & tag: tags) {
+    if (matchTags(file->getTags())) {
+        return new VSearchResultItem(VSearchResultItem::Note,
+                                     VSearchResultItem::LineNumber,
+                                     file->getName(),
+                                     file->fetchPath());
+    }
+
+    return NULL;
+}
+
+bool VSearch::matchTags(const QStringList &p_tags) const
+{
+    for (auto const & tag: p_tags) {
         if (tag.isEmpty()) {
             continue;
         }
 
         if (matchNonContent(tag)) {
-            return new VSearchResultItem(VSearchResultItem::Note,
-                                         VSearchResultItem::LineNumber,
-                                         file->getName(),
-                                         file->fetchPath());
+            return true;
         }
     }
 
-    return NULL;
+    return false;
 }
 
-VSearchResultItem *VSearch::searchForContent(const VFile *p_file) const
+void VSearch::resetSecondPhase()
 {
-    Q_ASSERT(p_file->isOpened());
-    const QString &content = p_file->getContent();
-    if (content.isEmpty()) {
-        return NULL;
-    }
-
-    VSearchResultItem *item = NULL;
-    int lineNum = 1;
-    int pos = 0;
-    int size = content.size();
-    QRegExp newLineReg = QRegExp("\\n|\\r\\n|\\r");
-    VSearchToken &contentToken = m_config->m_contentToken;
-    bool singleToken = contentToken.tokenSize() == 1;
-    if (!singleToken) {
-        contentToken.startBatchMode();
-    }
-
-    bool allMatched = false;
-
-    while (pos < size) {
-        int idx = content.indexOf(newLineReg, pos);
-        if (idx == -1) {
-            idx = size;
-        }
-
-        if (idx > pos) {
-            QString lineText = content.mid(pos, idx - pos);
-            bool matched = false;
-            if (singleToken) {
-                matched = contentToken.matched(lineText);
-            } else {
-                matched = contentToken.matchBatchMode(lineText);
-            }
+    clearTraversers();
 
-            if (matched) {
-                if (!item) {
-                    item = new VSearchResultItem(VSearchResultItem::Note,
-                                                 VSearchResultItem::LineNumber,
-                                                 p_file->getName(),
-                                                 p_file->fetchPath());
-                }
+    delete m_engine;
+    m_engine = NULL;
 
-                VSearchResultSubItem sitem(lineNum, lineText);
-                item->m_matches.append(sitem);
-            }
-        }
+    m_numOfFedItems = 0;
+    m_notebookProgress.clear();
+}
 
-        if (idx == size) {
-            break;
-        }
+bool VSearch::startSecondPhase(const QSharedPointer<VSearchResult> &p_result)
+{
+    if (m_engine) {
+        return true;
+    }
 
-        if (!singleToken && contentToken.readyToEndBatchMode(allMatched)) {
-            break;
-        }
+    switch (m_config->m_engine) {
+    case VSearchConfig::Internal:
+        m_engine = new VSearchEngine(this);
+        break;
 
-        pos = idx + newLineReg.matchedLength();
-        ++lineNum;
+    default:
+        return false;
     }
 
-    if (!singleToken) {
-        contentToken.readyToEndBatchMode(allMatched);
-        contentToken.endBatchMode();
+    connect(m_engine, &ISearchEngine::finished,
+            this, &VSearch::finished);
+    connect(m_engine, &ISearchEngine::resultItemsAdded,
+            this, &VSearch::resultItemsAdded);
+    connect(m_engine, &ISearchEngine::itemsSearched,
+            this, &VSearch::handleItemsSearched);
+
+    m_engine->start(m_config, p_result);
 
-        if (!allMatched && item) {
-            // This file does not meet all the tokens.
-            delete item;
-            item = NULL;
+    // Notebooks skipped before the engine is started.
+    for (int i = 0; i < m_notebookProgress.size(); ++i) {
+        if (m_notebookProgress[i].m_cancelled) {
+            m_engine->stopStream(i);
         }
     }
-
-    return item;
+    return true;
 }
 
-void VSearch::searchSecondPhase(const QSharedPointer<VSearchResult> &p_result)
+void VSearch::feedSecondPhase(const QSharedPointer<VSearchResult> &p_result, int p_stream)
 {
-    delete m_engine;
-    m_engine = NULL;
+    int total = p_result->m_secondPhaseItems.size();
+    int cnt = total - m_numOfFedItems;
+    if (cnt <= 0) {
+        return;
+    }
 
-    switch (m_config->m_engine) {
-    case VSearchConfig::Internal:
-    {
-        m_engine = new VSearchEngine(this);
-        m_engine->search(m_config, p_result);
-        break;
+    if (!startSecondPhase(p_result)) {
+        return;
     }
 
-    default:
-        p_result->m_state = VSearchState::Success;
-        break;
+    m_engine->addItems(p_result->m_secondPhaseItems.mid(m_numOfFedItems, cnt), p_stream);
+    m_numOfFedItems = total;
+
+    if (p_stream < m_notebookProgress.size()) {
+        m_notebookProgress[p_stream].m_numOfItems += cnt;
+        emit notebookProgressChanged();
     }
+}
+
+void VSearch::searchSecondPhase(const QSharedPointer<VSearchResult> &p_result)
+{
+    feedSecondPhase(p_result);
 
     if (m_engine) {
-        connect(m_engine, &ISearchEngine::finished,
-                this, &VSearch::finished);
-        connect(m_engine, &ISearchEngine::resultItemsAdded,
-                this, &VSearch::resultItemsAdded);
+        m_engine->finishItems();
+    } else {
+        p_result->m_state = VSearchState::Success;
     }
 }
 
 void VSearch::clear()
 {
+    clearTraversers();
+
     m_config.clear();
+    m_notebookProgress.clear();
 
     if (m_engine) {
         m_engine->clear();
@@ -641,7 +708,336 @@ void VSearch::stop()
     qDebug() << "VSearch asked to stop";
     m_askedToStop = true;
 
+    for (auto th : m_traversers) {
+        th->stop();
+    }
+
     if (m_engine) {
         m_engine->stop();
     }
 }
+
+void VSearch::stopNotebook(int p_idx)
+{
+    if (p_idx < 0 || p_idx >= m_notebookProgress.size()) {
+        return;
+    }
+
+    NotebookProgress &pro = m_notebookProgress[p_idx];
+    if (pro.isFinished()) {
+        return;
+    }
+
+    qDebug() << "VSearch asked to stop notebook" << pro.m_name;
+    pro.m_cancelled = true;
+
+    for (auto th : m_traversers) {
+        if (th->getStream() == p_idx) {
+            th->stop();
+        }
+    }
+
+    if (m_engine) {
+        m_engine->stopStream(p_idx);
+    }
+
+    emit notebookProgressChanged();
+}
+
+void VSearch::handleItemsSearched(int p_stream, int p_numOfItems)
+{
+    if (p_stream >= m_notebookProgress.size()) {
+        return;
+    }
+
+    m_notebookProgress[p_stream].m_numOfSearchedItems += p_numOfItems;
+    emit notebookProgressChanged();
+}
+
+void VSearch::setRankingLimit(int p_limit)
+{
+    m_rankingLimit = p_limit;
+}
+
+void VSearch::startRanking()
+{
+    m_ranking = testObject(VSearchConfig::Name)
+                && m_config->m_token.m_type == VSearchToken::Fuzzy;
+    m_ranker = VTopK<QSharedPointer<VSearchResultItem> >(m_rankingLimit);
+}
+
+void VSearch::finishRanking()
+{
+    if (!m_ranking) {
+        return;
+    }
+
+    m_ranking = false;
+
+    QVector<QSharedPointer<VSearchResultItem> > items = m_ranker.takeSorted();
+    if (!items.isEmpty()) {
+        emit resultItemsAdded(items.toList());
+    }
+}
+
+void VSearch::searchForName(VSearchResultItem::ItemType p_type,
+                            const QString &p_name,
+                            const QString &p_path)
+{
+    if (!m_ranking) {
+        if (matchNonContent(p_name)) {
+            QSharedPointer<VSearchResultItem> pitem(new VSearchResultItem(p_type,
+                                                                          VSearchResultItem::LineNumber,
+                                                                          p_name,
+                                                                          p_path));
+            emit resultItemAdded(pitem);
+        }
+
+        return;
+    }
+
+    int score = m_config->m_token.score(p_name);
+    if (score < 0 || !m_ranker.accept(score)) {
+        return;
+    }
+
+    QSharedPointer<VSearchResultItem> pitem(new VSearchResultItem(p_type,
+                                                                  VSearchResultItem::LineNumber,
+                                                                  p_name,
+                                                                  p_path));
+    m_ranker.add(score, pitem);
+}
+
+void VSearch::startRecord(const QStringList &p_roots, bool p_canRescan)
+{
+    m_lastSearch = SearchRecord();
+    m_lastSearch.m_config = m_config;
+    m_lastSearch.m_roots = p_roots;
+    m_lastSearch.m_canRescan = p_canRescan;
+    m_lastSearch.m_startedTime = QDateTime::currentDateTime();
+}
+
+void VSearch::invalidateRecord()
+{
+    m_lastSearch.m_invalidated = true;
+}
+
+void VSearch::recordItem(const QSharedPointer<VSearchResultItem> &p_item)
+{
+    if (m_lastSearch.m_config.isNull() || m_lastSearch.m_overflow) {
+        return;
+    }
+
+    m_lastSearch.m_numOfMatches += qMax(1, p_item->m_matches.size());
+    if (m_lastSearch.m_numOfMatches > MAX_RECORDED_MATCHES) {
+        m_lastSearch.m_overflow = true;
+        m_lastSearch.m_items.clear();
+        return;
+    }
+
+    m_lastSearch.m_items.append(p_item);
+    if (p_item->m_truncated) {
+        m_lastSearch.m_truncated = true;
+    }
+}
+
+void VSearch::finishRecord(const QSharedPointer<VSearchResult> &p_result)
+{
+    // Results are incomplete if any notebook is skipped.
+    bool skipped = false;
+    for (auto const & pro : m_notebookProgress) {
+        if (pro.m_cancelled) {
+            skipped = true;
+            break;
+        }
+    }
+
+    if (p_result->m_state == VSearchState::Success
+        && !m_lastSearch.m_overflow
+        && !m_lastSearch.m_invalidated
+        && !skipped) {
+        m_lastSearch.m_finishedTime = QDateTime::currentDateTime();
+    } else {
+        m_lastSearch = SearchRecord();
+    }
+}
+
+VSearch::Refinement VSearch::checkRefinement(const QStringList &p_roots, bool p_canRescan) const
+{
+    const SearchRecord &last = m_lastSearch;
+    if (last.m_config.isNull()
+        || !last.m_finishedTime.isValid()
+        || last.m_invalidated
+        || last.m_finishedTime.secsTo(QDateTime::currentDateTime()) > REFINE_INTERVAL) {
+        return Refinement::None;
+    }
+
+    const VSearchConfig &oldConfig = *last.m_config;
+    const VSearchConfig &newConfig = *m_config;
+    if (oldConfig.m_object != newConfig.m_object
+        || oldConfig.m_target != newConfig.m_target
+        || oldConfig.m_engine != newConfig.m_engine
+        || oldConfig.m_pattern != newConfig.m_pattern) {
+        return Refinement::None;
+    }
+
+    // The scope should be the same or narrower.
+    if (p_roots.isEmpty()) {
+        return Refinement::None;
+    }
+
+    for (auto const & root : p_roots) {
+        if (!isUnderRoots(root, last.m_roots)) {
+            return Refinement::None;
+        }
+    }
+
+    switch (newConfig.m_object) {
+    case VSearchConfig::Name:
+    case VSearchConfig::Outline:
+        // Each name or heading is matched as a whole.
+        if (isRefinedToken(oldConfig.m_token, newConfig.m_token)) {
+            return Refinement::FilterItems;
+        }
+
+        break;
+
+    case VSearchConfig::Content:
+        if (!isRefinedToken(oldConfig.m_contentToken, newConfig.m_contentToken)) {
+            break;
+        }
+
+        // With multiple tokens, a note stops being scanned once all the tokens
+        // are matched, so the recorded matches may be incomplete.
+        // Items truncated at the max matches per file are rescanned from disk.
+        if (oldConfig.m_contentToken.tokenSize() == 1
+            && newConfig.m_contentToken.tokenSize() == 1
+            && (!last.m_truncated || (p_canRescan && last.m_canRescan))) {
+            return Refinement::FilterItems;
+        }
+
+        if (p_canRescan && last.m_canRescan) {
+            return Refinement::RescanNotes;
+        }
+
+        break;
+
+    default:
+        break;
+    }
+
+    return Refinement::None;
+}
+
+bool VSearch::isRecordChanged(const QStringList &p_roots) const
+{
+    // Unsaved edits are not seen by the search of notebooks.
+    if (g_mainWin) {
+        const QVector<VEditTabInfo> tabs = g_mainWin->getEditArea()->getAllTabsInfo();
+        for (auto const & info : tabs) {
+            if (info.m_editTab
+                && info.m_editTab->isModified()
+                && isUnderRoots(info.m_editTab->getFile()->fetchPath(), p_roots)) {
+                return true;
+            }
+        }
+    }
+
+    // Changed outside. Saves within VNote invalidate the record already.
+    // The modified time may be truncated to seconds by the file system.
+    QDateTime startedTime = m_lastSearch.m_startedTime.addSecs(-1);
+    for (auto const & it : m_lastSearch.m_items) {
+        if (!isUnderRoots(it->m_path, p_roots)) {
+            continue;
+        }
+
+        QFileInfo fi(it->m_path);
+        if (!fi.exists() || fi.lastModified() >= startedTime) {
+            qDebug() << "search result changed since last search" << it->m_path;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VSearch::refineLastSearch(const QStringList &p_roots,
+                               bool p_canRescan,
+                               const QSharedPointer<VSearchResult> &p_result)
+{
+    Refinement refinement = checkRefinement(p_roots, p_canRescan);
+    if (refinement == Refinement::None || isRecordChanged(p_roots)) {
+        return false;
+    }
+
+    qDebug() << "refine last search with" << m_lastSearch.m_items.size() << "items"
+             << (int)refinement;
+
+    QList<QSharedPointer<VSearchResultItem> > lastItems = m_lastSearch.m_items;
+    startRecord(p_roots, p_canRescan);
+    resetSecondPhase();
+
+    QList<QSharedPointer<VSearchResultItem> > items;
+    for (auto const & it : lastItems) {
+        if (!isUnderRoots(it->m_path, p_roots)) {
+            continue;
+        }
+
+        if (refinement == Refinement::FilterItems && !it->m_truncated) {
+            QSharedPointer<VSearchResultItem> item = filterItem(it);
+            if (!item.isNull()) {
+                items.append(item);
+            }
+        } else if (it->m_type == VSearchResultItem::Note) {
+            p_result->addSecondPhaseItem(it->m_path);
+        }
+    }
+
+    if (!items.isEmpty()) {
+        emit resultItemsAdded(items);
+    }
+
+    if (p_result->hasSecondPhaseItems()) {
+        searchSecondPhase(p_result);
+    } else {
+        p_result->m_state = VSearchState::Success;
+    }
+
+    if (p_result->m_state != VSearchState::Busy) {
+        finishRecord(p_result);
+    }
+
+    return true;
+}
+
+QSharedPointer<VSearchResultItem> VSearch::filterItem(const QSharedPointer<VSearchResultItem> &p_item) const
+{
+    QSharedPointer<VSearchResultItem> item;
+    if (m_config->m_object == VSearchConfig::Name) {
+        // Items are never modified once emitted, so just share it.
+        if (matchNonContent(p_item->m_text)) {
+            item = p_item;
+        }
+
+        return item;
+    }
+
+    const VSearchToken &token = m_config->m_object == VSearchConfig::Content
+                                ? m_config->m_contentToken : m_config->m_token;
+    for (auto const & it : p_item->m_matches) {
+        if (!token.matched(it.m_text)) {
+            continue;
+        }
+
+        if (item.isNull()) {
+            item.reset(new VSearchResultItem(p_item->m_type,
+                                             p_item->m_matchType,
+                                             p_item->m_text,
+                                             p_item->m_path));
+        }
+
+        item->m_matches.append(it);
+    }
+
+    return item;
+}
@@ -4,8 +4,10 @@
 #include <QObject>
 #include <QString>
 #include <QSharedPointer>
+#include <QPointer>
 #include <QRegExp>
 #include <QCoreApplication>
+#include <QDateTime>
 
 #include "vsearchconfig.h"
 
@@ -13,23 +15,64 @@ class VFile;
 class VDirectory;
 class VNotebook;
 class ISearchEngine;
+class VNotebookManifest;
+class VSearchTraverser;
 
 
 class VSearch : public QObject
 {
     Q_OBJECT
 public:
+    // Progress of one notebook, whose notes are searched as a separate stream
+    // by the engine.
+    struct NotebookProgress
+    {
+        NotebookProgress()
+            : m_traversed(false),
+              m_cancelled(false),
+              m_numOfItems(0),
+              m_numOfSearchedItems(0)
+        {
+        }
+
+        bool isFinished() const
+        {
+            return m_cancelled || (m_traversed && m_numOfSearchedItems >= m_numOfItems);
+        }
+
+        QString m_name;
+
+        // Whether all the folders have been walked through.
+        bool m_traversed;
+
+        bool m_cancelled;
+
+        // Number of notes to search content.
+        int m_numOfItems;
+
+        int m_numOfSearchedItems;
+    };
+
     explicit VSearch(QObject *p_parent = nullptr);
 
+    ~VSearch();
+
     void setConfig(QSharedPointer<VSearchConfig> p_config);
 
+    // Max number of results of a fuzzy name search, which are ranked by score.
+    // 0 to keep all the results.
+    void setRankingLimit(int p_limit);
+
     // Search list of files for CurrentNote and OpenedNotes.
     QSharedPointer<VSearchResult> search(const QVector<VFile *> &p_files);
 
     // Search folder for CurrentFolder.
+    // Folders are walked through in background and the result is finished
+    // via finished().
     QSharedPointer<VSearchResult> search(VDirectory *p_directory);
 
     // Search folder for CurrentNotebook and AllNotebooks.
+    // Notebooks are walked through concurrently in background.
     QSharedPointer<VSearchResult> search(const QVector<VNotebook *> &p_notebooks);
 
     // Search directory path for ExplorerDirectory.
@@ -40,6 +83,12 @@ public:
 
     void stop();
 
+    // Skip notebook @p_idx of current search.
+    void stopNotebook(int p_idx);
+
+    // Empty if current search is not a search of notebooks.
+    const QVector<NotebookProgress> &getNotebookProgress() const;
+
 signals:
     // Emitted when a new item added as result.
     void resultItemAdded(const QSharedPointer<VSearchResultItem> &p_item);
@@ -49,27 +98,127 @@ signals:
     // Emitted when async task finished.
     void finished(const QSharedPointer<VSearchResult> &p_result);
 
+    void notebookProgressChanged();
+
+private slots:
+    // Mark the record of current search as finished with @p_result.
+    void finishRecord(const QSharedPointer<VSearchResult> &p_result);
+
+    void handleItemsSearched(int p_stream, int p_numOfItems);
+
+    // Drop the record of the last search since the notes may be changed.
+    void invalidateRecord();
+
 private:
+    // How a search could reuse the results of the last search.
+    enum class Refinement
+    {
+        None = 0,
+        // Filter the last result items and their matches.
+        FilterItems,
+        // Search the notes of the last result items only.
+        RescanNotes
+    };
+
+    // Record of the last search which could be refined by following searches.
+    struct SearchRecord
+    {
+        SearchRecord()
+            : m_canRescan(false),
+              m_numOfMatches(0),
+              m_overflow(false),
+              m_truncated(false),
+              m_invalidated(false)
+        {
+        }
+
+        QSharedPointer<VSearchConfig> m_config;
+
+        // Root paths of the scope.
+        QStringList m_roots;
+
+        // Whether notes could be searched in second phase.
+        bool m_canRescan;
+
+        QList<QSharedPointer<VSearchResultItem> > m_items;
+
+        int m_numOfMatches;
+
+        // Too many matches to keep.
+        bool m_overflow;
+
+        // Whether matches of any item are truncated.
+        bool m_truncated;
+
+        QDateTime m_startedTime;
+
+        // Invalid if the search did not finish successfully.
+        QDateTime m_finishedTime;
+
+        // Whether any note or folder is written since the search started.
+        bool m_invalidated;
+    };
+
+    // Whether asked to stop the whole search.
     bool askedToStop() const;
 
-    // @p_searchContent: whether search content in first phase.
+    // Start to rank results of name search if it is fuzzy.
+    void startRanking();
+
+    // Add the ranked results in order.
+    void finishRanking();
+
+    // Add a result item if @p_name matches.
+    void searchForName(VSearchResultItem::ItemType p_type,
+                       const QString &p_name,
+                       const QString &p_path);
+
+    // Start to record results of current search.
+    void startRecord(const QStringList &p_roots, bool p_canRescan);
+
+    void recordItem(const QSharedPointer<VSearchResultItem> &p_item);
+
+    Refinement checkRefinement(const QStringList &p_roots, bool p_canRescan) const;
+
+    // Whether any recorded item under @p_roots is changed or removed since the
+    // last search started, or any opened note under @p_roots is edited.
+    bool isRecordChanged(const QStringList &p_roots) const;
+
+    // Try to get results of current search by refining the last search.
+    // Returns true if refined.
+    bool refineLastSearch(const QStringList &p_roots,
+                          bool p_canRescan,
+                          const QSharedPointer<VSearchResult> &p_result);
+
+    // Filter @p_item and its matches with current config.
+    // Returns NULL if it does not match any more.
+    QSharedPointer<VSearchResultItem> filterItem(const QSharedPointer<VSearchResultItem> &p_item) const;
+
+    // @p_searchContent: whether search the content of opened file in memory.
     void searchFirstPhase(VFile *p_file,
                           const QSharedPointer<VSearchResult> &p_result,
                           bool p_searchContent = false);
 
-    void searchFirstPhase(VDirectory *p_directory,
-                          const QSharedPointer<VSearchResult> &p_result);
+    // Start @p_traverser to walk through folders for @p_result.
+    // @p_manifest: manifest to add the outlines built by @p_traverser.
+    void startTraverser(VSearchTraverser *p_traverser,
+                        VNotebookManifest *p_manifest,
+                        const QSharedPointer<VSearchResult> &p_result);
 
-    void searchFirstPhase(VNotebook *p_notebook,
-                          const QSharedPointer<VSearchResult> &p_result);
+    // Take the results posted by @p_traverser.
+    void takeTraverserResults(VSearchTraverser *p_traverser,
+                              const QPointer<VNotebookManifest> &p_manifest,
+                              const QSharedPointer<VSearchResult> &p_result);
 
-    void searchFirstPhase(const QString &p_basePath,
-                          const QString &p_directoryPath,
-                          const QSharedPointer<VSearchResult> &p_result);
+    void finishTraverser(VSearchTraverser *p_traverser,
+                         const QPointer<VNotebookManifest> &p_manifest,
+                         const QSharedPointer<VSearchResult> &p_result);
 
-    void searchFirstPhaseFile(const QString &p_basePath,
-                              const QString &p_filePath,
-                              const QSharedPointer<VSearchResult> &p_result);
+    // Called when all the traversers finished.
+    void finishFirstPhase(const QSharedPointer<VSearchResult> &p_result);
+
+    // Stop and delete the traversers of previous search.
+    void clearTraversers();
 
     bool testTarget(VSearchConfig::Target p_target) const;
 
@@ -85,8 +234,20 @@ private:
 
     VSearchResultItem *searchForTag(const VFile *p_file) const;
 
-    VSearchResultItem *searchForContent(const VFile *p_file) const;
+    bool matchTags(const QStringList &p_tags) const;
 
+    // Delete the traversers and the engine of previous search.
+    void resetSecondPhase();
+
+    // Start the engine if not started yet.
+    // Returns false if there is no engine to use.
+    bool startSecondPhase(const QSharedPointer<VSearchResult> &p_result);
+
+    // Feed new second phase items to stream @p_stream of the engine, which
+    // searches them while the first phase is still going on.
+    void feedSecondPhase(const QSharedPointer<VSearchResult> &p_result, int p_stream = 0);
+
+    // Feed all the remaining second phase items and finish feeding.
     void searchSecondPhase(const QSharedPointer<VSearchResult> &p_result);
 
     void removeSlashFromPath(QString &p_path);
@@ -97,11 +258,31 @@ private:
 
     ISearchEngine *m_engine;
 
+    // Number of second phase items fed to the engine.
+    int m_numOfFedItems;
+
+    // Indexed by the stream id.
+    QVector<NotebookProgress> m_notebookProgress;
+
+    // Traversers of current search, one for each stream.
+    QVector<VSearchTraverser *> m_traversers;
+
+    int m_numOfRunningTraversers;
+
     // Wildcard reg to for file name pattern.
     QRegExp m_patternReg;
 
     // Remove slashes.
     QRegExp m_slashReg;
+
+    SearchRecord m_lastSearch;
+
+    int m_rankingLimit;
+
+    // Whether results of name search are being ranked.
+    bool m_ranking;
+
+    VTopK<QSharedPointer<VSearchResultItem> > m_ranker;
 };
 
 inline bool VSearch::askedToStop() const
@@ -110,6 +291,11 @@ inline bool VSearch::askedToStop() const
     return m_askedToStop;
 }
 
+inline const QVector<VSearch::NotebookProgress> &VSearch::getNotebookProgress() const
+{
+    return m_notebookProgress;
+}
+
 inline void VSearch::setConfig(QSharedPointer<VSearchConfig> p_config)
 {
     m_config = p_config;
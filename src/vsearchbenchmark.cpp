@@ -0,0 +1,621 @@
+#include "vsearchbenchmark.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QDebug>
+
+#include "vsearch.h"
+#include "vnotebook.h"
+#include "vnotebookmanifest.h"
+#include "vconfigmanager.h"
+#include "vdirconfigwriter.h"
+#include "vfilemetacache.h"
+#include "vconstants.h"
+#include "utils/vutils.h"
+
+extern VConfigManager *g_config;
+
+static const QString c_benchmarkOption = "--search-benchmark";
+
+// Words used to generate names and contents.
+static const char *c_words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "labore", "dolore", "magna",
+    "aliqua", "enim", "minim", "veniam", "quis", "nostrud", "exercitation", "ullamco",
+    "laboris", "nisi", "aliquip", "commodo", "consequat", "duis", "aute", "irure",
+    "reprehenderit", "voluptate", "velit", "esse", "cillum", "fugiat", "nulla", "pariatur",
+    "excepteur", "sint", "occaecat", "cupidatat", "proident", "sunt", "culpa", "officia",
+    "deserunt", "mollit", "anim", "laborum", "vnote", "markdown", "notebook", "folder",
+    "search", "engine", "outline", "heading", "snippet", "attachment", "image", "preview"
+};
+
+static const int c_numOfWords = sizeof(c_words) / sizeof(c_words[0]);
+
+static const char *c_tags[] = {
+    "work", "personal", "todo", "draft", "review", "archive", "idea", "reference",
+    "linux", "windows", "macos", "cpp", "qt", "design", "meeting", "reading"
+};
+
+static const int c_numOfTags = sizeof(c_tags) / sizeof(c_tags[0]);
+
+// Search engines to benchmark, one per VSearchConfig::Engine.
+static const struct
+{
+    int m_engine;
+    const char *m_name;
+} c_engines[] = {
+    { VSearchConfig::Internal, "internal" }
+};
+
+// Name of the attachment folder of generated notebooks.
+static const QString c_attachmentFolder = "_v_attachments";
+
+VSearchBenchmark::VSearchBenchmark()
+    : m_runs(3),
+      m_randomState(1),
+      m_numOfFolders(0),
+      m_numOfNotes(0),
+      m_totalSize(0)
+{
+}
+
+bool VSearchBenchmark::isRequested(const QStringList &p_args)
+{
+    return p_args.contains(c_benchmarkOption);
+}
+
+int VSearchBenchmark::run(const QStringList &p_args)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Search benchmark of VNote.");
+    QCommandLineOption benchmarkOpt(c_benchmarkOption.mid(2), "Run the search benchmark.");
+    QCommandLineOption dirOpt("dir", "Notebook folder to search.", "path");
+    QCommandLineOption generateOpt("generate", "Generate a synthetic notebook in <dir> first.");
+    QCommandLineOption depthOpt("depth", "Depth of generated folders.", "n", "2");
+    QCommandLineOption foldersOpt("folders", "Sub-folders of each generated folder.", "n", "4");
+    QCommandLineOption notesOpt("notes", "Notes of each generated folder.", "n", "20");
+    QCommandLineOption minSizeOpt("min-size", "Min size of notes in KB.", "kb", "1");
+    QCommandLineOption maxSizeOpt("max-size", "Max size of notes in KB.", "kb", "64");
+    QCommandLineOption largeRatioOpt("large-ratio", "Ratio of large notes.", "ratio", "0.02");
+    QCommandLineOption largeSizeOpt("large-size", "Size of large notes in KB.", "kb", "1024");
+    QCommandLineOption seedOpt("seed", "Random seed of the generator.", "n", "1");
+    QCommandLineOption runsOpt("runs", "Runs of each query.", "n", "3");
+    QCommandLineOption outputOpt("output", "Write the JSON report to <file> instead of stdout.", "file");
+    parser.addOptions({ benchmarkOpt, dirOpt, generateOpt, depthOpt, foldersOpt, notesOpt,
+                        minSizeOpt, maxSizeOpt, largeRatioOpt, largeSizeOpt, seedOpt,
+                        runsOpt, outputOpt });
+    // Arguments of Qt such as -platform have been removed by QApplication.
+    if (!parser.parse(p_args)) {
+        qWarning() << "search benchmark:" << parser.errorText();
+        return -1;
+    }
+
+    QString dir = parser.value(dirOpt);
+    if (dir.isEmpty()) {
+        qWarning() << "search benchmark: --dir is required";
+        return -1;
+    }
+
+    dir = QDir(dir).absolutePath();
+
+    m_options.m_depth = qMax(0, parser.value(depthOpt).toInt());
+    m_options.m_foldersPerFolder = qMax(0, parser.value(foldersOpt).toInt());
+    m_options.m_notesPerFolder = qMax(0, parser.value(notesOpt).toInt());
+    m_options.m_minSizeKB = qMax(0, parser.value(minSizeOpt).toInt());
+    m_options.m_maxSizeKB = qMax(m_options.m_minSizeKB, parser.value(maxSizeOpt).toInt());
+    m_options.m_largeRatio = parser.value(largeRatioOpt).toDouble();
+    m_options.m_largeSizeKB = qMax(0, parser.value(largeSizeOpt).toInt());
+    m_options.m_seed = parser.value(seedOpt).toUInt();
+    m_runs = qMax(1, parser.value(runsOpt).toInt());
+
+    if (parser.isSet(generateOpt)) {
+        if (!generateNotebook(dir) || !VDirConfigWriter::getInstance()->flush()) {
+            qWarning() << "search benchmark: fail to generate notebook" << dir;
+            return -1;
+        }
+    }
+
+    if (!QFileInfo::exists(VConfigManager::fetchDirConfigFilePath(dir))) {
+        qWarning() << "search benchmark: not a notebook" << dir;
+        return -1;
+    }
+
+    // Work on a scratch copy of the cache folder so that the caches of VNote,
+    // such as the manifest of the notebook, are left untouched.
+    QTemporaryDir scratchDir;
+    if (!scratchDir.isValid()) {
+        qWarning() << "search benchmark: fail to create scratch cache folder";
+        return -1;
+    }
+
+    QDir cacheDir(g_config->getCacheFolder());
+    for (auto const & file : cacheDir.entryList(QDir::Files)) {
+        QFile::copy(cacheDir.filePath(file), QDir(scratchDir.path()).filePath(file));
+    }
+
+    g_config->setCacheFolder(scratchDir.path());
+
+    collectStatistics(dir);
+
+    QJsonObject report;
+    QJsonObject nbJson;
+    nbJson["path"] = dir;
+    nbJson["generated"] = parser.isSet(generateOpt);
+    nbJson["folders"] = m_numOfFolders;
+    nbJson["notes"] = m_numOfNotes;
+    nbJson["bytes"] = m_totalSize;
+    report["notebook"] = nbJson;
+    report["runs"] = m_runs;
+
+    VNotebook *notebook = new VNotebook(QFileInfo(dir).fileName(), dir);
+    notebook->readConfigNotebook();
+
+    // Build the manifest before queries.
+    QElapsedTimer timer;
+    timer.start();
+    bool hasManifest = notebook->getManifest(true) != NULL;
+    report["manifest_ms"] = hasManifest ? timer.elapsed() : -1;
+
+    QJsonArray results;
+    for (auto const & engine : c_engines) {
+        for (auto const & query : queries()) {
+            QJsonObject res = runQuery(notebook, engine.m_engine, query);
+            res["engine"] = QString::fromLatin1(engine.m_name);
+            results.append(res);
+        }
+    }
+
+    report["results"] = results;
+
+    delete notebook;
+
+    // The file meta cache is saved on exit, so save it into the scratch cache
+    // folder before the folder is removed.
+    delete VFileMetaCache::getInstance();
+
+    QByteArray data = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    QString output = parser.value(outputOpt);
+    if (output.isEmpty()) {
+        QTextStream out(stdout);
+        out << data;
+    } else {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "search benchmark: fail to write report" << output;
+            return -1;
+        }
+
+        file.write(data);
+    }
+
+    return 0;
+}
+
+bool VSearchBenchmark::generateNotebook(const QString &p_path)
+{
+    QDir dir(p_path);
+    if (dir.exists() && !dir.entryList(QDir::AllEntries | QDir::NoDotAndDotDot).isEmpty()) {
+        qWarning() << "search benchmark: folder to generate notebook is not empty" << p_path;
+        return false;
+    }
+
+    if (!dir.mkpath(p_path)) {
+        return false;
+    }
+
+    m_randomState = m_options.m_seed ? m_options.m_seed : 1;
+    return generateFolder(p_path, QString(), 0);
+}
+
+bool VSearchBenchmark::generateFolder(const QString &p_notebookPath,
+                                      const QString &p_relativePath,
+                                      int p_depth)
+{
+    QDir nbDir(p_notebookPath);
+    QString folderPath = p_relativePath.isEmpty() ? p_notebookPath
+                                                  : nbDir.filePath(p_relativePath);
+    if (!nbDir.mkpath(folderPath)) {
+        return false;
+    }
+
+    QDir folder(folderPath);
+    QString now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QJsonObject json;
+    json[DirConfig::c_version] = "1";
+    json[DirConfig::c_createdTime] = now;
+
+    QJsonArray subDirs;
+    if (p_depth < m_options.m_depth) {
+        for (int i = 0; i < m_options.m_foldersPerFolder; ++i) {
+            QString name = QString("%1_%2").arg(randomWord()).arg(i);
+            if (!generateFolder(p_notebookPath,
+                                VNotebookManifest::childPath(p_relativePath, name),
+                                p_depth + 1)) {
+                return false;
+            }
+
+            QJsonObject item;
+            item[DirConfig::c_name] = name;
+            subDirs.append(item);
+        }
+    }
+
+    json[DirConfig::c_subDirectories] = subDirs;
+
+    QJsonArray files;
+    for (int i = 0; i < m_options.m_notesPerFolder; ++i) {
+        QString name = QString("%1 %2 %3.md").arg(randomWord()).arg(randomWord()).arg(i);
+
+        int sizeKB = m_options.m_minSizeKB;
+        if (random() % 10000 < quint32(m_options.m_largeRatio * 10000)) {
+            sizeKB = m_options.m_largeSizeKB;
+        } else {
+            sizeKB += random() % (m_options.m_maxSizeKB - m_options.m_minSizeKB + 1);
+        }
+
+        if (!VUtils::writeFileToDisk(folder.filePath(name), generateNoteContent(sizeKB * 1024))) {
+            return false;
+        }
+
+        QJsonObject item;
+        item[DirConfig::c_name] = name;
+        item[DirConfig::c_createdTime] = now;
+        item[DirConfig::c_modifiedTime] = now;
+
+        QJsonArray attachments;
+        if (random() % 10000 < quint32(m_options.m_attachmentRatio * 10000)) {
+            QString attFolder = QString("%1_%2").arg(randomWord()).arg(random());
+            QDir attDir(nbDir.filePath(c_attachmentFolder));
+            if (!attDir.mkpath(attFolder)) {
+                return false;
+            }
+
+            int cnt = 1 + random() % 3;
+            for (int j = 0; j < cnt; ++j) {
+                QString attName = QString("%1_%2.txt").arg(randomWord()).arg(j);
+                VUtils::writeFileToDisk(QDir(attDir.filePath(attFolder)).filePath(attName),
+                                        generateNoteContent(512));
+
+                QJsonObject attItem;
+                attItem[DirConfig::c_name] = attName;
+                attachments.append(attItem);
+            }
+
+            item[DirConfig::c_attachmentFolder] = attFolder;
+        } else {
+            item[DirConfig::c_attachmentFolder] = QString();
+        }
+
+        item[DirConfig::c_attachments] = attachments;
+        item[DirConfig::c_tags] = QJsonArray::fromStringList(generateTags());
+        files.append(item);
+    }
+
+    json[DirConfig::c_files] = files;
+
+    if (p_relativePath.isEmpty()) {
+        // Notebook config.
+        json[DirConfig::c_imageFolder] = QString();
+        json[DirConfig::c_attachmentFolder] = c_attachmentFolder;
+        json[DirConfig::c_recycleBinFolder] = QString();
+        json[DirConfig::c_tags] = QJsonArray();
+    }
+
+    // Flushed once the notebook is generated.
+    return VConfigManager::writeDirectoryConfig(folderPath, json, true);
+}
+
+QString VSearchBenchmark::generateNoteContent(int p_size)
+{
+    QString content;
+    content.reserve(p_size + 256);
+
+    int section = 0;
+    while (content.size() < p_size) {
+        // Heading.
+        int level = 1 + random() % 3;
+        content += QString(level, '#') + ' ' + randomWord() + ' ' + randomWord()
+                   + ' ' + QString::number(section++) + "\n\n";
+
+        // Paragraphs.
+        int paras = 1 + random() % 4;
+        for (int i = 0; i < paras && content.size() < p_size; ++i) {
+            int words = 20 + random() % 60;
+            for (int j = 0; j < words; ++j) {
+                content += randomWord();
+                content += (j % 12 == 11) ? '\n' : ' ';
+            }
+
+            content += "\n\n";
+        }
+
+        // Code block.
+        if (random() % 4 == 0) {
+            content += "```cpp\n";
+            int lines = 3 + random() % 10;
+            for (int i = 0; i < lines; ++i) {
+                content += QString("int %1_%2 = %3; // %4\n").arg(randomWord())
+                                                             .arg(i)
+                                                             .arg(random() % 1000)
+                                                             .arg(randomWord());
+            }
+
+            content += "```\n\n";
+        }
+    }
+
+    return content;
+}
+
+QStringList VSearchBenchmark::generateTags()
+{
+    QStringList tags;
+    int cnt = random() % 4;
+    for (int i = 0; i < cnt; ++i) {
+        QString tag = c_tags[random() % c_numOfTags];
+        if (!tags.contains(tag)) {
+            tags << tag;
+        }
+    }
+
+    return tags;
+}
+
+void VSearchBenchmark::collectStatistics(const QString &p_path)
+{
+    m_numOfFolders = 0;
+    m_numOfNotes = 0;
+    m_totalSize = 0;
+
+    QDirIterator it(p_path, QDir::Dirs | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    QStringList folders(p_path);
+    while (it.hasNext()) {
+        folders << it.next();
+    }
+
+    for (auto const & folder : folders) {
+        QJsonObject json = VConfigManager::readDirectoryConfig(folder);
+        if (json.isEmpty()) {
+            continue;
+        }
+
+        ++m_numOfFolders;
+        QDir dir(folder);
+        QJsonArray files = json[DirConfig::c_files].toArray();
+        for (auto const & file : files) {
+            QFileInfo info(dir.filePath(file.toObject()[DirConfig::c_name].toString()));
+            if (info.exists()) {
+                ++m_numOfNotes;
+                m_totalSize += info.size();
+            }
+        }
+    }
+}
+
+QVector<VSearchBenchmark::Query> VSearchBenchmark::queries() const
+{
+    struct Variant
+    {
+        QString m_name;
+        int m_option;
+    };
+
+    const Variant variants[] = {
+        { "single", VSearchConfig::NoneOption },
+        { "and", VSearchConfig::NoneOption },
+        { "or", VSearchConfig::NoneOption },
+        { "regex", VSearchConfig::RegularExpression },
+        { "fuzzy", VSearchConfig::Fuzzy }
+    };
+
+    QVector<Query> ret;
+    const int objects[] = { VSearchConfig::Name,
+                            VSearchConfig::Tag,
+                            VSearchConfig::Outline,
+                            VSearchConfig::Content };
+    for (int obj : objects) {
+        // Tags are short words.
+        bool isTag = obj == VSearchConfig::Tag;
+        for (auto const & var : variants) {
+            Query q;
+            q.m_object = obj;
+            q.m_option = var.m_option;
+            q.m_variant = var.m_name;
+            if (var.m_name == "single") {
+                q.m_keyword = isTag ? "todo" : "magna";
+            } else if (var.m_name == "and") {
+                q.m_keyword = isTag ? "todo work" : "magna elit";
+            } else if (var.m_name == "or") {
+                q.m_keyword = isTag ? "todo || work" : "magna || veniam";
+            } else if (var.m_name == "regex") {
+                q.m_keyword = isTag ? "t.d." : "mag.a\\s+\\w+";
+            } else {
+                q.m_keyword = isTag ? "tdo" : "mgna";
+            }
+
+            ret.append(q);
+        }
+    }
+
+    return ret;
+}
+
+QJsonObject VSearchBenchmark::runQuery(VNotebook *p_notebook, int p_engine, const Query &p_query)
+{
+    QString objName;
+    switch (p_query.m_object) {
+    case VSearchConfig::Name:
+        objName = "name";
+        break;
+
+    case VSearchConfig::Tag:
+        objName = "tag";
+        break;
+
+    case VSearchConfig::Outline:
+        objName = "outline";
+        break;
+
+    default:
+        objName = "content";
+        break;
+    }
+
+    QJsonObject res;
+    res["object"] = objName;
+    res["variant"] = p_query.m_variant;
+    res["keyword"] = p_query.m_keyword;
+
+    // Only content queries read all the notes.
+    bool readsContent = p_query.m_object == VSearchConfig::Content;
+
+    QJsonArray runs;
+    qint64 totalMs = 0;
+    qint64 minMs = -1;
+    for (int i = 0; i < m_runs; ++i) {
+        int target = p_query.m_object == VSearchConfig::Name
+                     ? VSearchConfig::Note | VSearchConfig::Folder : VSearchConfig::Note;
+        QSharedPointer<VSearchConfig> config(new VSearchConfig(VSearchConfig::AllNotebooks,
+                                                               p_query.m_object,
+                                                               target,
+                                                               p_engine,
+                                                               p_query.m_option,
+                                                               p_query.m_keyword,
+                                                               QString()));
+
+        resetPeakMemory();
+
+        // A new VSearch each time so that no previous search is refined.
+        VSearch search;
+        search.setConfig(config);
+
+        QElapsedTimer timer;
+        qint64 firstResultMs = -1;
+        int numOfItems = 0;
+        int numOfMatches = 0;
+        auto countItem = [&](const QSharedPointer<VSearchResultItem> &p_item) {
+            if (firstResultMs == -1) {
+                firstResultMs = timer.elapsed();
+            }
+
+            ++numOfItems;
+            numOfMatches += p_item->m_matches.size();
+        };
+
+        QObject::connect(&search, &VSearch::resultItemAdded, countItem);
+        QObject::connect(&search, &VSearch::resultItemsAdded,
+                         [&](const QList<QSharedPointer<VSearchResultItem> > &p_items) {
+                             for (auto const & it : p_items) {
+                                 countItem(it);
+                             }
+                         });
+
+        QEventLoop loop;
+        QSharedPointer<VSearchResult> result;
+        QObject::connect(&search, &VSearch::finished,
+                         [&](const QSharedPointer<VSearchResult> &p_result) {
+                             result = p_result;
+                             loop.quit();
+                         });
+
+        timer.start();
+        result = search.search(QVector<VNotebook *>() << p_notebook);
+        if (result->m_state == VSearchState::Busy) {
+            // Results of second phase will be delivered via the event loop.
+            loop.exec();
+        }
+
+        qint64 ms = timer.elapsed();
+        search.clear();
+
+        totalMs += ms;
+        if (minMs == -1 || ms < minMs) {
+            minMs = ms;
+        }
+
+        double secs = qMax(ms, qint64(1)) / 1000.0;
+        QJsonObject runJson;
+        runJson["state"] = int(result->m_state);
+        runJson["ms"] = ms;
+        runJson["first_result_ms"] = firstResultMs;
+        runJson["items"] = numOfItems;
+        runJson["matches"] = numOfMatches;
+        runJson["files_per_sec"] = m_numOfNotes / secs;
+        if (readsContent) {
+            runJson["mb_per_sec"] = m_totalSize / (1024.0 * 1024.0) / secs;
+        }
+
+        runJson["peak_memory_kb"] = peakMemoryKB();
+        runs.append(runJson);
+    }
+
+    res["runs"] = runs;
+    res["avg_ms"] = double(totalMs) / m_runs;
+    res["min_ms"] = minMs;
+
+    double secs = qMax(minMs, qint64(1)) / 1000.0;
+    res["files_per_sec"] = m_numOfNotes / secs;
+    if (readsContent) {
+        res["mb_per_sec"] = m_totalSize / (1024.0 * 1024.0) / secs;
+    }
+
+    return res;
+}
+
+QString VSearchBenchmark::randomWord()
+{
+    return QString::fromLatin1(c_words[random() % c_numOfWords]);
+}
+
+quint32 VSearchBenchmark::random()
+{
+    // Xorshift to get the same notebook with the same seed on all platforms.
+    quint32 x = m_randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_randomState = x;
+    return x;
+}
+
+qint64 VSearchBenchmark::peakMemoryKB()
+{
+#if defined(Q_OS_LINUX)
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+
+    QTextStream in(&file);
+    QString line;
+    while (!(line = in.readLine()).isNull()) {
+        if (line.startsWith("VmHWM:")) {
+            return line.mid(6).trimmed().split(' ').first().toLongLong();
+        }
+    }
+#endif
+
+    return -1;
+}
+
+void VSearchBenchmark::resetPeakMemory()
+{
+#if defined(Q_OS_LINUX)
+    // Reset the peak resident set size to current.
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write("5");
+    }
+#endif
+}
@@ -0,0 +1,119 @@
+#ifndef VSEARCHBENCHMARK_H
+#define VSEARCHBENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVector>
+
+class VNotebook;
+
+// Benchmark of VSearch run from command line without the main window:
+//   vnote --search-benchmark --dir <notebook> [--generate] [options]
+// It could generate a synthetic notebook, runs name, tag, outline, and content
+// queries with various options against each search engine, and prints the
+// measurements as JSON.
+class VSearchBenchmark
+{
+public:
+    VSearchBenchmark();
+
+    // Whether the benchmark is requested by command line @p_args.
+    static bool isRequested(const QStringList &p_args);
+
+    // Returns the exit code.
+    int run(const QStringList &p_args);
+
+private:
+    // Options to generate a synthetic notebook.
+    struct GenerateOptions
+    {
+        GenerateOptions()
+            : m_depth(2),
+              m_foldersPerFolder(4),
+              m_notesPerFolder(20),
+              m_minSizeKB(1),
+              m_maxSizeKB(64),
+              m_largeRatio(0.02),
+              m_largeSizeKB(1024),
+              m_attachmentRatio(0.1),
+              m_seed(1)
+        {
+        }
+
+        int m_depth;
+
+        int m_foldersPerFolder;
+
+        int m_notesPerFolder;
+
+        // Sizes of notes are uniformly distributed in [m_minSizeKB, m_maxSizeKB],
+        // except a ratio of @m_largeRatio notes with size @m_largeSizeKB.
+        int m_minSizeKB;
+
+        int m_maxSizeKB;
+
+        double m_largeRatio;
+
+        int m_largeSizeKB;
+
+        // Ratio of notes with attachments.
+        double m_attachmentRatio;
+
+        quint32 m_seed;
+    };
+
+    struct Query
+    {
+        int m_object;
+
+        int m_option;
+
+        // Name of the option variant.
+        QString m_variant;
+
+        QString m_keyword;
+    };
+
+    bool generateNotebook(const QString &p_path);
+
+    // Generate folder @p_relativePath and its notes recursively.
+    bool generateFolder(const QString &p_notebookPath,
+                        const QString &p_relativePath,
+                        int p_depth);
+
+    QString generateNoteContent(int p_size);
+
+    QStringList generateTags();
+
+    // Collect number and size of notes of the notebook.
+    void collectStatistics(const QString &p_path);
+
+    QVector<Query> queries() const;
+
+    QJsonObject runQuery(VNotebook *p_notebook, int p_engine, const Query &p_query);
+
+    QString randomWord();
+
+    quint32 random();
+
+    // Returns -1 if not supported.
+    static qint64 peakMemoryKB();
+
+    static void resetPeakMemory();
+
+    GenerateOptions m_options;
+
+    int m_runs;
+
+    quint32 m_randomState;
+
+    int m_numOfFolders;
+
+    int m_numOfNotes;
+
+    qint64 m_totalSize;
+};
+
+#endif // VSEARCHBENCHMARK_H
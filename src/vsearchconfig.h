@@ -5,9 +5,11 @@
 #include <QStringList>
 #include <QSharedPointer>
 #include <QVector>
+#include <QHash>
 #include <QRegExp>
 
 #include "utils/vutils.h"
+#include "utils/vfuzzymatcher.h"
 
 
 struct VSearchToken
@@ -15,7 +17,8 @@ struct VSearchToken
     enum Type
     {
         RawString = 0,
-        RegularExpression
+        RegularExpression,
+        Fuzzy
     };
 
     enum Operator
@@ -35,6 +38,7 @@ struct VSearchToken
     {
         m_keywords.clear();
         m_regs.clear();
+        m_fuzzyMatchers.clear();
     }
 
     void append(const QString &p_rawStr)
@@ -42,6 +46,13 @@ struct VSearchToken
         m_keywords.append(p_rawStr);
     }
 
+    // Should be called after m_caseSensitivity is set.
+    void appendFuzzy(const QString &p_rawStr)
+    {
+        m_keywords.append(p_rawStr);
+        m_fuzzyMatchers.append(VFuzzyMatcher(p_rawStr, m_caseSensitivity));
+    }
+
     void append(const QRegExp &p_reg)
     {
         m_regs.append(p_reg);
@@ -70,13 +81,7 @@ struct VSearchToken
 
         bool ret = m_op == Operator::And ? true : false;
         for (int i = 0; i < size; ++i) {
-            bool tmp = false;
-            if (m_type == Type::RawString) {
-                tmp = p_text.contains(m_keywords[i], m_caseSensitivity);
-            } else {
-                tmp = p_text.contains(m_regs[i]);
-            }
-
+            bool tmp = matchOne(i, p_text);
             if (tmp) {
                 if (m_op == Operator::Or) {
                     ret = true;
@@ -93,9 +98,40 @@ struct VSearchToken
         return ret;
     }
 
+    // Return the score of @p_text, or -1 if it does not match.
+    // Only fuzzy tokens give a ranking score. Others give 0 on match.
+    int score(const QString &p_text) const
+    {
+        if (m_type != Type::Fuzzy) {
+            return matched(p_text) ? 0 : -1;
+        }
+
+        int size = m_fuzzyMatchers.size();
+        if (size == 0) {
+            return -1;
+        }
+
+        // Sum of all the scores for AND, best one for OR.
+        int ret = -1;
+        for (int i = 0; i < size; ++i) {
+            int tmp = m_fuzzyMatchers[i].score(p_text);
+            if (m_op == Operator::And) {
+                if (tmp < 0) {
+                    return -1;
+                }
+
+                ret = qMax(ret, 0) + tmp;
+            } else {
+                ret = qMax(ret, tmp);
+            }
+        }
+
+        return ret;
+    }
+
     void startBatchMode()
     {
-        int size = m_type == Type::RawString ? m_keywords.size() : m_regs.size();
+        int size = tokenSize();
         m_matchesInBatch.resize(size);
         m_matchesInBatch.fill(false);
         m_numOfMatches = 0;
@@ -112,13 +148,7 @@ struct VSearchToken
                 continue;
             }
 
-            bool tmp = false;
-            if (m_type == Type::RawString) {
-                tmp = p_text.contains(m_keywords[i], m_caseSensitivity);
-            } else {
-                tmp = p_text.contains(m_regs[i]);
-            }
-
+            bool tmp = matchOne(i, p_text);
             if (tmp) {
                 m_matchesInBatch[i] = true;
                 ++m_numOfMatches;
@@ -160,9 +190,38 @@ struct VSearchToken
         m_numOfMatches = 0;
     }
 
+    // Max length of the text matched by the token, or -1 if unknown.
+    int maxMatchLength() const
+    {
+        if (m_type != Type::RawString) {
+            return -1;
+        }
+
+        int len = 0;
+        for (auto const & kw : m_keywords) {
+            len = qMax(len, kw.size());
+        }
+
+        return len;
+    }
+
     int tokenSize() const
     {
-        return m_type == Type::RawString ? m_keywords.size() : m_regs.size();
+        return m_type == Type::RegularExpression ? m_regs.size() : m_keywords.size();
+    }
+
+    bool matchOne(int p_idx, const QString &p_text) const
+    {
+        switch (m_type) {
+        case Type::RawString:
+            return p_text.contains(m_keywords[p_idx], m_caseSensitivity);
+
+        case Type::RegularExpression:
+            return p_text.contains(m_regs[p_idx]);
+
+        default:
+            return m_fuzzyMatchers[p_idx].matched(p_text);
+        }
     }
 
     VSearchToken::Type m_type;
@@ -177,6 +236,9 @@ struct VSearchToken
     // Valid at RegularExpression.
     QVector<QRegExp> m_regs;
 
+    // Valid at Fuzzy, one for each keyword.
+    QVector<VFuzzyMatcher> m_fuzzyMatchers;
+
     // Bitmap for batch mode.
     // True if m_regs[i] or m_keywords[i] has been matched.
     QVector<bool> m_matchesInBatch;
@@ -332,7 +394,7 @@ struct VSearchConfig
             m_contentToken.m_type = VSearchToken::RegularExpression;
         } else {
             if (fuzzy) {
-                m_token.m_type = VSearchToken::RegularExpression;
+                m_token.m_type = VSearchToken::Fuzzy;
                 m_contentToken.m_type = VSearchToken::RawString;
             } else if (wwo) {
                 m_token.m_type = VSearchToken::RegularExpression;
@@ -359,13 +421,7 @@ struct VSearchConfig
                 m_contentToken.append(reg);
             } else {
                 if (fuzzy) {
-                    QString wildcardText(arg.size() * 2 + 1, '*');
-                    for (int i = 0, j = 1; i < arg.size(); ++i, j += 2) {
-                        wildcardText[j] = arg[i];
-                    }
-
-                    QRegExp reg(wildcardText, cs, QRegExp::Wildcard);
-                    m_token.append(reg);
+                    m_token.appendFuzzy(arg);
                     m_contentToken.append(arg);
                 } else if (wwo) {
                     QString pattern = QRegExp::escape(arg);
@@ -440,19 +496,27 @@ struct VSearchConfig
 struct VSearchResultSubItem
 {
     VSearchResultSubItem()
-        : m_lineNumber(-1)
+        : m_lineNumber(-1),
+          m_column(-1)
     {
     }
 
     VSearchResultSubItem(int p_lineNumber,
-                         const QString &p_text)
+                         const QString &p_text,
+                         int p_column = -1)
         : m_lineNumber(p_lineNumber),
+          m_column(p_column),
           m_text(p_text)
     {
     }
 
     int m_lineNumber;
 
+    // Offset in chars of @m_text within line @m_lineNumber of the file on
+    // disk, so it could be read again from the file. -1 if it is not, such
+    // as an outline or a line of an unsaved buffer.
+    int m_column;
+
     QString m_text;
 };
 
@@ -477,7 +541,8 @@ struct VSearchResultItem
 
     VSearchResultItem()
         : m_type(ItemType::None),
-          m_matchType(MatchType::LineNumber)
+          m_matchType(MatchType::LineNumber),
+          m_truncated(false)
     {
     }
 
@@ -488,7 +553,8 @@ struct VSearchResultItem
         : m_type(p_type),
           m_matchType(p_matchType),
           m_text(p_text),
-          m_path(p_path)
+          m_path(p_path),
+          m_truncated(false)
     {
     }
 
@@ -518,6 +584,10 @@ struct VSearchResultItem
 
     // Matched places within this item.
     QList<VSearchResultSubItem> m_matches;
+
+    // Whether there are more matches than @m_matches, such as when the max
+    // number of matches per file is reached.
+    bool m_truncated;
 };
 
 
@@ -563,6 +633,13 @@ struct VSearchResult
         m_secondPhaseItems.append(p_item);
     }
 
+    // @p_content: content of an opened note which may differ from the file.
+    void addSecondPhaseItem(const QString &p_item, const QString &p_content)
+    {
+        m_secondPhaseItems.append(p_item);
+        m_secondPhaseContents.insert(p_item, p_content);
+    }
+
     QString toString() const
     {
         QString str = QString("search result: state %1 err %2")
@@ -582,6 +659,9 @@ struct VSearchResult
 
     QStringList m_secondPhaseItems;
 
+    // Contents of second phase items to search instead of reading the files.
+    QHash<QString, QString> m_secondPhaseContents;
+
 private:
     VSearch *m_search;
 };
@@ -3,21 +3,44 @@
 #include <QDebug>
 #include <QFile>
 #include <QMimeDatabase>
+#include <QElapsedTimer>
+#include <QTextCodec>
+#include <QFileInfo>
+#include <QDateTime>
 
 #include "utils/vutils.h"
+#include "utils/vchunkedlinereader.h"
+#include "vfilemetacache.h"
+#include "vconfigmanager.h"
 
-VSearchEngineWorker::VSearchEngineWorker(QObject *p_parent)
+extern VConfigManager *g_config;
+
+// Max number of items a worker takes from the queue each time.
+#define TAKE_ITEM_SIZE 16
+
+// Lines longer than this are searched in segments.
+#define MAX_SEGMENT_LENGTH (64 * 1024)
+
+// Overlap of segments if the max length of a match is unknown.
+#define DEFAULT_SEGMENT_OVERLAP 1024
+
+VSearchEngineWorker::VSearchEngineWorker(VSearchEngine *p_engine, QObject *p_parent)
     : QThread(p_parent),
+      m_engine(p_engine),
+      m_metaCache(NULL),
+      m_maxMatchesPerFile(0),
       m_stop(0),
       m_state(VSearchState::Idle)
 {
 }
 
-void VSearchEngineWorker::setData(const QStringList &p_files,
-                                  const VSearchToken &p_token)
+void VSearchEngineWorker::setData(const VSearchToken &p_token,
+                                  const QHash<QString, QString> &p_contents,
+                                  VFileMetaCache *p_metaCache)
 {
-    m_files = p_files;
     m_token = p_token;
+    m_contents = p_contents;
+    m_metaCache = p_metaCache;
 }
 
 void VSearchEngineWorker::stop()
@@ -27,55 +50,152 @@ void VSearchEngineWorker::stop()
 
 void VSearchEngineWorker::run()
 {
-    qDebug() << "worker" << QThread::currentThreadId() << m_files.size();
+    qDebug() << "worker" << QThread::currentThreadId() << "started";
 
     QMimeDatabase mimeDatabase;
     m_state = VSearchState::Busy;
 
     m_results.clear();
+
+    // Post results in batch, but do not hold them for long so that the first
+    // results show up soon.
+    QElapsedTimer timer;
+    timer.start();
+
     int nr = 0;
-    for (auto const & fileName : m_files) {
+    int stream = 0;
+    QStringList files;
+    while (m_engine->takeItems(files, stream)) {
+        for (auto const & fileName : files) {
+            if (m_stop.load() == 1 || m_engine->isStreamStopped(stream)) {
+                break;
+            }
+
+            VSearchResultItem *item = NULL;
+            auto it = m_contents.constFind(fileName);
+            if (it != m_contents.constEnd()) {
+                VChunkedLineReader reader(it.value());
+                item = searchReader(reader, fileName, false);
+            } else {
+                item = searchFile(fileName, mimeDatabase);
+            }
+
+            if (item) {
+                m_results.append(QSharedPointer<VSearchResultItem>(item));
+            }
+
+            if (++nr >= BATCH_ITEM_SIZE
+                || (!m_results.isEmpty() && timer.elapsed() >= BATCH_INTERVAL)) {
+                nr = 0;
+                postAndClearResults();
+                timer.restart();
+            }
+        }
+
         if (m_stop.load() == 1) {
-            m_state = VSearchState::Cancelled;
-            qDebug() << "worker" << QThread::currentThreadId() << "is asked to stop";
             break;
         }
 
-        const QMimeType mimeType = mimeDatabase.mimeTypeForFile(fileName);
+        // Post before waiting for more items.
+        postAndClearResults();
+
+        // Skipped items of a stopped stream are counted too.
+        emit itemsSearched(stream, files.size());
+    }
+
+    postAndClearResults();
+
+    if (m_stop.load() == 1) {
+        m_state = VSearchState::Cancelled;
+        qDebug() << "worker" << QThread::currentThreadId() << "is asked to stop";
+    } else if (m_state == VSearchState::Busy) {
+        m_state = VSearchState::Success;
+    }
+}
+
+VSearchResultItem *VSearchEngineWorker::searchFile(const QString &p_fileName,
+                                                   QMimeDatabase &p_mimeDatabase)
+{
+    QFileInfo info(p_fileName);
+    if (!info.exists()) {
+        return NULL;
+    }
+
+    VFileMeta meta(info.size(), info.lastModified().toMSecsSinceEpoch());
+    bool cached = m_metaCache->find(p_fileName, meta.m_size, meta.m_modifiedTime, meta);
+    if (!cached) {
+        // May sniff the content.
+        const QMimeType mimeType = p_mimeDatabase.mimeTypeForFile(info);
         if (mimeType.isValid() && !mimeType.inherits(QStringLiteral("text/plain"))) {
-            appendError(tr("Skip binary file %1.").arg(fileName));
-            continue;
+            meta.m_kind = VFileMeta::Binary;
+        } else {
+            meta.m_kind = VFileMeta::Text;
         }
+    }
 
-        VSearchResultItem *item = searchFile(fileName);
-        if (item) {
-            m_results.append(QSharedPointer<VSearchResultItem>(item));
+    if (meta.m_kind == VFileMeta::Binary) {
+        if (!cached) {
+            m_metaCache->insert(p_fileName, meta);
         }
 
-        if (++nr >= BATCH_ITEM_SIZE) {
-            nr = 0;
-            postAndClearResults();
-        }
+        appendError(tr("Skip binary file %1.").arg(p_fileName));
+        return NULL;
     }
 
-    postAndClearResults();
-
-    if (m_state == VSearchState::Busy) {
-        m_state = VSearchState::Success;
+    int lineCount = meta.m_lineCount;
+    QByteArray encoding = meta.m_encoding;
+    VSearchResultItem *item = searchFile(p_fileName, meta);
+    if (!cached || lineCount != meta.m_lineCount || encoding != meta.m_encoding) {
+        m_metaCache->insert(p_fileName, meta);
     }
+
+    return item;
 }
 
-VSearchResultItem *VSearchEngineWorker::searchFile(const QString &p_fileName)
+VSearchResultItem *VSearchEngineWorker::searchFile(const QString &p_fileName, VFileMeta &p_meta)
 {
     QFile file(p_fileName);
     if (!file.open(QIODevice::ReadOnly)) {
         return NULL;
     }
 
-    int lineNum = 1;
+    QTextCodec *codec = NULL;
+    if (!p_meta.m_encoding.isEmpty()) {
+        codec = QTextCodec::codecForName(p_meta.m_encoding);
+    }
+
+    if (!codec) {
+        // Detect by BOM and fall back to UTF-8.
+        codec = QTextCodec::codecForUtfText(file.peek(4), QTextCodec::codecForName("UTF-8"));
+        p_meta.m_encoding = codec->name();
+    }
+
+    VChunkedLineReader reader(&file, codec);
+
+    int lineCount = -1;
+    VSearchResultItem *item = searchReader(reader, p_fileName, true, &lineCount);
+    if (lineCount > -1) {
+        p_meta.m_lineCount = lineCount;
+    }
+
+    return item;
+}
+
+VSearchResultItem *VSearchEngineWorker::searchReader(VChunkedLineReader &p_reader,
+                                                     const QString &p_fileName,
+                                                     bool p_onDisk,
+                                                     int *p_lineCount)
+{
+    int overlap = m_token.maxMatchLength() - 1;
+    if (overlap < 0) {
+        overlap = DEFAULT_SEGMENT_OVERLAP;
+    }
+
+    p_reader.setMaxLineLength(MAX_SEGMENT_LENGTH, overlap);
+
     VSearchResultItem *item = NULL;
     QString line;
-    QTextStream in(&file);
+    int lineNum = 0;
 
     bool singleToken = m_token.tokenSize() == 1;
     if (!singleToken) {
@@ -84,14 +204,12 @@ VSearchResultItem *VSearchEngineWorker::searchFile(const QString &p_fileName)
 
     bool allMatched = false;
 
-    while (!in.atEnd()) {
+    while (p_reader.readLine(line, lineNum)) {
         if (m_stop.load() == 1) {
-            m_state = VSearchState::Cancelled;
             qDebug() << "worker" << QThread::currentThreadId() << "is asked to stop";
             break;
         }
 
-        line = in.readLine();
         bool matched = false;
         if (singleToken) {
             matched = m_token.matched(line);
@@ -107,15 +225,32 @@ VSearchResultItem *VSearchEngineWorker::searchFile(const QString &p_fileName)
                                              p_fileName);
             }
 
-            VSearchResultSubItem sitem(lineNum, line);
-            item->m_matches.append(sitem);
+            // Segments of a long line share the same line number.
+            if (!item->m_truncated
+                && (item->m_matches.isEmpty() || item->m_matches.last().m_lineNumber != lineNum)) {
+                VSearchResultSubItem sitem(lineNum, line, p_onDisk ? p_reader.column() : -1);
+                item->m_matches.append(sitem);
+
+                if (m_maxMatchesPerFile > 0 && item->m_matches.size() >= m_maxMatchesPerFile) {
+                    qDebug() << "reach max matches per file" << p_fileName;
+                    item->m_truncated = true;
+
+                    // With multiple tokens, keep scanning without recording
+                    // matches until all the tokens are matched.
+                    if (singleToken) {
+                        break;
+                    }
+                }
+            }
         }
 
         if (!singleToken && m_token.readyToEndBatchMode(allMatched)) {
             break;
         }
+    }
 
-        ++lineNum;
+    if (p_lineCount && p_reader.atEnd() && m_stop.load() == 0) {
+        *p_lineCount = p_reader.lineCount();
     }
 
     if (!singleToken) {
@@ -142,7 +277,10 @@ void VSearchEngineWorker::postAndClearResults()
 
 VSearchEngine::VSearchEngine(QObject *p_parent)
     : ISearchEngine(p_parent),
-      m_finishedWorkers(0)
+      m_finishedWorkers(0),
+      m_nextStream(0),
+      m_noMoreItems(false),
+      m_stopped(false)
 {
 }
 
@@ -152,57 +290,146 @@ VSearchEngine::~VSearchEngine()
     clear();
 }
 
-void VSearchEngine::search(const QSharedPointer<VSearchConfig> &p_config,
-                           const QSharedPointer<VSearchResult> &p_result)
+void VSearchEngine::start(const QSharedPointer<VSearchConfig> &p_config,
+                          const QSharedPointer<VSearchResult> &p_result)
 {
     int numThread = QThread::idealThreadCount();
     if (numThread < 1) {
         numThread = 1;
     }
 
-    const QStringList items = p_result->m_secondPhaseItems;
-    Q_ASSERT(!items.isEmpty());
-    if (items.size() < numThread) {
-        numThread = items.size();
-    }
-
     m_result = p_result;
 
     clearAllWorkers();
-    m_workers.reserve(numThread);
-    m_finishedWorkers = 0;
-    int totalSize = m_result->m_secondPhaseItems.size();
-    int step = totalSize / numThread;
-    int remain = totalSize % numThread;
-    int start = 0;
-    for (int i = 0; i < numThread && start < totalSize; ++i) {
-        int len = step;
-        if (remain) {
-            ++len;
-            --remain;
-        }
 
-        if (start + len > totalSize) {
-            len = totalSize - start;
-        }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_streams.clear();
+        m_nextStream = 0;
+        m_noMoreItems = false;
+        m_stopped = false;
+    }
 
-        VSearchEngineWorker *th = new VSearchEngineWorker(this);
-        th->setData(m_result->m_secondPhaseItems.mid(start, len),
-                    p_config->m_contentToken);
+    VFileMetaCache *metaCache = VFileMetaCache::getInstance();
+    int maxMatches = g_config->getSearchMaxMatchesPerFile();
+
+    m_workers.reserve(numThread);
+    m_finishedWorkers = 0;
+    for (int i = 0; i < numThread; ++i) {
+        VSearchEngineWorker *th = new VSearchEngineWorker(this, this);
+        th->setData(p_config->m_contentToken, m_result->m_secondPhaseContents, metaCache);
+        th->setMaxMatchesPerFile(maxMatches);
         connect(th, &VSearchEngineWorker::finished,
                 this, &VSearchEngine::handleWorkerFinished);
         connect(th, &VSearchEngineWorker::resultItemsReady,
                 this, [this](const QList<QSharedPointer<VSearchResultItem> > &p_items) {
                     emit resultItemsAdded(p_items);
                 });
+        connect(th, &VSearchEngineWorker::itemsSearched,
+                this, &ISearchEngine::itemsSearched);
 
         m_workers.append(th);
         th->start();
+    }
+
+    qDebug() << "start search engine with threads" << m_workers.size();
+}
+
+void VSearchEngine::addItems(const QStringList &p_items, int p_stream)
+{
+    Q_ASSERT(p_stream >= 0);
+    if (p_items.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_noMoreItems) {
+        // Stopped.
+        return;
+    }
+
+    if (p_stream >= m_streams.size()) {
+        m_streams.resize(p_stream + 1);
+    }
+
+    Stream &st = m_streams[p_stream];
+    if (st.m_stopped) {
+        return;
+    }
+
+    st.m_queue.append(p_items);
+    m_queueCond.wakeAll();
+}
+
+void VSearchEngine::stopStream(int p_stream)
+{
+    QMutexLocker locker(&m_mutex);
+    if (p_stream >= m_streams.size()) {
+        m_streams.resize(p_stream + 1);
+    }
 
-        start += len;
+    Stream &st = m_streams[p_stream];
+    st.m_stopped = true;
+    st.m_queue.clear();
+}
+
+bool VSearchEngine::isStreamStopped(int p_stream)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streams[p_stream].m_stopped;
+}
+
+int VSearchEngine::nextStreamToServe() const
+{
+    int size = m_streams.size();
+    for (int i = 0; i < size; ++i) {
+        int idx = (m_nextStream + i) % size;
+        if (!m_streams[idx].m_queue.isEmpty()) {
+            return idx;
+        }
     }
 
-    qDebug() << "schedule tasks to threads" << m_workers.size() << totalSize << step;
+    return -1;
+}
+
+void VSearchEngine::finishItems()
+{
+    closeQueue(false);
+}
+
+bool VSearchEngine::takeItems(QStringList &p_items, int &p_stream)
+{
+    QMutexLocker locker(&m_mutex);
+    int idx = nextStreamToServe();
+    while (idx == -1 && !m_noMoreItems && !m_stopped) {
+        m_queueCond.wait(&m_mutex);
+        idx = nextStreamToServe();
+    }
+
+    if (m_stopped || idx == -1) {
+        p_items.clear();
+        return false;
+    }
+
+    QStringList &queue = m_streams[idx].m_queue;
+    int cnt = qMin(queue.size(), TAKE_ITEM_SIZE);
+    p_items = queue.mid(0, cnt);
+    queue.erase(queue.begin(), queue.begin() + cnt);
+
+    p_stream = idx;
+    m_nextStream = (idx + 1) % m_streams.size();
+    return true;
+}
+
+void VSearchEngine::closeQueue(bool p_stop)
+{
+    QMutexLocker locker(&m_mutex);
+    m_noMoreItems = true;
+    if (p_stop) {
+        m_stopped = true;
+    }
+
+    m_queueCond.wakeAll();
 }
 
 void VSearchEngine::stop()
@@ -211,6 +438,8 @@ void VSearchEngine::stop()
     for (auto const & th : m_workers) {
         th->stop();
     }
+
+    closeQueue(true);
 }
 
 void VSearchEngine::handleWorkerFinished()
@@ -241,6 +470,8 @@ void VSearchEngine::handleWorkerFinished()
         m_workers.clear();
         m_finishedWorkers = 0;
 
+        VFileMetaCache::getInstance()->scheduleSave();
+
         m_result->m_state = state;
         qDebug() << "SearchEngine finished" << (int)state;
         emit finished(m_result);
@@ -258,6 +489,11 @@ void VSearchEngine::clear()
 
 void VSearchEngine::clearAllWorkers()
 {
+    if (!m_workers.isEmpty()) {
+        // Workers may be waiting for more items.
+        closeQueue(true);
+    }
+
     for (auto const & th : m_workers) {
         th->quit();
         th->wait();
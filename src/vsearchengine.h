@@ -7,11 +7,25 @@
 #include <QRegExp>
 #include <QAtomicInt>
 #include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
 
 #include "vsearchconfig.h"
 
+class QMimeDatabase;
+class VChunkedLineReader;
+class VFileMetaCache;
+struct VFileMeta;
+
 #define BATCH_ITEM_SIZE 100
 
+// Max interval in ms to hold results before posting them.
+#define BATCH_INTERVAL 50
+
+class VSearchEngine;
+
+// Worker taking items from the queue of the engine until there is no more.
 class VSearchEngineWorker : public QThread
 {
     Q_OBJECT
@@ -19,10 +33,14 @@ class VSearchEngineWorker : public QThread
     friend class VSearchEngine;
 
 public:
-    explicit VSearchEngineWorker(QObject *p_parent = nullptr);
+    explicit VSearchEngineWorker(VSearchEngine *p_engine, QObject *p_parent = nullptr);
+
+    void setData(const VSearchToken &p_token,
+                 const QHash<QString, QString> &p_contents,
+                 VFileMetaCache *p_metaCache);
 
-    void setData(const QStringList &p_files,
-                 const VSearchToken &p_token);
+    // 0 for no limit.
+    void setMaxMatchesPerFile(int p_max);
 
 public slots:
     void stop();
@@ -30,22 +48,43 @@ public slots:
 signals:
     void resultItemsReady(const QList<QSharedPointer<VSearchResultItem> > &p_items);
 
+    void itemsSearched(int p_stream, int p_numOfItems);
+
 protected:
     void run() Q_DECL_OVERRIDE;
 
 private:
     void appendError(const QString &p_err);
 
-    VSearchResultItem *searchFile(const QString &p_fileName);
+    // Search file @p_fileName on disk. Skip it if it is binary.
+    VSearchResultItem *searchFile(const QString &p_fileName, QMimeDatabase &p_mimeDatabase);
+
+    // Search file @p_fileName with meta data @p_meta, which will be updated.
+    VSearchResultItem *searchFile(const QString &p_fileName, VFileMeta &p_meta);
+
+    // @p_onDisk: whether @p_reader reads the file on disk rather than a buffer.
+    // @p_lineCount: set to the number of lines if the whole content is read.
+    VSearchResultItem *searchReader(VChunkedLineReader &p_reader,
+                                    const QString &p_fileName,
+                                    bool p_onDisk,
+                                    int *p_lineCount = NULL);
 
     void postAndClearResults();
 
-    QAtomicInt m_stop;
+    VSearchEngine *m_engine;
 
-    QStringList m_files;
+    QAtomicInt m_stop;
 
     VSearchToken m_token;
 
+    // Contents to search instead of reading the files.
+    QHash<QString, QString> m_contents;
+
+    VFileMetaCache *m_metaCache;
+
+    // Max number of matched lines of one file. Stop searching the file if reached.
+    int m_maxMatchesPerFile;
+
     VSearchState m_state;
 
     QString m_error;
@@ -53,6 +92,11 @@ private:
     QList<QSharedPointer<VSearchResultItem> > m_results;
 };
 
+inline void VSearchEngineWorker::setMaxMatchesPerFile(int p_max)
+{
+    m_maxMatchesPerFile = p_max;
+}
+
 inline void VSearchEngineWorker::appendError(const QString &p_err)
 {
     if (m_error.isEmpty()) {
@@ -71,22 +115,70 @@ public:
 
     ~VSearchEngine();
 
-    void search(const QSharedPointer<VSearchConfig> &p_config,
-                const QSharedPointer<VSearchResult> &p_result) Q_DECL_OVERRIDE;
+    void start(const QSharedPointer<VSearchConfig> &p_config,
+               const QSharedPointer<VSearchResult> &p_result) Q_DECL_OVERRIDE;
+
+    void addItems(const QStringList &p_items, int p_stream = 0) Q_DECL_OVERRIDE;
+
+    void stopStream(int p_stream) Q_DECL_OVERRIDE;
+
+    void finishItems() Q_DECL_OVERRIDE;
 
     void stop() Q_DECL_OVERRIDE;
 
     void clear() Q_DECL_OVERRIDE;
 
+    // Called by workers to take items of one stream to search.
+    // Block until there are items in the queue.
+    // Returns false if there is no more items or the engine is stopped.
+    bool takeItems(QStringList &p_items, int &p_stream);
+
+    // Called by workers.
+    bool isStreamStopped(int p_stream);
+
 private slots:
     void handleWorkerFinished();
 
 private:
     void clearAllWorkers();
 
+    // Queue of items of one stream.
+    struct Stream
+    {
+        Stream()
+            : m_stopped(false)
+        {
+        }
+
+        QStringList m_queue;
+
+        bool m_stopped;
+    };
+
+    // Wake up workers waiting for items and let them quit.
+    void closeQueue(bool p_stop);
+
+    // Returns -1 if there is no pending item.
+    int nextStreamToServe() const;
+
     int m_finishedWorkers;
 
     QVector<VSearchEngineWorker *> m_workers;
+
+    // Protect the queues below which are shared with workers.
+    QMutex m_mutex;
+
+    QWaitCondition m_queueCond;
+
+    // Indexed by the stream id.
+    QVector<Stream> m_streams;
+
+    // Stream to serve next in turn.
+    int m_nextStream;
+
+    bool m_noMoreItems;
+
+    bool m_stopped;
 };
 
 #endif // VSEARCHENGINE_H
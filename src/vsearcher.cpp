@@ -24,6 +24,9 @@ extern VNote *g_vnote;
 
 extern VConfigManager *g_config;
 
+// Interval in ms to update the progress of notebooks.
+#define PROGRESS_UPDATE_INTERVAL 200
+
 VSearcher::VSearcher(QWidget *p_parent)
     : QWidget(p_parent),
       m_initialized(false),
@@ -193,8 +196,47 @@ void VSearcher::setupUI()
                 }
             });
 
+    // Skip notebook button.
+    m_skipBtn = new QPushButton(VIconUtils::buttonIcon(":/resources/icons/notebook.svg"),
+                                "",
+                                this);
+    m_skipBtn->setToolTip(tr("Skip Notebook"));
+    m_skipBtn->setProperty("FlatBtn", true);
+    QMenu *skipMenu = new QMenu(this);
+    connect(skipMenu, &QMenu::aboutToShow,
+            this, [this, skipMenu]() {
+                skipMenu->clear();
+                const QVector<VSearch::NotebookProgress> &pros = m_search.getNotebookProgress();
+                for (int i = 0; i < pros.size(); ++i) {
+                    const VSearch::NotebookProgress &pro = pros[i];
+                    if (pro.isFinished()) {
+                        continue;
+                    }
+
+                    QString name = pro.m_name;
+                    QAction *act = skipMenu->addAction(tr("%1 (%2/%3)").arg(name)
+                                                                       .arg(pro.m_numOfSearchedItems)
+                                                                       .arg(pro.m_numOfItems));
+                    connect(act, &QAction::triggered,
+                            this, [this, i, name]() {
+                                if (m_inSearch) {
+                                    appendLogLine(tr("Skip notebook %1.").arg(name));
+                                    m_search.stopNotebook(i);
+                                }
+                            });
+                }
+            });
+    m_skipBtn->setMenu(skipMenu);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setSingleShot(true);
+    m_progressTimer->setInterval(PROGRESS_UPDATE_INTERVAL);
+    connect(m_progressTimer, &QTimer::timeout,
+            this, &VSearcher::updateNotebookProgress);
+
     QHBoxLayout *proLayout = new QHBoxLayout();
     proLayout->addWidget(m_proBar);
+    proLayout->addWidget(m_skipBtn);
     proLayout->addWidget(m_cancelBtn);
     proLayout->setContentsMargins(0, 0, 0, 0);
 
@@ -293,6 +335,61 @@ void VSearcher::setProgressVisible(bool p_visible)
 {
     m_proBar->setVisible(p_visible);
     m_cancelBtn->setVisible(p_visible);
+
+    if (!p_visible) {
+        m_skipBtn->setVisible(false);
+    }
+}
+
+void VSearcher::updateNotebookProgress()
+{
+    const QVector<VSearch::NotebookProgress> &pros = m_search.getNotebookProgress();
+    if (!m_inSearch || pros.isEmpty()) {
+        return;
+    }
+
+    int total = 0;
+    int searched = 0;
+    int finished = 0;
+    QStringList lines;
+    for (auto const & pro : pros) {
+        total += pro.m_numOfItems;
+        if (pro.m_cancelled) {
+            searched += pro.m_numOfItems;
+        } else {
+            searched += qMin(pro.m_numOfSearchedItems, pro.m_numOfItems);
+        }
+
+        QString state;
+        if (pro.m_cancelled) {
+            state = tr("skipped");
+        } else if (pro.isFinished()) {
+            state = tr("done");
+        } else if (!pro.m_traversed) {
+            state = tr("collecting");
+        } else {
+            state = tr("searching");
+        }
+
+        if (pro.isFinished()) {
+            ++finished;
+        }
+
+        lines << tr("%1: %2/%3 notes, %4").arg(pro.m_name)
+                                          .arg(pro.m_numOfSearchedItems)
+                                          .arg(pro.m_numOfItems)
+                                          .arg(state);
+    }
+
+    if (total > 0) {
+        m_proBar->setRange(0, total);
+        m_proBar->setValue(searched);
+    }
+
+    m_proBar->setFormat(tr("%1/%2 notebooks").arg(finished).arg(pros.size()));
+    m_proBar->setToolTip(lines.join('\n'));
+
+    m_skipBtn->setVisible(pros.size() > 1 && finished < pros.size());
 }
 
 void VSearcher::appendLogLine(const QString &p_text)
@@ -328,14 +425,6 @@ void VSearcher::handleInputChanged()
             readyToSearch = false;
         }
 
-        if (readyToSearch
-            && obj == VSearchConfig::Outline
-            && scope != VSearchConfig::CurrentNotebook
-            && scope != VSearchConfig::OpenedNotes) {
-            // Outline is available only for CurrentNote and OpenedNotes.
-            readyToSearch = false;
-        }
-
         if (readyToSearch && scope == VSearchConfig::ExplorerDirectory) {
             if (!(obj & VSearchConfig::Name)
                 && !(obj & VSearchConfig::Path)
@@ -358,6 +447,9 @@ void VSearcher::startSearch()
     }
 
     m_searchBtn->setEnabled(false);
+    m_proBar->setRange(0, 0);
+    m_proBar->setFormat("%p%");
+    m_proBar->setToolTip("");
     setProgressVisible(true);
     m_results->clearResults();
     m_askedToStop = false;
@@ -613,6 +705,12 @@ void VSearcher::init()
             });
     connect(&m_search, &VSearch::finished,
             this, &VSearcher::handleSearchFinished);
+    connect(&m_search, &VSearch::notebookProgressChanged,
+            this, [this]() {
+                if (!m_progressTimer->isActive()) {
+                    m_progressTimer->start();
+                }
+            });
 }
 
 void VSearcher::showEvent(QShowEvent *p_event)
@@ -15,6 +15,7 @@ class QLabel;
 class VSearchResultTree;
 class QProgressBar;
 class QPlainTextEdit;
+class QTimer;
 class QShowEvent;
 
 class VSearcher : public QWidget, public VNavigationMode
@@ -35,6 +36,9 @@ protected:
 private slots:
     void handleSearchFinished(const QSharedPointer<VSearchResult> &p_result);
 
+    // Show the progress of each notebook of current search.
+    void updateNotebookProgress();
+
 private:
     void startSearch();
 
@@ -102,6 +106,11 @@ private:
 
     QPushButton *m_cancelBtn;
 
+    // Skip one notebook of current search.
+    QPushButton *m_skipBtn;
+
+    QTimer *m_progressTimer;
+
     QPlainTextEdit *m_consoleEdit;
 
     bool m_initialized;
@@ -0,0 +1,341 @@
+#include "vsearchresultmodel.h"
+
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QTextCodec>
+#include <QDebug>
+
+#include "utils/vchunkedlinereader.h"
+
+// Number of matches to fetch each time an item asks for more children.
+#define FETCH_BATCH_SIZE 200
+
+// Max number of lines read from the files to keep.
+#define LINE_CACHE_SIZE 2000
+
+// Max length in chars of the text shown for a matched line.
+#define MAX_LINE_TEXT_LENGTH 1024
+
+VSearchResultModel::VSearchResultModel(QObject *p_parent)
+    : QAbstractItemModel(p_parent),
+      m_lineCache(LINE_CACHE_SIZE)
+{
+}
+
+// For top level items, internal id is 0.
+// For matches, internal id is the row of its parent item plus 1.
+QModelIndex VSearchResultModel::index(int p_row,
+                                      int p_column,
+                                      const QModelIndex &p_parent) const
+{
+    if (p_row < 0 || p_column != 0) {
+        return QModelIndex();
+    }
+
+    if (!p_parent.isValid()) {
+        if (p_row >= m_entries.size()) {
+            return QModelIndex();
+        }
+
+        return createIndex(p_row, p_column, quintptr(0));
+    }
+
+    if (p_parent.internalId() != 0) {
+        // Matches have no children.
+        return QModelIndex();
+    }
+
+    int parentRow = p_parent.row();
+    if (parentRow >= m_entries.size() || p_row >= m_entries[parentRow].m_fetchedCount) {
+        return QModelIndex();
+    }
+
+    return createIndex(p_row, p_column, quintptr(parentRow + 1));
+}
+
+QModelIndex VSearchResultModel::parent(const QModelIndex &p_index) const
+{
+    if (!p_index.isValid() || p_index.internalId() == 0) {
+        return QModelIndex();
+    }
+
+    return createIndex(int(p_index.internalId() - 1), 0, quintptr(0));
+}
+
+int VSearchResultModel::rowCount(const QModelIndex &p_parent) const
+{
+    if (!p_parent.isValid()) {
+        return m_entries.size();
+    }
+
+    if (p_parent.internalId() != 0 || p_parent.column() != 0) {
+        return 0;
+    }
+
+    return m_entries[p_parent.row()].m_fetchedCount;
+}
+
+int VSearchResultModel::columnCount(const QModelIndex &p_parent) const
+{
+    Q_UNUSED(p_parent);
+    return 1;
+}
+
+bool VSearchResultModel::hasChildren(const QModelIndex &p_parent) const
+{
+    if (!p_parent.isValid()) {
+        return !m_entries.isEmpty();
+    }
+
+    if (p_parent.internalId() != 0) {
+        return false;
+    }
+
+    return m_entries[p_parent.row()].m_matchCount > 0;
+}
+
+bool VSearchResultModel::canFetchMore(const QModelIndex &p_parent) const
+{
+    if (!p_parent.isValid() || p_parent.internalId() != 0) {
+        return false;
+    }
+
+    const Entry &entry = m_entries[p_parent.row()];
+    return entry.m_fetchedCount < entry.m_matchCount;
+}
+
+void VSearchResultModel::fetchMore(const QModelIndex &p_parent)
+{
+    if (!canFetchMore(p_parent)) {
+        return;
+    }
+
+    Entry &entry = m_entries[p_parent.row()];
+    int cnt = qMin(FETCH_BATCH_SIZE, entry.m_matchCount - entry.m_fetchedCount);
+    beginInsertRows(p_parent, entry.m_fetchedCount, entry.m_fetchedCount + cnt - 1);
+    entry.m_fetchedCount += cnt;
+    endInsertRows();
+}
+
+QVariant VSearchResultModel::data(const QModelIndex &p_index, int p_role) const
+{
+    if (!p_index.isValid()) {
+        return QVariant();
+    }
+
+    const Entry &entry = m_entries[entryRow(p_index)];
+    if (p_index.internalId() == 0) {
+        switch (p_role) {
+        case Qt::DisplayRole:
+            return entry.m_text.isEmpty() ? entry.m_path : entry.m_text;
+
+        case Qt::ToolTipRole:
+            return entry.m_path;
+
+        case Qt::DecorationRole:
+            switch (entry.m_type) {
+            case VSearchResultItem::Note:
+                return m_noteIcon;
+
+            case VSearchResultItem::Folder:
+                return m_folderIcon;
+
+            case VSearchResultItem::Notebook:
+                return m_notebookIcon;
+
+            default:
+                break;
+            }
+
+            break;
+
+        default:
+            break;
+        }
+
+        return QVariant();
+    }
+
+    // Match item, rendered only when it is requested by the view.
+    int idx = entry.m_matchStart + p_index.row();
+    switch (p_role) {
+    case Qt::DisplayRole:
+    {
+        QString text = matchText(entryRow(p_index), idx);
+        if (m_matches[idx].m_lineNumber > -1) {
+            return QString("[%1] %2").arg(m_matches[idx].m_lineNumber).arg(text);
+        }
+
+        return text;
+    }
+
+    case Qt::ToolTipRole:
+        return matchText(entryRow(p_index), idx);
+
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+QString VSearchResultModel::matchText(int p_row, int p_match) const
+{
+    const Match &match = m_matches[p_match];
+    if (match.m_column < 0) {
+        return match.m_text;
+    }
+
+    if (!m_lineCache.contains(p_match)) {
+        readMatchLines(p_row, p_match);
+    }
+
+    QString *line = m_lineCache.object(p_match);
+    return line ? *line : QString();
+}
+
+void VSearchResultModel::readMatchLines(int p_row, int p_match) const
+{
+    const Entry &entry = m_entries[p_row];
+
+    // Read the lines of the matches around in one pass, which are likely to
+    // be shown together.
+    int first = qMax(entry.m_matchStart, p_match - FETCH_BATCH_SIZE);
+    int last = qMin(entry.m_matchStart + entry.m_fetchedCount, p_match + FETCH_BATCH_SIZE);
+    QHash<int, QList<int> > matchesOfLine;
+    int lastLine = 0;
+    for (int i = first; i < last; ++i) {
+        const Match &match = m_matches[i];
+        if (match.m_column >= 0 && !m_lineCache.contains(i)) {
+            matchesOfLine[match.m_lineNumber].append(i);
+            lastLine = qMax(lastLine, match.m_lineNumber);
+        }
+    }
+
+    if (matchesOfLine.isEmpty()) {
+        return;
+    }
+
+    QHash<int, QString> texts;
+    QFile file(entry.m_path);
+    if (file.open(QIODevice::ReadOnly)) {
+        QTextCodec *codec = QTextCodec::codecForUtfText(file.peek(4),
+                                                        QTextCodec::codecForName("UTF-8"));
+        VChunkedLineReader reader(&file, codec);
+        reader.setMaxLineLength(MAX_LINE_TEXT_LENGTH, 0);
+
+        // Segments of a long line are collected from the column of each match.
+        QString segment;
+        int lineNum = 0;
+        while (reader.readLine(segment, lineNum) && lineNum <= lastLine) {
+            auto it = matchesOfLine.constFind(lineNum);
+            if (it == matchesOfLine.constEnd()) {
+                continue;
+            }
+
+            int segStart = reader.column();
+            int segEnd = segStart + segment.size();
+            for (auto idx : it.value()) {
+                int column = m_matches[idx].m_column;
+                if (segEnd <= column || segStart >= column + MAX_LINE_TEXT_LENGTH) {
+                    continue;
+                }
+
+                QString &text = texts[idx];
+                int from = qMax(column - segStart, 0);
+                int len = column + MAX_LINE_TEXT_LENGTH - segStart - from;
+                text.append(segment.mid(from, len));
+            }
+        }
+    } else {
+        qWarning() << "fail to read search result" << entry.m_path << file.errorString();
+    }
+
+    // Cache empty text too so a missing file is not read for each row.
+    for (auto it = matchesOfLine.constBegin(); it != matchesOfLine.constEnd(); ++it) {
+        for (auto idx : it.value()) {
+            m_lineCache.insert(idx, new QString(texts.value(idx)));
+        }
+    }
+}
+
+void VSearchResultModel::appendItems(const QList<QSharedPointer<VSearchResultItem> > &p_items)
+{
+    if (p_items.isEmpty()) {
+        return;
+    }
+
+    int first = m_entries.size();
+    beginInsertRows(QModelIndex(), first, first + p_items.size() - 1);
+    m_entries.reserve(first + p_items.size());
+    for (auto const & it : p_items) {
+        Entry entry;
+        entry.m_type = it->m_type;
+        entry.m_text = it->m_text;
+        entry.m_path = it->m_path;
+        entry.m_matchStart = m_matches.size();
+        entry.m_matchCount = it->m_matches.size();
+
+        for (auto const & sitem : it->m_matches) {
+            Match match;
+            match.m_lineNumber = sitem.m_lineNumber;
+            match.m_column = sitem.m_column;
+            if (match.m_column < 0) {
+                match.m_text = sitem.m_text;
+            }
+
+            m_matches.append(match);
+        }
+
+        m_entries.append(entry);
+    }
+
+    endInsertRows();
+}
+
+void VSearchResultModel::clear()
+{
+    beginResetModel();
+    m_entries.clear();
+    m_matches.clear();
+    m_lineCache.clear();
+    endResetModel();
+}
+
+VSearchResultItem::ItemType VSearchResultModel::itemType(const QModelIndex &p_index) const
+{
+    if (!p_index.isValid()) {
+        return VSearchResultItem::None;
+    }
+
+    return m_entries[entryRow(p_index)].m_type;
+}
+
+QString VSearchResultModel::itemPath(const QModelIndex &p_index) const
+{
+    if (!p_index.isValid()) {
+        return QString();
+    }
+
+    return m_entries[entryRow(p_index)].m_path;
+}
+
+void VSearchResultModel::setIcons(const QIcon &p_noteIcon,
+                                  const QIcon &p_folderIcon,
+                                  const QIcon &p_notebookIcon)
+{
+    m_noteIcon = p_noteIcon;
+    m_folderIcon = p_folderIcon;
+    m_notebookIcon = p_notebookIcon;
+}
+
+int VSearchResultModel::entryRow(const QModelIndex &p_index) const
+{
+    Q_ASSERT(p_index.isValid());
+    if (p_index.internalId() == 0) {
+        return p_index.row();
+    }
+
+    return int(p_index.internalId() - 1);
+}
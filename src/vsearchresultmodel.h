@@ -0,0 +1,130 @@
+#ifndef VSEARCHRESULTMODEL_H
+#define VSEARCHRESULTMODEL_H
+
+#include <QAbstractItemModel>
+#include <QVector>
+#include <QIcon>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QCache>
+
+#include "vsearchconfig.h"
+
+// Model of search results used by VSearchResultTree.
+// Results are kept in compact arrays: one entry for each result item and one
+// match for each matched line. A matched line of a file on disk keeps only
+// its position, and is read from the file when it is shown.
+// Matches of an item are fetched lazily when the item is expanded.
+class VSearchResultModel : public QAbstractItemModel
+{
+    Q_OBJECT
+public:
+    explicit VSearchResultModel(QObject *p_parent = nullptr);
+
+    QModelIndex index(int p_row,
+                      int p_column,
+                      const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+    QModelIndex parent(const QModelIndex &p_index) const Q_DECL_OVERRIDE;
+
+    int rowCount(const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+    int columnCount(const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+    bool hasChildren(const QModelIndex &p_parent = QModelIndex()) const Q_DECL_OVERRIDE;
+
+    QVariant data(const QModelIndex &p_index, int p_role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
+
+    bool canFetchMore(const QModelIndex &p_parent) const Q_DECL_OVERRIDE;
+
+    void fetchMore(const QModelIndex &p_parent) Q_DECL_OVERRIDE;
+
+    void appendItems(const QList<QSharedPointer<VSearchResultItem> > &p_items);
+
+    void clear();
+
+    // Number of result items, not including matches.
+    int itemCount() const;
+
+    // Type of the result item @p_index belongs to.
+    VSearchResultItem::ItemType itemType(const QModelIndex &p_index) const;
+
+    // Path of the result item @p_index belongs to.
+    QString itemPath(const QModelIndex &p_index) const;
+
+    void setIcons(const QIcon &p_noteIcon,
+                  const QIcon &p_folderIcon,
+                  const QIcon &p_notebookIcon);
+
+private:
+    struct Entry
+    {
+        Entry()
+            : m_type(VSearchResultItem::None),
+              m_matchStart(0),
+              m_matchCount(0),
+              m_fetchedCount(0)
+        {
+        }
+
+        VSearchResultItem::ItemType m_type;
+
+        QString m_text;
+
+        QString m_path;
+
+        // Matches of this entry are [m_matchStart, m_matchStart + m_matchCount)
+        // in m_matches.
+        int m_matchStart;
+
+        int m_matchCount;
+
+        // Number of matches exposed as children.
+        int m_fetchedCount;
+    };
+
+    struct Match
+    {
+        Match()
+            : m_lineNumber(-1),
+              m_column(-1)
+        {
+        }
+
+        int m_lineNumber;
+
+        // Offset of the matched text within the line, or -1 if @m_text is kept.
+        int m_column;
+
+        // Text kept when it could not be read from the file again.
+        QString m_text;
+    };
+
+    // Return the row of the entry @p_index belongs to.
+    int entryRow(const QModelIndex &p_index) const;
+
+    // Text of match @p_match of entry @p_row, read from the file if needed.
+    QString matchText(int p_row, int p_match) const;
+
+    // Read the lines of the fetched matches of entry @p_row around match
+    // @p_match which are not cached yet.
+    void readMatchLines(int p_row, int p_match) const;
+
+    QVector<Entry> m_entries;
+
+    // Matches of all the entries.
+    QVector<Match> m_matches;
+
+    // Lines read from the files, keyed by the index in m_matches.
+    mutable QCache<int, QString> m_lineCache;
+
+    QIcon m_noteIcon;
+    QIcon m_folderIcon;
+    QIcon m_notebookIcon;
+};
+
+inline int VSearchResultModel::itemCount() const
+{
+    return m_entries.size();
+}
+#endif // VSEARCHRESULTMODEL_H
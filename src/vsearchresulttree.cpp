@@ -2,40 +2,71 @@
 
 #include <QAction>
 #include <QMenu>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QSet>
 
 #include "utils/vutils.h"
 #include "utils/viconutils.h"
+#include "utils/vimnavigationforwidget.h"
 #include "vnote.h"
 #include "vmainwindow.h"
 #include "vnotefile.h"
 #include "vcart.h"
 #include "vhistorylist.h"
 #include "vexplorer.h"
+#include "vsearchresultmodel.h"
+#include "vstyleditemdelegate.h"
 
 extern VNote *g_vnote;
 
 extern VMainWindow *g_mainWin;
 
+// Hit items of simple search are top level rows encoded as row plus 1.
+static void *rowToHitItem(int p_row)
+{
+    return reinterpret_cast<void *>(static_cast<quintptr>(p_row + 1));
+}
+
+static int hitItemToRow(void *p_item)
+{
+    return static_cast<int>(reinterpret_cast<quintptr>(p_item)) - 1;
+}
+
 VSearchResultTree::VSearchResultTree(QWidget *p_parent)
-    : VTreeWidget(p_parent)
+    : QTreeView(p_parent),
+      ISimpleSearch()
 {
-    setColumnCount(1);
+    setAttribute(Qt::WA_MacShowFocusRect, false);
     setHeaderHidden(true);
     setExpandsOnDoubleClick(false);
+    setUniformRowHeights(true);
     setContextMenuPolicy(Qt::CustomContextMenu);
     setSelectionMode(QAbstractItemView::ExtendedSelection);
 
-    setSimpleSearchMatchFlags(getSimpleSearchMatchFlags() & ~Qt::MatchRecursive);
-
     m_noteIcon = VIconUtils::treeViewIcon(":/resources/icons/note_item.svg");
     m_folderIcon = VIconUtils::treeViewIcon(":/resources/icons/dir_item.svg");
     m_notebookIcon = VIconUtils::treeViewIcon(":/resources/icons/notebook_item.svg");
 
+    m_model = new VSearchResultModel(this);
+    m_model->setIcons(m_noteIcon, m_folderIcon, m_notebookIcon);
+    setModel(m_model);
+
+    m_delegate = new VStyledItemDelegate(NULL, NULL);
+    m_delegate->setParent(this);
+    setItemDelegate(m_delegate);
+
+    m_searchInput = new VSimpleSearchInput(this, this);
+    m_searchInput->setMatchFlags(m_searchInput->getMatchFlags() & ~Qt::MatchRecursive);
+    connect(m_searchInput, &VSimpleSearchInput::triggered,
+            this, &VSearchResultTree::handleSearchModeTriggered);
+    m_searchInput->hide();
+
     initActions();
 
-    connect(this, &VTreeWidget::itemActivated,
+    connect(this, &QTreeView::activated,
             this, &VSearchResultTree::activateItem);
-    connect(this, &VTreeWidget::customContextMenuRequested,
+    connect(this, &QTreeView::customContextMenuRequested,
             this, &VSearchResultTree::handleContextMenuRequested);
 }
 
@@ -45,7 +76,7 @@ void VSearchResultTree::initActions()
     m_openAct->setToolTip(tr("Open selected notes"));
     connect(m_openAct, &QAction::triggered,
             this, [this]() {
-                activateItem(currentItem());
+                activateItem(currentIndex());
             });
 
     m_locateAct = new QAction(VIconUtils::menuIcon(":/resources/icons/locate_note.svg"),
@@ -74,99 +105,200 @@ void VSearchResultTree::updateResults(const QList<QSharedPointer<VSearchResultIt
 {
     clearResults();
 
-    for (auto const & it : p_items) {
-        appendItem(it);
-    }
+    m_model->appendItems(p_items);
 
-    emit countChanged(topLevelItemCount());
+    emit countChanged(m_model->itemCount());
 }
 
 void VSearchResultTree::addResultItem(const QSharedPointer<VSearchResultItem> &p_item)
 {
-    appendItem(p_item);
+    QList<QSharedPointer<VSearchResultItem> > items;
+    items.append(p_item);
+    m_model->appendItems(items);
 
-    emit countChanged(topLevelItemCount());
+    emit countChanged(m_model->itemCount());
 }
 
 void VSearchResultTree::addResultItems(const QList<QSharedPointer<VSearchResultItem> > &p_items)
 {
-    for (auto const & it : p_items) {
-        appendItem(it);
-    }
+    m_model->appendItems(p_items);
 
-    emit countChanged(topLevelItemCount());
+    emit countChanged(m_model->itemCount());
 }
 
 void VSearchResultTree::clearResults()
 {
-    clearAll();
+    m_searchInput->clear();
+    setSearchInputVisible(false);
 
-    m_data.clear();
+    m_model->clear();
 
-    emit countChanged(topLevelItemCount());
+    emit countChanged(m_model->itemCount());
 }
 
-void VSearchResultTree::appendItem(const QSharedPointer<VSearchResultItem> &p_item)
+void VSearchResultTree::keyPressEvent(QKeyEvent *p_event)
 {
-    m_data.append(p_item);
+    if (m_searchInput->tryHandleKeyPressEvent(p_event)) {
+        return;
+    }
 
-    QTreeWidgetItem *item = new QTreeWidgetItem(this);
-    item->setData(0, Qt::UserRole, m_data.size() - 1);
-    item->setText(0, p_item->m_text.isEmpty() ? p_item->m_path : p_item->m_text);
-    item->setToolTip(0, p_item->m_path);
+    if (VimNavigationForWidget::injectKeyPressEventForVim(this, p_event)) {
+        return;
+    }
 
-    switch (p_item->m_type) {
-    case VSearchResultItem::Note:
-        item->setIcon(0, m_noteIcon);
-        break;
+    QTreeView::keyPressEvent(p_event);
+}
 
-    case VSearchResultItem::Folder:
-        item->setIcon(0, m_folderIcon);
-        break;
+void VSearchResultTree::resizeEvent(QResizeEvent *p_event)
+{
+    QTreeView::resizeEvent(p_event);
 
-    case VSearchResultItem::Notebook:
-        item->setIcon(0, m_notebookIcon);
-        break;
+    QRect rect = contentsRect();
+    int width = rect.width();
+    QScrollBar *vbar = verticalScrollBar();
+    if (vbar && (vbar->minimum() != vbar->maximum())) {
+        width -= vbar->width();
+    }
 
-    default:
-        break;
+    int y = rect.bottom() - m_searchInput->height();
+    QScrollBar *hbar = horizontalScrollBar();
+    if (hbar && (hbar->minimum() != hbar->maximum())) {
+        y -= hbar->height();
     }
 
-    for (auto const & it: p_item->m_matches) {
-        QTreeWidgetItem *subItem = new QTreeWidgetItem(item);
-        QString text;
-        if (it.m_lineNumber > -1) {
-            text = QString("[%1] %2").arg(it.m_lineNumber).arg(it.m_text);
-        } else {
-            text = it.m_text;
+    m_searchInput->setGeometry(QRect(rect.left(),
+                                     y,
+                                     width,
+                                     m_searchInput->height()));
+}
+
+void VSearchResultTree::setSearchInputVisible(bool p_visible)
+{
+    m_searchInput->setVisible(p_visible);
+
+    int bottomMargin = 0;
+    if (p_visible) {
+        bottomMargin = m_searchInput->height();
+    }
+
+    setViewportMargins(0, 0, 0, bottomMargin);
+}
+
+void VSearchResultTree::handleSearchModeTriggered(bool p_inSearchMode, bool p_focus)
+{
+    if (p_focus) {
+        setFocus();
+    }
+
+    setSearchInputVisible(p_inSearchMode);
+    if (!p_inSearchMode) {
+        clearItemsHighlight();
+    }
+}
+
+QList<void *> VSearchResultTree::searchItems(const QString &p_text,
+                                             Qt::MatchFlags p_flags) const
+{
+    QList<void *> res;
+    if (m_model->itemCount() == 0) {
+        return res;
+    }
+
+    QModelIndexList indexes = m_model->match(m_model->index(0, 0),
+                                             Qt::DisplayRole,
+                                             p_text,
+                                             -1,
+                                             p_flags & ~Qt::MatchRecursive);
+    res.reserve(indexes.size());
+    for (auto const & index : indexes) {
+        res.append(rowToHitItem(index.row()));
+    }
+
+    return res;
+}
+
+void VSearchResultTree::highlightHitItems(const QList<void *> &p_items)
+{
+    clearItemsHighlight();
+
+    QSet<QModelIndex> hitIndexes;
+    for (auto it : p_items) {
+        QModelIndex index = m_model->index(hitItemToRow(it), 0);
+        if (index.isValid()) {
+            hitIndexes.insert(index);
         }
+    }
+
+    if (!hitIndexes.isEmpty()) {
+        m_delegate->setHitItems(hitIndexes);
+        viewport()->update();
+    }
+}
+
+void VSearchResultTree::clearItemsHighlight()
+{
+    m_delegate->clearHitItems();
+    viewport()->update();
+}
+
+void VSearchResultTree::selectHitItem(void *p_item)
+{
+    if (!p_item) {
+        clearSelection();
+        return;
+    }
+
+    QModelIndex index = m_model->index(hitItemToRow(p_item), 0);
+    if (index.isValid()) {
+        selectionModel()->setCurrentIndex(index, QItemSelectionModel::ClearAndSelect);
+    }
+}
+
+int VSearchResultTree::totalNumberOfItems()
+{
+    return m_model->itemCount();
+}
+
+void VSearchResultTree::selectNextItem(bool p_forward)
+{
+    if (m_model->itemCount() == 0) {
+        return;
+    }
+
+    QModelIndex index = currentIndex();
+    if (!index.isValid()) {
+        selectionModel()->setCurrentIndex(m_model->index(0, 0),
+                                          QItemSelectionModel::ClearAndSelect);
+        return;
+    }
 
-        subItem->setText(0, text);
-        subItem->setToolTip(0, it.m_text);
+    QModelIndex nIndex = p_forward ? indexBelow(index) : indexAbove(index);
+    if (nIndex.isValid()) {
+        selectionModel()->setCurrentIndex(nIndex, QItemSelectionModel::ClearAndSelect);
     }
 }
 
 void VSearchResultTree::handleContextMenuRequested(QPoint p_pos)
 {
-    QTreeWidgetItem *item = itemAt(p_pos);
-    if (!item) {
+    QModelIndex index = indexAt(p_pos);
+    if (!index.isValid()) {
         return;
     }
 
     QMenu menu(this);
     menu.setToolTipsVisible(true);
 
-    QList<QTreeWidgetItem *> items = selectedItems();
+    QModelIndexList indexes = selectionModel()->selectedIndexes();
 
     bool hasNote = false;
-    for (auto const & it : items) {
-        if (itemResultType(it) == VSearchResultItem::Note) {
+    for (auto const & it : indexes) {
+        if (m_model->itemType(it) == VSearchResultItem::Note) {
             hasNote = true;
             break;
         }
     }
 
-    if (items.size() == 1) {
+    if (indexes.size() == 1) {
         menu.addAction(m_openAct);
 
         if (hasNote) {
@@ -184,34 +316,44 @@ void VSearchResultTree::handleContextMenuRequested(QPoint p_pos)
 
 void VSearchResultTree::locateCurrentItem()
 {
-    auto item =  currentItem();
-    if (!item) {
+    QModelIndex index = currentIndex();
+    if (!index.isValid()) {
         return;
     }
 
-    const QSharedPointer<VSearchResultItem> &resItem = itemResultData(item);
-    if (resItem->m_type == VSearchResultItem::Note) {
-        VFile *file = g_vnote->getInternalFile(resItem->m_path);
+    if (m_model->itemType(index) == VSearchResultItem::Note) {
+        VFile *file = g_vnote->getInternalFile(m_model->itemPath(index));
         if (file) {
             g_mainWin->locateFile(file);
         }
     }
 }
 
+QStringList VSearchResultTree::selectedNotes() const
+{
+    QStringList files;
+    QModelIndexList indexes = selectionModel()->selectedIndexes();
+    for (auto const & it : indexes) {
+        if (m_model->itemType(it) == VSearchResultItem::Note) {
+            QString path = m_model->itemPath(it);
+            if (!files.contains(path)) {
+                files << path;
+            }
+        }
+    }
+
+    return files;
+}
+
 void VSearchResultTree::addSelectedItemsToCart()
 {
-    QList<QTreeWidgetItem *> items = selectedItems();
+    QStringList files = selectedNotes();
     VCart *cart = g_mainWin->getCart();
-
-    int nrAdded = 0;
-    for (int i = 0; i < items.size(); ++i) {
-        const QSharedPointer<VSearchResultItem> &resItem = itemResultData(items[i]);
-        if (resItem->m_type == VSearchResultItem::Note) {
-            cart->addFile(resItem->m_path);
-            ++nrAdded;
-        }
+    for (auto const & file : files) {
+        cart->addFile(file);
     }
 
+    int nrAdded = files.size();
     if (nrAdded) {
         g_mainWin->showStatusMessage(tr("%1 %2 added to Cart")
                                        .arg(nrAdded)
@@ -221,15 +363,7 @@ void VSearchResultTree::addSelectedItemsToCart()
 
 void VSearchResultTree::pinSelectedItemsToHistory()
 {
-    QList<QTreeWidgetItem *> items = selectedItems();
-    QStringList files;
-    for (int i = 0; i < items.size(); ++i) {
-        const QSharedPointer<VSearchResultItem> &resItem = itemResultData(items[i]);
-        if (resItem->m_type == VSearchResultItem::Note) {
-            files << resItem->m_path;
-        }
-    }
-
+    QStringList files = selectedNotes();
     if (!files.isEmpty()) {
         g_mainWin->getHistoryList()->pinFiles(files);
         g_mainWin->showStatusMessage(tr("%1 %2 pinned to History")
@@ -238,45 +372,30 @@ void VSearchResultTree::pinSelectedItemsToHistory()
     }
 }
 
-VSearchResultItem::ItemType VSearchResultTree::itemResultType(const QTreeWidgetItem *p_item) const
-{
-    Q_ASSERT(p_item);
-    return itemResultData(p_item)->m_type;
-}
-
-const QSharedPointer<VSearchResultItem> &VSearchResultTree::itemResultData(const QTreeWidgetItem *p_item) const
-{
-    Q_ASSERT(p_item);
-    const QTreeWidgetItem *topItem = VUtils::topLevelTreeItem(p_item);
-    int idx = topItem->data(0, Qt::UserRole).toInt();
-    Q_ASSERT(idx >= 0 && idx < m_data.size());
-    return m_data[idx];
-}
-
-void VSearchResultTree::activateItem(const QTreeWidgetItem *p_item) const
+void VSearchResultTree::activateItem(const QModelIndex &p_index) const
 {
-    if (!p_item) {
+    if (!p_index.isValid()) {
         return;
     }
 
-    const QSharedPointer<VSearchResultItem> &resItem = itemResultData(p_item);
-    switch (resItem->m_type) {
+    QString path = m_model->itemPath(p_index);
+    switch (m_model->itemType(p_index)) {
     case VSearchResultItem::Note:
     {
-        QStringList files(resItem->m_path);
+        QStringList files(path);
         g_mainWin->openFiles(files);
         break;
     }
 
     case VSearchResultItem::Folder:
     {
-        VDirectory *dir = g_vnote->getInternalDirectory(resItem->m_path);
+        VDirectory *dir = g_vnote->getInternalDirectory(path);
         if (dir) {
             g_mainWin->locateDirectory(dir);
         } else {
             // External directory.
             g_mainWin->showExplorerPanel(true);
-            g_mainWin->getExplorer()->setRootDirectory(resItem->m_path);
+            g_mainWin->getExplorer()->setRootDirectory(path);
         }
 
         break;
@@ -284,7 +403,7 @@ void VSearchResultTree::activateItem(const QTreeWidgetItem *p_item) const
 
     case VSearchResultItem::Notebook:
     {
-        VNotebook *nb = g_vnote->getNotebook(resItem->m_path);
+        VNotebook *nb = g_vnote->getNotebook(path);
         if (nb) {
             g_mainWin->locateNotebook(nb);
         }
@@ -1,15 +1,20 @@
 #ifndef VSEARCHRESULTTREE_H
 #define VSEARCHRESULTTREE_H
 
+#include <QTreeView>
 #include <QIcon>
 
-#include "vtreewidget.h"
+#include "vsimplesearchinput.h"
 #include "vsearch.h"
 
 class QAction;
+class VSearchResultModel;
+class VStyledItemDelegate;
 
 
-class VSearchResultTree : public VTreeWidget
+// Results are held by VSearchResultModel so that a large number of hits
+// will not create a widget item for each of them.
+class VSearchResultTree : public QTreeView, public ISimpleSearch
 {
     Q_OBJECT
 public:
@@ -19,6 +24,21 @@ public:
 
     void clearResults();
 
+    // Implement ISimpleSearch.
+    // Only the top level items are searched.
+    virtual QList<void *> searchItems(const QString &p_text,
+                                      Qt::MatchFlags p_flags) const Q_DECL_OVERRIDE;
+
+    virtual void highlightHitItems(const QList<void *> &p_items) Q_DECL_OVERRIDE;
+
+    virtual void clearItemsHighlight() Q_DECL_OVERRIDE;
+
+    virtual void selectHitItem(void *p_item) Q_DECL_OVERRIDE;
+
+    virtual int totalNumberOfItems() Q_DECL_OVERRIDE;
+
+    virtual void selectNextItem(bool p_forward) Q_DECL_OVERRIDE;
+
 public slots:
     void addResultItem(const QSharedPointer<VSearchResultItem> &p_item);
 
@@ -29,6 +49,11 @@ public slots:
 signals:
     void countChanged(int p_count);
 
+protected:
+    void keyPressEvent(QKeyEvent *p_event) Q_DECL_OVERRIDE;
+
+    void resizeEvent(QResizeEvent *p_event) Q_DECL_OVERRIDE;
+
 private slots:
     void locateCurrentItem();
 
@@ -36,18 +61,23 @@ private slots:
 
     void pinSelectedItemsToHistory();
 
-private:
-    void appendItem(const QSharedPointer<VSearchResultItem> &p_item);
+    void handleSearchModeTriggered(bool p_inSearchMode, bool p_focus);
 
+private:
     void initActions();
 
-    VSearchResultItem::ItemType itemResultType(const QTreeWidgetItem *p_item) const;
+    void activateItem(const QModelIndex &p_index) const;
+
+    // Paths of selected notes.
+    QStringList selectedNotes() const;
+
+    void setSearchInputVisible(bool p_visible);
 
-    void activateItem(const QTreeWidgetItem *p_item) const;
+    VSearchResultModel *m_model;
 
-    const QSharedPointer<VSearchResultItem> &itemResultData(const QTreeWidgetItem *p_item) const;
+    VSimpleSearchInput *m_searchInput;
 
-    QVector<QSharedPointer<VSearchResultItem> > m_data;
+    VStyledItemDelegate *m_delegate;
 
     QIcon m_noteIcon;
     QIcon m_folderIcon;
@@ -0,0 +1,541 @@
+#include "vsearchtraverser.h"
+
+#include <QDir>
+#include <QDebug>
+
+#include "utils/vutils.h"
+
+// Min number of second phase items to post during traversal, so that the
+// engine could search them while the traversal is still going on.
+#define SECOND_PHASE_FEED_SIZE 32
+
+VSearchTraverser::VSearchTraverser(int p_stream,
+                                   const VSearchConfig &p_config,
+                                   bool p_ranking,
+                                   int p_rankingLimit,
+                                   QObject *p_parent)
+    : QThread(p_parent),
+      m_stream(p_stream),
+      m_config(p_config),
+      m_ranking(p_ranking),
+      m_ranker(p_rankingLimit),
+      m_source(Source::None),
+      m_manifestStale(false),
+      m_searchFolder(false),
+      m_stop(0),
+      m_state(VSearchState::Idle),
+      m_notified(false)
+{
+    m_slashReg = QRegExp("[\\/]");
+
+    if (!m_config.m_pattern.isEmpty()) {
+        m_patternReg = QRegExp(m_config.m_pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    }
+}
+
+void VSearchTraverser::setManifest(const VManifestSnapshot &p_snapshot,
+                                   const QString &p_relativePath,
+                                   bool p_searchFolder)
+{
+    m_source = Source::Manifest;
+    m_snapshot = p_snapshot;
+    m_basePath = p_snapshot.m_notebookPath;
+    m_relativePath = p_relativePath;
+    m_searchFolder = p_searchFolder;
+}
+
+void VSearchTraverser::setNotebook(const QString &p_notebookPath,
+                                   const QString &p_relativePath,
+                                   bool p_searchFolder)
+{
+    m_source = Source::Notebook;
+    m_basePath = p_notebookPath;
+    m_relativePath = p_relativePath;
+    m_searchFolder = p_searchFolder;
+}
+
+void VSearchTraverser::setDirectory(const QString &p_directoryPath)
+{
+    m_source = Source::Directory;
+    m_basePath = p_directoryPath;
+}
+
+void VSearchTraverser::stop()
+{
+    m_stop.store(1);
+}
+
+void VSearchTraverser::appendError(const QString &p_err)
+{
+    if (m_error.isEmpty()) {
+        m_error = p_err;
+    } else {
+        m_error += "\n" + p_err;
+    }
+}
+
+void VSearchTraverser::run()
+{
+    m_state = VSearchState::Busy;
+
+    switch (m_source) {
+    case Source::Manifest:
+        // Fall back to the tags in the folders if the tag index is stale.
+        if (m_config.m_object == VSearchConfig::Tag && isSnapshotUpToDate(m_relativePath)) {
+            searchTagIndex(m_relativePath);
+        } else {
+            searchFolder(m_relativePath, m_searchFolder);
+        }
+
+        break;
+
+    case Source::Notebook:
+        searchFolder(m_relativePath, m_searchFolder);
+        break;
+
+    case Source::Directory:
+        searchDirectory(m_basePath);
+        break;
+
+    default:
+        break;
+    }
+
+    postResults(true);
+
+    if (isStopped()) {
+        m_state = VSearchState::Cancelled;
+        qDebug() << "traverser of stream" << m_stream << "is asked to stop";
+    } else if (m_state == VSearchState::Busy) {
+        m_state = VSearchState::Success;
+    }
+}
+
+bool VSearchTraverser::fetchFolder(const QString &p_relativePath, VManifestFolder &p_folder)
+{
+    if (m_source == Source::Manifest) {
+        const VManifestFolder *folder = m_snapshot.findFolder(p_relativePath);
+        if (folder && !VManifestBuilder::configChanged(m_basePath, p_relativePath, *folder)) {
+            p_folder = *folder;
+            return true;
+        }
+
+        // A config not written yet is already in the manifest.
+        if (!folder || folder->m_configModifiedTime != -1) {
+            m_manifestStale = true;
+        }
+    }
+
+    return VManifestBuilder::readFolder(m_basePath, p_relativePath, p_folder);
+}
+
+bool VSearchTraverser::isSnapshotUpToDate(const QString &p_relativePath)
+{
+    const VManifestFolder *folder = m_snapshot.findFolder(p_relativePath);
+    if (!folder
+        || (folder->m_configModifiedTime != -1
+            && VManifestBuilder::configChanged(m_basePath, p_relativePath, *folder))) {
+        m_manifestStale = true;
+        return false;
+    }
+
+    for (auto const & sub : folder->m_subDirs) {
+        if (isStopped()) {
+            return true;
+        }
+
+        if (!isSnapshotUpToDate(VNotebookManifest::childPath(p_relativePath, sub))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QString VSearchTraverser::fetchPath(const QString &p_relativePath) const
+{
+    if (p_relativePath.isEmpty()) {
+        return m_basePath;
+    }
+
+    return QDir(m_basePath).filePath(p_relativePath);
+}
+
+void VSearchTraverser::searchFolder(const QString &p_relativePath, bool p_searchFolder)
+{
+    Q_ASSERT(testTarget(VSearchConfig::Note) || testTarget(VSearchConfig::Folder));
+
+    VManifestFolder folder;
+    if (!fetchFolder(p_relativePath, folder)) {
+        appendError(QString("Fail to read folder %1.").arg(fetchPath(p_relativePath)));
+        m_state = VSearchState::Fail;
+        return;
+    }
+
+    QString dirPath = fetchPath(p_relativePath);
+    if (p_searchFolder && testTarget(VSearchConfig::Folder)) {
+        if (testObject(VSearchConfig::Name)) {
+            searchForName(VSearchResultItem::Folder, folder.m_name, dirPath);
+        }
+
+        if (testObject(VSearchConfig::Path)) {
+            QString normPath(p_relativePath);
+            removeSlashFromPath(normPath);
+            if (matchNonContent(normPath)) {
+                addItem(new VSearchResultItem(VSearchResultItem::Folder,
+                                              VSearchResultItem::LineNumber,
+                                              folder.m_name,
+                                              dirPath));
+            }
+        }
+    }
+
+    // Search notes.
+    if (testTarget(VSearchConfig::Note)) {
+        QDir dir(dirPath);
+        for (auto const & note : folder.m_notes) {
+            if (isStopped()) {
+                return;
+            }
+
+            const QString &name = note.m_name;
+            if (!matchPattern(name)) {
+                continue;
+            }
+
+            QString notePath = VNotebookManifest::childPath(p_relativePath, name);
+            QString filePath = dir.filePath(name);
+            if (testObject(VSearchConfig::Name)) {
+                searchForName(VSearchResultItem::Note, name, filePath);
+            }
+
+            if (testObject(VSearchConfig::Path)) {
+                QString normFilePath(notePath);
+                removeSlashFromPath(normFilePath);
+                if (matchNonContent(normFilePath)) {
+                    addItem(new VSearchResultItem(VSearchResultItem::Note,
+                                                  VSearchResultItem::LineNumber,
+                                                  name,
+                                                  filePath));
+                }
+            }
+
+            if (testObject(VSearchConfig::Tag)) {
+                if (matchTags(note.m_tags)) {
+                    addItem(new VSearchResultItem(VSearchResultItem::Note,
+                                                  VSearchResultItem::LineNumber,
+                                                  name,
+                                                  filePath));
+                }
+            }
+
+            if (testObject(VSearchConfig::Outline)) {
+                VSearchResultItem *item = searchForOutline(notePath, filePath);
+                if (item) {
+                    addItem(item);
+                }
+            }
+
+            if (testObject(VSearchConfig::Content)) {
+                // Add an item for second phase process.
+                addSecondPhaseItem(filePath);
+            }
+        }
+    }
+
+    postResults();
+
+    // Search subfolders.
+    for (auto const & sub : folder.m_subDirs) {
+        if (isStopped()) {
+            return;
+        }
+
+        searchFolder(VNotebookManifest::childPath(p_relativePath, sub), true);
+    }
+}
+
+void VSearchTraverser::searchTagIndex(const QString &p_relativePath)
+{
+    if (!testTarget(VSearchConfig::Note)) {
+        return;
+    }
+
+    // A note matches if any of its tags matches, so we just test each tag once.
+    QSet<QString> notes;
+    const QHash<QString, QSet<QString>> &index = m_snapshot.m_tagIndex;
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        if (!it.key().isEmpty() && matchNonContent(it.key())) {
+            notes.unite(it.value());
+        }
+    }
+
+    QStringList sortedNotes = notes.toList();
+    sortedNotes.sort();
+
+    QString prefix;
+    if (!p_relativePath.isEmpty()) {
+        prefix = p_relativePath + '/';
+    }
+
+    QDir dir(m_basePath);
+    for (auto const & note : sortedNotes) {
+        if (!prefix.isEmpty() && !note.startsWith(prefix)) {
+            continue;
+        }
+
+        QString name = VUtils::fileNameFromPath(note);
+        if (!matchPattern(name)) {
+            continue;
+        }
+
+        addItem(new VSearchResultItem(VSearchResultItem::Note,
+                                      VSearchResultItem::LineNumber,
+                                      name,
+                                      dir.filePath(note)));
+    }
+}
+
+void VSearchTraverser::searchDirectory(const QString &p_directoryPath)
+{
+    Q_ASSERT(testTarget(VSearchConfig::Note) || testTarget(VSearchConfig::Folder));
+    Q_ASSERT(!p_directoryPath.isEmpty());
+
+    QDir dir(p_directoryPath);
+    if (!dir.exists()) {
+        appendError(QString("Directory %1 does not exist.").arg(p_directoryPath));
+        m_state = VSearchState::Fail;
+        return;
+    }
+
+    Q_ASSERT(dir.isAbsolute());
+
+    if (testTarget(VSearchConfig::Folder)) {
+        QString name = dir.dirName();
+        if (testObject(VSearchConfig::Name)) {
+            searchForName(VSearchResultItem::Folder, name, p_directoryPath);
+        }
+
+        if (testObject(VSearchConfig::Path)) {
+            QString normPath(QDir(m_basePath).relativeFilePath(p_directoryPath));
+            removeSlashFromPath(normPath);
+            if (matchNonContent(normPath)) {
+                addItem(new VSearchResultItem(VSearchResultItem::Folder,
+                                              VSearchResultItem::LineNumber,
+                                              name,
+                                              p_directoryPath));
+            }
+        }
+    }
+
+    if (testTarget(VSearchConfig::Note)) {
+        QStringList files = dir.entryList(QDir::Files);
+        for (auto const & file : files) {
+            if (isStopped()) {
+                return;
+            }
+
+            searchDirectoryFile(dir.absoluteFilePath(file));
+        }
+    }
+
+    postResults();
+
+    // Search subfolders.
+    QStringList subdirs = dir.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+    for (auto const & sub : subdirs) {
+        if (isStopped()) {
+            return;
+        }
+
+        searchDirectory(dir.absoluteFilePath(sub));
+    }
+}
+
+void VSearchTraverser::searchDirectoryFile(const QString &p_filePath)
+{
+    Q_ASSERT(testTarget(VSearchConfig::Note));
+
+    QString name = VUtils::fileNameFromPath(p_filePath);
+    if (!matchPattern(name)) {
+        return;
+    }
+
+    if (testObject(VSearchConfig::Name)) {
+        searchForName(VSearchResultItem::Note, name, p_filePath);
+    }
+
+    if (testObject(VSearchConfig::Path)) {
+        QString normFilePath(QDir(m_basePath).relativeFilePath(p_filePath));
+        removeSlashFromPath(normFilePath);
+        if (matchNonContent(normFilePath)) {
+            addItem(new VSearchResultItem(VSearchResultItem::Note,
+                                          VSearchResultItem::LineNumber,
+                                          name,
+                                          p_filePath));
+        }
+    }
+
+    if (testObject(VSearchConfig::Content)) {
+        // Add an item for second phase process.
+        addSecondPhaseItem(p_filePath);
+    }
+}
+
+void VSearchTraverser::searchForName(VSearchResultItem::ItemType p_type,
+                                     const QString &p_name,
+                                     const QString &p_path)
+{
+    if (!m_ranking) {
+        if (matchNonContent(p_name)) {
+            addItem(new VSearchResultItem(p_type,
+                                          VSearchResultItem::LineNumber,
+                                          p_name,
+                                          p_path));
+        }
+
+        return;
+    }
+
+    int score = m_config.m_token.score(p_name);
+    if (score < 0 || !m_ranker.accept(score)) {
+        return;
+    }
+
+    QSharedPointer<VSearchResultItem> pitem(new VSearchResultItem(p_type,
+                                                                  VSearchResultItem::LineNumber,
+                                                                  p_name,
+                                                                  p_path));
+    m_ranker.add(score, pitem);
+}
+
+VSearchResultItem *VSearchTraverser::searchForOutline(const QString &p_notePath,
+                                                      const QString &p_filePath)
+{
+    const VManifestOutline *outline = NULL;
+    if (m_source == Source::Manifest) {
+        outline = m_snapshot.findOutline(p_notePath);
+    }
+
+    VManifestOutline builtOutline;
+    if (!outline) {
+        if (!VNotebookManifest::buildOutline(p_filePath, builtOutline)) {
+            return NULL;
+        }
+
+        // Index it in the manifest once taken.
+        if (m_source == Source::Manifest) {
+            m_pendingOutlines.insert(p_notePath, builtOutline);
+        }
+
+        outline = &builtOutline;
+    }
+
+    VSearchResultItem *item = NULL;
+    for (auto const & it : outline->m_headings) {
+        if (!matchNonContent(it.m_text)) {
+            continue;
+        }
+
+        if (!item) {
+            item = new VSearchResultItem(VSearchResultItem::Note,
+                                         VSearchResultItem::LineNumber,
+                                         VUtils::fileNameFromPath(p_filePath),
+                                         p_filePath);
+        }
+
+        VSearchResultSubItem sitem(it.m_lineNumber, it.m_text);
+        item->m_matches.append(sitem);
+    }
+
+    return item;
+}
+
+bool VSearchTraverser::matchTags(const QStringList &p_tags) const
+{
+    for (auto const & tag: p_tags) {
+        if (tag.isEmpty()) {
+            continue;
+        }
+
+        if (matchNonContent(tag)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VSearchTraverser::addItem(VSearchResultItem *p_item)
+{
+    m_pendingItems.append(QSharedPointer<VSearchResultItem>(p_item));
+}
+
+void VSearchTraverser::addSecondPhaseItem(const QString &p_filePath)
+{
+    m_pendingSecondPhaseItems.append(p_filePath);
+    if (m_pendingSecondPhaseItems.size() >= SECOND_PHASE_FEED_SIZE) {
+        postResults(true);
+    }
+}
+
+void VSearchTraverser::postResults(bool p_force)
+{
+    if (m_pendingItems.isEmpty()
+        && m_pendingSecondPhaseItems.isEmpty()
+        && m_pendingOutlines.isEmpty()) {
+        return;
+    }
+
+    if (!p_force
+        && m_pendingItems.isEmpty()
+        && m_pendingSecondPhaseItems.size() < SECOND_PHASE_FEED_SIZE) {
+        return;
+    }
+
+    bool notify = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_items.append(m_pendingItems);
+        m_secondPhaseItems.append(m_pendingSecondPhaseItems);
+        for (auto it = m_pendingOutlines.constBegin(); it != m_pendingOutlines.constEnd(); ++it) {
+            m_outlines.insert(it.key(), it.value());
+        }
+
+        if (!m_notified) {
+            m_notified = true;
+            notify = true;
+        }
+    }
+
+    m_pendingItems.clear();
+    m_pendingSecondPhaseItems.clear();
+    m_pendingOutlines.clear();
+
+    // Only one notification is pending at a time. Results posted before it
+    // is handled are taken along.
+    if (notify) {
+        emit resultsReady();
+    }
+}
+
+void VSearchTraverser::takeResults(QList<QSharedPointer<VSearchResultItem> > &p_items,
+                                   QStringList &p_secondPhaseItems,
+                                   QHash<QString, VManifestOutline> &p_outlines)
+{
+    QMutexLocker locker(&m_mutex);
+    p_items = m_items;
+    p_secondPhaseItems = m_secondPhaseItems;
+    p_outlines = m_outlines;
+
+    m_items.clear();
+    m_secondPhaseItems.clear();
+    m_outlines.clear();
+    m_notified = false;
+}
+
+QVector<QPair<int, QSharedPointer<VSearchResultItem> > > VSearchTraverser::takeRankedItems()
+{
+    Q_ASSERT(isFinished());
+    return m_ranker.takeSortedWithScores();
+}
@@ -0,0 +1,252 @@
+#ifndef VSEARCHTRAVERSER_H
+#define VSEARCHTRAVERSER_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QRegExp>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QStringList>
+#include <QSharedPointer>
+
+#include "vsearchconfig.h"
+#include "vnotebookmanifest.h"
+
+// Walk through the folders of one notebook or directory in background to do
+// the first phase of a search, so that notebooks are traversed concurrently
+// and the GUI keeps responsive even on a slow file system.
+// Results are posted in batch and taken by VSearch in the GUI thread.
+class VSearchTraverser : public QThread
+{
+    Q_OBJECT
+public:
+    // @p_stream: stream of the engine to search the notes found.
+    // @p_config: copied since the tokens could not be shared between threads.
+    // @p_ranking: whether rank the results of name search by score.
+    VSearchTraverser(int p_stream,
+                     const VSearchConfig &p_config,
+                     bool p_ranking,
+                     int p_rankingLimit,
+                     QObject *p_parent = nullptr);
+
+    // Search folder @p_relativePath using the snapshot of the manifest.
+    // @p_searchFolder: whether test the folder itself as a target.
+    void setManifest(const VManifestSnapshot &p_snapshot,
+                     const QString &p_relativePath,
+                     bool p_searchFolder);
+
+    // Search folder @p_relativePath of notebook @p_notebookPath by reading
+    // the config of each folder.
+    void setNotebook(const QString &p_notebookPath,
+                     const QString &p_relativePath,
+                     bool p_searchFolder);
+
+    // Search directory @p_directoryPath which is not managed by VNote.
+    void setDirectory(const QString &p_directoryPath);
+
+    void stop();
+
+    int getStream() const;
+
+    // Take the results posted since last time.
+    // @p_outlines: outlines built for notes not indexed in the manifest,
+    // keyed by the relative path of the note.
+    void takeResults(QList<QSharedPointer<VSearchResultItem> > &p_items,
+                     QStringList &p_secondPhaseItems,
+                     QHash<QString, VManifestOutline> &p_outlines);
+
+    // Results of name search with their scores sorted from the best.
+    // Should be called after finished.
+    QVector<QPair<int, QSharedPointer<VSearchResultItem> > > takeRankedItems();
+
+    // Should be called after finished.
+    VSearchState getState() const;
+
+    const QString &getError() const;
+
+    // Whether any folder in the manifest is found changed since the snapshot.
+    // Should be called after finished.
+    bool isManifestStale() const;
+
+signals:
+    // Emitted once there are results to take.
+    void resultsReady();
+
+protected:
+    void run() Q_DECL_OVERRIDE;
+
+private:
+    enum class Source
+    {
+        None = 0,
+        Manifest,
+        Notebook,
+        Directory
+    };
+
+    bool isStopped() const;
+
+    void appendError(const QString &p_err);
+
+    // Read folder @p_relativePath from the manifest or its config.
+    // A folder in the manifest is read from its config instead if the config
+    // has been changed since the snapshot.
+    bool fetchFolder(const QString &p_relativePath, VManifestFolder &p_folder);
+
+    // Whether configs of folder @p_relativePath and its sub-folders are not
+    // changed since the snapshot.
+    bool isSnapshotUpToDate(const QString &p_relativePath);
+
+    QString fetchPath(const QString &p_relativePath) const;
+
+    // Search folder @p_relativePath recursively.
+    void searchFolder(const QString &p_relativePath, bool p_searchFolder);
+
+    // Search tags of notes in folder @p_relativePath recursively using the
+    // tag index of the manifest.
+    void searchTagIndex(const QString &p_relativePath);
+
+    // Search directory @p_directoryPath recursively.
+    void searchDirectory(const QString &p_directoryPath);
+
+    void searchDirectoryFile(const QString &p_filePath);
+
+    // Add a result item if @p_name matches.
+    void searchForName(VSearchResultItem::ItemType p_type,
+                       const QString &p_name,
+                       const QString &p_path);
+
+    // Search outline of note @p_notePath (relative path). Notes not indexed
+    // yet are parsed on the fly.
+    VSearchResultItem *searchForOutline(const QString &p_notePath, const QString &p_filePath);
+
+    void addItem(VSearchResultItem *p_item);
+
+    void addSecondPhaseItem(const QString &p_filePath);
+
+    // Post the collected results.
+    // @p_force: post even if there are only a few results.
+    void postResults(bool p_force = false);
+
+    bool testTarget(VSearchConfig::Target p_target) const;
+
+    bool testObject(VSearchConfig::Object p_object) const;
+
+    bool matchNonContent(const QString &p_text) const;
+
+    bool matchPattern(const QString &p_name) const;
+
+    bool matchTags(const QStringList &p_tags) const;
+
+    void removeSlashFromPath(QString &p_path);
+
+    int m_stream;
+
+    VSearchConfig m_config;
+
+    // Wildcard reg to for file name pattern.
+    QRegExp m_patternReg;
+
+    // Remove slashes.
+    QRegExp m_slashReg;
+
+    bool m_ranking;
+
+    VTopK<QSharedPointer<VSearchResultItem> > m_ranker;
+
+    Source m_source;
+
+    VManifestSnapshot m_snapshot;
+
+    bool m_manifestStale;
+
+    // Path of the notebook or directory to search.
+    QString m_basePath;
+
+    QString m_relativePath;
+
+    bool m_searchFolder;
+
+    QAtomicInt m_stop;
+
+    VSearchState m_state;
+
+    QString m_error;
+
+    // Results collected but not posted yet.
+    QList<QSharedPointer<VSearchResultItem> > m_pendingItems;
+
+    QStringList m_pendingSecondPhaseItems;
+
+    QHash<QString, VManifestOutline> m_pendingOutlines;
+
+    // Protect the posted results below which are shared with the GUI thread.
+    QMutex m_mutex;
+
+    QList<QSharedPointer<VSearchResultItem> > m_items;
+
+    QStringList m_secondPhaseItems;
+
+    QHash<QString, VManifestOutline> m_outlines;
+
+    // Whether resultsReady() is emitted and the results are not taken yet.
+    bool m_notified;
+};
+
+inline int VSearchTraverser::getStream() const
+{
+    return m_stream;
+}
+
+inline VSearchState VSearchTraverser::getState() const
+{
+    return m_state;
+}
+
+inline const QString &VSearchTraverser::getError() const
+{
+    return m_error;
+}
+
+inline bool VSearchTraverser::isManifestStale() const
+{
+    return m_manifestStale;
+}
+
+inline bool VSearchTraverser::isStopped() const
+{
+    return m_stop.load() == 1;
+}
+
+inline bool VSearchTraverser::testTarget(VSearchConfig::Target p_target) const
+{
+    return p_target & m_config.m_target;
+}
+
+inline bool VSearchTraverser::testObject(VSearchConfig::Object p_object) const
+{
+    return p_object & m_config.m_object;
+}
+
+inline bool VSearchTraverser::matchNonContent(const QString &p_text) const
+{
+    return m_config.m_token.matched(p_text);
+}
+
+inline bool VSearchTraverser::matchPattern(const QString &p_name) const
+{
+    if (m_patternReg.isEmpty()) {
+        return true;
+    }
+
+    return p_name.contains(m_patternReg);
+}
+
+inline void VSearchTraverser::removeSlashFromPath(QString &p_path)
+{
+    p_path.remove(m_slashReg);
+}
+#endif // VSEARCHTRAVERSER_H
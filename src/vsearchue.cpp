@@ -24,6 +24,9 @@ extern VMainWindow *g_mainWin;
 
 #define ITEM_NUM_TO_UPDATE_WIDGET 20
 
+// Max number of results of fuzzy name search.
+#define MAX_RANKED_RESULTS 100
+
 VSearchUE::VSearchUE(QObject *p_parent)
     : IUniversalEntry(p_parent),
       m_search(NULL),
@@ -76,6 +79,12 @@ QString VSearchUE::description(int p_id) const
     case ID::Outline_Note_Buffer:
         return tr("Search the outline of opened notes in buffer");
 
+    case ID::Outline_Note_AllNotebook:
+        return tr("Search the outline of notes in all the notebooks");
+
+    case ID::Outline_Note_CurrentNotebook:
+        return tr("Search the outline of notes in current notebook");
+
     case ID::Path_FolderNote_AllNotebook:
         return tr("Search the path of folders/notes in all the notebooks");
 
@@ -102,6 +111,7 @@ void VSearchUE::init()
     m_initialized = true;
 
     m_search = new VSearch(this);
+    m_search->setRankingLimit(MAX_RANKED_RESULTS);
     connect(m_search, &VSearch::resultItemAdded,
             this, &VSearchUE::handleSearchItemAdded);
     connect(m_search, &VSearch::resultItemsAdded,
@@ -154,6 +164,8 @@ QWidget *VSearchUE::widget(int p_id)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
         return m_treeWidget;
 
     default:
@@ -230,6 +242,14 @@ void VSearchUE::processCommand(int p_id, const QString &p_cmd)
         searchOutlineOfBuffer(p_cmd);
         break;
 
+    case ID::Outline_Note_AllNotebook:
+        searchOutlineOfNoteInAllNotebooks(p_cmd);
+        break;
+
+    case ID::Outline_Note_CurrentNotebook:
+        searchOutlineOfNoteInCurrentNotebook(p_cmd);
+        break;
+
     case ID::Path_FolderNote_AllNotebook:
         searchPathOfFolderNoteInAllNotebooks(p_cmd);
         break;
@@ -587,6 +607,48 @@ void VSearchUE::searchOutlineOfBuffer(const QString &p_cmd)
     }
 }
 
+void VSearchUE::searchOutlineOfNoteInAllNotebooks(const QString &p_cmd)
+{
+    if (p_cmd.isEmpty()) {
+        m_inSearch = false;
+        emit stateUpdated(State::Success);
+    } else {
+        m_search->clear();
+        QSharedPointer<VSearchConfig> config(new VSearchConfig(VSearchConfig::AllNotebooks,
+                                                               VSearchConfig::Outline,
+                                                               VSearchConfig::Note,
+                                                               VSearchConfig::Internal,
+                                                               VSearchConfig::NoneOption,
+                                                               p_cmd,
+                                                               QString()));
+        m_search->setConfig(config);
+        QSharedPointer<VSearchResult> result = m_search->search(g_vnote->getNotebooks());
+        handleSearchFinished(result);
+    }
+}
+
+void VSearchUE::searchOutlineOfNoteInCurrentNotebook(const QString &p_cmd)
+{
+    if (p_cmd.isEmpty()) {
+        m_inSearch = false;
+        emit stateUpdated(State::Success);
+    } else {
+        QVector<VNotebook *> notebooks;
+        notebooks.append(g_mainWin->getNotebookSelector()->currentNotebook());
+        m_search->clear();
+        QSharedPointer<VSearchConfig> config(new VSearchConfig(VSearchConfig::CurrentNotebook,
+                                                               VSearchConfig::Outline,
+                                                               VSearchConfig::Note,
+                                                               VSearchConfig::Internal,
+                                                               VSearchConfig::NoneOption,
+                                                               p_cmd,
+                                                               QString()));
+        m_search->setConfig(config);
+        QSharedPointer<VSearchResult> result = m_search->search(notebooks);
+        handleSearchFinished(result);
+    }
+}
+
 void VSearchUE::searchPathOfFolderNoteInAllNotebooks(const QString &p_cmd)
 {
     if (p_cmd.isEmpty()) {
@@ -672,6 +734,8 @@ void VSearchUE::handleSearchItemAdded(const QSharedPointer<VSearchResultItem> &p
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
         appendItemToTree(p_item);
         if (itemAdded > 50) {
             itemAdded = 0;
@@ -718,6 +782,8 @@ void VSearchUE::handleSearchItemsAdded(const QList<QSharedPointer<VSearchResultI
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
     {
         for (auto const & it : p_items) {
             appendItemToTree(it);
@@ -976,6 +1042,8 @@ void VSearchUE::selectNextItem(int p_id, bool p_forward)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
     {
         m_treeWidget->selectNextItem(p_forward);
         break;
@@ -1010,6 +1078,8 @@ void VSearchUE::activate(int p_id)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
     {
         activateItem(m_treeWidget->currentItem(), 0);
         break;
@@ -1037,6 +1107,8 @@ void VSearchUE::selectParentItem(int p_id)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
         m_treeWidget->selectParentItem();
         break;
 
@@ -1054,6 +1126,8 @@ void VSearchUE::toggleItemExpanded(int p_id)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
     {
         QTreeWidgetItem *item = m_treeWidget->currentItem();
         if (item) {
@@ -1151,6 +1225,8 @@ QString VSearchUE::currentItemFolder(int p_id)
     case ID::Content_Note_ExplorerDirectory:
     case ID::Content_Note_Buffer:
     case ID::Outline_Note_Buffer:
+    case ID::Outline_Note_AllNotebook:
+    case ID::Outline_Note_CurrentNotebook:
     {
         QTreeWidgetItem *item = m_treeWidget->currentItem();
         if (item) {
@@ -66,7 +66,13 @@ public:
         Path_FolderNote_CurrentNotebook,
 
         // Search content of the note in Explorer root directory.
-        Content_Note_ExplorerDirectory
+        Content_Note_ExplorerDirectory,
+
+        // Search outline of the note in all the notebooks.
+        Outline_Note_AllNotebook,
+
+        // Search outline of the note in current notebook.
+        Outline_Note_CurrentNotebook
     };
 
     explicit VSearchUE(QObject *p_parent = nullptr);
@@ -138,6 +144,10 @@ private:
 
     void searchOutlineOfBuffer(const QString &p_cmd);
 
+    void searchOutlineOfNoteInAllNotebooks(const QString &p_cmd);
+
+    void searchOutlineOfNoteInCurrentNotebook(const QString &p_cmd);
+
     void searchPathOfFolderNoteInAllNotebooks(const QString &p_cmd);
 
     void searchPathOfFolderNoteInCurrentNotebook(const QString &p_cmd);
@@ -7,7 +7,7 @@
 #include "vlistwidget.h"
 #include "vnotebook.h"
 #include "vconfigmanager.h"
-#include "vsearch.h"
+#include "vnotebookmanifest.h"
 #include "vnote.h"
 #include "vcart.h"
 #include "vhistorylist.h"
@@ -28,8 +28,7 @@ VTagExplorer::VTagExplorer(QWidget *p_parent)
     : QWidget(p_parent),
       m_uiInitialized(false),
       m_notebook(NULL),
-      m_notebookChanged(true),
-      m_search(NULL)
+      m_notebookChanged(true)
 {
 }
 
@@ -41,23 +40,32 @@ void VTagExplorer::setupUI()
 
     m_uiInitialized = true;
 
+    m_noteIcon = VIconUtils::treeViewIcon(":/resources/icons/note_item.svg");
+
     m_notebookLabel = new QLabel(tr("Tags"), this);
     m_notebookLabel->setProperty("TitleLabel", true);
 
+    m_matchAllCB = new QCheckBox(tr("Match all"), this);
+    m_matchAllCB->setToolTip(tr("List notes with all the selected tags instead of any of them"));
+    m_matchAllCB->setChecked(true);
+    connect(m_matchAllCB, &QCheckBox::stateChanged,
+            this, [this]() {
+                if (m_tagList->selectedItems().size() > 1) {
+                    activateSelectedTags();
+                }
+            });
+
+    QHBoxLayout *titleLayout = new QHBoxLayout();
+    titleLayout->addWidget(m_notebookLabel);
+    titleLayout->addStretch();
+    titleLayout->addWidget(m_matchAllCB);
+    titleLayout->setContentsMargins(0, 0, 0, 0);
+
     m_tagList = new VListWidget(this);
     m_tagList->setAttribute(Qt::WA_MacShowFocusRect, false);
+    m_tagList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     connect(m_tagList, &QListWidget::itemActivated,
-            this, [this](const QListWidgetItem *p_item) {
-                QString tag;
-                if (p_item) {
-                    tag = p_item->text();
-                }
-
-                bool ret = activateTag(tag);
-                if (ret && !tag.isEmpty() && m_fileList->count() == 0) {
-                    promptToRemoveEmptyTag(tag);
-                }
-            });
+            this, &VTagExplorer::activateSelectedTags);
 
     m_tagLabel = new QLabel(tr("Notes"), this);
     m_tagLabel->setProperty("TitleLabel", true);
@@ -87,7 +95,7 @@ void VTagExplorer::setupUI()
     m_splitter->setStretchFactor(1, 1);
 
     QVBoxLayout *mainLayout = new QVBoxLayout();
-    mainLayout->addWidget(m_notebookLabel);
+    mainLayout->addLayout(titleLayout);
     mainLayout->addWidget(m_splitter);
     mainLayout->setContentsMargins(0, 0, 0, 0);
 
@@ -119,6 +127,11 @@ void VTagExplorer::setNotebook(VNotebook *p_notebook)
 
     setupUI();
 
+    if (m_notebook) {
+        disconnect(m_notebook, &VNotebook::manifestLoaded,
+                   this, &VTagExplorer::activateSelectedTags);
+    }
+
     m_notebook = p_notebook;
     m_notebookChanged = true;
 
@@ -207,44 +220,63 @@ void VTagExplorer::updateTagLabel(const QString &p_tag)
     m_tagLabel->setToolTip(tooltip);
 }
 
-bool VTagExplorer::activateTag(const QString &p_tag)
+void VTagExplorer::activateSelectedTags()
 {
-    updateTagLabel(p_tag);
+    QStringList tags;
+    QList<QListWidgetItem *> items = m_tagList->selectedItems();
+    if (items.isEmpty() && m_tagList->currentItem()) {
+        items.append(m_tagList->currentItem());
+    }
+
+    for (auto const & it : items) {
+        tags << it->text();
+    }
+
+    bool ret = activateTags(tags);
+    if (ret && tags.size() == 1 && m_fileList->count() == 0) {
+        promptToRemoveEmptyTag(tags.first());
+    }
+}
+
+bool VTagExplorer::activateTags(const QStringList &p_tags)
+{
+    updateTagLabel(p_tags.join(QStringLiteral(", ")));
 
     m_fileList->clearAll();
 
-    if (p_tag.isEmpty()) {
+    if (p_tags.isEmpty() || !m_notebook) {
+        return false;
+    }
+
+    VNotebookManifest *manifest = m_notebook->getManifest();
+    if (!manifest) {
+        // Try again once it is loaded in background.
+        connect(m_notebook, &VNotebook::manifestLoaded,
+                this, &VTagExplorer::activateSelectedTags,
+                Qt::UniqueConnection);
+        g_mainWin->showStatusMessage(tr("Tags of notebook %1 are not available yet")
+                                       .arg(m_notebook->getName()));
         return false;
     }
 
-    // Search this tag within current notebook.
-    g_mainWin->showStatusMessage(tr("Searching for tag \"%1\"").arg(p_tag));
-
-    QVector<VNotebook *> notebooks;
-    notebooks.append(m_notebook);
-    getVSearch()->clear();
-    QSharedPointer<VSearchConfig> config(new VSearchConfig(VSearchConfig::CurrentNotebook,
-                                                           VSearchConfig::Tag,
-                                                           VSearchConfig::Note,
-                                                           VSearchConfig::Internal,
-                                                           VSearchConfig::CaseSensitive
-                                                           | VSearchConfig::WholeWordOnly,
-                                                           p_tag,
-                                                           QString()));
-    getVSearch()->setConfig(config);
-    QSharedPointer<VSearchResult> result = getVSearch()->search(notebooks);
-
-    bool ret = result->m_state == VSearchState::Success;
-    handleSearchFinished(result);
-
-    return ret;
+    QStringList notes = manifest->fetchNotesByTags(p_tags, m_matchAllCB->isChecked());
+    for (auto const & note : notes) {
+        appendItemToFileList(VUtils::fileNameFromPath(note),
+                             manifest->fetchPath(note));
+    }
+
+    g_mainWin->showStatusMessage(tr("%1 %2 found for tag \"%3\"")
+                                   .arg(notes.size())
+                                   .arg(notes.size() > 1 ? tr("notes") : tr("note"))
+                                   .arg(p_tags.join(QStringLiteral(", "))));
+    return true;
 }
 
 void VTagExplorer::updateTagList(const QStringList &p_tags)
 {
     // Clear.
     m_tagList->clearAll();
-    activateTag("");
+    activateTags(QStringList());
 
     for (auto const & tag : p_tags) {
         addTagItem(tag);
@@ -281,79 +313,15 @@ void VTagExplorer::restoreStateAndGeometry()
     }
 }
 
-void VTagExplorer::initVSearch()
-{
-    m_search = new VSearch(this);
-    connect(m_search, &VSearch::resultItemAdded,
-            this, &VTagExplorer::handleSearchItemAdded);
-    connect(m_search, &VSearch::resultItemsAdded,
-            this, &VTagExplorer::handleSearchItemsAdded);
-    connect(m_search, &VSearch::finished,
-            this, &VTagExplorer::handleSearchFinished);
-
-    m_noteIcon = VIconUtils::treeViewIcon(":/resources/icons/note_item.svg");
-}
-
-void VTagExplorer::handleSearchItemAdded(const QSharedPointer<VSearchResultItem> &p_item)
-{
-    appendItemToFileList(p_item);
-}
-
-void VTagExplorer::appendItemToFileList(const QSharedPointer<VSearchResultItem> &p_item)
+void VTagExplorer::appendItemToFileList(const QString &p_name, const QString &p_path)
 {
-    Q_ASSERT(p_item->m_type == VSearchResultItem::Note);
-
     QListWidgetItem *item = new QListWidgetItem(m_noteIcon,
-                                                p_item->m_text.isEmpty() ? p_item->m_path : p_item->m_text);
-    item->setData(Qt::UserRole, p_item->m_path);
-    item->setToolTip(p_item->m_path);
+                                                p_name.isEmpty() ? p_path : p_name);
+    item->setData(Qt::UserRole, p_path);
+    item->setToolTip(p_path);
     m_fileList->addItem(item);
 }
 
-void VTagExplorer::handleSearchItemsAdded(const QList<QSharedPointer<VSearchResultItem> > &p_items)
-{
-    for (auto const & it : p_items) {
-        appendItemToFileList(it);
-    }
-}
-
-void VTagExplorer::handleSearchFinished(const QSharedPointer<VSearchResult> &p_result)
-{
-    Q_ASSERT(p_result->m_state != VSearchState::Idle);
-    QString msg;
-    switch (p_result->m_state) {
-    case VSearchState::Busy:
-        // Only synchronized search.
-        Q_ASSERT(false);
-        msg = tr("Invalid busy state when searching for tag");
-        break;
-
-    case VSearchState::Success:
-        qDebug() << "search succeeded";
-        msg = tr("Search for tag succeeded");
-        break;
-
-    case VSearchState::Fail:
-        qDebug() << "search failed";
-        msg = tr("Search for tag failed");
-        break;
-
-    case VSearchState::Cancelled:
-        qDebug() << "search cancelled";
-        msg = tr("Search for tag calcelled");
-        break;
-
-    default:
-        break;
-    }
-
-    m_search->clear();
-
-    if (!msg.isEmpty()) {
-        g_mainWin->showStatusMessage(msg);
-    }
-}
-
 void VTagExplorer::openFileItem(QListWidgetItem *p_item) const
 {
     if (!p_item) {
@@ -3,15 +3,14 @@
 
 #include <QWidget>
 #include <QIcon>
-
-#include "vsearchconfig.h"
+#include <QStringList>
 
 class QLabel;
 class VListWidget;
 class QListWidgetItem;
 class QSplitter;
+class QCheckBox;
 class VNotebook;
-class VSearch;
 
 class VTagExplorer : public QWidget
 {
@@ -33,12 +32,6 @@ protected:
     void focusInEvent(QFocusEvent *p_event) Q_DECL_OVERRIDE;
 
 private slots:
-    void handleSearchItemAdded(const QSharedPointer<VSearchResultItem> &p_item);
-
-    void handleSearchItemsAdded(const QList<QSharedPointer<VSearchResultItem> > &p_items);
-
-    void handleSearchFinished(const QSharedPointer<VSearchResult> &p_result);
-
     void openFileItem(QListWidgetItem *p_item) const;
 
     void openSelectedFileItems() const;
@@ -64,18 +57,18 @@ private:
 
     void updateContent();
 
+    // List notes with tags @p_tags via the tag index of the notebook.
     // Return ture if succeeded.
-    bool activateTag(const QString &p_tag);
+    bool activateTags(const QStringList &p_tags);
+
+    // Activate selected tags.
+    void activateSelectedTags();
 
     void addTagItem(const QString &p_tag);
 
     void restoreStateAndGeometry();
 
-    VSearch *getVSearch() const;
-
-    void initVSearch();
-
-    void appendItemToFileList(const QSharedPointer<VSearchResultItem> &p_item);
+    void appendItemToFileList(const QString &p_name, const QString &p_path);
 
     QString getFilePath(const QListWidgetItem *p_item) const;
 
@@ -89,6 +82,9 @@ private:
 
     VListWidget *m_tagList;
 
+    // Whether notes should have all the selected tags.
+    QCheckBox *m_matchAllCB;
+
     VListWidget *m_fileList;
 
     QSplitter *m_splitter;
@@ -98,18 +94,6 @@ private:
     bool m_notebookChanged;
 
     QIcon m_noteIcon;
-
-    VSearch *m_search;
 };
 
-inline VSearch *VTagExplorer::getVSearch() const
-{
-    if (m_search) {
-        return m_search;
-    }
-
-    const_cast<VTagExplorer *>(this)->initVSearch();
-    return m_search;
-}
-
 #endif // VTAGEXPLORER_H
@@ -6,8 +6,11 @@
 #include <QTextLayout>
 #include <QPointF>
 #include <QFontMetrics>
+#include <QFontMetricsF>
+#include <QtMath>
 #include <QFont>
 #include <QPainter>
+#include <QDebug>
 
 #include "vimageresourcemanager2.h"
 #include "vtextedit.h"
@@ -16,12 +19,21 @@
 #define MARKER_THICKNESS        2
 #define MAX_INLINE_IMAGE_HEIGHT 400
 
+// Use lazy layout for documents with at least this number of blocks.
+#define LAZY_LAYOUT_MIN_BLOCKS 2000
+
+// Number of blocks above and below the visible range to layout in advance.
+#define LAZY_LAYOUT_PREFETCH_BLOCKS 50
+
+// Layouts out of the visible range are dropped once the layouted blocks
+// contain more chars than this.
+#define LAZY_LAYOUT_MAX_CHARS (512 * 1024)
+
 VTextDocumentLayout::VTextDocumentLayout(QTextDocument *p_doc,
                                          VImageResourceManager2 *p_imageMgr)
     : QAbstractTextDocumentLayout(p_doc),
       m_margin(p_doc->documentMargin()),
       m_width(0),
-      m_maximumWidthBlockNumber(-1),
       m_height(0),
       m_lineLeading(0),
       m_blockCount(0),
@@ -36,7 +48,13 @@ VTextDocumentLayout::VTextDocumentLayout(QTextDocument *p_doc,
       m_lastCursorBlockWidth(-1),
       m_highlightCursorLineBlock(false),
       m_cursorLineBlockBg("#C0C0C0"),
-      m_cursorLineBlockNumber(-1)
+      m_cursorLineBlockNumber(-1),
+      m_lazyLayout(false),
+      m_windowFirst(-1),
+      m_windowLast(-1),
+      m_layoutedChars(0),
+      m_estimatedCharWidth(0),
+      m_estimatedLineSpacing(0)
 {
 }
 
@@ -63,58 +81,6 @@ static void fillBackground(QPainter *p_painter,
     p_painter->restore();
 }
 
-void VTextDocumentLayout::blockRangeFromRect(const QRectF &p_rect,
-                                             int &p_first,
-                                             int &p_last) const
-{
-    if (p_rect.isNull()) {
-        p_first = 0;
-        p_last = m_blocks.size() - 1;
-        return;
-    }
-
-    if (document()->blockCount() != m_blocks.size()) {
-        p_first = -1;
-        p_last = -1;
-        return;
-    }
-
-    p_first = -1;
-    p_last = m_blocks.size() - 1;
-    int y = p_rect.y();
-    QTextBlock block = document()->firstBlock();
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.top() == y
-            || (info.top() < y && info.bottom() >= y)) {
-            p_first = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
-    }
-
-    if (p_first == -1) {
-        p_last = -1;
-        return;
-    }
-
-    y += p_rect.height();
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.bottom() > y) {
-            p_last = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
-    }
-}
-
 void VTextDocumentLayout::blockRangeFromRectBS(const QRectF &p_rect,
                                                int &p_first,
                                                int &p_last) const
@@ -137,57 +103,32 @@ void VTextDocumentLayout::blockRangeFromRectBS(const QRectF &p_rect,
     }
 
     int y = p_rect.bottom();
-    QTextBlock block = document()->findBlockByNumber(p_first);
 
-    if (m_blocks[p_first].top() == p_rect.top()
+    if (blockTop(p_first) == p_rect.top()
         && p_first > 0) {
         --p_first;
     }
 
-    p_last = m_blocks.size() - 1;
-    while (block.isValid()) {
-        const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
-
-        if (info.bottom() > y) {
-            p_last = block.blockNumber();
-            break;
-        }
-
-        block = block.next();
+    p_last = m_sizeTree.findByOffset(y);
+    if (p_last == -1) {
+        p_last = m_blocks.size() - 1;
     }
 }
 
 int VTextDocumentLayout::findBlockByPosition(const QPointF &p_point) const
 {
-    int first = 0, last = m_blocks.size() - 1;
-    int y = p_point.y();
-    while (first <= last) {
-        int mid = (first + last) / 2;
-        const BlockInfo &info = m_blocks[mid];
-        Q_ASSERT(info.hasOffset());
-        if (info.top() <= y && info.bottom() > y) {
-            // Found it.
-            return mid;
-        } else if (info.top() > y) {
-            last = mid - 1;
-        } else {
-            first = mid + 1;
-        }
-    }
-
-    int idx = previousValidBlockNumber(m_blocks.size());
-    if (y >= m_blocks[idx].bottom()) {
-        return idx;
+    if (m_blocks.isEmpty()) {
+        return -1;
     }
 
-    idx = nextValidBlockNumber(-1);
-    if (y < m_blocks[idx].top()) {
-        return idx;
+    int y = p_point.y();
+    int idx = m_sizeTree.findByOffset(y);
+    if (idx == -1) {
+        // Below the last block.
+        return m_blocks.size() - 1;
     }
 
-    Q_ASSERT(false);
-    return -1;
+    return idx;
 }
 
 void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_context)
@@ -201,7 +142,7 @@ void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_contex
 
     QTextDocument *doc = document();
     Q_ASSERT(doc->blockCount() == m_blocks.size());
-    QPointF offset(m_margin, m_blocks[first].top());
+    QPointF offset(m_margin, blockTop(first));
     QTextBlock block = doc->findBlockByNumber(first);
     QTextBlock lastBlock = doc->findBlockByNumber(last);
 
@@ -210,12 +151,15 @@ void VTextDocumentLayout::draw(QPainter *p_painter, const PaintContext &p_contex
 
     while (block.isValid()) {
         const BlockInfo &info = m_blocks[block.blockNumber()];
-        Q_ASSERT(info.hasOffset());
+        Q_ASSERT(info.isValid());
 
         const QRectF &rect = info.m_rect;
         QTextLayout *layout = block.layout();
 
-        if (!block.isVisible()) {
+        // Blocks with estimated heights are layouted by the view before
+        // painting via ensureBlocksLayouted(). Skip those not ready yet since
+        // drawing should not change the layout.
+        if (!block.isVisible() || layout->lineCount() == 0) {
             offset.ry() += rect.height();
             if (block == lastBlock) {
                 break;
@@ -372,9 +316,10 @@ int VTextDocumentLayout::hitTest(const QPointF &p_point, Qt::HitTestAccuracy p_a
 
     QTextBlock block = document()->findBlockByNumber(bn);
     Q_ASSERT(block.isValid());
+    const_cast<VTextDocumentLayout *>(this)->ensureBlockLayouted(block);
     QTextLayout *layout = block.layout();
     int off = 0;
-    QPointF pos = p_point - QPointF(m_margin, m_blocks[bn].top());
+    QPointF pos = p_point - QPointF(m_margin, blockTop(bn));
     for (int i = 0; i < layout->lineCount(); ++i) {
         QTextLine line = layout->lineAt(i);
         const QRectF lr = line.naturalTextRect();
@@ -415,11 +360,14 @@ QRectF VTextDocumentLayout::blockBoundingRect(const QTextBlock &p_block) const
         return QRectF();
     }
 
-    const BlockInfo &info = m_blocks[p_block.blockNumber()];
-    QRectF geo = info.m_rect.adjusted(0, info.m_offset, 0, info.m_offset);
-    Q_ASSERT(info.hasOffset());
+    // QTextCursor expects the lines of the block to be ready.
+    const_cast<VTextDocumentLayout *>(this)->ensureBlockLayouted(p_block);
 
-    return geo;
+    int num = p_block.blockNumber();
+    const BlockInfo &info = m_blocks[num];
+    Q_ASSERT(info.isValid());
+    qreal top = blockTop(num);
+    return info.m_rect.adjusted(0, top, 0, top);
 }
 
 void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_charsAdded)
@@ -430,32 +378,44 @@ void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_
     // Update the margin.
     m_margin = doc->documentMargin();
 
+    updateLazyLayout();
+
     int charsChanged = p_charsRemoved + p_charsAdded;
 
     QTextBlock changeStartBlock = doc->findBlock(p_from);
     // May be an invalid block.
     QTextBlock changeEndBlock = doc->findBlock(qMax(0, p_from + charsChanged));
 
+    // Blocks [startNumber, endNumber) are changed.
+    int startNumber = changeStartBlock.blockNumber();
+    int endNumber = changeEndBlock.isValid() ? changeEndBlock.blockNumber() + 1 : newBlockCount;
+
+    // Bottom of the changed blocks before the change.
+    int oldEndNumber = qBound(0, endNumber - (newBlockCount - m_blockCount), m_blocks.size());
+    qreal oldBottom = m_sizeTree.offset(oldEndNumber);
+
     bool needRelayout = false;
     if (changeStartBlock == changeEndBlock
         && newBlockCount == m_blockCount) {
         // Change single block internal only.
         QTextBlock block = changeStartBlock;
         if (block.isValid() && block.length()) {
-            QRectF oldBr = blockBoundingRect(block);
+            qreal oldHeight = m_blocks[block.blockNumber()].m_rect.height();
             clearBlockLayout(block);
             layoutBlock(block);
-            QRectF newBr = blockBoundingRect(block);
             // Only one block is affected.
-            if (newBr.height() == oldBr.height()) {
+            if (m_blocks[block.blockNumber()].m_rect.height() == oldHeight) {
                 // Update document size.
-                updateDocumentSizeWithOneBlockChanged(block.blockNumber());
+                updateDocumentSize();
 
                 emit updateBlock(block);
                 return;
             }
         }
     } else {
+        // Shift the blocks behind the change first.
+        updateBlockCount(newBlockCount, changeStartBlock.blockNumber());
+
         // Clear layout of all affected blocks.
         QTextBlock block = changeStartBlock;
         do {
@@ -470,13 +430,11 @@ void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_
         needRelayout = true;
     }
 
-    updateBlockCount(newBlockCount, changeStartBlock.blockNumber());
-
     if (needRelayout) {
         // Relayout all affected blocks.
         QTextBlock block = changeStartBlock;
         do {
-            layoutBlock(block);
+            layoutBlockLazily(block);
             if (block == changeEndBlock) {
                 break;
             }
@@ -487,9 +445,14 @@ void VTextDocumentLayout::documentChanged(int p_from, int p_charsRemoved, int p_
 
     updateDocumentSize();
 
-    // TODO: Update the view of all the blocks after changeStartBlock.
-    const BlockInfo &firstInfo = m_blocks[changeStartBlock.blockNumber()];
-    emit update(QRectF(0., firstInfo.m_offset, 1000000000., 1000000000.));
+    qreal top = blockTop(startNumber);
+    qreal bottom = m_sizeTree.offset(endNumber);
+    if (bottom != oldBottom) {
+        emit blocksMoved(oldBottom, bottom - oldBottom);
+    }
+
+    // Only the changed blocks need to be painted again.
+    emit update(QRectF(0., top, 1000000000., bottom - top));
 }
 
 void VTextDocumentLayout::clearBlockLayout(QTextBlock &p_block)
@@ -498,71 +461,32 @@ void VTextDocumentLayout::clearBlockLayout(QTextBlock &p_block)
     int num = p_block.blockNumber();
     if (num < m_blocks.size()) {
         m_blocks[num].reset();
-        clearOffsetFrom(num + 1);
-    }
-}
-
-void VTextDocumentLayout::clearOffsetFrom(int p_blockNumber)
-{
-    for (int i = p_blockNumber; i < m_blocks.size(); ++i) {
-        if (!m_blocks[i].hasOffset()) {
-            Q_ASSERT(validateBlocks());
-            break;
-        }
-
-        m_blocks[i].m_offset = -1;
+        m_sizeTree.setSize(num, 0, 0);
     }
 }
 
-void VTextDocumentLayout::fillOffsetFrom(int p_blockNumber)
+void VTextDocumentLayout::updateBlockCount(int p_count, int p_changeStartBlock)
 {
-    qreal offset = m_blocks[p_blockNumber].bottom();
-    for (int i = p_blockNumber + 1; i < m_blocks.size(); ++i) {
-        BlockInfo &info = m_blocks[i];
-        if (!info.m_rect.isNull()) {
-            info.m_offset = offset;
-            offset += info.m_rect.height();
-        } else {
-            break;
-        }
+    if (m_blockCount == p_count) {
+        return;
     }
-}
 
-bool VTextDocumentLayout::validateBlocks() const
-{
-    bool valid = true;
-    for (int i = 0; i < m_blocks.size(); ++i) {
-        const BlockInfo &info = m_blocks[i];
-        if (!info.hasOffset()) {
-            valid = false;
-        } else if (!valid) {
-            return false;
-        }
+    // Blocks within the change will be layouted again, so just insert or
+    // remove the difference after the start block. Blocks behind the change
+    // are shifted and keep their layout.
+    int diff = p_count - m_blockCount;
+    int idx = qBound(0, p_changeStartBlock + 1, m_blocks.size());
+    if (diff > 0) {
+        m_blocks.insert(idx, diff, BlockInfo());
+        m_sizeTree.insert(idx, diff);
+    } else {
+        diff = qMin(-diff, m_blocks.size() - idx);
+        m_blocks.remove(idx, diff);
+        m_sizeTree.remove(idx, diff);
     }
 
-    return true;
-}
-
-void VTextDocumentLayout::updateBlockCount(int p_count, int p_changeStartBlock)
-{
-    if (m_blockCount != p_count) {
-        m_blockCount = p_count;
-        m_blocks.resize(m_blockCount);
-
-        // Fix m_blocks.
-        QTextBlock block = document()->findBlockByNumber(p_changeStartBlock);
-        while (block.isValid()) {
-            BlockInfo &info = m_blocks[block.blockNumber()];
-            info.reset();
-
-            QRectF br = blockRectFromTextLayout(block);
-            if (!br.isNull()) {
-                info.m_rect = br;
-            }
-
-            block = block.next();
-        }
-    }
+    m_blockCount = p_count;
+    Q_ASSERT(m_blocks.size() == m_blockCount);
 }
 
 void VTextDocumentLayout::layoutBlock(const QTextBlock &p_block)
@@ -598,6 +522,154 @@ void VTextDocumentLayout::layoutBlock(const QTextBlock &p_block)
 
     // Update the info about this block.
     finishBlockLayout(p_block, markers, images);
+
+    if (m_lazyLayout) {
+        m_layoutedChars += p_block.length();
+    }
+}
+
+void VTextDocumentLayout::layoutBlockLazily(const QTextBlock &p_block)
+{
+    if (!m_lazyLayout
+        || isInLayoutWindow(p_block.blockNumber())
+        || !estimateBlock(p_block)) {
+        layoutBlock(p_block);
+    }
+}
+
+bool VTextDocumentLayout::estimateBlock(const QTextBlock &p_block)
+{
+    // The height of the previewed images is unknown without layout.
+    if (m_blockImageEnabled) {
+        VTextBlockData *blockData = dynamic_cast<VTextBlockData *>(p_block.userData());
+        if (blockData && !blockData->getPreviews().isEmpty()) {
+            return false;
+        }
+    }
+
+    QTextDocument *doc = document();
+    qreal textWidth = (p_block.length() - 1) * m_estimatedCharWidth;
+    int lineCount = 1;
+    qreal availableWidth = doc->pageSize().width();
+    if (availableWidth > 0) {
+        availableWidth -= (2 * m_margin + m_cursorMargin + m_cursorWidth);
+        if (availableWidth > 0 && textWidth > availableWidth) {
+            lineCount = qCeil(textWidth / availableWidth);
+            textWidth = availableWidth;
+        }
+    }
+
+    // Lines start at m_margin, just like layoutLines().
+    QRectF br(0, 0,
+              m_margin + textWidth + m_margin + m_cursorWidth,
+              lineCount * (m_lineLeading + m_estimatedLineSpacing));
+    if (!p_block.next().isValid()) {
+        br.adjust(0, 0, 0, m_margin);
+    }
+
+    const_cast<QTextBlock&>(p_block).setLineCount(p_block.isVisible() ? lineCount : 0);
+
+    int num = p_block.blockNumber();
+    BlockInfo &info = m_blocks[num];
+    info.reset();
+    info.m_rect = br;
+    m_sizeTree.setSize(num, br.width(), br.height());
+    return true;
+}
+
+void VTextDocumentLayout::ensureBlockLayouted(const QTextBlock &p_block)
+{
+    int num = p_block.blockNumber();
+    if (num < 0
+        || num >= m_blocks.size()
+        || !m_blocks[num].isValid()
+        || p_block.layout()->lineCount() > 0) {
+        return;
+    }
+
+    layoutBlock(p_block);
+    updateDocumentSize();
+}
+
+qreal VTextDocumentLayout::ensureBlocksLayouted(int p_first, int p_last)
+{
+    if (p_first < 0
+        || p_first >= m_blocks.size()
+        || document()->blockCount() != m_blocks.size()) {
+        return 0;
+    }
+
+    p_last = qBound(p_first, p_last, m_blocks.size() - 1);
+    m_windowFirst = qMax(0, p_first - LAZY_LAYOUT_PREFETCH_BLOCKS);
+    m_windowLast = qMin(m_blocks.size() - 1, p_last + LAZY_LAYOUT_PREFETCH_BLOCKS);
+
+    qreal oldTop = blockTop(p_first);
+    bool changed = false;
+    QTextBlock block = document()->findBlockByNumber(m_windowFirst);
+    while (block.isValid() && block.blockNumber() <= m_windowLast) {
+        if (block.layout()->lineCount() == 0
+            && m_blocks[block.blockNumber()].isValid()) {
+            layoutBlock(block);
+            changed = true;
+        }
+
+        block = block.next();
+    }
+
+    if (!changed) {
+        return 0;
+    }
+
+    dropInvisibleLayouts();
+
+    updateDocumentSize();
+
+    emit update(QRectF(0., blockTop(m_windowFirst), 1000000000., 1000000000.));
+
+    return blockTop(p_first) - oldTop;
+}
+
+void VTextDocumentLayout::dropInvisibleLayouts()
+{
+    if (!m_lazyLayout || m_layoutedChars <= LAZY_LAYOUT_MAX_CHARS) {
+        return;
+    }
+
+    int chars = 0;
+    for (QTextBlock block = document()->firstBlock(); block.isValid(); block = block.next()) {
+        QTextLayout *tl = block.layout();
+        if (tl->lineCount() == 0) {
+            continue;
+        }
+
+        if (isInLayoutWindow(block.blockNumber())
+            || !tl->preeditAreaText().isEmpty()) {
+            chars += block.length();
+            continue;
+        }
+
+        // The rect is kept as an exact estimate until it is layouted again.
+        block.clearLayout();
+    }
+
+    qDebug() << "drop block layouts out of the visible range" << m_layoutedChars << chars;
+    m_layoutedChars = chars;
+}
+
+void VTextDocumentLayout::updateLazyLayout()
+{
+    bool lazy = document()->blockCount() >= LAZY_LAYOUT_MIN_BLOCKS;
+    if (lazy != m_lazyLayout) {
+        m_lazyLayout = lazy;
+        m_layoutedChars = 0;
+    }
+
+    if (m_lazyLayout) {
+        // For estimateBlock() during this layout.
+        QFontMetricsF fm(document()->defaultFont());
+        m_estimatedCharWidth = fm.averageCharWidth();
+        m_estimatedLineSpacing = fm.lineSpacing();
+    }
 }
 
 qreal VTextDocumentLayout::layoutLines(const QTextBlock &p_block,
@@ -713,12 +785,7 @@ void VTextDocumentLayout::finishBlockLayout(const QTextBlock &p_block,
     info.reset();
     info.m_rect = blockRectFromTextLayout(p_block, &ipi);
     Q_ASSERT(!info.m_rect.isNull());
-    int pre = previousValidBlockNumber(num);
-    if (pre == -1) {
-        info.m_offset = 0;
-    } else if (m_blocks[pre].hasOffset()) {
-        info.m_offset = m_blocks[pre].bottom();
-    }
+    m_sizeTree.setSize(num, info.m_rect.width(), info.m_rect.height());
 
     bool hasImage = false;
     if (ipi.isValid()) {
@@ -743,53 +810,19 @@ void VTextDocumentLayout::finishBlockLayout(const QTextBlock &p_block,
 
         info.m_markers.append(mk);
     }
-
-    if (info.hasOffset()) {
-        fillOffsetFrom(num);
-    }
-}
-
-int VTextDocumentLayout::previousValidBlockNumber(int p_number) const
-{
-    return p_number >= 0 ? p_number - 1 : -1;
-}
-
-int VTextDocumentLayout::nextValidBlockNumber(int p_number) const
-{
-    if (p_number <= -1) {
-        return 0;
-    } else if (p_number >= m_blocks.size() - 1) {
-        return -1;
-    } else {
-        return p_number + 1;
-    }
 }
 
 void VTextDocumentLayout::updateDocumentSize()
 {
-    // The last valid block.
-    int idx = previousValidBlockNumber(m_blocks.size());
-    Q_ASSERT(idx > -1);
-    if (m_blocks[idx].hasOffset()) {
-        int oldHeight = m_height;
-        int oldWidth = m_width;
-
-        m_height = m_blocks[idx].bottom();
-
-        m_width = 0;
-        for (int i = 0; i < m_blocks.size(); ++i) {
-            const BlockInfo &info = m_blocks[i];
-            Q_ASSERT(info.hasOffset());
-            if (m_width < info.m_rect.width()) {
-                m_width = info.m_rect.width();
-                m_maximumWidthBlockNumber = i;
-            }
-        }
+    qreal oldHeight = m_height;
+    qreal oldWidth = m_width;
 
-        if (oldHeight != m_height
-            || oldWidth != m_width) {
-            emit documentSizeChanged(documentSize());
-        }
+    m_height = m_sizeTree.totalHeight();
+    m_width = m_sizeTree.maximumWidth();
+
+    if (oldHeight != m_height
+        || oldWidth != m_width) {
+        emit documentSizeChanged(documentSize());
     }
 }
 
@@ -855,20 +888,6 @@ QRectF VTextDocumentLayout::blockRectFromTextLayout(const QTextBlock &p_block,
     return br;
 }
 
-void VTextDocumentLayout::updateDocumentSizeWithOneBlockChanged(int p_blockNumber)
-{
-    const BlockInfo &info = m_blocks[p_blockNumber];
-    qreal width = info.m_rect.width();
-    if (width > m_width) {
-        m_width = width;
-        m_maximumWidthBlockNumber = p_blockNumber;
-        emit documentSizeChanged(documentSize());
-    } else if (width < m_width && p_blockNumber == m_maximumWidthBlockNumber) {
-        // Shrink the longest block.
-        updateDocumentSize();
-    }
-}
-
 void VTextDocumentLayout::setLineLeading(qreal p_leading)
 {
     if (p_leading >= 0) {
@@ -989,15 +1008,35 @@ void VTextDocumentLayout::relayout()
     // Update the margin.
     m_margin = doc->documentMargin();
 
+    updateLazyLayout();
+
     QTextBlock block = doc->lastBlock();
     while (block.isValid()) {
-        clearBlockLayout(block);
+        int num = block.blockNumber();
+        if (m_lazyLayout
+            && num < m_blocks.size()
+            && m_blocks[num].isValid()
+            && !isInLayoutWindow(num)) {
+            // Keep current height as an estimate so the view will not jump.
+            // It will be layouted when needed.
+            block.clearLayout();
+        } else {
+            clearBlockLayout(block);
+        }
+
         block = block.previous();
     }
 
+    if (m_lazyLayout) {
+        m_layoutedChars = 0;
+    }
+
     block = doc->firstBlock();
     while (block.isValid()) {
-        layoutBlock(block);
+        if (!m_blocks[block.blockNumber()].isValid()) {
+            layoutBlockLazily(block);
+        }
+
         block = block.next();
     }
 
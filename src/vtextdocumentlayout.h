@@ -7,6 +7,7 @@
 #include <QMap>
 
 #include "vconstants.h"
+#include "utils/vblocksizetree.h"
 
 class VImageResourceManager2;
 struct VPreviewedImageInfo;
@@ -76,10 +77,25 @@ public:
     // Request update block by block number.
     void updateBlockByNumber(int p_blockNumber);
 
+    // Whether blocks away from the visible range are given estimated heights
+    // instead of being layouted, which is used for large documents.
+    bool isLazyLayout() const;
+
+    // Layout the blocks around [@p_first, @p_last] which have not been
+    // layouted in lazy layout.
+    // Returns how much the top of block @p_first moves, by which the view
+    // should be scrolled to stay still.
+    qreal ensureBlocksLayouted(int p_first, int p_last);
+
 signals:
     // Emit to update current cursor block width if m_cursorBlockMode is enabled.
     void cursorBlockWidthUpdated(int p_width);
 
+    // Emitted when the blocks below @p_y are moved by @p_dy due to a document
+    // change. They are not requested to update, so the receiver should scroll
+    // their pixels or update them.
+    void blocksMoved(qreal p_y, qreal p_dy);
+
 protected:
     void documentChanged(int p_from, int p_charsRemoved, int p_charsAdded) Q_DECL_OVERRIDE;
 
@@ -122,33 +138,16 @@ private:
 
         void reset()
         {
-            m_offset = -1;
             m_rect = QRectF();
             m_markers.clear();
             m_images.clear();
         }
 
-        bool hasOffset() const
-        {
-            return m_offset > -1 && !m_rect.isNull();
-        }
-
-        qreal top() const
-        {
-            Q_ASSERT(hasOffset());
-            return m_offset;
-        }
-
-        qreal bottom() const
+        bool isValid() const
         {
-            Q_ASSERT(hasOffset());
-            return m_offset + m_rect.height();
+            return !m_rect.isNull();
         }
 
-        // Y offset of this block.
-        // -1 for invalid.
-        qreal m_offset;
-
         // The bounding rect of this block, including the margins.
         // Null for invalid.
         QRectF m_rect;
@@ -164,6 +163,28 @@ private:
 
     void layoutBlock(const QTextBlock &p_block);
 
+    // Layout @p_block, or estimate its height if it is away from the visible
+    // range in lazy layout.
+    void layoutBlockLazily(const QTextBlock &p_block);
+
+    // Give @p_block an estimated height from its length and the font metrics
+    // without layouting it.
+    // Returns false if it could not be estimated.
+    bool estimateBlock(const QTextBlock &p_block);
+
+    // Layout @p_block if it has an estimated height or its layout has been
+    // dropped. Update the document size if needed.
+    void ensureBlockLayouted(const QTextBlock &p_block);
+
+    // Drop the layouts of blocks out of the visible range once the layouted
+    // blocks exceed the budget. Their heights are kept.
+    void dropInvisibleLayouts();
+
+    // Switch lazy layout on or off according to the block count.
+    void updateLazyLayout();
+
+    bool isInLayoutWindow(int p_blockNumber) const;
+
     // Returns the total height of this block after layouting lines and inline
     // images.
     qreal layoutLines(const QTextBlock &p_block,
@@ -197,42 +218,31 @@ private:
                                       QVector<QPair<qreal, qreal>> &p_imageRange);
 
     // Clear the layout of @p_block.
-    // Also clear all the offset behind this block.
     void clearBlockLayout(QTextBlock &p_block);
 
-    // Clear the offset of all the blocks from @p_blockNumber.
-    void clearOffsetFrom(int p_blockNumber);
-
-    // Fill the offset filed from @p_blockNumber + 1.
-    void fillOffsetFrom(int p_blockNumber);
-
     // Update block count to @p_count due to document change.
-    // Maintain m_blocks.
+    // Maintain m_blocks and m_sizeTree.
     // @p_changeStartBlock is the block number of the start block in this change.
     void updateBlockCount(int p_count, int p_changeStartBlock);
 
-    bool validateBlocks() const;
-
     void finishBlockLayout(const QTextBlock &p_block,
                            const QVector<Marker> &p_markers,
                            const QVector<ImagePaintInfo> &p_images);
 
-    int previousValidBlockNumber(int p_number) const;
+    // Y offset of the top and bottom of block @p_blockNumber.
+    qreal blockTop(int p_blockNumber) const;
 
-    int nextValidBlockNumber(int p_number) const;
+    qreal blockBottom(int p_blockNumber) const;
 
-    // Update block count and m_blocks size.
+    // Update the document size from m_sizeTree.
     void updateDocumentSize();
 
     QVector<QTextLayout::FormatRange> formatRangeFromSelection(const QTextBlock &p_block,
                                                                const QVector<Selection> &p_selections) const;
 
-    // Get the block range [first, last] by rect @p_rect.
+    // Get the block range [first, last] by rect @p_rect via m_sizeTree.
     // @p_rect: a clip region in document coordinates. If null, returns all the blocks.
     // Return [-1, -1] if no valid block range found.
-    void blockRangeFromRect(const QRectF &p_rect, int &p_first, int &p_last) const;
-
-    // Binary search to get the block range [first, last] by @p_rect.
     void blockRangeFromRectBS(const QRectF &p_rect, int &p_first, int &p_last) const;
 
     // Return a rect from the layout.
@@ -242,10 +252,6 @@ private:
     QRectF blockRectFromTextLayout(const QTextBlock &p_block,
                                    ImagePaintInfo *p_image = NULL);
 
-    // Update document size when only block @p_blockNumber is changed and the height
-    // remain the same.
-    void updateDocumentSizeWithOneBlockChanged(int p_blockNumber);
-
     void adjustImagePaddingAndSize(const VPreviewedImageInfo *p_info,
                                    int p_maximumWidth,
                                    int &p_padding,
@@ -273,9 +279,6 @@ private:
     // Maximum width of the contents.
     qreal m_width;
 
-    // The block number of the block which contains the m_width.
-    int m_maximumWidthBlockNumber;
-
     // Height of all the document (all the blocks).
     qreal m_height;
 
@@ -293,6 +296,10 @@ private:
 
     QVector<BlockInfo> m_blocks;
 
+    // Heights and widths of m_blocks for the offsets and the document size.
+    // Blocks not layouted are of zero size.
+    VBlockSizeTree m_sizeTree;
+
     VImageResourceManager2 *m_imageMgr;
 
     bool m_blockImageEnabled;
@@ -319,8 +326,46 @@ private:
 
     // The block containing the cursor.
     int m_cursorLineBlockNumber;
+
+    bool m_lazyLayout;
+
+    // Blocks to keep layouted in lazy layout, which are the visible ones and
+    // those around them.
+    int m_windowFirst;
+
+    int m_windowLast;
+
+    // Number of chars of the blocks layouted in lazy layout.
+    // Some of them may have been dropped by others.
+    int m_layoutedChars;
+
+    // Metrics of the default font to estimate the blocks, updated by
+    // updateLazyLayout().
+    qreal m_estimatedCharWidth;
+
+    qreal m_estimatedLineSpacing;
 };
 
+inline qreal VTextDocumentLayout::blockTop(int p_blockNumber) const
+{
+    return m_sizeTree.offset(p_blockNumber);
+}
+
+inline qreal VTextDocumentLayout::blockBottom(int p_blockNumber) const
+{
+    return m_sizeTree.offset(p_blockNumber) + m_sizeTree.height(p_blockNumber);
+}
+
+inline bool VTextDocumentLayout::isLazyLayout() const
+{
+    return m_lazyLayout;
+}
+
+inline bool VTextDocumentLayout::isInLayoutWindow(int p_blockNumber) const
+{
+    return p_blockNumber >= m_windowFirst && p_blockNumber <= m_windowLast;
+}
+
 inline qreal VTextDocumentLayout::getLineLeading() const
 {
     return m_lineLeading;
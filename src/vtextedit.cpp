@@ -63,6 +63,9 @@ void VTextEdit::init()
 
     docLayout->setCursorWidth(m_defaultCursorWidth);
 
+    connect(docLayout, &VTextDocumentLayout::blocksMoved,
+            this, &VTextEdit::handleBlocksMoved);
+
     connect(docLayout, &VTextDocumentLayout::cursorBlockWidthUpdated,
             this, [this](int p_width) {
                 if (p_width != cursorWidth()
@@ -79,6 +82,12 @@ void VTextEdit::init()
             this, &VTextEdit::updateLineNumberAreaMargin);
     connect(this, &QTextEdit::textChanged,
             this, &VTextEdit::updateLineNumberArea);
+    // The layout does not layout blocks while painting, so layout the visible
+    // ones whenever they may change.
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &VTextEdit::layoutVisibleBlocks);
+    connect(doc, &QTextDocument::contentsChanged,
+            this, &VTextEdit::layoutVisibleBlocks);
     connect(verticalScrollBar(), &QScrollBar::valueChanged,
             this, &VTextEdit::updateLineNumberArea);
     connect(this, &QTextEdit::cursorPositionChanged,
@@ -88,6 +97,9 @@ void VTextEdit::init()
                     getLayout()->setCursorLineBlockNumber(cursor.block().blockNumber());
                 }
 
+                // The cursor may jump to blocks with estimated heights.
+                layoutVisibleBlocks();
+
                 updateLineNumberArea();
             });
 }
@@ -104,8 +116,27 @@ void VTextEdit::setLineLeading(qreal p_leading)
 
 void VTextEdit::resizeEvent(QResizeEvent *p_event)
 {
+    // Resizing relayouts all the blocks, which gets estimated heights in lazy
+    // layout. Keep the first visible block still.
+    VTextDocumentLayout *layout = getLayout();
+    int anchor = -1;
+    int anchorY = 0;
+    if (layout->isLazyLayout()) {
+        QTextBlock block = firstVisibleBlock();
+        if (block.isValid()) {
+            anchor = block.blockNumber();
+            anchorY = contentOffsetY() + (int)layout->blockBoundingRect(block).y();
+        }
+    }
+
     QTextEdit::resizeEvent(p_event);
 
+    if (anchor > -1) {
+        scrollBlockTopTo(anchor, anchorY);
+    }
+
+    layoutVisibleBlocks();
+
     if (m_lineNumberType != LineNumberType::None) {
         QRect rect = contentsRect();
         m_lineNumberArea->setGeometry(QRect(rect.left(),
@@ -350,12 +381,7 @@ bool VTextEdit::containsImage(const QString &p_imageName) const
 
 QSize VTextEdit::imageSize(const QString &p_imageName) const
 {
-    const QPixmap *img = m_imageMgr->findImage(p_imageName);
-    if (img) {
-        return img->size();
-    }
-
-    return QSize();
+    return m_imageMgr->imageSize(p_imageName);
 }
 
 void VTextEdit::addImage(const QString &p_imageName, const QPixmap &p_image)
@@ -365,6 +391,15 @@ void VTextEdit::addImage(const QString &p_imageName, const QPixmap &p_image)
     }
 }
 
+void VTextEdit::addImage(const QString &p_imageName,
+                         const QPixmap &p_image,
+                         const QSize &p_size)
+{
+    if (m_blockImageEnabled) {
+        m_imageMgr->addImage(p_imageName, p_image, p_size);
+    }
+}
+
 void VTextEdit::removeImage(const QString &p_imageName)
 {
     m_imageMgr->removeImage(p_imageName);
@@ -431,9 +466,69 @@ void VTextEdit::relayout()
 {
     getLayout()->relayout();
 
+    layoutVisibleBlocks();
+
     updateLineNumberArea();
 }
 
+void VTextEdit::layoutVisibleBlocks()
+{
+    VTextDocumentLayout *layout = getLayout();
+    if (!layout->isLazyLayout()) {
+        return;
+    }
+
+    int first, last;
+    visibleBlockRange(first, last);
+    if (first == -1) {
+        return;
+    }
+
+    // Blocks above the first visible one may change height.
+    int delta = qRound(layout->ensureBlocksLayouted(first, last));
+    if (delta != 0) {
+        QScrollBar *sb = verticalScrollBar();
+        sb->setValue(sb->value() + delta);
+    }
+}
+
+void VTextEdit::handleBlocksMoved(qreal p_y, qreal p_dy)
+{
+    QWidget *vp = viewport();
+    int y = contentOffsetY() + (int)p_y;
+    int dy = qRound(p_dy);
+
+    // The rect covers both the old and new positions of the moved pixels.
+    int top = qMax(0, y + qMin(0, dy));
+    if (top >= vp->height()) {
+        return;
+    }
+
+    QRect rect(0, top, vp->width(), vp->height() - top);
+    if (dy != p_dy || y != contentOffsetY() + p_y) {
+        // Pixels could not be moved by fractional offsets.
+        vp->update(rect);
+        return;
+    }
+
+    // The exposed area is updated by scroll().
+    vp->scroll(0, dy, rect);
+}
+
+void VTextEdit::scrollBlockTopTo(int p_blockNumber, int p_y)
+{
+    QTextBlock block = document()->findBlockByNumber(p_blockNumber);
+    if (!block.isValid()) {
+        return;
+    }
+
+    QScrollBar *sb = verticalScrollBar();
+    int y = contentOffsetY() + (int)getLayout()->blockBoundingRect(block).y();
+    if (y != p_y) {
+        sb->setValue(sb->value() + y - p_y);
+    }
+}
+
 void VTextEdit::setDisplayScaleFactor(qreal p_factor)
 {
     m_defaultCursorWidth = p_factor + 0.5;
@@ -52,6 +52,10 @@ public:
     // Add an image to the resources.
     void addImage(const QString &p_imageName, const QPixmap &p_image);
 
+    // Add an image laid out in @p_size to the resources.
+    // @p_image: could be null as a placeholder before it is decoded.
+    void addImage(const QString &p_imageName, const QPixmap &p_image, const QSize &p_size);
+
     // Remove an image from the resources.
     void removeImage(const QString &p_imageName);
 
@@ -91,7 +95,18 @@ private slots:
 
     void updateLineNumberArea();
 
+    // Layout the visible blocks whose heights are estimated in lazy layout,
+    // keeping the first visible block still.
+    void layoutVisibleBlocks();
+
+    // Scroll the pixels of the blocks below @p_y by @p_dy instead of painting
+    // them again.
+    void handleBlocksMoved(qreal p_y, qreal p_dy);
+
 private:
+    // Scroll to put the top of block @p_blockNumber at @p_y of the viewport.
+    void scrollBlockTopTo(int p_blockNumber, int p_y);
+
     VTextDocumentLayout *getLayout() const;
 
     VLineNumberArea *m_lineNumberArea;
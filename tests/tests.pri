@@ -0,0 +1,12 @@
+# Common settings of the unit tests.
+# Each test builds the sources under test from src directly.
+
+QT += testlib
+QT -= gui
+
+CONFIG += testcase console c++11
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/../src
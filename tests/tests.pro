@@ -0,0 +1,8 @@
+# Unit tests of VNote.
+# Run them by "make check" after building.
+
+TEMPLATE = subdirs
+
+SUBDIRS = veditjournal \
+    vchunkedlinereader \
+    vblocksizetree
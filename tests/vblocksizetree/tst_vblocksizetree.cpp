@@ -0,0 +1,218 @@
+#include <QtTest>
+#include <QVector>
+
+#include "utils/vblocksizetree.h"
+
+class TestVBlockSizeTree : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void empty();
+
+    void queries();
+
+    void skipZeroHeightBlocks();
+
+    void insertAndRemove();
+
+    void matchBruteForce();
+
+private:
+    // Compare all the queries of @p_tree with the brute force ones on
+    // @p_widths and @p_heights.
+    static void verify(const VBlockSizeTree &p_tree,
+                       const QVector<qreal> &p_widths,
+                       const QVector<qreal> &p_heights);
+
+    // Set the sizes of all the blocks of @p_tree.
+    static void setSizes(VBlockSizeTree &p_tree,
+                         const QVector<qreal> &p_widths,
+                         const QVector<qreal> &p_heights);
+};
+
+void TestVBlockSizeTree::setSizes(VBlockSizeTree &p_tree,
+                                  const QVector<qreal> &p_widths,
+                                  const QVector<qreal> &p_heights)
+{
+    p_tree.reset(p_heights.size());
+    for (int i = 0; i < p_heights.size(); ++i) {
+        p_tree.setSize(i, p_widths[i], p_heights[i]);
+    }
+}
+
+void TestVBlockSizeTree::verify(const VBlockSizeTree &p_tree,
+                                const QVector<qreal> &p_widths,
+                                const QVector<qreal> &p_heights)
+{
+    QCOMPARE(p_tree.count(), p_heights.size());
+
+    qreal off = 0;
+    qreal maxWidth = 0;
+    int maxWidthIndex = -1;
+    for (int i = 0; i < p_heights.size(); ++i) {
+        QCOMPARE(p_tree.height(i), p_heights[i]);
+        QCOMPARE(p_tree.offset(i), off);
+
+        // The block containing its top and the one before its bottom.
+        if (p_heights[i] > 0) {
+            QCOMPARE(p_tree.findByOffset(off), i);
+            QCOMPARE(p_tree.findByOffset(off + p_heights[i] - 0.5), i);
+        }
+
+        off += p_heights[i];
+
+        if (maxWidthIndex == -1 || p_widths[i] > maxWidth) {
+            maxWidth = p_widths[i];
+            maxWidthIndex = i;
+        }
+    }
+
+    QCOMPARE(p_tree.offset(p_heights.size()), off);
+    QCOMPARE(p_tree.totalHeight(), off);
+    QCOMPARE(p_tree.findByOffset(off), -1);
+    QCOMPARE(p_tree.maximumWidth(), maxWidth);
+    QCOMPARE(p_tree.maximumWidthIndex(), maxWidthIndex);
+}
+
+void TestVBlockSizeTree::empty()
+{
+    VBlockSizeTree tree;
+    verify(tree, QVector<qreal>(), QVector<qreal>());
+    QCOMPARE(tree.findByOffset(0), -1);
+
+    tree.reset(3);
+    verify(tree, QVector<qreal>(3, 0), QVector<qreal>(3, 0));
+
+    tree.reset(0);
+    verify(tree, QVector<qreal>(), QVector<qreal>());
+}
+
+void TestVBlockSizeTree::queries()
+{
+    const QVector<qreal> widths({ 5, 50, 50, 7, 1 });
+    const QVector<qreal> heights({ 10, 20, 15, 30, 40 });
+
+    VBlockSizeTree tree;
+    setSizes(tree, widths, heights);
+    verify(tree, widths, heights);
+
+    QCOMPARE(tree.offset(3), qreal(45));
+    QCOMPARE(tree.findByOffset(-5), 0);
+    QCOMPARE(tree.findByOffset(10), 1);
+    QCOMPARE(tree.findByOffset(114.5), 4);
+    QCOMPARE(tree.findByOffset(115), -1);
+
+    // The first one of the maximum width.
+    QCOMPARE(tree.maximumWidthIndex(), 1);
+
+    // Shrink the widest one.
+    tree.setSize(1, 6, 20);
+    QCOMPARE(tree.maximumWidth(), qreal(50));
+    QCOMPARE(tree.maximumWidthIndex(), 2);
+
+    tree.setSize(2, 6, 15);
+    QCOMPARE(tree.maximumWidth(), qreal(7));
+    QCOMPARE(tree.maximumWidthIndex(), 3);
+}
+
+void TestVBlockSizeTree::skipZeroHeightBlocks()
+{
+    const QVector<qreal> widths({ 1, 1, 1, 1, 1 });
+    const QVector<qreal> heights({ 10, 0, 0, 30, 0 });
+
+    VBlockSizeTree tree;
+    setSizes(tree, widths, heights);
+    verify(tree, widths, heights);
+
+    QCOMPARE(tree.findByOffset(9.5), 0);
+    QCOMPARE(tree.findByOffset(10), 3);
+    QCOMPARE(tree.findByOffset(40), -1);
+}
+
+void TestVBlockSizeTree::insertAndRemove()
+{
+    QVector<qreal> widths({ 5, 50, 7 });
+    QVector<qreal> heights({ 10, 20, 30 });
+
+    VBlockSizeTree tree;
+    setSizes(tree, widths, heights);
+
+    // Grow beyond the number of leaves.
+    tree.insert(1, 3);
+    widths.insert(1, 3, 0);
+    heights.insert(1, 3, 0);
+    verify(tree, widths, heights);
+    QCOMPARE(tree.findByOffset(10), 4);
+
+    tree.setSize(2, 60, 5);
+    widths[2] = 60;
+    heights[2] = 5;
+    verify(tree, widths, heights);
+
+    tree.insert(tree.count(), 1);
+    widths.append(0);
+    heights.append(0);
+    verify(tree, widths, heights);
+
+    tree.remove(0, 3);
+    widths.remove(0, 3);
+    heights.remove(0, 3);
+    verify(tree, widths, heights);
+    QCOMPARE(tree.maximumWidthIndex(), 1);
+
+    tree.remove(0, tree.count());
+    verify(tree, QVector<qreal>(), QVector<qreal>());
+}
+
+void TestVBlockSizeTree::matchBruteForce()
+{
+    // Linear congruential generator to get the same sizes on all platforms.
+    quint32 state = 1;
+    auto next = [&state](int p_bound) {
+        state = state * 1103515245U + 12345U;
+        return int((state >> 16) % p_bound);
+    };
+
+    QVector<qreal> widths;
+    QVector<qreal> heights;
+    VBlockSizeTree tree;
+    for (int round = 0; round < 200; ++round) {
+        int op = next(10);
+        if (op == 0) {
+            int idx = next(tree.count() + 1);
+            int cnt = next(5);
+            tree.insert(idx, cnt);
+            widths.insert(idx, cnt, 0);
+            heights.insert(idx, cnt, 0);
+        } else if (op == 1 && tree.count() > 0) {
+            int idx = next(tree.count());
+            int cnt = next(tree.count() - idx + 1);
+            tree.remove(idx, cnt);
+            widths.remove(idx, cnt);
+            heights.remove(idx, cnt);
+        } else if (tree.count() > 0) {
+            int idx = next(tree.count());
+            // Zero height for hidden blocks.
+            qreal width = next(100);
+            qreal height = next(4) == 0 ? 0 : next(50) + 1;
+            tree.setSize(idx, width, height);
+            widths[idx] = width;
+            heights[idx] = height;
+        } else {
+            tree.insert(0, 1 + next(8));
+            widths.insert(0, tree.count(), 0);
+            heights.insert(0, tree.count(), 0);
+        }
+
+        verify(tree, widths, heights);
+        if (QTest::currentTestFailed()) {
+            qWarning() << "mismatch at round" << round;
+            return;
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(TestVBlockSizeTree)
+
+#include "tst_vblocksizetree.moc"
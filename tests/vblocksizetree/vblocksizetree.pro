@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_vblocksizetree
+
+SOURCES += tst_vblocksizetree.cpp \
+    $$PWD/../../src/utils/vblocksizetree.cpp
+
+HEADERS += $$PWD/../../src/utils/vblocksizetree.h
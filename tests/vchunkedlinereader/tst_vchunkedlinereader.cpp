@@ -0,0 +1,192 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QTextCodec>
+
+#include "utils/vchunkedlinereader.h"
+
+// Size in bytes of each chunk read from the device by the reader.
+#define READ_CHUNK_SIZE (256 * 1024)
+
+class TestVChunkedLineReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void readLines_data();
+
+    void readLines();
+
+    void splitLongLine();
+
+    void keepShortMatchInOverlap();
+
+    void notSplitLineOfMaxLength();
+
+    void decodeCharAcrossChunks();
+
+    void joinEolAcrossChunks();
+
+private:
+    struct Line
+    {
+        QString m_text;
+
+        int m_lineNumber;
+
+        int m_column;
+    };
+
+    // Read all the lines of @p_reader.
+    static QVector<Line> readAll(VChunkedLineReader &p_reader);
+};
+
+QVector<TestVChunkedLineReader::Line> TestVChunkedLineReader::readAll(VChunkedLineReader &p_reader)
+{
+    QVector<Line> lines;
+    Line line;
+    while (p_reader.readLine(line.m_text, line.m_lineNumber)) {
+        line.m_column = p_reader.column();
+        lines.append(line);
+    }
+
+    return lines;
+}
+
+void TestVChunkedLineReader::readLines_data()
+{
+    QTest::addColumn<QString>("content");
+    QTest::addColumn<QStringList>("lines");
+
+    QTest::newRow("empty") << QString() << QStringList();
+    QTest::newRow("no eol") << QString("abc") << QStringList({ "abc" });
+    QTest::newRow("lf") << QString("a\nb\n") << QStringList({ "a", "b" });
+    QTest::newRow("crlf") << QString("a\r\nb\r\n") << QStringList({ "a", "b" });
+    QTest::newRow("cr") << QString("a\rb") << QStringList({ "a", "b" });
+    QTest::newRow("empty lines") << QString("\n\r\n\ra") << QStringList({ "", "", "", "a" });
+}
+
+void TestVChunkedLineReader::readLines()
+{
+    QFETCH(QString, content);
+    QFETCH(QStringList, lines);
+
+    VChunkedLineReader reader(content);
+    QVector<Line> got = readAll(reader);
+    QCOMPARE(got.size(), lines.size());
+    for (int i = 0; i < got.size(); ++i) {
+        QCOMPARE(got[i].m_text, lines[i]);
+        QCOMPARE(got[i].m_lineNumber, i + 1);
+        QCOMPARE(got[i].m_column, 0);
+    }
+
+    QVERIFY(reader.atEnd());
+    QCOMPARE(reader.lineCount(), lines.size());
+}
+
+void TestVChunkedLineReader::splitLongLine()
+{
+    const QString longLine("abcdefghijklmnopqrstuvwxyz");
+    VChunkedLineReader reader("first\n" + longLine + "\nlast");
+    reader.setMaxLineLength(10, 3);
+
+    QVector<Line> got = readAll(reader);
+    QCOMPARE(got.size(), 6);
+
+    QCOMPARE(got[0].m_text, QString("first"));
+    QCOMPARE(got[0].m_lineNumber, 1);
+
+    // Segments of the same line overlapping each other by 3 chars.
+    const int columns[] = { 0, 7, 14, 21 };
+    for (int i = 0; i < 4; ++i) {
+        const Line &seg = got[i + 1];
+        QCOMPARE(seg.m_lineNumber, 2);
+        QCOMPARE(seg.m_column, columns[i]);
+        QCOMPARE(seg.m_text, longLine.mid(columns[i], 10));
+        if (i > 0) {
+            QCOMPARE(seg.m_text.left(3), got[i].m_text.right(3));
+        }
+    }
+
+    QCOMPARE(got[5].m_text, QString("last"));
+    QCOMPARE(got[5].m_lineNumber, 3);
+    QCOMPARE(got[5].m_column, 0);
+}
+
+void TestVChunkedLineReader::keepShortMatchInOverlap()
+{
+    // Every match not longer than the overlap is within one segment.
+    for (int pos = 90; pos <= 110; ++pos) {
+        QString line(206, QChar('a'));
+        line.replace(pos, 6, "needle");
+
+        VChunkedLineReader reader(line);
+        reader.setMaxLineLength(16, 6);
+
+        bool found = false;
+        for (auto const & seg : readAll(reader)) {
+            int idx = seg.m_text.indexOf("needle");
+            if (idx != -1) {
+                QCOMPARE(seg.m_column + idx, pos);
+                found = true;
+            }
+        }
+
+        QVERIFY2(found, qPrintable(QString("match at %1 is split").arg(pos)));
+    }
+}
+
+void TestVChunkedLineReader::notSplitLineOfMaxLength()
+{
+    VChunkedLineReader reader(QString("0123456789\r\nabc"));
+    reader.setMaxLineLength(10, 3);
+
+    QVector<Line> got = readAll(reader);
+    QCOMPARE(got.size(), 2);
+    QCOMPARE(got[0].m_text, QString("0123456789"));
+    QCOMPARE(got[1].m_text, QString("abc"));
+    QCOMPARE(got[1].m_lineNumber, 2);
+}
+
+void TestVChunkedLineReader::decodeCharAcrossChunks()
+{
+    // A 3-byte char split by the chunk boundary.
+    const QByteArray ch("\xe4\xbd\xa0");
+    QByteArray data(READ_CHUNK_SIZE - 1, 'a');
+    data += ch + "\nend";
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    VChunkedLineReader reader(&buffer, QTextCodec::codecForName("UTF-8"));
+    reader.setMaxLineLength(2 * READ_CHUNK_SIZE, 0);
+
+    QVector<Line> got = readAll(reader);
+    QCOMPARE(got.size(), 2);
+    QCOMPARE(got[0].m_text.size(), READ_CHUNK_SIZE);
+    QCOMPARE(got[0].m_text.right(1), QString::fromUtf8(ch));
+    QCOMPARE(got[1].m_text, QString("end"));
+    QVERIFY(reader.atEnd());
+}
+
+void TestVChunkedLineReader::joinEolAcrossChunks()
+{
+    // "\r" ends the first chunk and "\n" starts the second one.
+    QByteArray data(READ_CHUNK_SIZE - 1, 'a');
+    data += "\r\nb";
+
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+
+    VChunkedLineReader reader(&buffer, QTextCodec::codecForName("UTF-8"));
+    reader.setMaxLineLength(2 * READ_CHUNK_SIZE, 0);
+
+    QVector<Line> got = readAll(reader);
+    QCOMPARE(got.size(), 2);
+    QCOMPARE(got[0].m_text.size(), READ_CHUNK_SIZE - 1);
+    QCOMPARE(got[1].m_text, QString("b"));
+    QCOMPARE(got[1].m_lineNumber, 2);
+}
+
+QTEST_APPLESS_MAIN(TestVChunkedLineReader)
+
+#include "tst_vchunkedlinereader.moc"
@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_vchunkedlinereader
+
+SOURCES += tst_vchunkedlinereader.cpp \
+    $$PWD/../../src/utils/vchunkedlinereader.cpp
+
+HEADERS += $$PWD/../../src/utils/vchunkedlinereader.h
@@ -0,0 +1,235 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "utils/veditjournal.h"
+
+class TestVEditJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void cleanup();
+
+    void replaySnapshot();
+
+    void replayChanges();
+
+    void replayMultiByteText();
+
+    void dropTornRecord();
+
+    void stopAtCorruptedRecord();
+
+    void failWithoutSnapshot();
+
+    void breakOnInvalidChange();
+
+    void compact();
+
+private:
+    // Append @p_data to file @p_filePath.
+    static void appendToFile(const QString &p_filePath, const QByteArray &p_data);
+
+    // Flip the byte at @p_offset from the end of file @p_filePath.
+    static void flipByteFromEnd(const QString &p_filePath, int p_offset);
+
+    QTemporaryDir *m_dir;
+
+    QString m_filePath;
+};
+
+void TestVEditJournal::init()
+{
+    m_dir = new QTemporaryDir();
+    QVERIFY(m_dir->isValid());
+    m_filePath = m_dir->filePath("note.md.vswp");
+}
+
+void TestVEditJournal::cleanup()
+{
+    delete m_dir;
+    m_dir = NULL;
+}
+
+void TestVEditJournal::appendToFile(const QString &p_filePath, const QByteArray &p_data)
+{
+    QFile file(p_filePath);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+    QCOMPARE(file.write(p_data), qint64(p_data.size()));
+}
+
+void TestVEditJournal::flipByteFromEnd(const QString &p_filePath, int p_offset)
+{
+    QFile file(p_filePath);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    QVERIFY(data.size() >= p_offset);
+    data[data.size() - p_offset] = data[data.size() - p_offset] ^ 0x5A;
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(data), qint64(data.size()));
+}
+
+void TestVEditJournal::replaySnapshot()
+{
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "hello world"));
+    QCOMPARE(journal.getFilePath(), m_filePath);
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("hello world"));
+}
+
+void TestVEditJournal::replayChanges()
+{
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "hello world"));
+
+    // Insert.
+    journal.addChange(5, ",", 12);
+    // Replace "world".
+    journal.addChange(7, "there", 12);
+    // Remove "hello, ".
+    journal.addChange(0, QString(), 5);
+    QVERIFY(journal.flush());
+
+    // Changes are appended by later flushes.
+    journal.addChange(5, "!", 6);
+    QVERIFY(journal.flush());
+    QVERIFY(!journal.needsCompaction());
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("there!"));
+}
+
+void TestVEditJournal::replayMultiByteText()
+{
+    const QString snapshot = QString::fromUtf8("\xe4\xbd\xa0\xe5\xa5\xbd");
+    const QString inserted = QString::fromUtf8(" \xe4\xb8\x96\xe7\x95\x8c");
+
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", snapshot));
+    journal.addChange(snapshot.size(), inserted, snapshot.size() + inserted.size());
+    QVERIFY(journal.flush());
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, snapshot + inserted);
+}
+
+void TestVEditJournal::dropTornRecord()
+{
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "abc"));
+    journal.addChange(3, "d", 4);
+    QVERIFY(journal.flush());
+
+    // Less than the length and checksum of a record.
+    appendToFile(m_filePath, QByteArray("\x00\x00", 2));
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("abcd"));
+
+    // Length of a record larger than the rest of the file.
+    QString filePath = m_dir->filePath("torn.vswp");
+    QVERIFY(journal.start(filePath, "head", "abc"));
+    journal.addChange(3, "d", 4);
+    QVERIFY(journal.flush());
+    appendToFile(filePath, QByteArray("\x00\x00\x01\x00xyzxyzxy", 12));
+
+    content.clear();
+    QVERIFY(VEditJournal::replay(filePath, content));
+    QCOMPARE(content, QString("abcd"));
+}
+
+void TestVEditJournal::stopAtCorruptedRecord()
+{
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "abc"));
+    journal.addChange(3, "d", 4);
+    journal.addChange(4, "e", 5);
+    QVERIFY(journal.flush());
+
+    // Break the checksum of the last change.
+    flipByteFromEnd(m_filePath, 1);
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("abcd"));
+}
+
+void TestVEditJournal::failWithoutSnapshot()
+{
+    appendToFile(m_filePath, "head\n");
+
+    QString content;
+    QVERIFY(!VEditJournal::replay(m_filePath, content));
+
+    // A broken snapshot is no snapshot.
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "abc"));
+    flipByteFromEnd(m_filePath, 1);
+    QVERIFY(!VEditJournal::replay(m_filePath, content));
+
+    QVERIFY(!VEditJournal::replay(m_dir->filePath("missing.vswp"), content));
+}
+
+void TestVEditJournal::breakOnInvalidChange()
+{
+    VEditJournal journal;
+    QVERIFY(journal.start(m_filePath, "head", "abc"));
+    QVERIFY(!journal.needsCompaction());
+
+    // Remove beyond the end.
+    journal.addChange(2, QString(), 0);
+    QVERIFY(journal.needsCompaction());
+
+    // Later changes are not recorded.
+    journal.addChange(0, "x", 4);
+    QVERIFY(journal.flush());
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("abc"));
+}
+
+void TestVEditJournal::compact()
+{
+    VEditJournal journal;
+    QVERIFY(journal.needsCompaction());
+
+    QVERIFY(journal.start(m_filePath, "head", "abc"));
+
+    // Changes larger than the snapshot and 1MB.
+    const QString text(512 * 1024, QChar('x'));
+    int length = 3;
+    for (int i = 0; i < 3; ++i) {
+        journal.addChange(length, text, length + text.size());
+        length += text.size();
+    }
+
+    QVERIFY(journal.needsCompaction());
+    QVERIFY(journal.flush());
+
+    QString content;
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content.size(), length);
+
+    // A new snapshot replaces the journal.
+    QVERIFY(journal.start(m_filePath, "head", content));
+    QVERIFY(!journal.needsCompaction());
+    journal.addChange(0, QString(), 3);
+    QVERIFY(journal.flush());
+
+    QVERIFY(VEditJournal::replay(m_filePath, content));
+    QCOMPARE(content, QString("xxx"));
+}
+
+QTEST_APPLESS_MAIN(TestVEditJournal)
+
+#include "tst_veditjournal.moc"
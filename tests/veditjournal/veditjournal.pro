@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_veditjournal
+
+SOURCES += tst_veditjournal.cpp \
+    $$PWD/../../src/utils/veditjournal.cpp
+
+HEADERS += $$PWD/../../src/utils/veditjournal.h